@@ -0,0 +1,396 @@
+#include "AgeBaudNegotiator.h"
+#include <QDebug>
+#include <QSettings>
+#include <QThread>
+#include <cstring>
+#include <memory>
+#include "AgeMotionDriver.h"
+
+namespace {
+
+constexpr int DRIVER_NAME_WORDS = 16;
+
+std::unique_ptr<QSettings> openSettings(const AgeBaudNegotiator::Options &options)
+{
+    if (options.settingsFile.isEmpty()) return std::unique_ptr<QSettings>(new QSettings("AutoFocus", "AgeMotion"));
+    return std::unique_ptr<QSettings>(new QSettings(options.settingsFile, QSettings::IniFormat));
+}
+
+} // namespace
+
+AgeBaudNegotiator::AgeBaudNegotiator()
+{
+}
+
+AgeBaudNegotiator::AgeBaudNegotiator(const Options &options)
+    : m_options(options)
+{
+}
+
+void AgeBaudNegotiator::attach(AgeTransport *transport, const QVector<quint8> &stations)
+{
+    m_transport = transport;
+    m_stations = stations;
+    m_references.clear();
+    m_lastRxFrames = -1;
+    m_badWindows = 0;
+}
+
+int AgeBaudNegotiator::currentBaud()
+{
+    DWORD baud = 0;
+    WORD parity = 0;
+    if (!m_transport || !m_transport->getSerialConfig(baud, parity)) return 0;
+    return (int)baud;
+}
+
+// ==========================================
+//          基本操作
+// ==========================================
+
+bool AgeBaudNegotiator::setHost(int baud)
+{
+    if (!m_transport->setSerialConfig((DWORD)baud, m_options.parity)) {
+        m_lastError = m_transport->lastError();
+        return false;
+    }
+    return true;
+}
+
+// 主机能否使用该波特率 (试设后恢复)
+bool AgeBaudNegotiator::hostSupports(int baud)
+{
+    const int current = currentBaud();
+    const bool ok = setHost(baud);
+    setHost(current);
+    return ok;
+}
+
+// 站号寄存器读回自身站号，比单纯有应答更能排除错位帧
+bool AgeBaudNegotiator::ping(quint8 station, int attempts)
+{
+    for (int i = 0; i < qMax(1, attempts); ++i) {
+        WORD value = 0;
+        if (m_transport->readWORD(station, AgeReg::ADDR_BUS_ADDR, value, 0) && value == station) return true;
+    }
+    return false;
+}
+
+bool AgeBaudNegotiator::writeBaud(quint8 station, int baud)
+{
+    for (int i = 0; i < qMax(1, m_options.writeRetries); ++i) {
+        if (m_transport->writeDWORD(station, AgeReg::ADDR_BUS_BAUD, (DWORD)baud, 0)) return true;
+    }
+    m_lastError = QString("Station %1: writing %2 baud failed: %3")
+                      .arg((int)station).arg(baud).arg(m_transport->lastError());
+    return false;
+}
+
+void AgeBaudNegotiator::settle()
+{
+    if (m_options.settleMs > 0) QThread::msleep((unsigned long)m_options.settleMs);
+}
+
+QList<int> AgeBaudNegotiator::searchOrder(int preferred)
+{
+    QList<int> order;
+    auto add = [&order](int baud) { if (baud > 0 && !order.contains(baud)) order.append(baud); };
+    add(preferred);
+    add(m_options.defaultBaud);
+    add(currentBaud());
+    for (int i = m_options.candidates.size() - 1; i >= 0; --i) add(m_options.candidates[i]);
+    return order;
+}
+
+// ==========================================
+//          回环校验
+// ==========================================
+
+bool AgeBaudNegotiator::captureReferences()
+{
+    m_references.clear();
+    for (quint8 station : m_stations) {
+        Reference ref;
+        bool ok = false;
+        for (int i = 0; i < qMax(1, m_options.writeRetries) && !ok; ++i) {
+            ok = m_transport->readMWORD(station, AgeReg::ADDR_DRIVER_NAME, ref.name, DRIVER_NAME_WORDS, 0)
+                 && m_transport->readQWORD(station, AgeReg::ADDR_MOTOR_SN0, ref.serial, 0);
+        }
+        if (!ok) {
+            m_lastError = QString("Station %1: reading reference failed: %2").arg((int)station).arg(m_transport->lastError());
+            return false;
+        }
+        m_references.insert(station, ref);
+    }
+    return true;
+}
+
+// 每轮每站: 型号 (16 字)、序列号、波特率寄存器，与参考值逐字比较
+bool AgeBaudNegotiator::loopback(int baud)
+{
+    for (int round = 0; round < m_options.loopbackRounds; ++round) {
+        for (quint8 station : m_stations) {
+            const Reference &ref = m_references[station];
+            WORD name[DRIVER_NAME_WORDS] = {};
+            QWORD serial = 0;
+            DWORD value = 0;
+            const bool ok = m_transport->readMWORD(station, AgeReg::ADDR_DRIVER_NAME, name, DRIVER_NAME_WORDS, 0)
+                            && std::memcmp(name, ref.name, sizeof(name)) == 0
+                            && m_transport->readQWORD(station, AgeReg::ADDR_MOTOR_SN0, serial, 0)
+                            && serial == ref.serial
+                            && m_transport->readDWORD(station, AgeReg::ADDR_BUS_BAUD, value, 0)
+                            && value == (DWORD)baud;
+            if (!ok) {
+                m_lastError = QString("Loopback at %1 baud failed (station %2, round %3).")
+                                  .arg(baud).arg((int)station).arg(round + 1);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// ==========================================
+//          切换 (失败时整体退回原波特率)
+// ==========================================
+
+bool AgeBaudNegotiator::switchTo(int baud)
+{
+    const int from = currentBaud();
+    if (!hostSupports(baud)) {
+        m_lastError = QString("Host does not support %1 baud.").arg(baud);
+        return false;
+    }
+
+    // 写失败不立即放弃: 驱动器可能已切换、只是应答丢失，以新波特率下的回环校验为准
+    QString writeError;
+    for (quint8 station : m_stations) {
+        if (!writeBaud(station, baud) && writeError.isEmpty()) writeError = m_lastError;
+    }
+    setHost(baud);
+    settle();
+    if (loopback(baud)) return true;
+
+    // 已切换的站号全部退回
+    const QString error = writeError.isEmpty() ? m_lastError : writeError;
+    if (!unify(from, true)) {
+        m_lastError = QString("%1; rollback to %2 baud failed: %3").arg(error).arg(from).arg(m_lastError);
+        return false;
+    }
+    m_lastError = error;
+    return false;
+}
+
+// 找到每个站号当前所在的波特率，再把不在目标波特率的站号逐个迁过去
+bool AgeBaudNegotiator::unify(int preferred, bool forcePreferred)
+{
+    // 先每个波特率各试一次；仍有站号没找到时 (链路不稳)，再按重试次数搜一遍
+    QMap<quint8, int> found;
+    const QList<int> order = searchOrder(preferred);
+    for (int attempts : {1, m_options.writeRetries}) {
+        for (int baud : order) {
+            if (found.size() == m_stations.size()) break;
+            if (!setHost(baud)) continue;
+            for (quint8 station : m_stations) {
+                if (!found.contains(station) && ping(station, attempts)) found.insert(station, baud);
+            }
+        }
+        if (found.size() == m_stations.size() || m_options.writeRetries <= 1) break;
+    }
+
+    if (found.size() < m_stations.size()) {
+        QStringList missing;
+        for (quint8 station : m_stations) {
+            if (!found.contains(station)) missing << QString::number(station);
+        }
+        setHost(found.isEmpty() ? preferred : found.first());
+        m_lastError = QString("Station %1 not responding at any baud rate.").arg(missing.join(", "));
+        return false;
+    }
+
+    // 目标: 强制时为 preferred；否则有站号在 preferred 就用它，不然取多数站所在的波特率
+    int target = preferred;
+    if (!forcePreferred && !found.values().contains(preferred)) {
+        QMap<int, int> count;
+        for (int baud : found) ++count[baud];
+        for (auto it = count.constBegin(); it != count.constEnd(); ++it) {
+            if (it.value() > count.value(target)) target = it.key();
+        }
+    }
+
+    bool moved = false;
+    for (quint8 station : m_stations) {
+        if (found.value(station) == target) continue;
+        if (!setHost(found.value(station))) return false;
+        writeBaud(station, target);   // 应答可能丢失，以下面的确认为准
+        moved = true;
+    }
+    if (!setHost(target)) return false;
+    if (moved) settle();
+    for (quint8 station : m_stations) {
+        if (!ping(station, m_options.writeRetries)) {
+            m_lastError = QString("Station %1 not responding at %2 baud.").arg((int)station).arg(target);
+            return false;
+        }
+    }
+    return true;
+}
+
+// ==========================================
+//          对外接口
+// ==========================================
+
+bool AgeBaudNegotiator::restore()
+{
+    m_savedValid = false;
+    if (!m_transport || m_stations.isEmpty()) {
+        m_lastError = "No transport or stations attached.";
+        return false;
+    }
+    if (!m_transport->open() || !m_transport->isValid(true)) {
+        m_lastError = m_transport->lastError();
+        return false;
+    }
+    if (currentBaud() <= 0) {
+        m_lastError = m_transport->lastError();
+        return false;
+    }
+
+    QMap<quint8, QWORD> serials;
+    const int saved = savedBaud(&serials);
+    if (!unify(saved > 0 ? saved : currentBaud(), false)) return false;
+
+    // 保存值只在全部站号就在该波特率、且仍是原来那台电机时有效
+    if (saved > 0 && currentBaud() == saved) {
+        m_savedValid = true;
+        for (quint8 station : m_stations) {
+            QWORD serial = 0;
+            if (!m_transport->readQWORD(station, AgeReg::ADDR_MOTOR_SN0, serial, 0) || serial != serials.value(station)) {
+                m_savedValid = false;
+            }
+        }
+    }
+    m_lastRxFrames = -1;
+    return true;
+}
+
+bool AgeBaudNegotiator::negotiate()
+{
+    const int from = currentBaud();
+    if (from <= 0) {
+        m_lastError = m_transport ? m_transport->lastError() : QString("No transport attached.");
+        return false;
+    }
+    if (!captureReferences()) return false;
+
+    int best = from;
+    for (int baud : m_options.candidates) {
+        if (baud <= from || (m_options.maxBaud > 0 && baud > m_options.maxBaud)) continue;
+        if (!switchTo(baud)) {
+            qDebug() << "AgeBaudNegotiator: stop at" << best << "baud:" << m_lastError;
+            break;
+        }
+        best = baud;
+    }
+    save(best);
+    m_savedValid = true;
+    m_lastRxFrames = -1;
+    qDebug() << "✅ AgeBaudNegotiator:" << m_transport->name() << "running at" << best << "baud";
+    return true;
+}
+
+bool AgeBaudNegotiator::fallback()
+{
+    const int from = currentBaud();
+    if (from <= 0) {
+        m_lastError = m_transport ? m_transport->lastError() : QString("No transport attached.");
+        return false;
+    }
+    m_lastRxFrames = -1;
+    m_badWindows = 0;
+
+    // 链路差到读不出参考值时，直接统一回出厂波特率
+    if (!captureReferences()) {
+        if (!unify(m_options.defaultBaud, true)) return false;
+        save(m_options.defaultBaud);
+        return true;
+    }
+    for (int i = m_options.candidates.size() - 1; i >= 0; --i) {
+        const int baud = m_options.candidates[i];
+        if (baud >= from) continue;
+        if (switchTo(baud)) {
+            save(baud);
+            qDebug() << "AgeBaudNegotiator: fell back from" << from << "to" << baud << "baud";
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AgeBaudNegotiator::checkLinkQuality()
+{
+    AgeBusInfo info;
+    if (!m_transport || !m_transport->getBusInfo(info)) return false;
+
+    const qint64 errors = info.rxFrameErrors + info.txFrameErrors;
+    if (m_lastRxFrames < 0 || info.rxFrames < m_lastRxFrames) {
+        m_lastRxFrames = info.rxFrames;
+        m_lastFrameErrors = errors;
+        return false;
+    }
+    // 应答帧不足一个窗口时继续累计
+    const qint64 frames = info.rxFrames - m_lastRxFrames;
+    if (frames < m_options.minFramesPerWindow) return false;
+    const qint64 bad = errors - m_lastFrameErrors;
+    m_lastRxFrames = info.rxFrames;
+    m_lastFrameErrors = errors;
+
+    if ((double)bad / (double)frames > m_options.fallbackErrorRatio) {
+        ++m_badWindows;
+    } else {
+        m_badWindows = 0;
+    }
+    if (m_badWindows < m_options.fallbackWindows) return false;
+    m_badWindows = 0;
+    return true;
+}
+
+// ==========================================
+//          保存 (按链路与站号)
+// ==========================================
+
+QString AgeBaudNegotiator::settingsPrefix() const
+{
+    QString link = m_transport->name();
+    link.replace('/', '_').replace('\\', '_').replace(':', '_');
+    return "AgeBaud/" + link + "/";
+}
+
+// 全部站号都有记录且一致时返回该波特率，否则 0
+int AgeBaudNegotiator::savedBaud(QMap<quint8, QWORD> *serials) const
+{
+    const std::unique_ptr<QSettings> settings = openSettings(m_options);
+    const QString prefix = settingsPrefix();
+    int baud = 0;
+    for (quint8 station : m_stations) {
+        const QString key = prefix + QString::number(station);
+        const int value = settings->value(key + "/baud").toInt();
+        if (value <= 0 || (baud > 0 && value != baud)) return 0;
+        baud = value;
+        if (serials) serials->insert(station, settings->value(key + "/serial").toString().toULongLong(nullptr, 16));
+    }
+    return baud;
+}
+
+void AgeBaudNegotiator::save(int baud)
+{
+    const std::unique_ptr<QSettings> settings = openSettings(m_options);
+    const QString prefix = settingsPrefix();
+    for (quint8 station : m_stations) {
+        const QString key = prefix + QString::number(station);
+        QWORD serial = m_references.value(station).serial;
+        if (!m_references.contains(station)) m_transport->readQWORD(station, AgeReg::ADDR_MOTOR_SN0, serial, 0);
+        settings->setValue(key + "/baud", baud);
+        settings->setValue(key + "/serial", QString::number((quint64)serial, 16));
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef AGEBAUDNEGOTIATOR_H
+#define AGEBAUDNEGOTIATOR_H
+
+#include <QList>
+#include <QMap>
+#include <QVector>
+#include "AgeTransport.h"
+
+// ==========================================
+//   波特率协商: 升速、降级与按设备保存
+// ==========================================
+// - 驱动器没有"支持的波特率"列表可读: 候选表中主机 setSerialConfig() 不接受的跳过，
+//   驱动器写 ADDR_BUS_BAUD 返回异常或切换后读回不一致的视为不支持
+// - 切换顺序: 以当前波特率逐站写 ADDR_BUS_BAUD (驱动器以原波特率应答后切换)，主机随后切换，
+//   再做回环校验: 多轮读取型号、序列号与 ADDR_BUS_BAUD，与切换前读到的参考值逐字比较
+// - 逐级升速，每一级都从已验证的波特率出发；某一级不通过即整体退回上一级并停止
+// - 持续帧错误 (checkLinkQuality()) 时降一级；各站号实际所在的波特率不一致时先统一
+// - 协商结果按 (链路, 站号) 与电机序列号一起存入 QSettings，下次启动直接使用，序列号不符则重新协商
+// - 不加锁: 只能在总线线程中使用 (与驱动共用同一个传输)
+class AgeBaudNegotiator
+{
+public:
+    struct Options {
+        QList<int> candidates{9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600}; // 升序
+        int defaultBaud = 115200;        // 出厂波特率，搜索时优先尝试
+        int maxBaud = 0;                 // 升速上限，0 = 不限
+        WORD parity = 2;                 // 与 AgeCOMSetCOM 相同
+        int loopbackRounds = 20;         // 回环校验轮数 (每轮每站 3 帧)，任一帧失败即不通过
+        int settleMs = 20;               // 切换后等待驱动器重新配置串口
+        int writeRetries = 3;            // 降级/统一时链路可能不稳，写入与确认的重试次数
+        double fallbackErrorRatio = 0.05; // 一个检查窗口内帧错误占应答帧的比例
+        int fallbackWindows = 3;         // 连续超过比例的窗口数
+        int minFramesPerWindow = 20;     // 应答帧少于此数的窗口不计
+        QString settingsFile;            // 空 = QSettings("AutoFocus", "AgeMotion")
+    };
+
+    AgeBaudNegotiator();
+    explicit AgeBaudNegotiator(const Options &options);
+
+    const Options &options() const { return m_options; }
+
+    // 绑定传输与站号 (每次连接前在总线线程调用)
+    void attach(AgeTransport *transport, const QVector<quint8> &stations);
+
+    // 连接前: 先按保存的波特率 (没有则为主机当前波特率) 确认全部站号应答，
+    // 不应答时逐个候选搜索，各站波特率不一致时统一到多数站所在的波特率
+    bool restore();
+    // 连接后: 逐级升到通过回环校验的最高波特率并保存
+    bool negotiate();
+    // 降到下一个通过回环校验的较低波特率并保存
+    bool fallback();
+    // 周期调用 (如连接健康检查): 帧错误持续超过比例时返回 true，应随后调用 fallback()
+    bool checkLinkQuality();
+
+    // 全部站号都有保存的波特率且序列号一致 (restore() 之后有效)
+    bool hasSavedBaud() const { return m_savedValid; }
+    int currentBaud();
+    QString lastError() const { return m_lastError; }
+
+private:
+    struct Reference {
+        WORD name[16] = {};
+        QWORD serial = 0;
+    };
+
+    bool setHost(int baud);
+    bool hostSupports(int baud);
+    bool ping(quint8 station, int attempts);
+    bool writeBaud(quint8 station, int baud);
+    bool captureReferences();
+    bool loopback(int baud);
+    bool switchTo(int baud);
+    bool unify(int preferred, bool forcePreferred);
+    QList<int> searchOrder(int preferred);
+    void settle();
+
+    int savedBaud(QMap<quint8, QWORD> *serials) const;
+    void save(int baud);
+    QString settingsPrefix() const;
+
+    Options m_options;
+    AgeTransport *m_transport = nullptr;
+    QVector<quint8> m_stations;
+    QMap<quint8, Reference> m_references;
+    bool m_savedValid = false;
+
+    qint64 m_lastRxFrames = -1;
+    qint64 m_lastFrameErrors = 0;
+    int m_badWindows = 0;
+
+    QString m_lastError;
+};
+
+#endif // AGEBAUDNEGOTIATOR_H
@@ -0,0 +1,396 @@
+#include "AgeBusThread.h"
+#include <QMutexLocker>
+#include "AgeTrace.h"
+#include <limits>
+
+AgeBusThread::AgeBusThread(QObject *parent, QSharedPointer<AgeTransport> transport)
+    : QThread(parent)
+    , m_link(new AgeResilientTransport(transport ? transport : AgeTransport::createDefault()))
+    , m_transport(new AgeInstrumentedTransport(m_link))
+{
+    addAxis(AgeMotionDriver::DEFAULT_STATION_ID);
+}
+
+AgeBusThread::~AgeBusThread()
+{
+    shutdown();
+}
+
+int AgeBusThread::addAxis(quint8 station)
+{
+    Q_ASSERT(!isRunning());
+    m_axes.emplace_back(new Axis(m_transport, station));
+    return (int)m_axes.size() - 1;
+}
+
+int AgeBusThread::axisCount() const
+{
+    return (int)m_axes.size();
+}
+
+quint8 AgeBusThread::axisStation(int axis) const
+{
+    return m_axes[axis]->driver.station();
+}
+
+void AgeBusThread::setPollConfig(const AgePollScheduler::Config &config)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pollConfig = config;
+    m_pollConfigChanged = true;
+    m_wake.wakeAll();
+}
+
+AgePollScheduler::Config AgeBusThread::pollConfig() const
+{
+    QMutexLocker locker(const_cast<QMutex *>(&m_mutex));
+    return m_pollConfig;
+}
+
+void AgeBusThread::post(Job job, Priority priority, int axis, Cancel cancel)
+{
+    QueuedJob queued;
+    queued.job = std::move(job);
+    queued.cancel = std::move(cancel);
+    if (priority == Priority::Emergency) cancelCommands(axis, "Cancelled by emergency stop.");
+    enqueue(std::move(queued), priority, axis);
+}
+
+void AgeBusThread::enqueue(QueuedJob job, Priority priority, int axis)
+{
+    Q_ASSERT(axis >= 0 && axis < (int)m_axes.size());
+    QMutexLocker locker(&m_mutex);
+    job.enqueuedUs = AgeMotionDriver::monotonicUs();
+    m_axes[axis]->jobs[(int)priority].enqueue(std::move(job));
+    m_wake.wakeAll();
+}
+
+int AgeBusThread::cancelCommands(int axis, const QString &reason)
+{
+    QList<Cancel> cancelled;
+    {
+        QMutexLocker locker(&m_mutex);
+        takeCommands(axis, cancelled);
+    }
+    // 在锁外通知: 回调可能再次 post()
+    for (const Cancel &cancel : cancelled) {
+        if (cancel) cancel(reason);
+    }
+    return cancelled.size();
+}
+
+// 取出该轴的运动命令，以及任一轴队列中的多轴运动命令 (挂在轴 0，可能涉及该轴)
+void AgeBusThread::takeCommands(int axis, QList<Cancel> &cancelled)
+{
+    for (int i = 0; i < (int)m_axes.size(); ++i) {
+        QQueue<QueuedJob> &queue = m_axes[i]->jobs[(int)Priority::Command];
+        for (int k = 0; k < queue.size();) {
+            if (i != axis && !queue.at(k).group) {
+                ++k;
+                continue;
+            }
+            cancelled.append(queue.takeAt(k).cancel);
+        }
+    }
+}
+
+void AgeBusThread::postGroup(GroupJob job, Priority priority, Cancel cancel)
+{
+    // 挂在轴 0 的队列上执行，job 内部可访问所有轴
+    QueuedJob queued;
+    queued.cancel = std::move(cancel);
+    queued.group = true;
+    queued.job = [this, job, priority](AgeMotionDriver &) {
+        QList<AgeMotionDriver *> drivers;
+        for (auto &axis : m_axes) drivers.append(&axis->driver);
+        job(drivers);
+        // 多轴命令 (如同步运动) 之后各轴都按运动中轮询
+        if (priority != Priority::Telemetry) {
+            const qint64 nowUs = AgeMotionDriver::monotonicUs();
+            for (int i = 0; i < (int)m_axes.size(); ++i) m_poll.onCommand(i, nowUs);
+        }
+    };
+    enqueue(std::move(queued), priority, 0);
+}
+
+bool AgeBusThread::hasJobs() const
+{
+    for (const auto &axis : m_axes) {
+        for (const QQueue<QueuedJob> &queue : axis->jobs) {
+            if (!queue.isEmpty()) return true;
+        }
+    }
+    return false;
+}
+
+// 先按优先级，再从 m_jobCursor 开始在各轴间轮转，避免某个轴的命令流饿死其他轴
+bool AgeBusThread::takeJob(QueuedJob &job, int &axis, Priority &priority)
+{
+    const int count = (int)m_axes.size();
+    for (int p = 0; p < PRIORITY_COUNT; ++p) {
+        for (int k = 0; k < count; ++k) {
+            const int i = (m_jobCursor + k) % count;
+            QQueue<QueuedJob> &queue = m_axes[i]->jobs[p];
+            if (queue.isEmpty()) continue;
+            job = queue.dequeue();
+            axis = i;
+            priority = (Priority)p;
+            m_jobCursor = (i + 1) % count;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AgeBusThread::anyConnected() const
+{
+    for (const auto &axis : m_axes) {
+        if (axis->driver.isConnected()) return true;
+    }
+    return false;
+}
+
+bool AgeBusThread::latestSnapshot(DriveStatusSnapshot &snapshot, int axis) const
+{
+    return m_axes[axis]->snapshot.load(snapshot);
+}
+
+quint64 AgeBusThread::snapshotVersion(int axis) const
+{
+    return m_axes[axis]->snapshot.version();
+}
+
+// ==========================================
+//          运动到位监视
+// ==========================================
+
+void AgeBusThread::watchMotion(int timeoutMs, MotionDone done, int axis)
+{
+    Axis *target = m_axes[axis].get();
+    post([target, timeoutMs, done](AgeMotionDriver &driver) {
+        AgeMotionWaiter::Profile profile;
+        DriveStatusSnapshot snapshot;
+        if (!driver.getMotionProfile(profile) ||
+            !driver.readStatusSnapshot(snapshot, DriveStatusSnapshot::GroupPosition)) {
+            BusResult<bool> r;
+            r.error = driver.getLastError();
+            done(r);
+            return;
+        }
+        MotionWatch watch;
+        watch.waiter.start(profile, snapshot.posRealMms, snapshot.posTargetMms, snapshot.timestampUs, timeoutMs);
+        watch.done = done;
+        target->watches.append(watch);
+    }, Priority::Command, axis, [done](const QString &reason) {
+        BusResult<bool> r;
+        r.error = reason;
+        done(r);
+    });
+}
+
+qint64 AgeBusThread::nextWatchUs(int &axis) const
+{
+    qint64 due = std::numeric_limits<qint64>::max();
+    axis = -1;
+    for (int i = 0; i < (int)m_axes.size(); ++i) {
+        for (const MotionWatch &watch : m_axes[i]->watches) {
+            if (watch.waiter.nextPollUs() < due) {
+                due = watch.waiter.nextPollUs();
+                axis = i;
+            }
+        }
+    }
+    return due;
+}
+
+void AgeBusThread::setRecorder(QSharedPointer<AgeTelemetryRecorder> recorder)
+{
+    post([this, recorder](AgeMotionDriver &) {
+        m_recorder = recorder;
+    }, Priority::Control);
+}
+
+void AgeBusThread::setPublisher(QSharedPointer<AgeTelemetryPublisher> publisher)
+{
+    post([this, publisher](AgeMotionDriver &) {
+        m_publisher = publisher;
+    }, Priority::Control);
+}
+
+// 发布快照，读取成功时再追加一条遥测样本 (并写入记录文件与共享内存)
+void AgeBusThread::publish(int axisIndex)
+{
+    Axis &axis = *m_axes[axisIndex];
+    axis.snapshot.store(axis.work);
+    if (!axis.work.freshGroups) return;
+    const AgeTelemetrySample sample = AgeTelemetrySample::fromSnapshot(axisIndex, axis.work);
+    m_telemetry.push(sample);
+    if (m_recorder) m_recorder->append(sample);
+    if (m_publisher) m_publisher->publish(sample);
+}
+
+// 一次位置块读取同时服务该轴所有到期的监视，并顺带发布快照 (同时算作这两个分组的轮询)
+void AgeBusThread::serviceWatches(int axisIndex)
+{
+    Axis &axis = *m_axes[axisIndex];
+    DriveStatusSnapshot &snapshot = axis.work;
+    const quint32 groups = DriveStatusSnapshot::GroupControl | DriveStatusSnapshot::GroupPosition;
+    const qint64 startUs = AgeMotionDriver::monotonicUs();
+    const bool ok = axis.driver.readStatusSnapshot(snapshot, groups);
+    m_poll.onPolled(axisIndex, groups, snapshot, startUs, AgeMotionDriver::monotonicUs());
+    if (!ok) {
+        finishWatches(axis, axis.driver.getLastError());
+        return;
+    }
+    publish(axisIndex);
+
+    for (int i = axis.watches.size() - 1; i >= 0; --i) {
+        MotionWatch &watch = axis.watches[i];
+        if (watch.waiter.nextPollUs() > snapshot.timestampUs) continue;
+
+        const AgeMotionWaiter::State state =
+            watch.waiter.update(snapshot.posRealMms, snapshot.posTargetMms, snapshot.timestampUs);
+        if (state == AgeMotionWaiter::State::Waiting) continue;
+
+        BusResult<bool> r;
+        r.ok = (state == AgeMotionWaiter::State::Done);
+        r.value = r.ok;
+        if (!r.ok) r.error = "Motion not complete before timeout.";
+        MotionDone done = watch.done;
+        axis.watches.removeAt(i);
+        done(r);
+    }
+}
+
+void AgeBusThread::finishWatches(Axis &axis, const QString &error)
+{
+    QList<MotionWatch> watches;
+    watches.swap(axis.watches);
+    for (const MotionWatch &watch : watches) {
+        BusResult<bool> r;
+        r.error = error;
+        watch.done(r);
+    }
+}
+
+// ==========================================
+//          诊断
+// ==========================================
+
+std::future<AgeBusDiagnostics> AgeBusThread::diagnostics(bool reset)
+{
+    return submit([this, reset](AgeMotionDriver &) {
+        return collectDiagnostics(reset);
+    }, Priority::Telemetry);
+}
+
+AgeBusDiagnostics AgeBusThread::collectDiagnostics(bool reset)
+{
+    AgeBusDiagnostics diag;
+    m_transport->collect(diag);
+    diag.queueWait = AgeBusDiagnostics::makeRow("queueWait", -1, m_queueWait, 0);
+    diag.jobRun = AgeBusDiagnostics::makeRow("jobRun", -1, m_jobRun, 0);
+    diag.links = m_link->linkStates();
+    if (reset) {
+        m_transport->reset();
+        m_queueWait.reset();
+        m_jobRun.reset();
+    }
+    return diag;
+}
+
+AgeLinkState AgeBusThread::linkState(int axis) const
+{
+    return m_link->linkState(m_axes[axis]->driver.station());
+}
+
+void AgeBusThread::shutdown()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_wake.wakeAll();
+    }
+    wait();
+}
+
+void AgeBusThread::run()
+{
+    AGE_TRACE_THREAD_NAME("AgeBusThread");
+    m_poll.setAxisCount((int)m_axes.size());
+    forever {
+        QueuedJob job;
+        int jobAxis = 0;
+        Priority jobPriority = Priority::Telemetry;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_pollConfigChanged) {
+                m_poll.setConfig(m_pollConfig);
+                m_pollConfigChanged = false;
+            }
+            // 等待命令或下一个轮询/监视时刻 (全部未连接时只等命令)
+            while (!m_stopRequested && !hasJobs()) {
+                if (!anyConnected()) {
+                    m_wake.wait(&m_mutex);
+                    continue;
+                }
+                for (int i = 0; i < (int)m_axes.size(); ++i) m_poll.setEnabled(i, m_axes[i]->driver.isConnected());
+                int watchAxis = -1;
+                const qint64 dueUs = qMin(qMin(nextWatchUs(watchAxis), m_link->nextProbeUs()), m_poll.nextDueUs());
+                const qint64 remainUs = dueUs - AgeMotionDriver::monotonicUs();
+                if (remainUs <= 0) break;
+                m_wake.wait(&m_mutex, (unsigned long)((remainUs + 999) / 1000));
+            }
+            if (m_stopRequested) {
+                // 丢弃未执行的命令 (submit() 的 future 随之得到 broken_promise)
+                for (auto &axis : m_axes) {
+                    for (QQueue<QueuedJob> &queue : axis->jobs) queue.clear();
+                }
+                break;
+            }
+            takeJob(job, jobAxis, jobPriority);
+        }
+
+        // 1. 命令优先
+        if (job.job) {
+            const qint64 startUs = AgeMotionDriver::monotonicUs();
+            m_queueWait.record(startUs - job.enqueuedUs);
+            AGE_TRACE_SCOPE_ARG("bus", "job", jobAxis);
+            job.job(m_axes[jobAxis]->driver);
+            const qint64 endUs = AgeMotionDriver::monotonicUs();
+            m_jobRun.record(endUs - startUs);
+            // 命令之后该轴按运动中轮询，记录完整的运动与到位过程
+            if (jobPriority != Priority::Telemetry) m_poll.onCommand(jobAxis, endUs);
+            continue;
+        }
+
+        // 2. 运动到位监视的采样 (按预测时刻，可能比周期轮询更密)
+        const qint64 nowUs = AgeMotionDriver::monotonicUs();
+        int watchAxis = -1;
+        if (nextWatchUs(watchAxis) <= nowUs) {
+            AGE_TRACE_SCOPE_ARG("bus", "motionWatch", watchAxis);
+            serviceWatches(watchAxis);
+            continue;
+        }
+
+        // 3. 断路站号的恢复探测
+        if (m_link->nextProbeUs() <= nowUs) {
+            AGE_TRACE_SCOPE("bus", "probe");
+            m_link->probe();
+            continue;
+        }
+
+        // 4. 状态轮询: 每次只读一个轴的到期分组，然后回到队列检查
+        int pollAxis = 0;
+        quint32 groups = 0;
+        if (m_poll.takeDue(nowUs, pollAxis, groups)) {
+            AGE_TRACE_SCOPE_ARG("bus", "poll", pollAxis);
+            Axis &axis = *m_axes[pollAxis];
+            axis.driver.readStatusSnapshot(axis.work, groups);
+            publish(pollAxis);
+            m_poll.onPolled(pollAxis, groups, axis.work, nowUs, AgeMotionDriver::monotonicUs());
+        }
+    }
+
+    for (auto &axis : m_axes) finishWatches(*axis, "Bus thread stopped.");
+}
@@ -0,0 +1,265 @@
+#ifndef AGEBUSTHREAD_H
+#define AGEBUSTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QPointer>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "AgeMotionDriver.h"
+#include "AgeSeqLock.h"
+#include "AgeInstrumentedTransport.h"
+#include "AgePollScheduler.h"
+#include "AgeTelemetryRing.h"
+#include "AgeTelemetryRecorder.h"
+#include "AgeTelemetryShm.h"
+
+// 总线线程的执行结果 (带错误信息)
+template<typename T>
+struct BusResult
+{
+    bool ok = false;
+    T value = T();
+    QString error;
+};
+
+// 排队的命令被停止取消时交给调用方的结果: BusResult 以 error 说明原因，其他类型无法表示失败
+template<typename R>
+struct BusCancelResult
+{
+    static constexpr bool supported = false;
+};
+
+template<typename T>
+struct BusCancelResult<BusResult<T>>
+{
+    static constexpr bool supported = true;
+    static BusResult<T> make(const QString &reason)
+    {
+        BusResult<T> r;
+        r.error = reason;
+        return r;
+    }
+};
+
+// ==========================================
+//   总线线程：独占一条总线上的全部 AgeMotionDriver，定时轮询状态
+// ==========================================
+// - 所有 AgeCOM 调用都在本线程执行，GUI 线程不再被串口往返阻塞
+// - 同一总线上的多个轴 (不同站号) 共用一个 AgeTransport，由本线程串行仲裁
+// - 轮询结果按轴通过 SeqLock 发布，读取端无锁、不阻塞
+// - 其他线程的命令通过 post()/call()/submit() 排队到本线程执行，优先于轮询
+// - 队列按优先级出队: 急停 > 控制 (停止/使能) > 运动命令 > 遥测读取；
+//   同一优先级内各轴轮转，单轴内先进先出；已开始的总线事务不会被打断
+// - 停止插队之后不能让排在后面的运动命令再次启动: 急停 (Priority::Emergency) 入队时、
+//   以及调用 cancelCommands() 时，取消该轴尚未执行的 Priority::Command 命令 (含多轴命令)，
+//   见 cancelCommands()
+// - 轮询按分组与运动状态分别定频 (AgePollScheduler): 运动中位置/速度高频，静止与慢变量低频，
+//   总耗时受总线时间预算约束；每次只读一个轴的到期分组，轮询之间总会先处理排队的命令，
+//   因此轴数增加只拉长轮询周期，不会拉长单个命令的等待
+// - 传输层外包一层 AgeInstrumentedTransport，另记录命令排队与执行耗时，见 diagnostics()
+// - 其内再包一层 AgeResilientTransport: 自动超时按往返时间估计收紧，
+//   驱动器无应答时断路、立即失败，空闲时由本线程探测恢复
+class AgeBusThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(AgeMotionDriver &)> Job;
+    // 尚未执行的 job 被取消时在取消方线程调用，reason 为原因
+    typedef std::function<void(const QString &reason)> Cancel;
+
+    enum class Priority {
+        Emergency = 0,  // 急停
+        Control,        // 停止、使能/脱机
+        Command,        // 运动与参数设置 (默认)
+        Telemetry       // 状态读取
+    };
+
+    // 创建总线 (transport 为空时按 AgeTransport::createDefault() 选择)，并添加站号 1 的轴 0
+    explicit AgeBusThread(QObject *parent = nullptr,
+                          QSharedPointer<AgeTransport> transport = QSharedPointer<AgeTransport>());
+    ~AgeBusThread() override;
+
+    // 添加一个轴，返回轴编号；必须在 start() 之前调用
+    int addAxis(quint8 station);
+    int axisCount() const;
+    quint8 axisStation(int axis) const;
+
+    // 轮询频率与总线预算，可在任意线程修改，下一次调度生效
+    void setPollConfig(const AgePollScheduler::Config &config);
+    AgePollScheduler::Config pollConfig() const;
+
+    // 在总线线程执行 job (不等待结果)；被停止取消时调用 cancel (可为空)
+    // Priority::Emergency 的 job 入队前先取消该轴排队的运动命令，见 cancelCommands()
+    void post(Job job, Priority priority = Priority::Command, int axis = 0, Cancel cancel = Cancel());
+
+    // 在总线线程执行 job，结果通过 done 回调送回 context 所在线程
+    // 被停止取消时: 结果为 BusResult 的以失败结果 (error 为原因) 回调，其他类型不回调
+    template<typename Fn, typename Done>
+    void call(Fn job, QObject *context, Done done, Priority priority = Priority::Command, int axis = 0)
+    {
+        typedef typename std::decay<decltype(job(std::declval<AgeMotionDriver &>()))>::type R;
+        QPointer<QObject> guard(context);
+        post([job, guard, done](AgeMotionDriver &driver) mutable {
+            auto result = job(driver);
+            if (guard) {
+                QMetaObject::invokeMethod(guard.data(), [done, result]() mutable { done(result); },
+                                          Qt::QueuedConnection);
+            }
+        }, priority, axis, [guard, done](const QString &reason) {
+            if constexpr (BusCancelResult<R>::supported) {
+                const R result = BusCancelResult<R>::make(reason);
+                if (guard) {
+                    QMetaObject::invokeMethod(guard.data(), [done, result]() mutable { done(result); },
+                                              Qt::QueuedConnection);
+                }
+            } else {
+                Q_UNUSED(reason);
+            }
+        });
+    }
+
+    // 在总线线程执行 job，返回 std::future，可在任意非 GUI 线程等待
+    // 线程退出时尚未执行的 job 会被丢弃，对应 future 抛出 broken_promise；
+    // 被停止取消时 BusResult 得到失败结果 (error 为原因)，其他类型抛出 std::runtime_error
+    template<typename Fn>
+    auto submit(Fn job, Priority priority = Priority::Command, int axis = 0)
+        -> std::future<decltype(job(std::declval<AgeMotionDriver &>()))>
+    {
+        typedef decltype(job(std::declval<AgeMotionDriver &>())) R;
+        auto promise = std::make_shared<std::promise<R>>();
+        std::future<R> future = promise->get_future();
+        post([job, promise](AgeMotionDriver &driver) mutable {
+            fulfil(*promise, job, driver);
+        }, priority, axis, [promise](const QString &reason) {
+            if constexpr (BusCancelResult<R>::supported) {
+                promise->set_value(BusCancelResult<R>::make(reason));
+            } else {
+                promise->set_exception(std::make_exception_ptr(std::runtime_error(reason.toStdString())));
+            }
+        });
+        return future;
+    }
+
+    // 在总线线程执行涉及多个轴的 job (按轴编号排列的全部驱动)，执行期间不插入其他事务
+    // Priority::Command 的多轴命令会被任一轴的停止取消；多轴急停入队时不自动取消，由调用方按轴 cancelCommands()
+    typedef std::function<void(const QList<AgeMotionDriver *> &)> GroupJob;
+    void postGroup(GroupJob job, Priority priority = Priority::Command, Cancel cancel = Cancel());
+
+    // 取消该轴尚未执行的 Priority::Command 命令 (及排队的多轴运动命令)，返回取消的个数；
+    // 在发出停止之前调用，停止插队执行后，之前排队的运动不会再次启动。
+    // 被取消的 job 按 post() 的 cancel 通知 (call() / submit() / watchMotion() 见各自说明)；
+    // 急停 (Priority::Emergency) 的 post() 会自动调用本函数
+    int cancelCommands(int axis = 0, const QString &reason = QString("Cancelled by stop."));
+
+    // 等待运动到位，不占用总线线程: 按 AgeMotionWaiter 预测的时刻插入位置采样，
+    // 期间其他命令照常执行；done 在总线线程调用 (线程退出时以失败结果调用；
+    // 监视尚未开始即被停止取消时，在取消方线程以失败结果调用)
+    typedef std::function<void(const BusResult<bool> &)> MotionDone;
+    void watchMotion(int timeoutMs, MotionDone done, int axis = 0);
+
+    // 最新状态快照 (无锁读取)，尚无数据时返回 false
+    bool latestSnapshot(DriveStatusSnapshot &snapshot, int axis = 0) const;
+    quint64 snapshotVersion(int axis = 0) const;
+
+    // 全部轴的遥测历史: 每次状态读取成功后写入一条样本 (总线线程写)，
+    // 消费者各自用 telemetry().reader() 建立游标，无锁读取并得到溢出计数
+    const AgeTelemetryRing &telemetry() const { return m_telemetry; }
+    // 在总线线程中把每条遥测样本同时写入记录文件 (recorder 须已 open())，空指针停止记录；
+    // 线程持有一份引用，停止后最后一份引用释放时关闭文件
+    void setRecorder(QSharedPointer<AgeTelemetryRecorder> recorder);
+    // 同上，把每条样本同时发布到共享内存 (publisher 须已 create())，供本机其他进程无系统调用读取
+    void setPublisher(QSharedPointer<AgeTelemetryPublisher> publisher);
+
+    // 总线诊断: 按 (操作, 寄存器) 的传输耗时、命令排队/执行耗时与链路层计数
+    // reset 为 true 时取完后清零，开始新的统计区间
+    std::future<AgeBusDiagnostics> diagnostics(bool reset = false);
+    // 同上，只能在总线线程 (job 内) 调用，例如配合 call() 送回 GUI 线程
+    AgeBusDiagnostics collectDiagnostics(bool reset = false);
+    // 轴所在站号的往返时间估计与断路状态，只能在总线线程调用
+    AgeLinkState linkState(int axis) const;
+
+    // 请求线程退出并等待结束
+    void shutdown();
+
+protected:
+    void run() override;
+
+private:
+    static constexpr int PRIORITY_COUNT = 4;
+    static constexpr int TELEMETRY_CAPACITY = 1 << 16;  // 约 4 MB，运动中 100 Hz x 几轴时可保留数分钟
+
+    template<typename R, typename Fn>
+    static void fulfil(std::promise<R> &promise, Fn &job, AgeMotionDriver &driver)
+    {
+        promise.set_value(job(driver));
+    }
+    template<typename Fn>
+    static void fulfil(std::promise<void> &promise, Fn &job, AgeMotionDriver &driver)
+    {
+        job(driver);
+        promise.set_value();
+    }
+
+    struct QueuedJob {
+        Job job;
+        Cancel cancel;
+        qint64 enqueuedUs = 0;
+        bool group = false;    // postGroup()
+    };
+
+    struct MotionWatch {
+        AgeMotionWaiter waiter;
+        MotionDone done;
+    };
+
+    // 单个轴: 驱动、发布的快照、命令队列与到位监视
+    struct Axis {
+        Axis(QSharedPointer<AgeTransport> transport, quint8 station) : driver(transport, station) {}
+
+        AgeMotionDriver driver;                    // 仅在总线线程中访问
+        AgeSeqLock<DriveStatusSnapshot> snapshot;  // 总线线程写，任意线程读
+        DriveStatusSnapshot work;                  // 总线线程的工作副本 (增量刷新)
+        QQueue<QueuedJob> jobs[PRIORITY_COUNT];    // 受 m_mutex 保护，按 Priority 下标
+        QList<MotionWatch> watches;                // 仅在总线线程中访问
+    };
+
+    bool hasJobs() const;                 // 调用方持有 m_mutex
+    bool takeJob(QueuedJob &job, int &axis, Priority &priority); // 调用方持有 m_mutex
+    void enqueue(QueuedJob job, Priority priority, int axis);
+    void takeCommands(int axis, QList<Cancel> &cancelled);         // 调用方持有 m_mutex
+    bool anyConnected() const;
+    qint64 nextWatchUs(int &axis) const;
+    void serviceWatches(int axisIndex);
+    void publish(int axisIndex);
+    void finishWatches(Axis &axis, const QString &error);
+
+    QSharedPointer<AgeResilientTransport> m_link;        // 自适应超时 + 断路
+    QSharedPointer<AgeInstrumentedTransport> m_transport; // 包在 m_link 外，驱动使用此对象
+    std::vector<std::unique_ptr<Axis>> m_axes;   // start() 后不再增删
+
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    int m_jobCursor = 0;                         // 同优先级轮转起点 (受 m_mutex 保护)
+    bool m_stopRequested = false;
+    AgePollScheduler::Config m_pollConfig;       // 受 m_mutex 保护，总线线程取走后应用
+    bool m_pollConfigChanged = false;
+
+    // 以下仅在总线线程中访问
+    AgeLatencyHistogram m_queueWait;             // 入队到开始执行
+    AgeLatencyHistogram m_jobRun;                // 命令执行耗时
+    AgePollScheduler m_poll;
+    AgeTelemetryRing m_telemetry{TELEMETRY_CAPACITY};
+    QSharedPointer<AgeTelemetryRecorder> m_recorder;  // 仅在总线线程中访问
+    QSharedPointer<AgeTelemetryPublisher> m_publisher; // 仅在总线线程中访问
+};
+
+#endif // AGEBUSTHREAD_H
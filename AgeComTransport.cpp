@@ -0,0 +1,250 @@
+#include "AgeComTransport.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <cstring>
+#include "AgeRtuFrame.h"
+
+AgeComTransport::AgeComTransport()
+{
+}
+
+AgeComTransport::~AgeComTransport()
+{
+    close();
+}
+
+bool AgeComTransport::open()
+{
+    // 1. 加载 DLL (只加载一次，重连时不再重复解析)
+    if (!m_lib.isLoaded() && !loadLibrary()) {
+        return false;
+    }
+
+    // 2. 执行授权
+    if (!m_authorized) {
+        if (!authorize()) {
+            m_lastError = "License authorization failed.";
+            return false;
+        }
+        m_authorized = true;
+    }
+    return true;
+}
+
+void AgeComTransport::close()
+{
+    if (m_lib.isLoaded()) {
+        m_lib.unload();
+    }
+    m_authorized = false;
+}
+
+bool AgeComTransport::isValid(bool autoConnect)
+{
+    if (!m_api_isValid) return false;
+    if (!m_api_isValid(autoConnect ? 1 : 0)) {
+        m_lastError = "Failed to connect to USB Device (AgeCOMIsValid returned FALSE).";
+        return false;
+    }
+    return true;
+}
+
+// 不卸载 DLL、不重新授权，只让 AgeCOMIsValid(1) 重新打开 USB 设备
+bool AgeComTransport::reconnect()
+{
+    if (!open()) return false;
+    return isValid(true);
+}
+
+bool AgeComTransport::loadLibrary()
+{
+    // 使用头文件中定义的 DLL_RELATIVE_PATH
+    // QString dllPath = QCoreApplication::applicationDirPath() + DLL_RELATIVE_PATH;
+    // m_lib.setFileName(dllPath);
+
+    QString dllPath = DLL_ABS_PATH;
+    m_lib.setFileName(dllPath);
+
+    if (!m_lib.load()) {
+        m_lastError = "Failed to load DLL at: " + dllPath + "\nError: " + m_lib.errorString();
+        qCritical() << m_lastError;
+        return false;
+    }
+
+    // 解析函数指针
+    m_api_isValid   = (AgeCOMIsValidFunc)m_lib.resolve("AgeCOMIsValid");
+    m_api_getUSBID  = (AgeCOMGetUSBIDFunc)m_lib.resolve("AgeCOMGetUSBID");
+    m_api_readQWORD = (AgeCOMReadQWORDFunc)m_lib.resolve("AgeCOMReadQWORD");
+    m_api_getCOMID  = (AgeCOMGetCOMIDFunc)m_lib.resolve("AgeCOMGetCOMID");
+    m_api_setSerial = (AgeCOMSerialFunc)m_lib.resolve("AgeCOMSerial");
+
+    m_api_readWORD   = (AgeCOMReadWORDFunc)m_lib.resolve("AgeCOMReadWORD");
+    m_api_writeWORD  = (AgeCOMWriteWORDFunc)m_lib.resolve("AgeCOMWriteWORD");
+    m_api_writeQWORD = (AgeCOMWriteQWORDFunc)m_lib.resolve("AgeCOMWriteQWORD");
+    // 解析 32位读写函数
+    m_api_readDWORD  = (AgeCOMReadDWORDFunc)m_lib.resolve("AgeCOMReadDWORD");
+    m_api_writeDWORD = (AgeCOMWriteDWORDFunc)m_lib.resolve("AgeCOMWriteDWORD");
+    // 块读写 (DLL 1.00.81 以后提供，缺失时退化为逐字读写)
+    m_api_readMWORD  = (AgeCOMReadMWORDFunc)m_lib.resolve("AgeCOMReadMWORD");
+    m_api_writeMWORD = (AgeCOMWriteMWORDFunc)m_lib.resolve("AgeCOMWriteMWORD");
+    // 总线统计 (可选)
+    m_api_getBusInfo = (AgeCOMGetBusInfoFunc)m_lib.resolve("AgeCOMGetBusInfo");
+    // 串口参数 (可选)
+    m_api_getCOM = (AgeCOMGetCOMFunc)m_lib.resolve("AgeCOMGetCOM");
+    m_api_setCOM = (AgeCOMSetCOMFunc)m_lib.resolve("AgeCOMSetCOM");
+
+    // 校验 (注意：根据实际情况，有些函数可能不是必须的，但为了完整性建议都校验)
+    if (!m_api_isValid || !m_api_readQWORD || !m_api_setSerial ||
+        !m_api_readWORD || !m_api_writeWORD || !m_api_writeQWORD ||
+        !m_api_readDWORD || !m_api_writeDWORD) {
+        m_lastError = "Failed to resolve one or more functions from DLL.";
+        qCritical() << m_lastError;
+        m_lib.unload();
+        return false;
+    }
+
+    return true;
+}
+
+bool AgeComTransport::authorize()
+{
+    if (!m_api_setSerial) return false;
+
+    // 使用头文件中定义的 LICENSE_KEY
+    DWORD keyLength = (DWORD)strlen(LICENSE_KEY);
+
+    // 调用授权接口
+    return m_api_setSerial((BYTE*)LICENSE_KEY, keyLength);
+}
+
+bool AgeComTransport::getBusInfo(AgeBusInfo &info)
+{
+    if (!m_lib.isLoaded() || !m_api_getBusInfo) {
+        m_lastError = "AgeCOMGetBusInfo not available.";
+        return false;
+    }
+    long long v[14] = {};
+    if (!m_api_getBusInfo(v[0], v[1], v[2], v[3], v[4], v[5], v[6],
+                          v[7], v[8], v[9], v[10], v[11], v[12], v[13])) {
+        m_lastError = "AgeCOMGetBusInfo returned FALSE.";
+        return false;
+    }
+    info.hostRunTime = v[0];
+    info.busRunTime = v[1];
+    info.lastOpTime = v[2];
+    info.maxOpTime = v[3];
+    info.minOpTime = v[4];
+    info.busOpCounts = v[5];
+    info.txFrames = v[6];
+    info.rxFrames = v[7];
+    info.txBytes = v[8];
+    info.rxBytes = v[9];
+    info.hostErrors = v[10];
+    info.busOpErrors = v[11];
+    info.txFrameErrors = v[12];
+    info.rxFrameErrors = v[13];
+    return true;
+}
+
+bool AgeComTransport::getSerialConfig(DWORD &baudRate, WORD &parity)
+{
+    if (!m_lib.isLoaded() || !m_api_getCOM) {
+        m_lastError = "AgeCOMGetCOM not available.";
+        return false;
+    }
+    if (!m_api_getCOM(baudRate, parity)) {
+        m_lastError = "AgeCOMGetCOM returned FALSE.";
+        return false;
+    }
+    return true;
+}
+
+bool AgeComTransport::setSerialConfig(DWORD baudRate, WORD parity)
+{
+    if (!m_lib.isLoaded() || !m_api_setCOM) {
+        m_lastError = "AgeCOMSetCOM not available.";
+        return false;
+    }
+    if (!m_api_setCOM(baudRate, parity)) {
+        m_lastError = QString("AgeCOMSetCOM(%1, %2) returned FALSE.").arg((quint32)baudRate).arg(parity);
+        return false;
+    }
+    return true;
+}
+
+// ==========================================
+//          寄存器读写 (直接转发到 DLL)
+// ==========================================
+
+bool AgeComTransport::readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout)
+{
+    return m_api_readWORD && m_api_readWORD(station, reg, data, timeout);
+}
+
+bool AgeComTransport::readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout)
+{
+    return m_api_readDWORD && m_api_readDWORD(station, reg, data, timeout);
+}
+
+bool AgeComTransport::readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout)
+{
+    return m_api_readQWORD && m_api_readQWORD(station, reg, data, timeout);
+}
+
+bool AgeComTransport::readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout)
+{
+    if (m_api_readMWORD) {
+        return m_api_readMWORD(station, reg, data, count, timeout);
+    }
+
+    // 旧版 DLL 没有 AgeCOMReadMWORD，逐字读取
+    if (!m_api_readWORD) return false;
+    for (int i = 0; i < count; ++i) {
+        if (!m_api_readWORD(station, (WORD)(reg + i), data[i], timeout)) return false;
+    }
+    return true;
+}
+
+bool AgeComTransport::writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout)
+{
+    return m_api_writeWORD && m_api_writeWORD(station, reg, data, timeout);
+}
+
+bool AgeComTransport::writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout)
+{
+    return m_api_writeDWORD && m_api_writeDWORD(station, reg, data, timeout);
+}
+
+bool AgeComTransport::writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout)
+{
+    return m_api_writeQWORD && m_api_writeQWORD(station, reg, data, timeout);
+}
+
+bool AgeComTransport::writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout)
+{
+    if (m_api_writeMWORD) {
+        // DLL 接口参数不是 const，但不会修改数据
+        return m_api_writeMWORD(station, reg, const_cast<WORD*>(data), count, timeout);
+    }
+
+    // 旧版 DLL 没有 AgeCOMWriteMWORD: 按 QWORD/DWORD/WORD 分段写，
+    // 保证 4 字的目标位置等寄存器在同一帧内写入，不会出现只写了一半的中间值
+    int i = 0;
+    while (i < count) {
+        const WORD addr = (WORD)(reg + i);
+        const int remain = count - i;
+        bool ok = false;
+        if (remain >= 4 && m_api_writeQWORD) {
+            ok = m_api_writeQWORD(station, addr, (QWORD)AgeRtu::unpackU64(data + i), timeout);
+            i += 4;
+        } else if (remain >= 2 && m_api_writeDWORD) {
+            ok = m_api_writeDWORD(station, addr, (DWORD)AgeRtu::unpackU32(data + i), timeout);
+            i += 2;
+        } else {
+            ok = m_api_writeWORD && m_api_writeWORD(station, addr, data[i], timeout);
+            i += 1;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
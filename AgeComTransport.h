@@ -0,0 +1,93 @@
+#ifndef AGECOMTRANSPORT_H
+#define AGECOMTRANSPORT_H
+
+#include <QLibrary>
+#include "AgeTransport.h"
+
+// ==========================================
+//   AgeCOM.dll 传输 (Windows, 厂商 USB/串口驱动)
+// ==========================================
+class AgeComTransport : public AgeTransport
+{
+public:
+    AgeComTransport();
+    ~AgeComTransport() override;
+
+    bool open() override;
+    void close() override;
+    bool isValid(bool autoConnect) override;
+    bool reconnect() override;
+
+    bool readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout) override;
+    bool readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout) override;
+    bool readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout) override;
+    bool readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout) override;
+
+    bool writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout) override;
+    bool writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout) override;
+    bool writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout) override;
+    bool writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout) override;
+
+    QString name() const override { return "AgeCOM.dll"; }
+    bool getBusInfo(AgeBusInfo &info) override;
+    bool getSerialConfig(DWORD &baudRate, WORD &parity) override;
+    bool setSerialConfig(DWORD baudRate, WORD parity) override;
+
+private:
+    // 路径与授权 (使用 constexpr char* 确保在头文件中定义且无链接错误)
+    static constexpr const char* DLL_RELATIVE_PATH = "/AgeMotionForDriver/x64/AgeCOM.dll";
+    // static constexpr const char* DLL_ABS_PATH = "D:/Project/Git/Git/AutoFocus/AgeMotionForDriver/x64/AgeCOM.dll";
+    static constexpr const char* DLL_ABS_PATH = "D:\\Project\\CHR\\AutoFocus\\AgeMotionForDriver\\x64\\AgeCOM.dll";
+    static constexpr const char* LICENSE_KEY =
+        "AgeMotion-20010203-00000000-0000-0000-0000-0000-0000-0000-0000-0000-"
+        "0000-0000-0000-0000-0000-0000-0000-0000-0000-0000";
+
+    QLibrary m_lib;
+    bool m_authorized = false;
+
+    // --- 函数指针定义 ---
+    typedef BOOL32 (*AgeCOMIsValidFunc)(BOOL32);
+    typedef BOOL32 (*AgeCOMGetUSBIDFunc)(BYTE*);
+    typedef BOOL32 (*AgeCOMReadQWORDFunc)(BYTE, WORD, QWORD&, DWORD);
+    typedef BOOL32 (*AgeCOMGetCOMIDFunc)(WORD&);
+    typedef BOOL32 (*AgeCOMSerialFunc)(BYTE*, DWORD);
+    // 定义函数指针类型
+    typedef BOOL32 (*AgeCOMReadWORDFunc)(BYTE, WORD, WORD&, DWORD);
+    typedef BOOL32 (*AgeCOMWriteWORDFunc)(BYTE, WORD, WORD, DWORD);
+    typedef BOOL32 (*AgeCOMWriteQWORDFunc)(BYTE, WORD, QWORD, DWORD);
+    // 32位读写函数指针类型
+    typedef BOOL32 (*AgeCOMReadDWORDFunc)(BYTE, WORD, DWORD&, DWORD);
+    typedef BOOL32 (*AgeCOMWriteDWORDFunc)(BYTE, WORD, DWORD, DWORD);
+    // 多字块读写 (读最多 125 WORD，写最多 123 WORD)
+    typedef BOOL32 (*AgeCOMReadMWORDFunc)(BYTE, WORD, WORD*, WORD, DWORD);
+    typedef BOOL32 (*AgeCOMWriteMWORDFunc)(BYTE, WORD, WORD*, WORD, DWORD);
+    typedef BOOL32 (*AgeCOMGetBusInfoFunc)(long long&, long long&, long long&, long long&, long long&,
+                                           long long&, long long&, long long&, long long&, long long&,
+                                           long long&, long long&, long long&, long long&);
+    // 主机串口参数 (DLL 1.01.05 以后提供)
+    typedef BOOL32 (*AgeCOMGetCOMFunc)(DWORD&, WORD&);
+    typedef BOOL32 (*AgeCOMSetCOMFunc)(DWORD, WORD);
+
+    // 成员变量
+    AgeCOMReadWORDFunc  m_api_readWORD = nullptr;
+    AgeCOMWriteWORDFunc m_api_writeWORD = nullptr;
+    AgeCOMWriteQWORDFunc m_api_writeQWORD = nullptr;
+    AgeCOMReadDWORDFunc m_api_readDWORD = nullptr;
+    AgeCOMWriteDWORDFunc m_api_writeDWORD = nullptr;
+    AgeCOMReadMWORDFunc m_api_readMWORD = nullptr;
+    AgeCOMWriteMWORDFunc m_api_writeMWORD = nullptr;
+    AgeCOMGetBusInfoFunc m_api_getBusInfo = nullptr;
+    AgeCOMGetCOMFunc    m_api_getCOM = nullptr;
+    AgeCOMSetCOMFunc    m_api_setCOM = nullptr;
+
+    AgeCOMIsValidFunc   m_api_isValid = nullptr;
+    AgeCOMGetUSBIDFunc  m_api_getUSBID = nullptr;
+    AgeCOMReadQWORDFunc m_api_readQWORD = nullptr;
+    AgeCOMGetCOMIDFunc  m_api_getCOMID = nullptr;
+    AgeCOMSerialFunc    m_api_setSerial = nullptr;
+
+    bool loadLibrary();
+    bool authorize();
+};
+
+#endif // AGECOMTRANSPORT_H
@@ -0,0 +1,265 @@
+#include "AgeConnectionManager.h"
+#include <QDebug>
+
+namespace {
+constexpr int DEFAULT_HEALTH_CHECK_INTERVAL_MS = 500;
+}
+
+AgeConnectionManager::AgeConnectionManager(AgeBusThread *bus, QObject *parent)
+    : QObject(parent)
+    , m_bus(bus)
+    , m_retryTimer(new QTimer(this))
+    , m_healthTimer(new QTimer(this))
+    , m_baud(new AgeBaudNegotiator())
+{
+    m_retryTimer->setSingleShot(true);
+    m_healthTimer->setInterval(DEFAULT_HEALTH_CHECK_INTERVAL_MS);
+    connect(m_retryTimer, &QTimer::timeout, this, &AgeConnectionManager::attempt);
+    connect(m_healthTimer, &QTimer::timeout, this, &AgeConnectionManager::checkHealth);
+}
+
+QString AgeConnectionManager::stateName(State state)
+{
+    switch (state) {
+    case State::Idle:         return "Idle";
+    case State::Connecting:   return "Connecting";
+    case State::Connected:    return "Connected";
+    case State::Reconnecting: return "Reconnecting";
+    }
+    return QString();
+}
+
+void AgeConnectionManager::setBackoff(int initialMs, int maxMs)
+{
+    m_initialBackoffMs = qMax(1, initialMs);
+    m_maxBackoffMs = qMax(m_initialBackoffMs, maxMs);
+    m_backoffMs = m_initialBackoffMs;
+}
+
+void AgeConnectionManager::setHealthCheckInterval(int ms)
+{
+    m_healthTimer->setInterval(qMax(1, ms));
+}
+
+void AgeConnectionManager::setBaudOptions(const AgeBaudNegotiator::Options &options)
+{
+    m_baud.reset(new AgeBaudNegotiator(options));
+}
+
+void AgeConnectionManager::start()
+{
+    if (m_state == State::Connected) return;
+    m_backoffMs = m_initialBackoffMs;
+    m_retryTimer->stop();
+    m_busUp = false;    // stop() 期间未做掉线检测，重新确认传输与各轴
+    setState(m_everConnected ? State::Reconnecting : State::Connecting, QString());
+    if (!m_inFlight) attempt();
+}
+
+void AgeConnectionManager::stop()
+{
+    m_retryTimer->stop();
+    m_healthTimer->stop();
+    setState(State::Idle, QString());
+}
+
+void AgeConnectionManager::setState(State state, const QString &message)
+{
+    if (state == m_state && message.isEmpty()) return;
+    m_state = state;
+    emit stateChanged(state, message);
+}
+
+// ==========================================
+//          连接 / 重连 (总线线程执行)
+// ==========================================
+
+void AgeConnectionManager::attempt()
+{
+    if (m_state == State::Idle) return;
+    if (m_inFlight) {
+        // 个别轴重试时健康检查可能仍在进行，稍后再试
+        if (m_busUp && !m_retryTimer->isActive()) m_retryTimer->start(m_initialBackoffMs);
+        return;
+    }
+    m_inFlight = true;
+
+    const bool firstTime = !m_everConnected;
+    const bool busUp = m_busUp;
+    const QVector<AxisLink> axes = m_axes;
+    AgeBusThread *bus = m_bus;
+    const QSharedPointer<AgeBaudNegotiator> baud = m_baudEnabled ? m_baud : QSharedPointer<AgeBaudNegotiator>();
+    QPointer<AgeConnectionManager> guard(this);
+    m_bus->postGroup([bus, firstTime, busUp, axes, baud, guard](const QList<AgeMotionDriver *> &drivers) {
+        AttemptResult r;
+        AgeTransport *transport = drivers.first()->transport();
+        if (baud) {
+            QVector<quint8> stations;
+            for (AgeMotionDriver *driver : drivers) stations.append(driver->station());
+            baud->attach(transport, stations);
+        }
+
+        if (busUp) {
+            // 传输仍在: 只重试未恢复的轴
+            r.ok = true;
+        } else if (firstTime) {
+            // 首次: 打开传输 (DLL: 加载并授权; RTU: 打开串口)，再对齐主机与驱动器的波特率
+            r.ok = transport->open() && transport->isValid(true);
+            if (!r.ok) r.error = transport->lastError();
+        } else {
+            // 重连: 所有轴共用一个传输，只重建一次
+            r.ok = transport->reconnect();
+            if (!r.ok) r.error = transport->lastError();
+        }
+        // 波特率对齐失败时不在此报错，由随后各轴的连接判定
+        if (r.ok && !busUp && baud && !baud->restore()) {
+            qWarning() << "AgeConnectionManager: baud restore failed:" << baud->lastError();
+        }
+
+        if (r.ok) {
+            // 各轴单独判定: 首次完整初始化 (读取默认速度)，之后只写回主机设置过的配置
+            QStringList errors;
+            for (int i = 0; i < drivers.size(); ++i) {
+                AgeMotionDriver *driver = drivers.at(i);
+                AxisLink link = axes.value(i);
+                if (!busUp || !link.up) {
+                    link.up = link.connected ? driver->restoreConnection() : driver->connectDevice();
+                    if (link.up) link.connected = true;
+                    else errors << QString("Station %1: %2").arg((int)driver->station()).arg(driver->getLastError());
+                }
+                r.axes.append(link);
+            }
+            r.error = errors.join("; ");
+
+            // 没有保存的波特率 (或设备已更换) 时升速并保存，下次启动直接使用
+            if (firstTime && errors.isEmpty() && baud && !baud->hasSavedBaud()) {
+                if (baud->negotiate()) r.baudRate = baud->currentBaud();
+                else qWarning() << "AgeConnectionManager: baud negotiation failed:" << baud->lastError();
+            }
+        }
+        for (int i = 0; i < drivers.size(); ++i) r.trips.append(bus->linkState(i).trips);
+
+        if (guard) {
+            QMetaObject::invokeMethod(guard.data(), [guard, r]() {
+                if (guard) guard->onAttemptFinished(r);
+            }, Qt::QueuedConnection);
+        }
+    }, AgeBusThread::Priority::Control);
+}
+
+void AgeConnectionManager::onAttemptFinished(const AttemptResult &result)
+{
+    m_inFlight = false;
+    if (m_state == State::Idle) return;
+
+    if (!result.ok) {
+        m_busUp = false;
+        scheduleRetry(result.error);
+        return;
+    }
+
+    // 只采用本次恢复的轴的断路次数；其余已连接轴的变化留给健康检查
+    m_trips.resize(result.trips.size());
+    for (int i = 0; i < result.trips.size(); ++i) {
+        const bool wasUp = m_busUp && i < m_axes.size() && m_axes.at(i).up;
+        if (!wasUp) m_trips[i] = result.trips.at(i);
+    }
+    m_axes = result.axes;
+
+    m_busUp = true;
+    if (m_state != State::Connected) {
+        const bool firstTime = !m_everConnected;
+        m_everConnected = true;
+        m_backoffMs = m_initialBackoffMs;
+        setState(State::Connected, QString());
+        m_healthTimer->start();
+        emit connected(firstTime);
+        if (result.baudRate > 0) emit baudRateChanged(result.baudRate, "negotiated");
+    }
+
+    // 总线已连接，个别轴未恢复: 只重试这些轴
+    if (!result.error.isEmpty()) {
+        scheduleRetry(result.error);
+        return;
+    }
+    m_backoffMs = m_initialBackoffMs;
+}
+
+void AgeConnectionManager::scheduleRetry(const QString &error)
+{
+    qWarning() << "AgeConnectionManager:" << stateName(m_state) << "failed, retry in" << m_backoffMs << "ms:" << error;
+    setState(m_state, QString("%1, retry in %2 ms").arg(error).arg(m_backoffMs));
+    m_retryTimer->start(m_backoffMs);
+    m_backoffMs = qMin(m_backoffMs * 2, m_maxBackoffMs);
+}
+
+// ==========================================
+//          掉线检测
+// ==========================================
+
+void AgeConnectionManager::checkHealth()
+{
+    if (m_state != State::Connected || m_inFlight) return;
+    m_inFlight = true;
+
+    AgeBusThread *bus = m_bus;
+    const QSharedPointer<AgeBaudNegotiator> baud = m_baudEnabled ? m_baud : QSharedPointer<AgeBaudNegotiator>();
+    QPointer<AgeConnectionManager> guard(this);
+    m_bus->postGroup([bus, baud, guard](const QList<AgeMotionDriver *> &drivers) {
+        Health h;
+        // 持续帧错误: 降一级波特率 (在读取断路状态之前，降级成功后各站号已确认应答)
+        if (baud && baud->checkLinkQuality()) {
+            h.fellBack = true;
+            if (baud->fallback()) h.baudRate = baud->currentBaud();
+            else h.baudError = baud->lastError();
+        }
+        for (int i = 0; i < drivers.size(); ++i) {
+            const AgeLinkState link = bus->linkState(i);
+            h.open.append(link.breaker == AgeLinkState::Breaker::Open);
+            h.trips.append(link.trips);
+        }
+        if (guard) {
+            QMetaObject::invokeMethod(guard.data(), [guard, h]() {
+                if (guard) guard->onHealth(h);
+            }, Qt::QueuedConnection);
+        }
+    }, AgeBusThread::Priority::Telemetry);
+}
+
+void AgeConnectionManager::onHealth(const Health &health)
+{
+    m_inFlight = false;
+    if (m_state != State::Connected) return;
+    if (health.fellBack) {
+        // 降级过程中试探其他波特率造成的断路不算掉线
+        m_trips = health.trips;
+        if (health.baudRate > 0) emit baudRateChanged(health.baudRate, "frame errors");
+        else qWarning() << "AgeConnectionManager: baud fallback failed:" << health.baudError;
+    }
+
+    // 断路次数变化: 期间已断开过，即使探测已恢复也要写回配置；未恢复的轴已在重试中
+    QStringList lost;
+    int upCount = 0;
+    for (int i = 0; i < m_axes.size(); ++i) {
+        if (!m_axes.at(i).up) continue;
+        ++upCount;
+        if (health.open.value(i) || health.trips.value(i) != m_trips.value(i)) {
+            m_axes[i].up = false;
+            lost << QString("axis %1").arg(i);
+        }
+    }
+    if (lost.isEmpty()) return;
+
+    m_backoffMs = m_initialBackoffMs;
+    m_retryTimer->stop();
+    if (lost.size() == upCount) {
+        // 全部轴都断开: 视为总线掉线，重建传输
+        m_busUp = false;
+        m_healthTimer->stop();
+        setState(State::Reconnecting, "Link lost");
+    } else {
+        // 个别轴掉线: 传输仍在，只恢复这些轴
+        setState(State::Connected, QString("Link lost (%1)").arg(lost.join(", ")));
+    }
+    attempt();
+}
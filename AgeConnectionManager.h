@@ -0,0 +1,103 @@
+#ifndef AGECONNECTIONMANAGER_H
+#define AGECONNECTIONMANAGER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include "AgeBaudNegotiator.h"
+#include "AgeBusThread.h"
+
+// ==========================================
+//   连接管理：首次连接、掉线检测与后台重连
+// ==========================================
+// - start() 后首次连接失败按退避间隔自动重试，无需再次点击
+// - 连接后定时检查各站号的断路状态 (AgeResilientTransport)，
+//   断路过 (即使探测已恢复) 都视为掉线：驱动器可能断过电，配置需要写回
+// - 重连不卸载 DLL、不重新授权 (AgeTransport::reconnect())，
+//   各轴经 AgeMotionDriver::restoreConnection() 恢复主机设置过的配置，不重读默认速度
+// - 传输打开/重建成功即视为总线已连接；个别轴连接或恢复失败时单独按退避重试该轴，
+//   不再重建传输；只有全部已连接的轴都断开才视为总线掉线
+// - 波特率协商 (默认关闭，setBaudNegotiation(true) 开启；界面: AGEMOTION_BAUD_NEGOTIATE=1，
+//   agecli: --serve --negotiate-baud): 首次连接前按保存的波特率对齐主机与驱动器，
+//   没有保存值时连接后升速；健康检查发现持续帧错误时降一级 (AgeBaudNegotiator)
+// - 所有总线操作都在总线线程执行；本对象的定时器与信号在其所属线程 (GUI)
+class AgeConnectionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class State {
+        Idle,           // 未启动或已 stop()
+        Connecting,     // 首次连接 (含重试)
+        Connected,
+        Reconnecting    // 掉线后重连
+    };
+
+    explicit AgeConnectionManager(AgeBusThread *bus, QObject *parent = nullptr);
+
+    // 开始连接并保持；正在重试时立即再试一次 (重置退避)，已连接时无操作
+    void start();
+    // 停止检测与重连 (不断开已有连接)
+    void stop();
+
+    State state() const { return m_state; }
+    static QString stateName(State state);
+
+    // 重试间隔从 initialMs 起逐次加倍至 maxMs
+    void setBackoff(int initialMs, int maxMs);
+    void setHealthCheckInterval(int ms);
+    // 波特率协商开关与参数，须在 start() 之前设置
+    void setBaudNegotiation(bool enabled) { m_baudEnabled = enabled; }
+    void setBaudOptions(const AgeBaudNegotiator::Options &options);
+
+signals:
+    void stateChanged(AgeConnectionManager::State state, const QString &message);
+    // 首次连接成功 (firstTime = true) 或重连成功
+    void connected(bool firstTime);
+    // 协商升速或因帧错误降级后的总线波特率
+    void baudRateChanged(int baudRate, const QString &reason);
+
+private:
+    struct AxisLink {
+        bool connected = false;   // 完成过 connectDevice()，之后走 restoreConnection()
+        bool up = false;          // 当前已连接/恢复
+    };
+    struct AttemptResult {
+        bool ok = false;          // 传输已打开/重建 (总线已连接)
+        QString error;            // 总线错误，或未恢复各轴的错误
+        QVector<AxisLink> axes;
+        QVector<quint64> trips;   // 按轴，连接完成时的断路次数
+        int baudRate = 0;         // 本次协商后的波特率 (0 = 未协商)
+    };
+    struct Health {
+        QVector<bool> open;       // 按轴，断路器是否打开
+        QVector<quint64> trips;
+        bool fellBack = false;    // 因帧错误降过波特率 (期间的断路不算掉线)
+        int baudRate = 0;
+        QString baudError;
+    };
+
+    void attempt();
+    void onAttemptFinished(const AttemptResult &result);
+    void checkHealth();
+    void onHealth(const Health &health);
+    void scheduleRetry(const QString &error);
+    void setState(State state, const QString &message);
+
+    AgeBusThread *m_bus;
+    QTimer *m_retryTimer;
+    QTimer *m_healthTimer;
+    State m_state = State::Idle;
+    bool m_everConnected = false;  // 之后的连接走 reconnect()
+    bool m_busUp = false;          // 传输已连接，重试只针对未恢复的轴
+    QVector<AxisLink> m_axes;
+    bool m_inFlight = false;       // 总线线程上有未完成的连接/检查
+    int m_initialBackoffMs = 250;
+    int m_maxBackoffMs = 8000;
+    int m_backoffMs = 250;
+    QVector<quint64> m_trips;
+    bool m_baudEnabled = false;
+    QSharedPointer<AgeBaudNegotiator> m_baud;  // 只在总线线程上使用
+};
+
+#endif // AGECONNECTIONMANAGER_H
@@ -0,0 +1,225 @@
+#include "AgeDiscovery.h"
+#include <QElapsedTimer>
+#include <QSerialPortInfo>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "AgeMotionDriver.h"
+#include "AgeRtuFrame.h"
+#include "AgeRtuTransport.h"
+
+namespace {
+
+constexpr int DRIVER_NAME_WORDS = 16;
+constexpr int PROBE_REQUEST_BYTES = 8;    // FC03 请求
+constexpr int PROBE_RESPONSE_BYTES = 7;   // FC03 读 1 字的应答
+
+qint64 nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+QStringList AgeDiscovery::availablePorts()
+{
+    QStringList ports;
+    for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts()) ports << info.portName();
+    return ports;
+}
+
+// 与 AgeRtuTransport 自动超时相同: 探测帧线路时间 + 默认应答余量
+int AgeDiscovery::normalTimeoutMs(int baudRate)
+{
+    const qint64 wireUs = AgeRtu::wireTimeUs(PROBE_REQUEST_BYTES + PROBE_RESPONSE_BYTES, baudRate);
+    return (int)((wireUs + 999) / 1000) + AgeRtuTransport::Config().responseMarginMs;
+}
+
+int AgeDiscovery::probeTimeoutMs(const Options &options, int baudRate)
+{
+    return options.probeTimeoutMs > 0 ? options.probeTimeoutMs : normalTimeoutMs(baudRate);
+}
+
+// 型号字符串: 每字两个字符，高字节在前，以 0 结尾
+QString AgeDiscovery::decodeName(const WORD *words, int count)
+{
+    QByteArray bytes;
+    for (int i = 0; i < count; ++i) {
+        const char hi = (char)(words[i] >> 8);
+        const char lo = (char)(words[i] & 0xFF);
+        if (hi == 0) break;
+        bytes.append(hi);
+        if (lo == 0) break;
+        bytes.append(lo);
+    }
+    return QString::fromLatin1(bytes).trimmed();
+}
+
+// ==========================================
+//          单个串口
+// ==========================================
+
+QVector<AgeDiscoveredDevice> AgeDiscovery::scanPort(const QString &portName, const Options &options,
+                                                    PortReport &report)
+{
+    QElapsedTimer timer;
+    timer.start();
+    report.portName = portName;
+    QVector<AgeDiscoveredDevice> devices;
+
+    for (int baudRate : options.baudRates) {
+        QSharedPointer<AgeTransport> transport;
+        if (options.transportFactory) {
+            transport = options.transportFactory(portName, baudRate);
+        } else {
+            AgeRtuTransport::Config config;
+            config.portName = portName;
+            config.baudRate = baudRate;
+            transport.reset(new AgeRtuTransport(config));
+        }
+        if (!transport->open()) {
+            // 打开失败与波特率无关 (不存在或被占用)，不再尝试其他波特率
+            report.error = transport->lastError();
+            break;
+        }
+        report.opened = true;
+
+        // 1. 逐个站号探测；提前返回的失败说明收到了数据 (校验错、错位、异常应答)，留待复查
+        const int timeoutMs = probeTimeoutMs(options, baudRate);
+        QVector<quint8> present;
+        QVector<qint64> responseUs;
+        QVector<quint8> suspects;
+        QVector<quint8> silent;
+        // 超时后才到达的应答在下一帧发送前被丢弃，只能从 lateRxBytes 的增加得知，归于上一个超时的站号
+        AgeBusInfo info;
+        qint64 lateBytes = transport->getBusInfo(info) ? info.lateRxBytes : 0;
+        for (int station = options.firstStation; station <= options.lastStation; ++station) {
+            WORD value = 0;
+            const qint64 t0 = nowUs();
+            const bool ok = transport->readWORD((BYTE)station, AgeReg::ADDR_DRIVER_NAME, value, (DWORD)timeoutMs);
+            const qint64 elapsedUs = nowUs() - t0;
+            ++report.probes;
+            if (transport->getBusInfo(info) && info.lateRxBytes > lateBytes) {
+                lateBytes = info.lateRxBytes;
+                if (!silent.isEmpty() && silent.last() == station - 1) suspects.append(silent.takeLast());
+            }
+            if (ok) {
+                present.append((quint8)station);
+                responseUs.append(elapsedUs);
+            } else if (elapsedUs + 1000 < (qint64)timeoutMs * 1000) {
+                suspects.append((quint8)station);
+            } else {
+                silent.append((quint8)station);
+            }
+        }
+
+        // 2. 复查 (自动超时): 可疑站号；探测超时短于正常超时时还包括全部无应答的站号，
+        //    否则只复查最后一个 (其迟到的应答没有下一帧探测可以发现)
+        if (timeoutMs < normalTimeoutMs(baudRate)) {
+            suspects += silent;
+        } else if (!silent.isEmpty() && silent.last() == options.lastStation) {
+            suspects.append(silent.last());
+        }
+        std::sort(suspects.begin(), suspects.end());
+        for (quint8 station : suspects) {
+            WORD value = 0;
+            const qint64 t0 = nowUs();
+            ++report.probes;
+            if (transport->readWORD(station, AgeReg::ADDR_DRIVER_NAME, value, 0)) {
+                present.append(station);
+                responseUs.append(nowUs() - t0);
+            }
+        }
+
+        // 3. 读取型号与序列号
+        for (int i = 0; i < present.size(); ++i) {
+            AgeDiscoveredDevice device;
+            device.portName = portName;
+            device.baudRate = baudRate;
+            device.station = present[i];
+            device.responseUs = responseUs[i];
+            WORD name[DRIVER_NAME_WORDS] = {};
+            if (transport->readMWORD(device.station, AgeReg::ADDR_DRIVER_NAME, name, DRIVER_NAME_WORDS, 0)) {
+                device.driverName = decodeName(name, DRIVER_NAME_WORDS);
+            }
+            QWORD serial = 0;
+            if (transport->readQWORD(device.station, AgeReg::ADDR_MOTOR_SN0, serial, 0)) {
+                device.motorSerial = serial;
+            }
+            devices.append(device);
+        }
+        transport->close();
+
+        if (!devices.isEmpty() && options.stopAtFirstBaud) break;
+    }
+
+    std::sort(devices.begin(), devices.end(), [](const AgeDiscoveredDevice &a, const AgeDiscoveredDevice &b) {
+        return a.baudRate != b.baudRate ? a.baudRate < b.baudRate : a.station < b.station;
+    });
+    report.elapsedMs = timer.elapsed();
+    return devices;
+}
+
+// ==========================================
+//          全部串口 (并行)
+// ==========================================
+
+AgeDiscovery::Result AgeDiscovery::scanAll(const Options &options)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const QStringList ports = options.ports.isEmpty() ? availablePorts() : options.ports;
+
+    // 每个串口一个线程，传输在线程内创建 (QSerialPort 的线程归属)
+    typedef std::pair<PortReport, QVector<AgeDiscoveredDevice>> PortResult;
+    std::vector<std::future<PortResult>> jobs;
+    for (const QString &port : ports) {
+        jobs.push_back(std::async(std::launch::async, [port, options]() {
+            PortResult r;
+            r.second = scanPort(port, options, r.first);
+            return r;
+        }));
+    }
+
+    Result result;
+    for (auto &job : jobs) {
+        const PortResult r = job.get();
+        result.ports.append(r.first);
+        for (const AgeDiscoveredDevice &device : r.second) result.devices.append(device);
+    }
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+std::future<AgeDiscovery::Result> AgeDiscovery::scan(const Options &options)
+{
+    return std::async(std::launch::async, [options]() { return scanAll(options); });
+}
+
+QString AgeDiscovery::formatTable(const Result &result)
+{
+    QStringList lines;
+    lines << QString("%1 %2 %3 %4 %5 %6")
+                 .arg("port", -12).arg("baud", 7).arg("station", 7)
+                 .arg("driver", -20).arg("motor SN", -18).arg("rtt(ms)", 7);
+    for (const AgeDiscoveredDevice &d : result.devices) {
+        lines << QString("%1 %2 %3 %4 %5 %6")
+                     .arg(d.portName, -12).arg(d.baudRate, 7).arg((int)d.station, 7)
+                     .arg(d.driverName.isEmpty() ? QString("?") : d.driverName, -20)
+                     .arg(QString("0x%1").arg(d.motorSerial, 16, 16, QChar('0')), -18)
+                     .arg(d.responseUs / 1000.0, 7, 'f', 2);
+    }
+    if (result.devices.isEmpty()) lines << "(no devices found)";
+
+    lines << QString();
+    for (const PortReport &p : result.ports) {
+        if (p.opened) {
+            lines << QString("%1: %2 probes in %3 ms").arg(p.portName).arg(p.probes).arg(p.elapsedMs);
+        } else {
+            lines << QString("%1: not scanned (%2)").arg(p.portName, p.error);
+        }
+    }
+    lines << QString("Total: %1 ms").arg(result.elapsedMs);
+    return lines.join("\n");
+}
@@ -0,0 +1,80 @@
+#ifndef AGEDISCOVERY_H
+#define AGEDISCOVERY_H
+
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <future>
+#include "AgeTransport.h"
+
+// 扫描到的驱动器
+struct AgeDiscoveredDevice
+{
+    QString portName;
+    int baudRate = 0;
+    quint8 station = 0;
+    QString driverName;       // ADDR_DRIVER_NAME
+    quint64 motorSerial = 0;  // ADDR_MOTOR_SN0
+    qint64 responseUs = 0;    // 探测帧的往返时间
+};
+
+// ==========================================
+//   设备发现：并行扫描串口与站号
+// ==========================================
+// - 每个串口一个线程，各自建立原生 RTU 传输，串口之间完全并行
+// - RTU 为半双工，同一串口上一次只能有一个未完成的请求，站号探测因此逐个紧接发送；
+//   探测超时默认与正常事务相同 (线路时间 + AgeRtuTransport 应答余量，115200 下约 22 ms)，
+//   247 个站号约 5-6 s；可指定更短的探测超时加快扫描，此时无应答的站号以正常超时复查
+// - 探测只读 1 个字 (ADDR_DRIVER_NAME)；有应答的站号再用正常超时读完整型号与序列号
+// - 校验错或应答错位的站号 (可能是两台同号设备冲突)、以及超时后应答才到达的站号
+//   (下一帧发送前丢弃，见 AgeBusInfo::lateRxBytes) 在扫描末尾以正常超时复查一次
+// - 被占用的串口 (如已由 AgeCOM.dll 或总线线程打开) 报告打开失败并跳过，扫描应在连接之前进行
+class AgeDiscovery
+{
+public:
+    // 按串口名与波特率创建传输 (在扫描线程中调用)；默认为 AgeRtuTransport
+    typedef std::function<QSharedPointer<AgeTransport>(const QString &portName, int baudRate)> TransportFactory;
+
+    struct Options {
+        QStringList ports;                  // 空 = 全部可用串口 (QSerialPortInfo)
+        QList<int> baudRates{115200};       // 依次尝试
+        int firstStation = 1;
+        int lastStation = 247;
+        int probeTimeoutMs = 0;             // 0 = 正常超时 (normalTimeoutMs)
+        bool stopAtFirstBaud = true;        // 某个波特率下找到设备后不再尝试其他波特率
+        TransportFactory transportFactory;  // 空 = AgeRtuTransport (偶校验)
+    };
+
+    struct PortReport {
+        QString portName;
+        bool opened = false;
+        QString error;
+        int probes = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    struct Result {
+        QVector<AgeDiscoveredDevice> devices;   // 按串口、站号排序
+        QVector<PortReport> ports;
+        qint64 elapsedMs = 0;
+    };
+
+    // 扫描全部串口 (各串口并行)，阻塞至全部完成
+    static Result scanAll(const Options &options);
+    // 同上，在后台线程中执行
+    static std::future<Result> scan(const Options &options);
+    // 在当前线程中扫描单个串口 (全部波特率)
+    static QVector<AgeDiscoveredDevice> scanPort(const QString &portName, const Options &options,
+                                                 PortReport &report);
+
+    static QStringList availablePorts();
+    // 表格文本，供界面与命令行显示
+    static QString formatTable(const Result &result);
+
+private:
+    static int probeTimeoutMs(const Options &options, int baudRate);
+    static int normalTimeoutMs(int baudRate);
+    static QString decodeName(const WORD *words, int count);
+};
+
+#endif // AGEDISCOVERY_H
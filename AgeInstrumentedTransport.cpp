@@ -0,0 +1,262 @@
+#include "AgeInstrumentedTransport.h"
+#include "AgeTrace.h"
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+
+AgeInstrumentedTransport::AgeInstrumentedTransport(QSharedPointer<AgeTransport> inner)
+    : m_inner(inner)
+    , m_sinceUs(nowUs())
+{
+}
+
+qint64 AgeInstrumentedTransport::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char *AgeInstrumentedTransport::opName(int op)
+{
+    static const char *names[OP_COUNT] = {
+        "readWORD", "readDWORD", "readQWORD", "readMWORD",
+        "writeWORD", "writeDWORD", "writeQWORD", "writeMWORD"
+    };
+    return (op >= 0 && op < OP_COUNT) ? names[op] : "?";
+}
+
+bool AgeInstrumentedTransport::finish(Op op, WORD reg, qint64 startUs, bool ok)
+{
+    const qint64 elapsedUs = nowUs() - startUs;
+    const quint32 key = ((quint32)op << 16) | reg;
+
+    Entry *entry = m_index.value(key, nullptr);
+    if (!entry) {
+        m_entries.emplace_back(new Entry());
+        entry = m_entries.back().get();
+        entry->key = key;
+        m_index.insert(key, entry);
+    }
+    entry->latency.record(elapsedUs);
+    AGE_TRACE_RECORD("bus", opName(op), startUs, elapsedUs, reg);
+    if (!ok) {
+        ++entry->errors;
+        m_lastError = m_inner->lastError();
+    }
+    m_lastException = !ok && m_inner->lastFailureWasException();
+    return ok;
+}
+
+// ==========================================
+//          链路管理 (直接转发)
+// ==========================================
+
+bool AgeInstrumentedTransport::open()
+{
+    const bool ok = m_inner->open();
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+void AgeInstrumentedTransport::close()
+{
+    m_inner->close();
+}
+
+bool AgeInstrumentedTransport::isValid(bool autoConnect)
+{
+    const bool ok = m_inner->isValid(autoConnect);
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+bool AgeInstrumentedTransport::reconnect()
+{
+    const bool ok = m_inner->reconnect();
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+bool AgeInstrumentedTransport::getBusInfo(AgeBusInfo &info)
+{
+    const bool ok = m_inner->getBusInfo(info);
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+bool AgeInstrumentedTransport::getSerialConfig(DWORD &baudRate, WORD &parity)
+{
+    const bool ok = m_inner->getSerialConfig(baudRate, parity);
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+bool AgeInstrumentedTransport::setSerialConfig(DWORD baudRate, WORD parity)
+{
+    const bool ok = m_inner->setSerialConfig(baudRate, parity);
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+// ==========================================
+//          寄存器读写 (计时后转发)
+// ==========================================
+
+bool AgeInstrumentedTransport::readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(ReadWORD, reg, t0, m_inner->readWORD(station, reg, data, timeout));
+}
+
+bool AgeInstrumentedTransport::readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(ReadDWORD, reg, t0, m_inner->readDWORD(station, reg, data, timeout));
+}
+
+bool AgeInstrumentedTransport::readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(ReadQWORD, reg, t0, m_inner->readQWORD(station, reg, data, timeout));
+}
+
+bool AgeInstrumentedTransport::readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(ReadMWORD, reg, t0, m_inner->readMWORD(station, reg, data, count, timeout));
+}
+
+bool AgeInstrumentedTransport::writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(WriteWORD, reg, t0, m_inner->writeWORD(station, reg, data, timeout));
+}
+
+bool AgeInstrumentedTransport::writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(WriteDWORD, reg, t0, m_inner->writeDWORD(station, reg, data, timeout));
+}
+
+bool AgeInstrumentedTransport::writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(WriteQWORD, reg, t0, m_inner->writeQWORD(station, reg, data, timeout));
+}
+
+bool AgeInstrumentedTransport::writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout)
+{
+    const qint64 t0 = nowUs();
+    return finish(WriteMWORD, reg, t0, m_inner->writeMWORD(station, reg, data, count, timeout));
+}
+
+// ==========================================
+//          统计汇总
+// ==========================================
+
+void AgeInstrumentedTransport::collect(AgeBusDiagnostics &diag)
+{
+    diag.rows.clear();
+    AgeLatencyHistogram total;
+    quint64 totalErrors = 0;
+
+    // 按 key 排序输出 (操作优先，其次寄存器)
+    std::vector<const Entry *> sorted;
+    sorted.reserve(m_entries.size());
+    for (const auto &entry : m_entries) sorted.push_back(entry.get());
+    std::sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) { return a->key < b->key; });
+
+    for (const Entry *entry : sorted) {
+        if (entry->latency.count() == 0) continue;
+        diag.rows.append(AgeBusDiagnostics::makeRow(opName((int)(entry->key >> 16)), (int)(entry->key & 0xFFFF),
+                                                    entry->latency, entry->errors));
+        total.merge(entry->latency);
+        totalErrors += entry->errors;
+    }
+    diag.transportTotal = AgeBusDiagnostics::makeRow("total", -1, total, totalErrors);
+    diag.windowMs = (nowUs() - m_sinceUs) / 1000;
+    diag.transportName = name();
+    diag.hasBusInfo = m_inner->getBusInfo(diag.busInfo);
+}
+
+void AgeInstrumentedTransport::reset()
+{
+    for (auto &entry : m_entries) {
+        entry->latency.reset();
+        entry->errors = 0;
+    }
+    m_sinceUs = nowUs();
+}
+
+// ==========================================
+//          诊断报告
+// ==========================================
+
+AgeBusDiagnostics::Row AgeBusDiagnostics::makeRow(const QString &op, int reg,
+                                                  const AgeLatencyHistogram &h, quint64 errors)
+{
+    Row row;
+    row.op = op;
+    row.reg = reg;
+    row.count = h.count();
+    row.errors = errors;
+    row.p50Us = h.percentile(0.50);
+    row.p99Us = h.percentile(0.99);
+    row.maxUs = h.max();
+    return row;
+}
+
+QString AgeBusDiagnostics::toText() const
+{
+    auto line = [](const Row &r) {
+        const QString reg = r.reg < 0 ? QString("     -") : QString("0x%1").arg(r.reg, 4, 16, QChar('0'));
+        return QString("%1 %2 %3 %4 %5 %6 %7")
+            .arg(r.op, -11).arg(reg, 6)
+            .arg(r.count, 8).arg(r.errors, 6)
+            .arg(r.p50Us, 9).arg(r.p99Us, 9).arg(r.maxUs, 9);
+    };
+
+    QStringList lines;
+    lines << QString("Transport: %1   window: %2 s").arg(transportName).arg(windowMs / 1000.0, 0, 'f', 1);
+    lines << QString("%1 %2 %3 %4 %5 %6 %7")
+                 .arg("op", -11).arg("reg", 6).arg("count", 8).arg("err", 6)
+                 .arg("p50(us)", 9).arg("p99(us)", 9).arg("max(us)", 9);
+    for (const Row &r : rows) lines << line(r);
+    lines << line(transportTotal);
+    lines << QString();
+    lines << "Bus thread:";
+    lines << line(queueWait);
+    lines << line(jobRun);
+
+    if (!links.isEmpty()) {
+        lines << QString();
+        lines << "Links:";
+        for (const AgeLinkState &l : links) {
+            QString line = QString("  station %1  %2  srtt %3 ms  rttvar %4 ms  timeout %5")
+                               .arg(l.station, 3)
+                               .arg(l.breaker == AgeLinkState::Breaker::Open ? "DOWN" : "up  ")
+                               .arg(l.srttUs / 1000.0, 0, 'f', 2).arg(l.rttvarUs / 1000.0, 0, 'f', 2)
+                               .arg(l.timeoutMs > 0 ? QString("%1 ms").arg(l.timeoutMs) : QString("auto"));
+            line += QString("  trips %1  fast-failed %2").arg(l.trips).arg(l.shortCircuited);
+            if (l.breaker == AgeLinkState::Breaker::Open) line += QString("  probe in %1 ms").arg(l.nextProbeInMs);
+            lines << line;
+        }
+    }
+
+    lines << QString();
+    if (hasBusInfo) {
+        lines << "Link counters (AgeCOMGetBusInfo):";
+        lines << QString("  ops %1  busErr %2  hostErr %3")
+                     .arg(busInfo.busOpCounts).arg(busInfo.busOpErrors).arg(busInfo.hostErrors);
+        lines << QString("  tx %1 frames / %2 B  txErr %3")
+                     .arg(busInfo.txFrames).arg(busInfo.txBytes).arg(busInfo.txFrameErrors);
+        lines << QString("  rx %1 frames / %2 B  rxErr %3")
+                     .arg(busInfo.rxFrames).arg(busInfo.rxBytes).arg(busInfo.rxFrameErrors);
+        lines << QString("  op time last %1 / min %2 / max %3 ms, bus %4 of host %5 ms")
+                     .arg(busInfo.lastOpTime).arg(busInfo.minOpTime).arg(busInfo.maxOpTime)
+                     .arg(busInfo.busRunTime).arg(busInfo.hostRunTime);
+    } else {
+        lines << "Link counters: not available";
+    }
+    return lines.join("\n");
+}
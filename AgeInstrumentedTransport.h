@@ -0,0 +1,101 @@
+#ifndef AGEINSTRUMENTEDTRANSPORT_H
+#define AGEINSTRUMENTEDTRANSPORT_H
+
+#include <QHash>
+#include <QVector>
+#include <memory>
+#include <vector>
+#include "AgeTransport.h"
+#include "AgeLatencyHistogram.h"
+#include "AgeResilientTransport.h"
+
+// 总线诊断报告 (值类型，可跨线程传递)
+struct AgeBusDiagnostics
+{
+    struct Row {
+        QString op;              // readWORD / writeMWORD ...
+        int reg = -1;            // 寄存器地址，-1 表示非寄存器操作的汇总行
+        quint64 count = 0;
+        quint64 errors = 0;
+        qint64 p50Us = 0;
+        qint64 p99Us = 0;
+        qint64 maxUs = 0;
+    };
+
+    QVector<Row> rows;           // 按 (操作, 寄存器) 统计的传输层耗时
+    Row transportTotal;          // 全部传输调用
+    Row queueWait;               // 命令入队到开始执行 (总线线程调度)
+    Row jobRun;                  // 命令执行总耗时 (含传输)
+    qint64 windowMs = 0;         // 统计区间长度
+    bool hasBusInfo = false;     // 下列链路层计数是否有效
+    AgeBusInfo busInfo;
+    QString transportName;
+    QVector<AgeLinkState> links; // 各站号的往返时间估计与断路状态
+
+    // 多行文本，供界面与日志显示
+    QString toText() const;
+    static Row makeRow(const QString &op, int reg, const AgeLatencyHistogram &h, quint64 errors);
+};
+
+// ==========================================
+//   带耗时统计的传输装饰器
+// ==========================================
+// - 包装任意 AgeTransport，按 (操作, 寄存器) 记录每次调用的耗时直方图与失败次数
+// - 热路径开销: 两次单调时钟读取 + 一次哈希查找 + 直方图自增；首次出现的组合分配一次
+// - 不加锁: 只能在调用读写函数的线程 (总线线程) 中读取统计
+class AgeInstrumentedTransport : public AgeTransport
+{
+public:
+    enum Op {
+        ReadWORD = 0, ReadDWORD, ReadQWORD, ReadMWORD,
+        WriteWORD, WriteDWORD, WriteQWORD, WriteMWORD,
+        OP_COUNT
+    };
+
+    explicit AgeInstrumentedTransport(QSharedPointer<AgeTransport> inner);
+
+    QSharedPointer<AgeTransport> inner() const { return m_inner; }
+
+    bool open() override;
+    void close() override;
+    bool isValid(bool autoConnect) override;
+    bool reconnect() override;
+
+    bool readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout) override;
+    bool readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout) override;
+    bool readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout) override;
+    bool readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout) override;
+
+    bool writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout) override;
+    bool writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout) override;
+    bool writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout) override;
+    bool writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout) override;
+
+    QString name() const override { return m_inner->name(); }
+    bool getBusInfo(AgeBusInfo &info) override;
+    bool getSerialConfig(DWORD &baudRate, WORD &parity) override;
+    bool setSerialConfig(DWORD baudRate, WORD parity) override;
+
+    // 填充 rows / transportTotal / busInfo 部分
+    void collect(AgeBusDiagnostics &diag);
+    void reset();
+
+    static const char *opName(int op);
+    static qint64 nowUs();
+
+private:
+    struct Entry {
+        quint32 key = 0;
+        AgeLatencyHistogram latency;
+        quint64 errors = 0;
+    };
+
+    bool finish(Op op, WORD reg, qint64 startUs, bool ok);
+
+    QSharedPointer<AgeTransport> m_inner;
+    QHash<quint32, Entry *> m_index;                 // key = op << 16 | reg
+    std::vector<std::unique_ptr<Entry>> m_entries;   // 拥有 Entry，地址稳定
+    qint64 m_sinceUs = 0;
+};
+
+#endif // AGEINSTRUMENTEDTRANSPORT_H
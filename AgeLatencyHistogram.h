@@ -0,0 +1,99 @@
+#ifndef AGELATENCYHISTOGRAM_H
+#define AGELATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <cstring>
+
+// ==========================================
+//   对数-线性延迟直方图 (HDR 风格，单位微秒)
+// ==========================================
+// - 每个 2 的幂区间再均分 32 格，相对误差 < 3.2%；范围 0 ~ 134 s，超出按上限计
+// - record() 只做几次位运算和一次自增，无分配、无锁；只在一个线程中使用
+// - 百分位返回所在格的上界 (偏保守)，不超过实际记录到的最大值
+class AgeLatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS = 5;                       // 每个区间 32 格
+    static constexpr int VALUE_BITS = 27;                    // 上限 2^27 us
+    static constexpr int BUCKETS = (VALUE_BITS - SUB_BITS + 1) << SUB_BITS;
+    static constexpr qint64 MAX_VALUE = (Q_INT64_C(1) << VALUE_BITS) - 1;
+
+    AgeLatencyHistogram() { reset(); }
+
+    void reset()
+    {
+        memset(m_counts, 0, sizeof(m_counts));
+        m_total = 0;
+        m_min = 0;
+        m_max = 0;
+        m_sum = 0;
+    }
+
+    void record(qint64 us)
+    {
+        if (us < 0) us = 0;
+        if (us > MAX_VALUE) us = MAX_VALUE;
+        ++m_counts[bucketOf((quint64)us)];
+        if (m_total == 0 || us < m_min) m_min = us;
+        if (us > m_max) m_max = us;
+        m_sum += us;
+        ++m_total;
+    }
+
+    void merge(const AgeLatencyHistogram &other)
+    {
+        if (other.m_total == 0) return;
+        for (int i = 0; i < BUCKETS; ++i) m_counts[i] += other.m_counts[i];
+        if (m_total == 0 || other.m_min < m_min) m_min = other.m_min;
+        if (other.m_max > m_max) m_max = other.m_max;
+        m_sum += other.m_sum;
+        m_total += other.m_total;
+    }
+
+    quint64 count() const { return m_total; }
+    qint64 min() const { return m_min; }
+    qint64 max() const { return m_max; }
+    double mean() const { return m_total ? (double)m_sum / m_total : 0.0; }
+
+    // q 取 0..1，例如 0.5 / 0.99
+    qint64 percentile(double q) const
+    {
+        if (m_total == 0) return 0;
+        quint64 rank = (quint64)(q * m_total + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > m_total) rank = m_total;
+
+        quint64 seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += m_counts[i];
+            if (seen >= rank) return qMin(upperBoundOf(i), m_max);
+        }
+        return m_max;
+    }
+
+private:
+    static int bucketOf(quint64 v)
+    {
+        if (v < (1u << SUB_BITS)) return (int)v;
+        const int msb = 63 - (int)qCountLeadingZeroBits(v);
+        const int shift = msb - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + (int)((v >> shift) - (1u << SUB_BITS));
+    }
+
+    static qint64 upperBoundOf(int index)
+    {
+        if (index < (1 << SUB_BITS)) return index;
+        const int shift = (index >> SUB_BITS) - 1;
+        const qint64 low = (qint64)((index & ((1 << SUB_BITS) - 1)) + (1 << SUB_BITS)) << shift;
+        return low + (Q_INT64_C(1) << shift) - 1;
+    }
+
+    quint32 m_counts[BUCKETS];
+    quint64 m_total;
+    qint64 m_min;
+    qint64 m_max;
+    qint64 m_sum;
+};
+
+#endif // AGELATENCYHISTOGRAM_H
@@ -0,0 +1,114 @@
+#include "AgeMotionAsync.h"
+
+AgeMotionAsync::AgeMotionAsync(AgeBusThread *bus, int axis)
+    : m_bus(bus)
+    , m_axis(axis)
+{
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::connectDevice()
+{
+    return submitBool([](AgeMotionDriver &driver) {
+        return driver.connectDevice();
+    }, AgeBusThread::Priority::Command);
+}
+
+// ==========================================
+//          运动命令
+// ==========================================
+
+std::future<BusResult<bool>> AgeMotionAsync::moveTo(double positionUm, double velocityUmPerSec)
+{
+    return submitBool([positionUm, velocityUmPerSec](AgeMotionDriver &driver) {
+        return driver.moveTo(positionUm, velocityUmPerSec);
+    }, AgeBusThread::Priority::Command);
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::setTargetPosition(double positionUm)
+{
+    return submitBool([positionUm](AgeMotionDriver &driver) {
+        return driver.setTargetPosition(positionUm);
+    }, AgeBusThread::Priority::Command);
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::setRelativePosition(double deltaUm)
+{
+    return submitBool([deltaUm](AgeMotionDriver &driver) {
+        return driver.setRelativePosition(deltaUm);
+    }, AgeBusThread::Priority::Command);
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::setVelocity(double velocityUmPerSec)
+{
+    return submitBool([velocityUmPerSec](AgeMotionDriver &driver) {
+        return driver.setVelocity(velocityUmPerSec);
+    }, AgeBusThread::Priority::Command);
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::findReference(bool toHigh)
+{
+    return submitBool([toHigh](AgeMotionDriver &driver) {
+        return driver.findReference(toHigh);
+    }, AgeBusThread::Priority::Command);
+}
+
+// ==========================================
+//          控制 (插队执行)
+// ==========================================
+
+// 停止前先取消该轴排队的运动命令 (其 future 得到 "Cancelled by stop." 失败结果)；急停由总线线程自动取消
+std::future<BusResult<bool>> AgeMotionAsync::stopMotion()
+{
+    m_bus->cancelCommands(m_axis);
+    return submitBool([](AgeMotionDriver &driver) {
+        return driver.stopMotion();
+    }, AgeBusThread::Priority::Control);
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::setEnable(bool enable)
+{
+    return submitBool([enable](AgeMotionDriver &driver) {
+        return driver.setEnable(enable);
+    }, AgeBusThread::Priority::Control);
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::emergencyStop()
+{
+    return submitBool([](AgeMotionDriver &driver) {
+        return driver.emergencyStop();
+    }, AgeBusThread::Priority::Emergency);
+}
+
+std::future<BusResult<bool>> AgeMotionAsync::waitForMotionComplete(int timeoutMs)
+{
+    auto promise = std::make_shared<std::promise<BusResult<bool>>>();
+    std::future<BusResult<bool>> future = promise->get_future();
+    m_bus->watchMotion(timeoutMs, [promise](const BusResult<bool> &r) {
+        promise->set_value(r);
+    }, m_axis);
+    return future;
+}
+
+// ==========================================
+//          状态读取
+// ==========================================
+
+std::future<BusResult<double>> AgeMotionAsync::getPosition()
+{
+    return m_bus->submit([](AgeMotionDriver &driver) {
+        BusResult<double> r;
+        r.ok = driver.getPosition(r.value);
+        if (!r.ok) r.error = driver.getLastError();
+        return r;
+    }, AgeBusThread::Priority::Telemetry, m_axis);
+}
+
+std::future<BusResult<DriveStatusSnapshot>> AgeMotionAsync::readStatusSnapshot(quint32 groups)
+{
+    return m_bus->submit([groups](AgeMotionDriver &driver) {
+        BusResult<DriveStatusSnapshot> r;
+        r.ok = driver.readStatusSnapshot(r.value, groups);
+        if (!r.ok) r.error = driver.getLastError();
+        return r;
+    }, AgeBusThread::Priority::Telemetry, m_axis);
+}
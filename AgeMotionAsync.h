@@ -0,0 +1,65 @@
+#ifndef AGEMOTIONASYNC_H
+#define AGEMOTIONASYNC_H
+
+#include <future>
+#include "AgeBusThread.h"
+
+// ==========================================
+//   异步运动接口：每个操作返回 std::future
+// ==========================================
+// - 所有操作经 AgeBusThread 排队执行，调用方不直接接触 DLL / 串口
+// - 急停、停止、使能按高优先级插队，状态读取为最低优先级；
+//   停止与急停同时取消该轴尚未执行的运动命令 (其 future 得到失败结果)
+// - 典型用法 (自动对焦):
+//       auto move = motion.moveTo(nextUm, velUm);   // 发出下一步
+//       double metric = computeMetric(frame);       // 与总线传输重叠
+//       if (!move.get().ok) ...                     // 需要时再等待
+// 不要在 GUI 线程上调用 future::get()，GUI 中请使用 AgeBusThread::call()
+class AgeMotionAsync
+{
+public:
+    // axis 为 AgeBusThread::addAxis() 返回的轴编号
+    explicit AgeMotionAsync(AgeBusThread *bus, int axis = 0);
+    int axis() const { return m_axis; }
+
+    std::future<BusResult<bool>> connectDevice();
+
+    // --- 运动命令 (Priority::Command) ---
+    std::future<BusResult<bool>> moveTo(double positionUm, double velocityUmPerSec);
+    std::future<BusResult<bool>> setTargetPosition(double positionUm);
+    std::future<BusResult<bool>> setRelativePosition(double deltaUm);
+    std::future<BusResult<bool>> setVelocity(double velocityUmPerSec);
+    std::future<BusResult<bool>> findReference(bool toHigh);
+
+    // --- 控制 (Priority::Control / Emergency) ---
+    std::future<BusResult<bool>> stopMotion();
+    std::future<BusResult<bool>> setEnable(bool enable);
+    std::future<BusResult<bool>> emergencyStop();
+
+    // --- 等待运动到位 (按预测时刻采样，不阻塞总线上的其他命令) ---
+    std::future<BusResult<bool>> waitForMotionComplete(int timeoutMs);
+
+    // --- 状态读取 (Priority::Telemetry) ---
+    std::future<BusResult<double>> getPosition();
+    std::future<BusResult<DriveStatusSnapshot>> readStatusSnapshot(
+        quint32 groups = DriveStatusSnapshot::GroupsAll);
+
+private:
+    // 执行返回 bool 的驱动方法，附带 getLastError()
+    template<typename Fn>
+    std::future<BusResult<bool>> submitBool(Fn fn, AgeBusThread::Priority priority)
+    {
+        return m_bus->submit([fn](AgeMotionDriver &driver) {
+            BusResult<bool> r;
+            r.ok = fn(driver);
+            r.value = r.ok;
+            if (!r.ok) r.error = driver.getLastError();
+            return r;
+        }, priority, m_axis);
+    }
+
+    AgeBusThread *m_bus;
+    int m_axis;
+};
+
+#endif // AGEMOTIONASYNC_H
@@ -1,16 +1,20 @@
 #include "AgeMotionDriver.h"
 #include <QCoreApplication>
 #include <QDir>
+#include <QThread>
+#include <chrono>
+#include "AgeRtuFrame.h"
+#include "AgeTrace.h"
 
-AgeMotionDriver::AgeMotionDriver() : m_isConnected(false)
+AgeMotionDriver::AgeMotionDriver(QSharedPointer<AgeTransport> transport, quint8 station)
+    : m_transport(transport ? transport : AgeTransport::createDefault())
+    , m_station(station)
+    , m_isConnected(false)
 {
 }
 
 AgeMotionDriver::~AgeMotionDriver()
 {
-    if (m_lib.isLoaded()) {
-        m_lib.unload();
-    }
 }
 
 QString AgeMotionDriver::getLastError() const
@@ -18,27 +22,31 @@ QString AgeMotionDriver::getLastError() const
     return m_lastError;
 }
 
+void AgeMotionDriver::invalidateShadow()
+{
+    m_shadow = RegisterShadow();
+}
+
 bool AgeMotionDriver::connectDevice()
 {
-    // 1. 加载 DLL
-    if (!loadLibrary()) {
-        return false;
-    }
+    AGE_TRACE_FUNCTION("driver");
+    // 重新连接后驱动器可能已被复位或由其他工具改写，影子全部作废
+    invalidateShadow();
 
-    // 2. 执行授权
-    if (!authorize()) {
-        m_lastError = "License authorization failed.";
+    // 1. 打开传输 (DLL: 加载并授权; RTU: 打开串口)
+    if (!m_transport->open()) {
+        m_lastError = m_transport->lastError();
         return false;
     }
 
-    // 3. 建立连接 (AutoConnect = 1)
-    if (m_api_isValid && !m_api_isValid(1)) {
-        m_lastError = "Failed to connect to USB Device (AgeCOMIsValid returned FALSE).";
+    // 2. 建立连接 (AutoConnect = 1)
+    if (!m_transport->isValid(true)) {
+        m_lastError = m_transport->lastError();
         return false;
     }
 
     m_isConnected = true;
-    qDebug() << "✅ AgeMotionDriver: Device connected successfully.";
+    qDebug() << "✅ AgeMotionDriver: Device connected successfully via" << m_transport->name() << "station" << (int)m_station;
 
     // 读取并保存默认目标速度
     double vel = 0.0;
@@ -50,70 +58,56 @@ bool AgeMotionDriver::connectDevice()
     return true;
 }
 
-bool AgeMotionDriver::loadLibrary()
+bool AgeMotionDriver::restoreConnection()
 {
-    // 使用头文件中定义的 DLL_RELATIVE_PATH
-    // QString dllPath = QCoreApplication::applicationDirPath() + DLL_RELATIVE_PATH;
-    // m_lib.setFileName(dllPath);
-
-    QString dllPath = DLL_ABS_PATH;
-    m_lib.setFileName(dllPath);
+    AGE_TRACE_FUNCTION("driver");
+    invalidateShadow();
+    m_isConnected = false;
 
-    if (!m_lib.load()) {
-        m_lastError = "Failed to load DLL at: " + dllPath + "\nError: " + m_lib.errorString();
-        qCritical() << m_lastError;
+    // 1. 确认驱动器应答
+    WORD ctrl = 0;
+    if (!m_transport->readWORD(m_station, AgeReg::ADDR_CONTROL, ctrl, TIMEOUT_MS)) {
+        m_lastError = m_transport->lastError();
         return false;
     }
 
-    // 解析函数指针
-    m_api_isValid   = (AgeCOMIsValidFunc)m_lib.resolve("AgeCOMIsValid");
-    m_api_getUSBID  = (AgeCOMGetUSBIDFunc)m_lib.resolve("AgeCOMGetUSBID");
-    m_api_readQWORD = (AgeCOMReadQWORDFunc)m_lib.resolve("AgeCOMReadQWORD");
-    m_api_getCOMID  = (AgeCOMGetCOMIDFunc)m_lib.resolve("AgeCOMGetCOMID");
-    m_api_setSerial = (AgeCOMSerialFunc)m_lib.resolve("AgeCOMSerial");
-
-    // 新增函数指针解析
-    m_api_readWORD   = (AgeCOMReadWORDFunc)m_lib.resolve("AgeCOMReadWORD");
-    m_api_writeWORD  = (AgeCOMWriteWORDFunc)m_lib.resolve("AgeCOMWriteWORD");
-    m_api_writeQWORD = (AgeCOMWriteQWORDFunc)m_lib.resolve("AgeCOMWriteQWORD");
-    // 解析 32位读写函数
-    m_api_readDWORD  = (AgeCOMReadDWORDFunc)m_lib.resolve("AgeCOMReadDWORD");
-    m_api_writeDWORD = (AgeCOMWriteDWORDFunc)m_lib.resolve("AgeCOMWriteDWORD");
-
-    // 校验 (注意：根据实际情况，有些函数可能不是必须的，但为了完整性建议都校验)
-    if (!m_api_isValid || !m_api_readQWORD || !m_api_setSerial ||
-        !m_api_readWORD || !m_api_writeWORD || !m_api_writeQWORD ||
-        !m_api_readDWORD || !m_api_writeDWORD) {
-        m_lastError = "Failed to resolve one or more functions from DLL.";
-        qCritical() << m_lastError;
-        return false;
+    // 2. 写回主机设置过的配置
+    if (m_hostConfig.velSet.valid) {
+        if (!m_transport->writeWORD(m_station, AgeReg::ADDR_VEL_SET, m_hostConfig.velSet.value, TIMEOUT_MS)) {
+            m_lastError = m_transport->lastError();
+            return false;
+        }
+        m_shadow.velSet.set(m_hostConfig.velSet.value);
+    }
+    if (m_hostConfig.pulseLength.valid) {
+        if (!m_transport->writeDWORD(m_station, AgeReg::ADDR_PULSE_LENGTH, m_hostConfig.pulseLength.value, TIMEOUT_MS)) {
+            m_lastError = m_transport->lastError();
+            return false;
+        }
+        m_shadow.pulseLength.set(m_hostConfig.pulseLength.value);
     }
 
-    return true;
-}
-
-bool AgeMotionDriver::authorize()
-{
-    if (!m_api_setSerial) return false;
-
-    // 使用头文件中定义的 LICENSE_KEY
-    DWORD keyLength = (DWORD)strlen(LICENSE_KEY);
+    m_isConnected = true;
+    qDebug() << "✅ AgeMotionDriver: Connection restored via" << m_transport->name() << "station" << (int)m_station;
 
-    // 调用授权接口
-    return m_api_setSerial((BYTE*)LICENSE_KEY, keyLength);
+    // 首次连接时未能读到默认速度的，补读一次
+    double vel = 0.0;
+    if (m_defaultTargetVelocity <= 0.0 && getTargetVelocity(vel)) m_defaultTargetVelocity = vel;
+    return true;
 }
 
 bool AgeMotionDriver::getPosition(double &positionUm)
 {
-    if (!m_isConnected || !m_api_readQWORD) {
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) {
         m_lastError = "Driver not connected or function pointer invalid.";
         return false;
     }
 
     QWORD rawPos = 0;
 
-    // 使用头文件定义的常量: STATION_ID, REG_POSITION_ADDR, TIMEOUT_MS
-    if (m_api_readQWORD(STATION_ID, AgeReg::ADDR_POS_REAL, rawPos, TIMEOUT_MS)) {
+    // 使用站号 m_station 与头文件定义的常量: REG_POSITION_ADDR, TIMEOUT_MS
+    if (m_transport->readQWORD(m_station, AgeReg::ADDR_POS_REAL, rawPos, TIMEOUT_MS)) {
 
         // 1. 转为有符号数 (处理负方向)
         long long signedPulses = (long long)rawPos;
@@ -130,14 +124,16 @@ bool AgeMotionDriver::getPosition(double &positionUm)
 
 bool AgeMotionDriver::getTargetPosition(double &positionUm)
 {
-    if (!m_isConnected || !m_api_readQWORD) {
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) {
         m_lastError = "Driver not connected or function pointer invalid.";
         return false;
     }
 
+    // 目标位置会被驱动器自行改写 (停止/限位/回零/故障/其他主站)，总是从驱动器读取
     QWORD rawPos = 0;
 
-    if (m_api_readQWORD(STATION_ID, AgeReg::ADDR_POS_TARGET, rawPos, TIMEOUT_MS)) {
+    if (m_transport->readQWORD(m_station, AgeReg::ADDR_POS_TARGET, rawPos, TIMEOUT_MS)) {
         long long signedPulses = (long long)rawPos;
         positionUm = (double)signedPulses / (MMS_PER_UM);
         return true;
@@ -150,11 +146,18 @@ bool AgeMotionDriver::getTargetPosition(double &positionUm)
 // --- 获取目标速度 (RPM) ---
 bool AgeMotionDriver::getTargetRPM(double &rpm)
 {
-    if (!m_isConnected || !m_api_readWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     WORD rawVel = 0;
+    if (m_shadow.velSet.valid) {
+        ++m_shadowStats.localReads;
+        rpm = (m_shadow.velSet.value * KV_DEFAULT * 60000) / MMS_PER_R;
+        return true;
+    }
     // 读取速度设定寄存器 0x0040
-    if (m_api_readWORD(STATION_ID, AgeReg::ADDR_VEL_SET, rawVel, TIMEOUT_MS)) {
+    if (m_transport->readWORD(m_station, AgeReg::ADDR_VEL_SET, rawVel, TIMEOUT_MS)) {
+        m_shadow.velSet.set(rawVel);
         // VelSet is UINT16
         rpm = (rawVel * KV_DEFAULT * 60000) / MMS_PER_R;
         return true;
@@ -165,19 +168,34 @@ bool AgeMotionDriver::getTargetRPM(double &rpm)
 // --- 设置目标运行速度 (RPM) ---
 bool AgeMotionDriver::setTargetRPM(double rpm)
 {
-    if (!m_isConnected || !m_api_writeWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     // 转换公式: VelSet = (16 * RPM) / 5 (根据手册 4.4.21)
     // 注意: VelSet 值域 1~38400
     // unsigned short val = (unsigned short)((rpm * 16.0) / 5.0);
     WORD val = (WORD)((rpm * MMS_PER_R) / (KV_DEFAULT * 60000));
 
+    // 与驱动器当前值相同则省略
+    if (m_shadow.velSet.matches(val)) {
+        ++m_shadowStats.elidedWrites;
+        m_hostConfig.velSet.set(val);
+        return true;
+    }
+
     // 写入速度设定寄存器 0x0040
-    return m_api_writeWORD(STATION_ID, AgeReg::ADDR_VEL_SET, val, TIMEOUT_MS);
+    if (!m_transport->writeWORD(m_station, AgeReg::ADDR_VEL_SET, val, TIMEOUT_MS)) {
+        m_shadow.velSet.invalidate(); // 写失败时无法确定驱动器上的值
+        return false;
+    }
+    m_shadow.velSet.set(val);
+    m_hostConfig.velSet.set(val);
+    return true;
 }
 
 bool AgeMotionDriver::getTargetVelocity(double &velocityUmPerSec)
 {
+    AGE_TRACE_FUNCTION("driver");
     double rpm = 0.0;
     if (getTargetRPM(rpm)) {
         // RPM = r/min = r/60s
@@ -190,6 +208,7 @@ bool AgeMotionDriver::getTargetVelocity(double &velocityUmPerSec)
 
 bool AgeMotionDriver::setTargetVelocity(double velocityUmPerSec)
 {
+    AGE_TRACE_FUNCTION("driver");
     // velocity = (rpm / 60.0) * POSITION_PER_R
     // rpm = (velocity * 60.0) / POSITION_PER_R
     double rpm = (velocityUmPerSec * 60.0) / POSITION_PER_R;
@@ -199,11 +218,12 @@ bool AgeMotionDriver::setTargetVelocity(double velocityUmPerSec)
 // --- 获取实时速度 (um/s) ---
 bool AgeMotionDriver::getVelocity(double &velocityUmPerSec)
 {
-    if (!m_isConnected || !m_api_readWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     WORD rawVel = 0;
     // 读取实时速度寄存器 0x0045 (SHORT)
-    if (m_api_readWORD(STATION_ID, AgeReg::ADDR_VEL_REAL, rawVel, TIMEOUT_MS)) {
+    if (m_transport->readWORD(m_station, AgeReg::ADDR_VEL_REAL, rawVel, TIMEOUT_MS)) {
         // 转换为有符号 short
         short signedVel = (short)rawVel;
 
@@ -221,48 +241,72 @@ bool AgeMotionDriver::getVelocity(double &velocityUmPerSec)
 // --- 设置恒定运行速度 (Jog模式) ---
 bool AgeMotionDriver::setVelocity(double velocityUmPerSec)
 {
+    AGE_TRACE_FUNCTION("driver");
     // 速度为0则停止
     if (qAbs(velocityUmPerSec) < 0.001) {
         return stopMotion();
     }
 
-    // 1. 设置运行速度 (取绝对值)
-    if (!setTargetVelocity(qAbs(velocityUmPerSec))) return false;
-
-    // 2. 设置目标位置为极大值 (模拟恒定运行)
+    // 设置目标位置为极大值 (模拟恒定运行)
     // 正速度 -> 正无穷, 负速度 -> 负无穷
     // 假设 100米 (100,000,000 um) 足够远
     double targetPos = (velocityUmPerSec > 0) ? 100000000.0 : -100000000.0;
 
-    // 手动写入位置寄存器，避免调用 setTargetPosition (因为它会恢复默认速度)
-    if (!m_isConnected || !m_api_writeQWORD) return false;
-
-    long long mms = (long long)(targetPos * MMS_PER_UM);
-    return m_api_writeQWORD(STATION_ID, AgeReg::ADDR_POS_TARGET, (QWORD)mms, TIMEOUT_MS);
+    // 直接使用 moveTo，避免 setTargetPosition 恢复默认速度
+    return moveTo(targetPos, qAbs(velocityUmPerSec));
 }
 
 // --- 绝对运动到指定位置 (微米) ---
 bool AgeMotionDriver::setTargetPosition(double positionUm)
 {
-    if (!m_isConnected || !m_api_writeQWORD) return false;
-
+    AGE_TRACE_FUNCTION("driver");
     // 恢复默认速度 (防止之前调用 setVelocity 修改了速度)
-    if (m_defaultTargetVelocity > 0.001) {
-        setTargetVelocity(m_defaultTargetVelocity);
+    return moveTo(positionUm, m_defaultTargetVelocity);
+}
+
+// --- 以指定速度运动到绝对位置 ---
+// VEL_SET (0x0040) 与 POS_TARGET (0x0024) 不相邻，中间夹着只读寄存器
+// (PULSE_POS_REAL / POS_ERROR) 和会触发运动的 PULSE_POS_SET，无法合并为一帧 FC16；
+// 速度必须先于目标位置写入 (目标位置一写入驱动器即开始运动)
+bool AgeMotionDriver::moveTo(double positionUm, double velocityUmPerSec)
+{
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+
+    // 1. 速度 (与影子相同时不发帧)
+    if (velocityUmPerSec > 0.001) {
+        if (!setTargetVelocity(velocityUmPerSec)) return false;
     }
 
-    // 1. 将微米转换为脉冲/微步 (MMS)
+    // 2. 将微米转换为脉冲/微步 (MMS)
     // 1 um = MMS_PER_UM
     long long mms = (long long)(positionUm * MMS_PER_UM);
 
-    // 2. 写入目标位置寄存器 0x0024
+    // 3. 写入目标位置寄存器 0x0024
     // 注意: 类型是 INT64 (QWORD)
-    return m_api_writeQWORD(STATION_ID, AgeReg::ADDR_POS_TARGET, (QWORD)mms, TIMEOUT_MS);
+    return writeTargetMms(mms);
+}
+
+// --- 写目标位置 (MMS) ---
+// 写入目标位置即启动运动，不与影子比较省略: 驱动器可能已自行改写目标位置，
+// 重复下发相同位置也必须真正发出
+// writeMWORD 一帧 FC16 写 4 字 (DLL 缺少 AgeCOMWriteMWORD 时由 AgeComTransport 改用 QWORD 接口)；
+// writeQWORD 发出的是同一帧，失败后重试它只会再等一次超时，因此不做退回
+bool AgeMotionDriver::writeTargetMms(qint64 mms)
+{
+    WORD words[4];
+    AgeRtu::packU64((quint64)mms, words);
+    if (!m_transport->writeMWORD(m_station, AgeReg::ADDR_POS_TARGET, words, 4, TIMEOUT_MS)) {
+        m_lastError = m_transport->lastError();
+        return false;
+    }
+    return true;
 }
 
 // --- 相对运动 (微米) ---
 bool AgeMotionDriver::setRelativePosition(double deltaUm)
 {
+    AGE_TRACE_FUNCTION("driver");
     double targetPos = 0.0;
     // 1. 获取当前目标位置 (基于上一次的目标位置进行增量，避免多次累积误差或运动中修改)
     if (!getTargetPosition(targetPos)) return false;
@@ -274,22 +318,24 @@ bool AgeMotionDriver::setRelativePosition(double deltaUm)
 // --- 停止运动 ---
 bool AgeMotionDriver::stopMotion()
 {
-    if (!m_isConnected || !m_api_writeWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     // 写入控制寄存器 0x0000
     // 根据手册 4.4.1 [cite: 2430]，Bit 12 是 Stop (停止)
     // 0x1000 = 0001 0000 0000 0000 (二进制)
-    return m_api_writeWORD(STATION_ID, AgeReg::ADDR_CONTROL, 0x1000, TIMEOUT_MS);
+    return m_transport->writeWORD(m_station, AgeReg::ADDR_CONTROL, 0x1000, TIMEOUT_MS);
 }
 
 // --- 获取故障码 ---
 int AgeMotionDriver::checkError()
 {
-    if (!m_isConnected || !m_api_readWORD) return -1;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return -1;
 
     WORD errCode = 0;
     // 读取故障寄存器 0x0002 [cite: 2504]
-    if (m_api_readWORD(STATION_ID, AgeReg::ADDR_ERROR_CODE, errCode, TIMEOUT_MS)) {
+    if (m_transport->readWORD(m_station, AgeReg::ADDR_ERROR_CODE, errCode, TIMEOUT_MS)) {
         return (int)errCode; // 0 表示无故障
     }
     return -1; // 通讯失败
@@ -301,11 +347,12 @@ int AgeMotionDriver::checkError()
 
 bool AgeMotionDriver::setEnable(bool enable)
 {
-    if (!m_isConnected || !m_api_readWORD || !m_api_writeWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     WORD ctrl = 0;
     // 1. 读取当前控制字
-    if (!m_api_readWORD(STATION_ID, AgeReg::ADDR_CONTROL, ctrl, TIMEOUT_MS)) return false;
+    if (!m_transport->readWORD(m_station, AgeReg::ADDR_CONTROL, ctrl, TIMEOUT_MS)) return false;
 
     // 2. 修改 Bit 2 使能位
     // 0x0004 = 0000 0000 0000 0100 (二进制)
@@ -316,58 +363,106 @@ bool AgeMotionDriver::setEnable(bool enable)
         ctrl &= ~0x0004;
     }
 
-    // 3. 写回
-    return m_api_writeWORD(STATION_ID, AgeReg::ADDR_CONTROL, ctrl, TIMEOUT_MS);
+    // 3. 写回 (脱机/使能切换可能使目标位置跟随实际位置)
+    return m_transport->writeWORD(m_station, AgeReg::ADDR_CONTROL, ctrl, TIMEOUT_MS);
 }
 
 bool AgeMotionDriver::emergencyStop()
 {
-    if (!m_isConnected || !m_api_writeWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     // 假设 Bit 13 为急停 (Stop 是 Bit 12)
     // 0x2000 = 0010 0000 0000 0000 (二进制)
     // 这里直接发送急停指令，不读取旧值以保证速度
-    return m_api_writeWORD(STATION_ID, AgeReg::ADDR_CONTROL, 0x2000, TIMEOUT_MS);
+    return m_transport->writeWORD(m_station, AgeReg::ADDR_CONTROL, 0x2000, TIMEOUT_MS);
 }
 
 bool AgeMotionDriver::moveToLimit(bool toUpper)
 {
-    if (!m_isConnected || !m_api_writeWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
     //  Bit 4 = 向上限位运动, Bit 5 = 向下限位运动
     // 0x0010 = 0000 0000 0001 0000 (二进制)
     // 0x0020 = 0000 0000 0010 0000 (二进制)
     WORD cmd = toUpper ? 0x0010 : 0x0020;
-    return m_api_writeWORD(STATION_ID, AgeReg::ADDR_CONTROL, cmd, TIMEOUT_MS);
+    return m_transport->writeWORD(m_station, AgeReg::ADDR_CONTROL, cmd, TIMEOUT_MS);
 }
 
 bool AgeMotionDriver::setCurrPositionToZero()
 {
-    if (!m_isConnected || !m_api_writeWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
     //  Bit 8 = 位置偏移清零
     // 0x0100 = 0000 0001 0000 0000 (二进制)
-    return m_api_writeWORD(STATION_ID, AgeReg::ADDR_CONTROL, 0x0100, TIMEOUT_MS);
+    return m_transport->writeWORD(m_station, AgeReg::ADDR_CONTROL, 0x0100, TIMEOUT_MS);
 }
 
 bool AgeMotionDriver::findReference(bool toHigh)
 {
-    if (!m_isConnected || !m_api_writeWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
     // Bit 11 = 向高位回零, Bit 10 = 向低位回零
     // 0x0800 = 0000 1000 0000 0000 (二进制)
     // 0x0400 = 0000 0100 0000 0000 (二进制)
     WORD cmd = toHigh ? 0x0800 : 0x0400;
-    return m_api_writeWORD(STATION_ID, AgeReg::ADDR_CONTROL, cmd, TIMEOUT_MS);
+    return m_transport->writeWORD(m_station, AgeReg::ADDR_CONTROL, cmd, TIMEOUT_MS);
+}
+
+// ==========================================
+//          总线广播 (站号 0)
+// ==========================================
+
+bool AgeMotionDriver::broadcastTargetPosition(double positionUm)
+{
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+
+    long long mms = (long long)(positionUm * MMS_PER_UM);
+    // 广播帧没有应答，写失败只可能是本地发送失败；帧格式与 writeTargetMms() 一致
+    WORD words[4];
+    AgeRtu::packU64((quint64)mms, words);
+    if (!m_transport->writeMWORD(BROADCAST_STATION, AgeReg::ADDR_POS_TARGET, words, 4,
+                                 AgeTransport::TIMEOUT_NO_REPLY)) {
+        m_lastError = m_transport->lastError();
+        return false;
+    }
+    return true;
+}
+
+bool AgeMotionDriver::broadcastStop()
+{
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+    if (!m_transport->writeWORD(BROADCAST_STATION, AgeReg::ADDR_CONTROL, 0x1000, AgeTransport::TIMEOUT_NO_REPLY)) {
+        m_lastError = m_transport->lastError();
+        return false;
+    }
+    return true;
+}
+
+bool AgeMotionDriver::broadcastEmergencyStop()
+{
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+    if (!m_transport->writeWORD(BROADCAST_STATION, AgeReg::ADDR_CONTROL, 0x2000, AgeTransport::TIMEOUT_NO_REPLY)) {
+        m_lastError = m_transport->lastError();
+        return false;
+    }
+    return true;
 }
 
 bool AgeMotionDriver::isMotionComplete(bool &isDone)
 {
-    if (!m_isConnected || !m_api_readQWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     QWORD realPos = 0;
     QWORD targetPos = 0;
 
     // 读取实时位置和目标位置
-    if (!m_api_readQWORD(STATION_ID, AgeReg::ADDR_POS_REAL, realPos, TIMEOUT_MS)) return false;
-    if (!m_api_readQWORD(STATION_ID, AgeReg::ADDR_POS_TARGET, targetPos, TIMEOUT_MS)) return false;
+    if (!m_transport->readQWORD(m_station, AgeReg::ADDR_POS_REAL, realPos, TIMEOUT_MS)) return false;
+    if (!m_transport->readQWORD(m_station, AgeReg::ADDR_POS_TARGET, targetPos, TIMEOUT_MS)) return false;
 
     long long diff = (long long)realPos - (long long)targetPos;
     if (diff < 0) diff = -diff;
@@ -379,9 +474,10 @@ bool AgeMotionDriver::isMotionComplete(bool &isDone)
 
 bool AgeMotionDriver::isHomingComplete(bool &isDone)
 {
-    if (!m_isConnected || !m_api_readWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
     WORD ctrl = 0;
-    if (m_api_readWORD(STATION_ID, AgeReg::ADDR_CONTROL, ctrl, TIMEOUT_MS)) {
+    if (m_transport->readWORD(m_station, AgeReg::ADDR_CONTROL, ctrl, TIMEOUT_MS)) {
         // 如果 Bit 10 和 Bit 11 都是 0，则动作完成
         // 0x0C00 = 0000 1100 0000 0000
         isDone = ((ctrl & 0x0C00) == 0);
@@ -390,12 +486,71 @@ bool AgeMotionDriver::isHomingComplete(bool &isDone)
     return false;
 }
 
+// ==========================================
+//          等待运动到位
+// ==========================================
+
+bool AgeMotionDriver::getMotionProfile(AgeMotionWaiter::Profile &profile)
+{
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+
+    // 到位允许误差 (UINT32) + 到位允许时间 (UINT16)，0x0032-0x0034 一帧读出
+    if (!m_shadow.posErrAllow.valid || !m_shadow.timeErrAllow.valid) {
+        WORD buf[3];
+        if (!readBlock(AgeReg::ADDR_POS_ERR_ALLOW, buf, 3)) return false;
+        m_shadow.posErrAllow.set((DWORD)AgeRtu::unpackU32(buf));
+        m_shadow.timeErrAllow.set(buf[AgeReg::ADDR_TIME_ERR_ALLOW - AgeReg::ADDR_POS_ERR_ALLOW]);
+    }
+    if (!m_shadow.velSet.valid || !m_shadow.velFilter.valid) {
+        DriveStatusSnapshot snapshot;
+        if (!readStatusSnapshot(snapshot, DriveStatusSnapshot::GroupVelocity)) return false;
+    }
+
+    // MMS/s = VelSet * KV * 1000 (与 getTargetRPM 的换算一致)
+    profile.velocityMms = m_shadow.velSet.value * KV_DEFAULT * 1000.0;
+    profile.accelMs = m_shadow.velFilter.value;
+    // 驱动器未设置允许误差时沿用 isMotionComplete 的半微米阈值
+    profile.posErrAllowMms = m_shadow.posErrAllow.value ? (quint32)m_shadow.posErrAllow.value
+                                                         : (quint32)(MMS_PER_UM / 2);
+    profile.timeErrAllowMs = m_shadow.timeErrAllow.value;
+    return true;
+}
+
+bool AgeMotionDriver::waitForMotionComplete(int timeoutMs)
+{
+    AGE_TRACE_FUNCTION("driver");
+    AgeMotionWaiter::Profile profile;
+    if (!getMotionProfile(profile)) return false;
+
+    DriveStatusSnapshot snapshot;
+    if (!readStatusSnapshot(snapshot, DriveStatusSnapshot::GroupPosition)) return false;
+
+    AgeMotionWaiter waiter;
+    waiter.start(profile, snapshot.posRealMms, snapshot.posTargetMms, snapshot.timestampUs, timeoutMs);
+
+    while (waiter.state() == AgeMotionWaiter::State::Waiting) {
+        const qint64 sleepUs = waiter.nextPollUs() - monotonicUs();
+        if (sleepUs > 0) QThread::usleep((unsigned long)sleepUs);
+
+        if (!readStatusSnapshot(snapshot, DriveStatusSnapshot::GroupPosition)) return false;
+        waiter.update(snapshot.posRealMms, snapshot.posTargetMms, snapshot.timestampUs);
+    }
+
+    if (waiter.state() == AgeMotionWaiter::State::TimedOut) {
+        m_lastError = QString("Motion not complete within %1 ms.").arg(timeoutMs);
+        return false;
+    }
+    return true;
+}
+
 bool AgeMotionDriver::isLimitSensorTriggered(bool &upper, bool &lower)
 {
-    // if (!m_isConnected || !m_api_readWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    // if (!m_isConnected) return false;
     // WORD portStatus = 0;
     // // 读取 IO 端口状态 0x0080
-    // if (m_api_readWORD(STATION_ID, AgeReg::ADDR_PORT_STATUS, portStatus, TIMEOUT_MS)) {
+    // if (m_transport->readWORD(m_station, AgeReg::ADDR_PORT_STATUS, portStatus, TIMEOUT_MS)) {
     //     // 假设 Bit 0 = 上限位, Bit 1 = 下限位
     //     upper = (portStatus & 0x0001) != 0;
     //     lower = (portStatus & 0x0002) != 0;
@@ -410,10 +565,11 @@ bool AgeMotionDriver::isLimitSensorTriggered(bool &upper, bool &lower)
 
 bool AgeMotionDriver::getPulsePosition(int &pulses)
 {
-    if (!m_isConnected || !m_api_readDWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
     DWORD raw = 0;
-    if (m_api_readDWORD(STATION_ID, AgeReg::ADDR_PULSE_POS_REAL, raw, TIMEOUT_MS)) {
+    if (m_transport->readDWORD(m_station, AgeReg::ADDR_PULSE_POS_REAL, raw, TIMEOUT_MS)) {
         pulses = (int)raw; // 强制转换为有符号 int
         return true;
     }
@@ -422,10 +578,130 @@ bool AgeMotionDriver::getPulsePosition(int &pulses)
 
 bool AgeMotionDriver::setTargetPulsePosition(int pulses)
 {
-    if (!m_isConnected || !m_api_writeDWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
 
-    // 写入脉冲目标位置
-    return m_api_writeDWORD(STATION_ID, AgeReg::ADDR_PULSE_POS_SET, (DWORD)pulses, TIMEOUT_MS);
+    // 写入脉冲目标位置 (驱动器据此改写 ADDR_POS_TARGET)
+    return m_transport->writeDWORD(m_station, AgeReg::ADDR_PULSE_POS_SET, (DWORD)pulses, TIMEOUT_MS);
+}
+
+// ==========================================
+//          新增：状态快照 (块读取)
+// ==========================================
+
+qint64 AgeMotionDriver::monotonicUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool AgeMotionDriver::readBlock(int regAddr, WORD *words, int count)
+{
+    if (m_transport->readMWORD(m_station, (WORD)regAddr, words, (WORD)count, TIMEOUT_MS)) return true;
+    m_lastError = QString("Failed to read %1 WORDs at 0x%2.").arg(count).arg(regAddr, 4, 16, QChar('0'));
+    return false;
+}
+
+bool AgeMotionDriver::readStatusSnapshot(DriveStatusSnapshot &snapshot, quint32 groups)
+{
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) {
+        m_lastError = "Driver not connected or function pointer invalid.";
+        return false;
+    }
+
+    bool allOk = true;
+    WORD buf[AgeReg::BLOCK_POSITION_LEN];
+    snapshot.freshGroups = 0;
+
+    // 1. 控制字 + 故障码 (0x0000-0x0002)
+    if (groups & DriveStatusSnapshot::GroupControl) {
+        if (readBlock(AgeReg::BLOCK_CONTROL_BEGIN, buf, AgeReg::BLOCK_CONTROL_LEN)) {
+            snapshot.control   = buf[AgeReg::ADDR_CONTROL - AgeReg::BLOCK_CONTROL_BEGIN];
+            snapshot.errorCode = buf[AgeReg::ADDR_ERROR_CODE - AgeReg::BLOCK_CONTROL_BEGIN];
+            snapshot.freshGroups |= DriveStatusSnapshot::GroupControl;
+        } else {
+            allOk = false;
+        }
+    }
+
+    // 2. 实时/目标位置 + 分辨率 + 脉冲位置 (0x0020-0x002D)
+    if (groups & DriveStatusSnapshot::GroupPosition) {
+        if (readBlock(AgeReg::BLOCK_POSITION_BEGIN, buf, AgeReg::BLOCK_POSITION_LEN)) {
+            const int base = AgeReg::BLOCK_POSITION_BEGIN; // buf[addr - base] 即寄存器 addr
+            snapshot.posRealMms   = (qint64)AgeRtu::unpackU64(buf + AgeReg::ADDR_POS_REAL - base);
+            snapshot.posTargetMms = (qint64)AgeRtu::unpackU64(buf + AgeReg::ADDR_POS_TARGET - base);
+            snapshot.resolution   = AgeRtu::unpackU32(buf + AgeReg::ADDR_T_RESOLUTION - base);
+            snapshot.pulseLength  = AgeRtu::unpackU32(buf + AgeReg::ADDR_PULSE_LENGTH - base);
+            snapshot.pulsePosReal = (qint32)AgeRtu::unpackU32(buf + AgeReg::ADDR_PULSE_POS_REAL - base);
+            // 块读取顺带刷新影子
+            m_shadow.resolution.set(snapshot.resolution);
+            m_shadow.pulseLength.set(snapshot.pulseLength);
+            snapshot.freshGroups |= DriveStatusSnapshot::GroupPosition;
+        } else {
+            allOk = false;
+        }
+    }
+
+    // 3. 速度设定 ~ 实时速度 (0x0040-0x0045)
+    if (groups & DriveStatusSnapshot::GroupVelocity) {
+        if (readBlock(AgeReg::BLOCK_VELOCITY_BEGIN, buf, AgeReg::BLOCK_VELOCITY_LEN)) {
+            const int base = AgeReg::BLOCK_VELOCITY_BEGIN;
+            snapshot.velSet    = buf[AgeReg::ADDR_VEL_SET - base];
+            snapshot.velStart  = buf[AgeReg::ADDR_VEL_START - base];
+            snapshot.velFilter = buf[AgeReg::ADDR_VEL_FILTER - base];
+            snapshot.velKv     = buf[AgeReg::ADDR_VEL_KV - base];
+            snapshot.velReal   = (qint16)buf[AgeReg::ADDR_VEL_REAL - base];
+            m_shadow.velSet.set(snapshot.velSet);
+            m_shadow.velFilter.set(snapshot.velFilter);
+            snapshot.freshGroups |= DriveStatusSnapshot::GroupVelocity;
+        } else {
+            allOk = false;
+        }
+    }
+
+    // 4. 实时电流 / CPU温度 (不连续的单字寄存器)
+    if (groups & DriveStatusSnapshot::GroupCurrent) {
+        if (readBlock(AgeReg::ADDR_CURRENT_REAL, buf, 1)) {
+            snapshot.currentRaw = buf[0];
+            snapshot.freshGroups |= DriveStatusSnapshot::GroupCurrent;
+        } else {
+            allOk = false;
+        }
+    }
+
+    if (groups & DriveStatusSnapshot::GroupTemperature) {
+        if (readBlock(AgeReg::ADDR_CPU_TEMP, buf, 1)) {
+            snapshot.cpuTemp = (qint16)buf[0];
+            snapshot.freshGroups |= DriveStatusSnapshot::GroupTemperature;
+        } else {
+            allOk = false;
+        }
+    }
+
+    snapshot.validGroups |= snapshot.freshGroups;
+    snapshot.timestampUs = monotonicUs();
+    decodeSnapshot(snapshot);
+    return allOk;
+}
+
+void AgeMotionDriver::decodeSnapshot(DriveStatusSnapshot &snapshot) const
+{
+    // 换算公式与 getPosition / getTargetRPM / getVelocity 等单项接口保持一致
+    snapshot.positionUm = (double)snapshot.posRealMms / MMS_PER_UM;
+    snapshot.targetPositionUm = (double)snapshot.posTargetMms / MMS_PER_UM;
+
+    snapshot.targetRPM = (snapshot.velSet * KV_DEFAULT * 60000) / MMS_PER_R;
+    snapshot.targetVelocityUmPerSec = (snapshot.targetRPM / 60.0) * POSITION_PER_R;
+    double realRPM = (snapshot.velReal * KV_DEFAULT * 60000.0) / MMS_PER_R;
+    snapshot.realVelocityUmPerSec = (realRPM / 60.0) * POSITION_PER_R;
+
+    snapshot.currentA = snapshot.currentRaw / 100.0;
+
+    long long diff = snapshot.posRealMms - snapshot.posTargetMms;
+    if (diff < 0) diff = -diff;
+    snapshot.isMotionDone = (diff < MMS_PER_UM/2); // 与 isMotionComplete 相同的半微米阈值
+    snapshot.isHomingDone = ((snapshot.control & 0x0C00) == 0);
 }
 
 // ==========================================
@@ -434,9 +710,10 @@ bool AgeMotionDriver::setTargetPulsePosition(int pulses)
 
 bool AgeMotionDriver::getRealTimeCurrent(double &current)
 {
-    if (!m_isConnected || !m_api_readWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
     WORD raw = 0;
-    if (m_api_readWORD(STATION_ID, AgeReg::ADDR_CURRENT_REAL, raw, TIMEOUT_MS)) {
+    if (m_transport->readWORD(m_station, AgeReg::ADDR_CURRENT_REAL, raw, TIMEOUT_MS)) {
         // 假设单位是 0.01A
         current = raw / 100.0;
         return true;
@@ -446,9 +723,10 @@ bool AgeMotionDriver::getRealTimeCurrent(double &current)
 
 bool AgeMotionDriver::getCpuTemperature(int &temp)
 {
-    if (!m_isConnected || !m_api_readWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
     WORD raw = 0;
-    if (m_api_readWORD(STATION_ID, AgeReg::ADDR_CPU_TEMP, raw, TIMEOUT_MS)) {
+    if (m_transport->readWORD(m_station, AgeReg::ADDR_CPU_TEMP, raw, TIMEOUT_MS)) {
         temp = (short)raw; // 转为有符号
         return true;
     }
@@ -461,10 +739,18 @@ bool AgeMotionDriver::getCpuTemperature(int &temp)
 
 bool AgeMotionDriver::getSingleToothResolution(unsigned int &res)
 {
-    if (!m_isConnected || !m_api_readDWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+
+    if (m_shadow.resolution.valid) {
+        ++m_shadowStats.localReads;
+        res = (unsigned int)m_shadow.resolution.value;
+        return true;
+    }
 
     DWORD raw = 0;
-    if (m_api_readDWORD(STATION_ID, AgeReg::ADDR_T_RESOLUTION, raw, TIMEOUT_MS)) {
+    if (m_transport->readDWORD(m_station, AgeReg::ADDR_T_RESOLUTION, raw, TIMEOUT_MS)) {
+        m_shadow.resolution.set(raw);
         res = (unsigned int)raw;
         return true;
     }
@@ -473,10 +759,18 @@ bool AgeMotionDriver::getSingleToothResolution(unsigned int &res)
 
 bool AgeMotionDriver::getPulseStepLength(unsigned int &length)
 {
-    if (!m_isConnected || !m_api_readDWORD) return false;
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+
+    if (m_shadow.pulseLength.valid) {
+        ++m_shadowStats.localReads;
+        length = (unsigned int)m_shadow.pulseLength.value;
+        return true;
+    }
 
     DWORD raw = 0;
-    if (m_api_readDWORD(STATION_ID, AgeReg::ADDR_PULSE_LENGTH, raw, TIMEOUT_MS)) {
+    if (m_transport->readDWORD(m_station, AgeReg::ADDR_PULSE_LENGTH, raw, TIMEOUT_MS)) {
+        m_shadow.pulseLength.set(raw);
         length = (unsigned int)raw;
         return true;
     }
@@ -485,12 +779,25 @@ bool AgeMotionDriver::getPulseStepLength(unsigned int &length)
 
 bool AgeMotionDriver::setPulseStepLength(unsigned int length)
 {
-    if (!m_isConnected || !m_api_writeDWORD) return false;
-    return m_api_writeDWORD(STATION_ID, AgeReg::ADDR_PULSE_LENGTH, (DWORD)length, TIMEOUT_MS);
+    AGE_TRACE_FUNCTION("driver");
+    if (!m_isConnected) return false;
+    if (m_shadow.pulseLength.matches((DWORD)length)) {
+        ++m_shadowStats.elidedWrites;
+        m_hostConfig.pulseLength.set((DWORD)length);
+        return true;
+    }
+    if (!m_transport->writeDWORD(m_station, AgeReg::ADDR_PULSE_LENGTH, (DWORD)length, TIMEOUT_MS)) {
+        m_shadow.pulseLength.invalidate();
+        return false;
+    }
+    m_shadow.pulseLength.set((DWORD)length);
+    m_hostConfig.pulseLength.set((DWORD)length);
+    return true;
 }
 
 bool AgeMotionDriver::getMinStepUm(double &stepUm)
 {
+    AGE_TRACE_FUNCTION("driver");
     unsigned int pulses = 0;
     if (getPulseStepLength(pulses)) {
         stepUm = (double)pulses / MMS_PER_UM;
@@ -501,6 +808,7 @@ bool AgeMotionDriver::getMinStepUm(double &stepUm)
 
 bool AgeMotionDriver::setMinStepUm(double stepUm)
 {
+    AGE_TRACE_FUNCTION("driver");
     unsigned int pulses = (unsigned int)(stepUm * MMS_PER_UM);
     return setPulseStepLength(pulses);
 }
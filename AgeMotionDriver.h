@@ -1,16 +1,10 @@
 #ifndef AGEMOTIONDRIVER_H
 #define AGEMOTIONDRIVER_H
 
-#include <QLibrary>
 #include <QString>
 #include <QDebug>
-
-// --- AgeCOM 类型定义 ---
-typedef long BOOL32;
-typedef unsigned char BYTE;
-typedef unsigned short WORD;
-typedef unsigned long DWORD;
-typedef unsigned long long QWORD;
+#include "AgeTransport.h"
+#include "AgeMotionWaiter.h"
 
 namespace AgeReg {
 
@@ -70,21 +64,97 @@ static constexpr int ADDR_INPUT_BAND      = 0x0091; // [UINT32] 输入带宽
 static constexpr int ADDR_CPU_TEMP        = 0x0300; // [INT16]  CPU温度
 static constexpr int ADDR_MOTOR_SN0       = 0x2000; // [UINT64] 电机序列号0
 static constexpr int ADDR_DRIVER_NAME     = 0x8000; // [String] 驱动器型号
+
+// --- 7. 状态快照块读取范围 (ReadMWORD) ---
+// 0x0020-0x002D 中间的分辨率/脉冲长度寄存器一并读出，位置组只需一帧
+static constexpr int BLOCK_CONTROL_BEGIN  = ADDR_CONTROL;        // 0x0000-0x0002
+static constexpr int BLOCK_CONTROL_LEN    = 3;
+static constexpr int BLOCK_POSITION_BEGIN = ADDR_POS_REAL;       // 0x0020-0x002D
+static constexpr int BLOCK_POSITION_LEN   = 14;
+static constexpr int BLOCK_VELOCITY_BEGIN = ADDR_VEL_SET;        // 0x0040-0x0045
+static constexpr int BLOCK_VELOCITY_LEN   = 6;
 }
 
+// ==========================================
+//      状态快照 (一次轮询解码出的全部字段)
+// ==========================================
+struct DriveStatusSnapshot
+{
+    // 字段分组，每组对应一次总线读取
+    enum Group : quint32 {
+        GroupControl     = 0x01, // 0x0000-0x0002 控制字/故障码
+        GroupPosition    = 0x02, // 0x0020-0x002D 实时/目标位置、脉冲位置
+        GroupVelocity    = 0x04, // 0x0040-0x0045 速度设定/实时速度
+        GroupCurrent     = 0x08, // 0x0015 实时电流
+        GroupTemperature = 0x10, // 0x0300 CPU温度
+        GroupsCore = GroupControl | GroupPosition | GroupVelocity,
+        GroupsAll  = GroupsCore | GroupCurrent | GroupTemperature
+    };
+
+    qint64 timestampUs = 0;   // 采样时间 (单调时钟, 微秒)
+    quint32 validGroups = 0;  // 已成功读取过的分组
+    quint32 freshGroups = 0;  // 最近一次 readStatusSnapshot 成功刷新的分组
+
+    // --- 原始寄存器值 ---
+    quint16 control = 0;       // ADDR_CONTROL
+    quint16 errorCode = 0;     // ADDR_ERROR_CODE
+    qint64 posRealMms = 0;     // ADDR_POS_REAL
+    qint64 posTargetMms = 0;   // ADDR_POS_TARGET
+    quint32 resolution = 0;    // ADDR_T_RESOLUTION
+    quint32 pulseLength = 0;   // ADDR_PULSE_LENGTH
+    qint32 pulsePosReal = 0;   // ADDR_PULSE_POS_REAL
+    quint16 velSet = 0;        // ADDR_VEL_SET
+    quint16 velStart = 0;      // ADDR_VEL_START
+    quint16 velFilter = 0;     // ADDR_VEL_FILTER
+    quint16 velKv = 0;         // ADDR_VEL_KV
+    qint16 velReal = 0;        // ADDR_VEL_REAL
+    quint16 currentRaw = 0;    // ADDR_CURRENT_REAL (0.01A)
+    qint16 cpuTemp = 0;        // ADDR_CPU_TEMP (℃)
+
+    // --- 解码后的物理量 ---
+    double positionUm = 0.0;
+    double targetPositionUm = 0.0;
+    double targetRPM = 0.0;
+    double targetVelocityUmPerSec = 0.0;
+    double realVelocityUmPerSec = 0.0;
+    double currentA = 0.0;
+    bool isMotionDone = false;
+    bool isHomingDone = false;
+
+    bool has(quint32 groups) const { return (validGroups & groups) == groups; }
+};
+
 class AgeMotionDriver
 {
 public:
-    AgeMotionDriver();
+    static constexpr quint8 DEFAULT_STATION_ID = 1;
+    static constexpr quint8 BROADCAST_STATION = 0;  // Modbus 广播地址 (仅写，从站不应答)
+
+    // transport 为空时按 AgeTransport::createDefault() 选择 (DLL 或原生 RTU)
+    // 同一总线上的多个轴共用一个 transport，各自使用不同的站号 (1-247)；
+    // 共用 transport 的驱动实例必须在同一线程中调用 (见 AgeBusThread)
+    explicit AgeMotionDriver(QSharedPointer<AgeTransport> transport = QSharedPointer<AgeTransport>(),
+                             quint8 station = DEFAULT_STATION_ID);
     ~AgeMotionDriver();
 
+    AgeTransport *transport() const { return m_transport.data(); }
+    QSharedPointer<AgeTransport> sharedTransport() const { return m_transport; }
+    quint8 station() const { return m_station; }
+
     bool connectDevice();
+    bool isConnected() const { return m_isConnected; }
+    // 链路重建后恢复连接 (不重新打开传输、不重读默认速度): 确认驱动器应答后，
+    // 写回本实例设置过的速度与脉冲步长 (驱动器可能断过电)；使能与目标位置不恢复，避免自行运动
+    bool restoreConnection();
 
     // --- 位置相关接口 ---
     bool getPosition(double &positionUm); // 获取实时位置
     bool getTargetPosition(double &positionUm); // 获取期望位置
     bool setTargetPosition(double positionUm); // 绝对运动到指定位置
     bool setRelativePosition(double deltaUm);   // 相对运动
+    // 以指定速度运动到绝对位置；velocityUmPerSec <= 0 时沿用当前速度设定
+    // 速度未变化时只发一帧 (FC16 写目标位置)，否则先写速度再写目标位置
+    bool moveTo(double positionUm, double velocityUmPerSec);
 
     // 设置位置控制时的速度
     bool getTargetRPM(double &rpm);
@@ -103,15 +173,38 @@ public:
     bool setCurrPositionToZero();
     bool findReference(bool toHigh); // true=向高位, false=向低位
 
+    // --- 总线广播 (站号 0，所有驱动器同时执行，无应答) ---
+    // 通过本实例的 transport 发送
+    bool broadcastTargetPosition(double positionUm);
+    bool broadcastStop();
+    bool broadcastEmergencyStop();
+
     // --- 状态读取 ---
     bool isMotionComplete(bool &isDone); // 运动完成标志
     bool isHomingComplete(bool &isDone); // 回零完成标志
     bool isLimitSensorTriggered(bool &upper, bool &lower); // 限位触发状态
 
+    // --- 等待运动到位 (阻塞) ---
+    // 按距离与速度预测到达时刻，之前稀疏采样，临近到达加密采样；
+    // 到位判据取驱动器的 ADDR_POS_ERR_ALLOW / ADDR_TIME_ERR_ALLOW
+    // 超时返回 false (getLastError() 说明原因)
+    bool waitForMotionComplete(int timeoutMs);
+    // 到位判定所需参数 (优先取影子，缺失时从驱动器读取)
+    bool getMotionProfile(AgeMotionWaiter::Profile &profile);
+
     // --- 脉冲位置功能 (INT32) ---
     bool getPulsePosition(int &pulses);
     bool setTargetPulsePosition(int pulses);
 
+    // --- 状态快照 (块读取，一次解码) ---
+    // 只读取 groups 指定的分组，其余字段保留 snapshot 中原有的值
+    bool readStatusSnapshot(DriveStatusSnapshot &snapshot,
+                            quint32 groups = DriveStatusSnapshot::GroupsAll);
+    static qint64 monotonicUs(); // 快照使用的单调时钟 (微秒)
+    // 寄存器原始值与物理量的换算系数 (回放时由物理量还原寄存器值)
+    static double mmsPerUm() { return MMS_PER_UM; }                 // ADDR_POS_* 每微米
+    static double umPerSecPerVelUnit() { return (KV_DEFAULT * 60000.0 / MMS_PER_R) / 60.0 * POSITION_PER_R; } // ADDR_VEL_REAL 每单位
+
     // --- 其他信息读取 ---
     bool getRealTimeCurrent(double &current); // 获取实时电流 (A)
     bool getCpuTemperature(int &temp);        // 获取CPU温度 (℃)
@@ -127,6 +220,15 @@ public:
 
     QString getLastError() const;
 
+    // --- 寄存器影子 (主机侧配置寄存器缓存) ---
+    // 重新连接、复位或驱动器自行改写寄存器后 (外部工具、断电) 需调用
+    void invalidateShadow();
+    struct ShadowStats {
+        quint64 elidedWrites = 0; // 值未变化而省略的写
+        quint64 localReads = 0;   // 由影子直接返回的读
+    };
+    ShadowStats shadowStats() const { return m_shadowStats; }
+
 private:
     // ==========================================
     //               驱动配置常量
@@ -142,57 +244,51 @@ private:
 
 
     // 2. 通信参数
-    // 站号 (RTU Address)
-    static constexpr int STATION_ID = 1;
-    // 自动超时 (0 = Auto)
+    // 自动超时 (0 = Auto)；经 AgeBusThread 访问时由 AgeResilientTransport 按往返时间估计给出
     static constexpr int TIMEOUT_MS = 0;
 
-    // 4. 路径与授权 (使用 constexpr char* 确保在头文件中定义且无链接错误)
-    static constexpr const char* DLL_RELATIVE_PATH = "/AgeMotionForDriver/x64/AgeCOM.dll";
-    // static constexpr const char* DLL_ABS_PATH = "D:/Project/Git/Git/AutoFocus/AgeMotionForDriver/x64/AgeCOM.dll";
-    static constexpr const char* DLL_ABS_PATH = "D:\\Project\\CHR\\AutoFocus\\AgeMotionForDriver\\x64\\AgeCOM.dll";
-    static constexpr const char* LICENSE_KEY =
-        "AgeMotion-20010203-00000000-0000-0000-0000-0000-0000-0000-0000-0000-"
-        "0000-0000-0000-0000-0000-0000-0000-0000-0000-0000";
+    // ==========================================
 
     // ==========================================
+    //   寄存器影子: 只缓存主机写入、驱动器不会自行修改的配置寄存器
+    // ==========================================
+    // 目标位置 (会触发运动，且在停止/急停/限位/回零/清零时由驱动器改写) 与控制字不缓存，写入从不省略
+    template<typename T>
+    struct Shadow {
+        T value{};
+        bool valid = false;
+        bool matches(T v) const { return valid && value == v; }
+        void set(T v) { value = v; valid = true; }
+        void invalidate() { valid = false; }
+    };
+    struct RegisterShadow {
+        Shadow<WORD> velSet;          // ADDR_VEL_SET
+        Shadow<DWORD> resolution;     // ADDR_T_RESOLUTION
+        Shadow<DWORD> pulseLength;    // ADDR_PULSE_LENGTH
+        Shadow<WORD> velFilter;       // ADDR_VEL_FILTER
+        Shadow<DWORD> posErrAllow;    // ADDR_POS_ERR_ALLOW
+        Shadow<WORD> timeErrAllow;    // ADDR_TIME_ERR_ALLOW
+    };
 
     // --- 内部成员 ---
-    QLibrary m_lib;
+    QSharedPointer<AgeTransport> m_transport;
+    quint8 m_station;                     // 站号 (RTU Address)
     QString m_lastError;
     bool m_isConnected;
     double m_defaultTargetVelocity = 0.0; // 默认目标速度 (um/s)
-
-    // --- 函数指针定义 ---
-    typedef BOOL32 (*AgeCOMIsValidFunc)(BOOL32);
-    typedef BOOL32 (*AgeCOMGetUSBIDFunc)(BYTE*);
-    typedef BOOL32 (*AgeCOMReadQWORDFunc)(BYTE, WORD, QWORD&, DWORD);
-    typedef BOOL32 (*AgeCOMGetCOMIDFunc)(WORD&);
-    typedef BOOL32 (*AgeCOMSerialFunc)(BYTE*, DWORD);
-    // 定义函数指针类型
-    typedef BOOL32 (*AgeCOMReadWORDFunc)(BYTE, WORD, WORD&, DWORD);
-    typedef BOOL32 (*AgeCOMWriteWORDFunc)(BYTE, WORD, WORD, DWORD);
-    typedef BOOL32 (*AgeCOMWriteQWORDFunc)(BYTE, WORD, QWORD, DWORD);
-    // 新增 32位读写函数指针类型
-    typedef BOOL32 (*AgeCOMReadDWORDFunc)(BYTE, WORD, DWORD&, DWORD);
-    typedef BOOL32 (*AgeCOMWriteDWORDFunc)(BYTE, WORD, DWORD, DWORD);
-
-    // 成员变量
-    AgeCOMReadWORDFunc  m_api_readWORD = nullptr;
-    AgeCOMWriteWORDFunc m_api_writeWORD = nullptr;
-    AgeCOMWriteQWORDFunc m_api_writeQWORD = nullptr;
-    // 新增 32位读写成员
-    AgeCOMReadDWORDFunc m_api_readDWORD = nullptr;
-    AgeCOMWriteDWORDFunc m_api_writeDWORD = nullptr;
-
-    AgeCOMIsValidFunc   m_api_isValid = nullptr;
-    AgeCOMGetUSBIDFunc  m_api_getUSBID = nullptr;
-    AgeCOMReadQWORDFunc m_api_readQWORD = nullptr;
-    AgeCOMGetCOMIDFunc  m_api_getCOMID = nullptr;
-    AgeCOMSerialFunc    m_api_setSerial = nullptr;
-
-    bool loadLibrary();
-    bool authorize();
+    RegisterShadow m_shadow;
+    ShadowStats m_shadowStats;
+    // 本实例写入过的配置 (与影子不同，不含从驱动器读到的值)，restoreConnection() 时写回
+    struct HostConfig {
+        Shadow<WORD> velSet;
+        Shadow<DWORD> pulseLength;
+    };
+    HostConfig m_hostConfig;
+
+    bool writeTargetMms(qint64 mms);
+
+    bool readBlock(int regAddr, WORD *words, int count);
+    void decodeSnapshot(DriveStatusSnapshot &snapshot) const;
 };
 
 #endif // AGEMOTIONDRIVER_H
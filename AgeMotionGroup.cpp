@@ -0,0 +1,175 @@
+#include "AgeMotionGroup.h"
+#include <memory>
+
+AgeMotionGroup::AgeMotionGroup(AgeBusThread *bus)
+    : m_bus(bus)
+{
+}
+
+void AgeMotionGroup::stage(int axis, double positionUm, double velocityUmPerSec)
+{
+    Q_ASSERT(axis >= 0 && axis < m_bus->axisCount());
+    for (Target &t : m_targets) {
+        if (t.axis == axis) {
+            t.positionUm = positionUm;
+            t.velocityUmPerSec = velocityUmPerSec;
+            return;
+        }
+    }
+    Target t;
+    t.axis = axis;
+    t.positionUm = positionUm;
+    t.velocityUmPerSec = velocityUmPerSec;
+    m_targets.append(t);
+}
+
+void AgeMotionGroup::clear()
+{
+    m_targets.clear();
+}
+
+QVector<int> AgeMotionGroup::stagedAxes() const
+{
+    QVector<int> axes;
+    for (const Target &t : m_targets) axes.append(t.axis);
+    return axes;
+}
+
+// 广播会作用于总线上的每一个驱动器: 须显式启用，且组内包含全部轴时才使用
+bool AgeMotionGroup::canBroadcast(const QVector<int> &axes) const
+{
+    if (!m_useBroadcast) return false;
+    const int count = m_bus->axisCount();
+    if (axes.size() != count) return false;
+    for (int i = 0; i < count; ++i) {
+        if (!axes.contains(i)) return false;
+    }
+    return true;
+}
+
+// ==========================================
+//          同步启动
+// ==========================================
+
+std::future<AgeMotionGroup::StartReport> AgeMotionGroup::start()
+{
+    auto promise = std::make_shared<std::promise<StartReport>>();
+    std::future<StartReport> future = promise->get_future();
+
+    const QVector<Target> targets = m_targets;
+    const bool broadcast = canBroadcast(stagedAxes());
+
+    if (targets.isEmpty()) {
+        StartReport r;
+        r.ok = true;
+        promise->set_value(r);
+        return future;
+    }
+
+    m_bus->postGroup([promise, targets, broadcast](const QList<AgeMotionDriver *> &drivers) {
+        StartReport r;
+
+        // 1. 预置速度 (影子相同时不发帧)，触发阶段只剩目标位置
+        for (const Target &t : targets) {
+            AgeMotionDriver *driver = drivers[t.axis];
+            if (t.velocityUmPerSec > 0.0 && !driver->setTargetVelocity(t.velocityUmPerSec)) {
+                r.error = QString("Axis %1: %2").arg(t.axis).arg(driver->getLastError());
+                promise->set_value(r);
+                return;
+            }
+        }
+
+        // 2. 全部轴且目标相同: 广播一帧，所有驱动器同时收到
+        bool sameTarget = true;
+        for (const Target &t : targets) {
+            if (t.positionUm != targets.first().positionUm) sameTarget = false;
+        }
+        if (broadcast && sameTarget) {
+            AgeMotionDriver *sender = drivers[targets.first().axis];
+            r.broadcast = true;
+            r.ok = sender->broadcastTargetPosition(targets.first().positionUm);
+            if (!r.ok) r.error = sender->getLastError();
+            for (int i = 0; i < targets.size(); ++i) r.offsetsUs.append(0);
+            promise->set_value(r);
+            return;
+        }
+
+        // 3. 逐轴紧凑连写目标位置，记录每帧完成时刻
+        //    moveTo() 对目标位置从不省略，每个轴都真正发出一帧；偏差只统计已发出的帧
+        r.ok = true;
+        qint64 firstUs = 0;
+        for (int i = 0; i < targets.size(); ++i) {
+            const Target &t = targets[i];
+            AgeMotionDriver *driver = drivers[t.axis];
+            if (!driver->moveTo(t.positionUm, 0.0)) {
+                r.ok = false;
+                r.error = QString("Axis %1: %2").arg(t.axis).arg(driver->getLastError());
+                break;
+            }
+            const qint64 nowUs = AgeMotionDriver::monotonicUs();
+            if (i == 0) firstUs = nowUs;
+            r.offsetsUs.append(nowUs - firstUs);
+        }
+        if (!r.offsetsUs.isEmpty()) r.skewUs = r.offsetsUs.last();
+        promise->set_value(r);
+    }, AgeBusThread::Priority::Command, [promise](const QString &reason) {
+        StartReport r;
+        r.error = reason;
+        promise->set_value(r);
+    });
+
+    return future;
+}
+
+// ==========================================
+//          停止 / 急停
+// ==========================================
+
+std::future<BusResult<bool>> AgeMotionGroup::stop()
+{
+    return halt(false);
+}
+
+std::future<BusResult<bool>> AgeMotionGroup::emergencyStop()
+{
+    return halt(true);
+}
+
+std::future<BusResult<bool>> AgeMotionGroup::halt(bool emergency)
+{
+    auto promise = std::make_shared<std::promise<BusResult<bool>>>();
+    std::future<BusResult<bool>> future = promise->get_future();
+
+    const QVector<int> axes = stagedAxes();
+    const bool broadcast = canBroadcast(axes);
+    const AgeBusThread::Priority priority =
+        emergency ? AgeBusThread::Priority::Emergency : AgeBusThread::Priority::Control;
+
+    // 先取消各轴排队的运动命令 (含尚未触发的 start())，停止之后不会再启动
+    for (int axis : axes) {
+        m_bus->cancelCommands(axis, emergency ? QString("Cancelled by emergency stop.") : QString("Cancelled by stop."));
+    }
+
+    m_bus->postGroup([promise, axes, broadcast, emergency](const QList<AgeMotionDriver *> &drivers) {
+        BusResult<bool> r;
+        if (broadcast) {
+            AgeMotionDriver *sender = drivers.first();
+            r.ok = emergency ? sender->broadcastEmergencyStop() : sender->broadcastStop();
+            if (!r.ok) r.error = sender->getLastError();
+        } else {
+            // 逐轴发送，一个轴失败不影响其余轴的停止
+            r.ok = true;
+            for (int axis : axes) {
+                AgeMotionDriver *driver = drivers[axis];
+                if (!(emergency ? driver->emergencyStop() : driver->stopMotion())) {
+                    r.ok = false;
+                    if (r.error.isEmpty()) r.error = QString("Axis %1: %2").arg(axis).arg(driver->getLastError());
+                }
+            }
+        }
+        r.value = r.ok;
+        promise->set_value(r);
+    }, priority);
+
+    return future;
+}
@@ -0,0 +1,68 @@
+#ifndef AGEMOTIONGROUP_H
+#define AGEMOTIONGROUP_H
+
+#include <QVector>
+#include <future>
+#include "AgeBusThread.h"
+
+// ==========================================
+//   多轴同步启动：先暂存各轴目标，再一次性触发
+// ==========================================
+// - 所有写入在总线线程的一个 job 内连续完成，中间不会插入轮询或其他命令
+// - 触发前先按轴写好速度 (与影子相同则省略)，触发阶段只剩目标位置帧
+// - 默认逐轴紧凑连写目标位置，报告首末两帧完成时刻之差作为启动偏差
+// - setUseBroadcast(true) 后，组内包含本进程全部轴且目标相同时，用站号 0 广播一帧触发，各轴同时启动；
+//   广播作用于线上的每一个驱动器 (包括不由本进程管理的，如另一工具共用的 RS-485 总线)，
+//   只有确认总线上没有其他驱动器时才应启用
+// ASD90XX 没有独立的 "启动" 寄存器，写入目标位置即开始运动，
+// 因此目标各不相同的轴只能逐站写入
+class AgeMotionGroup
+{
+public:
+    struct StartReport {
+        bool ok = false;
+        bool broadcast = false;       // 是否经广播一帧触发
+        qint64 skewUs = 0;            // 首末两帧目标写入完成的时间差 (广播时为 0)
+        QVector<qint64> offsetsUs;    // 已发出的目标帧相对第一帧的完成时刻，按 stage() 顺序；
+                                      // 中途失败时只含失败之前的轴
+        QString error;
+    };
+
+    explicit AgeMotionGroup(AgeBusThread *bus);
+
+    // 暂存轴目标；velocityUmPerSec <= 0 时沿用该轴当前速度设定
+    // 同一轴重复暂存时以最后一次为准
+    void stage(int axis, double positionUm, double velocityUmPerSec = 0.0);
+    void clear();
+    int stagedCount() const { return m_targets.size(); }
+
+    // 允许在覆盖全部轴时用站号 0 广播启动 / 停止 (默认关闭，见类说明)
+    void setUseBroadcast(bool enable) { m_useBroadcast = enable; }
+    bool useBroadcast() const { return m_useBroadcast; }
+
+    // 触发所有暂存目标 (Priority::Command)；暂存保留，扫描时只需重新 stage() 变化的轴
+    // 每个暂存轴的目标位置每次都会写出 (与上次相同也写，驱动器可能已自行改写目标)
+    std::future<StartReport> start();
+
+    // 暂存过的轴一起停止 / 急停；启用广播且覆盖全部轴时走广播
+    // 先取消这些轴排队中的运动命令 (包括尚未执行的 start()，其 StartReport 以 error 说明)
+    std::future<BusResult<bool>> stop();
+    std::future<BusResult<bool>> emergencyStop();
+
+private:
+    struct Target {
+        int axis = 0;
+        double positionUm = 0.0;
+        double velocityUmPerSec = 0.0;
+    };
+
+    std::future<BusResult<bool>> halt(bool emergency);
+    bool canBroadcast(const QVector<int> &axes) const;
+    QVector<int> stagedAxes() const;
+
+    AgeBusThread *m_bus;
+    QVector<Target> m_targets;
+    bool m_useBroadcast = false;
+};
+
+#endif // AGEMOTIONGROUP_H
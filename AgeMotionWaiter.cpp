@@ -0,0 +1,88 @@
+#include "AgeMotionWaiter.h"
+#include <cmath>
+
+qint64 AgeMotionWaiter::travelTimeUs(double distanceMms, double velocityMms, int accelMs)
+{
+    if (distanceMms <= 0.0) return 0;
+    if (velocityMms <= 0.0) return MAX_POLL_US; // 速度未知: 按最疏间隔采样
+
+    const double ta = accelMs / 1000.0;
+    double t = 0.0;
+    if (ta <= 0.0 || distanceMms >= velocityMms * ta) {
+        t = distanceMms / velocityMms + ta;                    // 梯形: 加速 + 匀速 + 减速
+    } else {
+        t = 2.0 * std::sqrt(distanceMms * ta / velocityMms);   // 三角形: 未达到最高速
+    }
+    return (qint64)(t * 1e6);
+}
+
+void AgeMotionWaiter::start(const Profile &profile, qint64 posRealMms, qint64 posTargetMms,
+                            qint64 nowUs, int timeoutMs)
+{
+    m_profile = profile;
+    m_state = State::Waiting;
+    m_deadlineUs = nowUs + (qint64)timeoutMs * 1000;
+    m_inBandSinceUs = -1;
+    m_samples = 0;
+    m_lastTargetMms = posTargetMms;
+
+    const double distance = std::fabs((double)(posTargetMms - posRealMms));
+    m_arrivalUs = nowUs + travelTimeUs(distance, m_profile.velocityMms, m_profile.accelMs)
+                  + (qint64)m_profile.timeErrAllowMs * 1000;
+
+    // 第一次采样: 预测到达前留出 10% (至少一个最密间隔) 的余量；
+    // 不晚于 MAX_FIRST_POLL_US 与超时时刻 (之后由 schedule() 按剩余时间加密)
+    const qint64 lead = qMax(MIN_POLL_US, (m_arrivalUs - nowUs) / 10);
+    m_nextPollUs = qMin(qMax(nowUs, m_arrivalUs - lead), qMin(nowUs + MAX_FIRST_POLL_US, m_deadlineUs));
+}
+
+AgeMotionWaiter::State AgeMotionWaiter::update(qint64 posRealMms, qint64 posTargetMms, qint64 nowUs)
+{
+    if (m_state != State::Waiting) return m_state;
+    ++m_samples;
+
+    qint64 diff = posRealMms - posTargetMms;
+    if (diff < 0) diff = -diff;
+
+    // 目标被其他命令改写: 重新预测
+    if (posTargetMms != m_lastTargetMms) {
+        m_lastTargetMms = posTargetMms;
+        m_inBandSinceUs = -1;
+        m_arrivalUs = nowUs + travelTimeUs((double)diff, m_profile.velocityMms, m_profile.accelMs)
+                      + (qint64)m_profile.timeErrAllowMs * 1000;
+    }
+
+    if ((quint64)diff <= m_profile.posErrAllowMms) {
+        if (m_inBandSinceUs < 0) m_inBandSinceUs = nowUs;
+        if (nowUs - m_inBandSinceUs >= (qint64)m_profile.timeErrAllowMs * 1000) {
+            m_state = State::Done;
+            return m_state;
+        }
+    } else {
+        m_inBandSinceUs = -1;
+    }
+
+    if (nowUs >= m_deadlineUs) {
+        m_state = State::TimedOut;
+        return m_state;
+    }
+    schedule(nowUs);
+    return m_state;
+}
+
+void AgeMotionWaiter::schedule(qint64 nowUs)
+{
+    qint64 interval = 0;
+    if (m_inBandSinceUs >= 0) {
+        // 已在到位带内: 在保持时间到达时再采一次
+        interval = m_inBandSinceUs + (qint64)m_profile.timeErrAllowMs * 1000 - nowUs;
+    } else if (nowUs < m_arrivalUs) {
+        // 到达前: 间隔取剩余时间的一半，越接近越密
+        interval = (m_arrivalUs - nowUs) / 2;
+    } else {
+        // 已超过预测时刻: 迟到越久间隔越大
+        interval = (nowUs - m_arrivalUs) / 4;
+    }
+    interval = qBound(MIN_POLL_US, interval, MAX_POLL_US);
+    m_nextPollUs = qMin(nowUs + interval, m_deadlineUs);
+}
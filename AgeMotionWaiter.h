@@ -0,0 +1,56 @@
+#ifndef AGEMOTIONWAITER_H
+#define AGEMOTIONWAITER_H
+
+#include <QtGlobal>
+
+// ==========================================
+//   运动到位判定 + 轮询时刻预测 (纯逻辑，不访问总线)
+// ==========================================
+// - 由剩余距离、ADDR_VEL_SET 换算的速度和加减速时间预测到达时刻，
+//   在到达前只做稀疏采样，临近到达时加密采样
+// - 到位判据: |实际 - 目标| <= ADDR_POS_ERR_ALLOW 且持续 ADDR_TIME_ERR_ALLOW
+// - 超过预测时刻仍未到位时逐步放慢采样，避免电机堵转时占满总线
+// 同一个对象可被同步等待 (AgeMotionDriver) 或总线线程调度复用
+class AgeMotionWaiter
+{
+public:
+    struct Profile {
+        double velocityMms = 0.0;    // 运行速度 (MMS/s)
+        int accelMs = 0;             // 加减速时间 (ADDR_VEL_FILTER)
+        quint32 posErrAllowMms = 0;  // 到位允许误差 (MMS)
+        int timeErrAllowMs = 0;      // 到位保持时间 (ms)
+    };
+
+    enum class State { Idle, Waiting, Done, TimedOut };
+
+    static constexpr qint64 MIN_POLL_US = 2000;   // 最密采样间隔
+    static constexpr qint64 MAX_POLL_US = 50000;  // 最疏采样间隔
+    static constexpr qint64 MAX_FIRST_POLL_US = 10 * MAX_POLL_US;  // 首次采样最多等待，长行程中也能及时发现停止或故障
+
+    void start(const Profile &profile, qint64 posRealMms, qint64 posTargetMms, qint64 nowUs, int timeoutMs);
+
+    // 送入一次采样，返回新的状态
+    State update(qint64 posRealMms, qint64 posTargetMms, qint64 nowUs);
+
+    State state() const { return m_state; }
+    qint64 nextPollUs() const { return m_nextPollUs; }
+    qint64 predictedArrivalUs() const { return m_arrivalUs; }
+    int samples() const { return m_samples; }
+
+    // 从静止走完 distance 所需时间 (梯形/三角形速度曲线)
+    static qint64 travelTimeUs(double distanceMms, double velocityMms, int accelMs);
+
+private:
+    void schedule(qint64 nowUs);
+
+    Profile m_profile;
+    State m_state = State::Idle;
+    qint64 m_deadlineUs = 0;
+    qint64 m_arrivalUs = 0;        // 预测到达 (含保持时间)
+    qint64 m_nextPollUs = 0;
+    qint64 m_inBandSinceUs = -1;   // 进入到位带的时刻，-1 表示不在带内
+    qint64 m_lastTargetMms = 0;
+    int m_samples = 0;
+};
+
+#endif // AGEMOTIONWAITER_H
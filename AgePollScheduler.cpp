@@ -0,0 +1,173 @@
+#include "AgePollScheduler.h"
+#include <limits>
+
+namespace {
+
+enum GroupIndex { Control = 0, Position, Velocity, Current, Temperature };
+
+// 回零 (0x0400/0x0800) 与限位运动 (0x0010/0x0020) 在动作完成前保持为 1
+constexpr quint16 CTRL_RUNNING_MASK = 0x0010 | 0x0020 | 0x0400 | 0x0800;
+
+constexpr qint64 NEVER = std::numeric_limits<qint64>::max();
+
+} // namespace
+
+void AgePollScheduler::setConfig(const Config &config)
+{
+    m_config = config;
+    m_config.busBudget = qBound(0.01, m_config.busBudget, 1.0);
+    m_config.burstMs = qMax(1, m_config.burstMs);
+    m_tokensUs = qMin(m_tokensUs, (double)m_config.burstMs * 1000.0);
+    // 新间隔从各分组上次读取时刻起算
+    const qint64 nowUs = AgeMotionDriver::monotonicUs();
+    for (AxisState &state : m_axes) reschedule(state, nowUs);
+}
+
+void AgePollScheduler::setAxisCount(int count)
+{
+    m_axes.resize((size_t)qMax(0, count));
+}
+
+void AgePollScheduler::setEnabled(int axis, bool enabled)
+{
+    AxisState &state = m_axes[(size_t)axis];
+    if (state.enabled == enabled) return;
+    state = AxisState();
+    state.enabled = enabled;   // 重新启用时 lastUs/dueUs 为 0，全部分组立即到期
+}
+
+bool AgePollScheduler::isMoving(int axis, qint64 nowUs) const
+{
+    const AxisState &state = m_axes[(size_t)axis];
+    return state.moving || nowUs < state.holdUntilUs;
+}
+
+qint64 AgePollScheduler::intervalUs(int axis, int group, qint64 nowUs) const
+{
+    return interval(m_axes[(size_t)axis], group, nowUs);
+}
+
+qint64 AgePollScheduler::interval(const AxisState &state, int group, qint64 nowUs) const
+{
+    const bool moving = state.moving || nowUs < state.holdUntilUs;
+    int ms = 0;
+    switch (group) {
+    case Control:     ms = m_config.controlMs; break;
+    case Position:    ms = moving ? m_config.positionMovingMs : m_config.positionIdleMs; break;
+    case Velocity:    ms = moving ? m_config.velocityMovingMs : m_config.velocityIdleMs; break;
+    case Current:     ms = m_config.currentMs; break;
+    case Temperature: ms = m_config.temperatureMs; break;
+    }
+    return (qint64)qMax(1, ms) * 1000;
+}
+
+void AgePollScheduler::reschedule(AxisState &state, qint64 nowUs)
+{
+    for (int g = 0; g < GROUP_COUNT; ++g) {
+        state.dueUs[g] = state.lastUs[g] ? state.lastUs[g] + interval(state, g, nowUs) : 0;
+    }
+}
+
+qint64 AgePollScheduler::earliestDue(const AxisState &state) const
+{
+    qint64 due = NEVER;
+    for (qint64 d : state.dueUs) due = qMin(due, d);
+    return due;
+}
+
+// ==========================================
+//          预算 (令牌桶)
+// ==========================================
+
+void AgePollScheduler::refill(qint64 nowUs)
+{
+    if (m_refillUs == 0) {
+        m_tokensUs = (double)m_config.burstMs * 1000.0;
+    } else if (nowUs > m_refillUs) {
+        m_tokensUs = qMin((double)m_config.burstMs * 1000.0,
+                          m_tokensUs + (double)(nowUs - m_refillUs) * m_config.busBudget);
+    }
+    m_refillUs = qMax(m_refillUs, nowUs);
+}
+
+// 令牌回到 0 的时刻
+qint64 AgePollScheduler::budgetReadyUs() const
+{
+    if (m_tokensUs >= 0.0 || m_refillUs == 0) return 0;
+    return m_refillUs + (qint64)(-m_tokensUs / m_config.busBudget) + 1;
+}
+
+// ==========================================
+//          调度
+// ==========================================
+
+qint64 AgePollScheduler::nextDueUs() const
+{
+    qint64 due = NEVER;
+    for (const AxisState &state : m_axes) {
+        if (state.enabled) due = qMin(due, earliestDue(state));
+    }
+    if (due == NEVER) return NEVER;
+    return qMax(due, budgetReadyUs());
+}
+
+bool AgePollScheduler::takeDue(qint64 nowUs, int &axis, quint32 &groups)
+{
+    if (budgetReadyUs() > nowUs) return false;
+
+    // 最早到期的轴；到期时刻相同时从 m_cursor 起轮转
+    const int count = (int)m_axes.size();
+    int best = -1;
+    qint64 bestDue = NEVER;
+    for (int k = 0; k < count; ++k) {
+        const int i = (m_cursor + k) % count;
+        const AxisState &state = m_axes[(size_t)i];
+        if (!state.enabled) continue;
+        const qint64 due = earliestDue(state);
+        if (due < bestDue) {
+            bestDue = due;
+            best = i;
+        }
+    }
+    if (best < 0 || bestDue > nowUs) return false;
+
+    groups = 0;
+    const AxisState &state = m_axes[(size_t)best];
+    for (int g = 0; g < GROUP_COUNT; ++g) {
+        if (state.dueUs[g] <= nowUs + COALESCE_US) groups |= (1u << g);
+    }
+    axis = best;
+    m_cursor = (best + 1) % count;
+    return true;
+}
+
+void AgePollScheduler::onPolled(int axis, quint32 groups, const DriveStatusSnapshot &snapshot,
+                                qint64 startUs, qint64 endUs)
+{
+    refill(endUs);
+    m_tokensUs -= (double)qMax<qint64>(0, endUs - startUs);
+
+    AxisState &state = m_axes[(size_t)axis];
+    // 失败的分组同样按间隔推迟，不在断线时占满总线 (断路由 AgeResilientTransport 处理)
+    for (int g = 0; g < GROUP_COUNT; ++g) {
+        if (groups & (1u << g)) state.lastUs[g] = startUs;
+    }
+
+    const quint32 fresh = snapshot.freshGroups;
+    if (fresh & (DriveStatusSnapshot::GroupControl | DriveStatusSnapshot::GroupPosition | DriveStatusSnapshot::GroupVelocity)) {
+        const bool moving = (snapshot.has(DriveStatusSnapshot::GroupPosition) && !snapshot.isMotionDone)
+                            || (snapshot.has(DriveStatusSnapshot::GroupVelocity) && snapshot.velReal != 0)
+                            || (snapshot.has(DriveStatusSnapshot::GroupControl) && (snapshot.control & CTRL_RUNNING_MASK));
+        if (moving || state.moving) state.holdUntilUs = qMax(state.holdUntilUs, endUs + (qint64)m_config.settleHoldMs * 1000);
+        state.moving = moving;
+    }
+    reschedule(state, endUs);
+}
+
+void AgePollScheduler::onCommand(int axis, qint64 nowUs)
+{
+    AxisState &state = m_axes[(size_t)axis];
+    if (!state.enabled) return;
+    state.holdUntilUs = qMax(state.holdUntilUs, nowUs + (qint64)m_config.settleHoldMs * 1000);
+    reschedule(state, nowUs);
+}
@@ -0,0 +1,79 @@
+#ifndef AGEPOLLSCHEDULER_H
+#define AGEPOLLSCHEDULER_H
+
+#include <QtGlobal>
+#include <vector>
+#include "AgeMotionDriver.h"
+
+// ==========================================
+//   状态轮询调度: 按分组与运动状态定频，受总线时间预算约束 (纯逻辑，不访问总线)
+// ==========================================
+// - 每个轴的每个分组 (DriveStatusSnapshot::Group) 各有下次到期时刻:
+//   位置/速度运动中快、静止时慢，控制字/故障码中速，电流与温度低速
+// - 运动判断: 实时位置未到目标、实时速度非零、或控制字的回零/限位运动位为 1；
+//   命令执行后 (onCommand) 立即按运动中处理，运动结束后再保持 settleHoldMs，记录完整的到位过程
+// - 预算: 令牌桶，每次读取按实际耗时扣除，按 busBudget 比例回补 (容量 burstMs)；
+//   令牌为负时推迟轮询，预算不足时各轴按到期先后依次推迟，命令与到位监视不受限制
+// - 只在总线线程中使用
+class AgePollScheduler
+{
+public:
+    struct Config {
+        int positionMovingMs = 10;
+        int positionIdleMs = 500;
+        int velocityMovingMs = 20;
+        int velocityIdleMs = 1000;
+        int controlMs = 100;          // 控制字 + 故障码
+        int currentMs = 1000;         // ADDR_CURRENT_REAL
+        int temperatureMs = 5000;     // ADDR_CPU_TEMP
+        int settleHoldMs = 300;
+        double busBudget = 0.5;       // 轮询可占用的总线时间比例 (0-1]
+        int burstMs = 20;             // 令牌桶容量
+    };
+
+    static constexpr int GROUP_COUNT = 5;        // 与 DriveStatusSnapshot::Group 的位一一对应
+    static constexpr qint64 COALESCE_US = 2000;  // 同一轴到期时刻相差不超过此值的分组一起读
+
+    void setConfig(const Config &config);
+    const Config &config() const { return m_config; }
+
+    // 轴数与可轮询状态 (未连接的轴不调度；重新可轮询时全部分组立即到期)
+    void setAxisCount(int count);
+    void setEnabled(int axis, bool enabled);
+
+    // 最早可执行轮询的时刻 (已计入预算)，没有可轮询的轴时返回 INT64 最大值
+    qint64 nextDueUs() const;
+    // 取一个到期的轴及其到期分组；没有到期或预算不足时返回 false
+    bool takeDue(qint64 nowUs, int &axis, quint32 &groups);
+    // 一次状态读取完成后调用 (包括到位监视等其他来源的读取)，groups 为本次请求的分组
+    void onPolled(int axis, quint32 groups, const DriveStatusSnapshot &snapshot, qint64 startUs, qint64 endUs);
+    // 命令执行后调用: 按运动中处理
+    void onCommand(int axis, qint64 nowUs);
+
+    bool isMoving(int axis, qint64 nowUs) const;
+    // 分组的当前轮询间隔 (µs)
+    qint64 intervalUs(int axis, int group, qint64 nowUs) const;
+
+private:
+    struct AxisState {
+        bool enabled = false;
+        bool moving = false;          // 最近一次读取判断为运动中
+        qint64 holdUntilUs = 0;       // 此前按运动中处理
+        qint64 lastUs[GROUP_COUNT] = {};
+        qint64 dueUs[GROUP_COUNT] = {};
+    };
+
+    void reschedule(AxisState &state, qint64 nowUs);
+    qint64 interval(const AxisState &state, int group, qint64 nowUs) const;
+    qint64 earliestDue(const AxisState &state) const;
+    qint64 budgetReadyUs() const;
+    void refill(qint64 nowUs);
+
+    Config m_config;
+    std::vector<AxisState> m_axes;
+    int m_cursor = 0;                 // 到期时刻相同时的轮转起点
+    double m_tokensUs = 0.0;
+    qint64 m_refillUs = 0;
+};
+
+#endif // AGEPOLLSCHEDULER_H
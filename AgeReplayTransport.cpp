@@ -0,0 +1,305 @@
+#include "AgeReplayTransport.h"
+#include "AgeMotionDriver.h"
+#include "AgeRtuFrame.h"
+#include <cmath>
+
+namespace {
+constexpr int REGISTER_COUNT = 0x10000;
+constexpr qint64 REFRESH_INTERVAL_US = 100000;  // 文件仍在写入时，重新读取计数的最短间隔
+}
+
+AgeReplayTransport::AgeReplayTransport(const Config &config)
+    : m_config(config)
+{
+}
+
+bool AgeReplayTransport::open()
+{
+    if (m_open) return true;
+    if (!m_reader.open(m_config.path)) {
+        m_lastError = m_reader.lastError();
+        return false;
+    }
+    if (m_reader.sampleCount() == 0) {
+        m_lastError = QString("Recording %1 contains no samples.").arg(m_config.path);
+        m_reader.close();
+        return false;
+    }
+    m_open = true;
+    m_busInfo = AgeBusInfo();
+    m_tables.clear();
+    seedTables();
+    restart();
+    return true;
+}
+
+// 扫描全部样本，按各轴的第一条样本建立寄存器表 (回放到该轴之前也能读到它的初始状态)
+void AgeReplayTransport::seedTables()
+{
+    QVector<bool> seen;
+    const qint64 total = m_reader.sampleCount();
+    for (qint64 first = 0; first < total;) {
+        const int n = m_reader.read(first, m_chunk, CHUNK);
+        if (n <= 0) break;
+        for (int i = 0; i < n; ++i) {
+            const AgeTelemetrySample &sample = m_chunk[i];
+            if (sample.axis < seen.size() && seen[sample.axis]) continue;
+            if (sample.axis >= seen.size()) seen.resize(sample.axis + 1);
+            seen[sample.axis] = true;
+            apply(sample);
+        }
+        first += n;
+    }
+}
+
+void AgeReplayTransport::close()
+{
+    m_reader.close();
+    m_open = false;
+}
+
+bool AgeReplayTransport::isValid(bool autoConnect)
+{
+    Q_UNUSED(autoConnect);
+    if (!m_open) m_lastError = "Replay file not open.";
+    return m_open;
+}
+
+bool AgeReplayTransport::getBusInfo(AgeBusInfo &info)
+{
+    info = m_busInfo;
+    return true;
+}
+
+// ==========================================
+//          回放时钟
+// ==========================================
+
+// 回到首条样本；首条样本立即生效，驱动连接时即可读到记录中的状态
+void AgeReplayTransport::restart()
+{
+    m_next = 0;
+    m_chunkSize = 0;
+    m_chunkPos = 0;
+    m_startUs = 0;
+    if (!fetch()) return;
+    m_firstTs = m_chunk[0].timestampUs;
+    apply(m_chunk[m_chunkPos++]);
+    ++m_next;
+}
+
+bool AgeReplayTransport::fetch()
+{
+    if (m_chunkPos < m_chunkSize) return true;
+    m_chunkSize = m_reader.read(m_next, m_chunk, CHUNK);
+    m_chunkPos = 0;
+    if (m_chunkSize > 0) return true;
+
+    // 写端仍在追加: 限频重新读取计数
+    const qint64 nowUs = AgeMotionDriver::monotonicUs();
+    if (m_reader.isComplete() || nowUs - m_lastRefreshUs < REFRESH_INTERVAL_US) return false;
+    m_lastRefreshUs = nowUs;
+    m_reader.refresh();
+    m_chunkSize = m_reader.read(m_next, m_chunk, CHUNK);
+    return m_chunkSize > 0;
+}
+
+void AgeReplayTransport::advance(bool stepOne)
+{
+    if (!m_open) return;
+    if (stepOne) {
+        if (fetch()) {
+            apply(m_chunk[m_chunkPos++]);
+            ++m_next;
+        } else if (m_config.loop && m_reader.isComplete()) {
+            restart();
+        }
+        return;
+    }
+
+    const qint64 nowUs = AgeMotionDriver::monotonicUs();
+    if (m_startUs == 0) m_startUs = nowUs;   // 从第一次读取开始计时，连接耗时不计入
+    const qint64 targetTs = m_firstTs + (qint64)((double)(nowUs - m_startUs) * m_config.speed);
+    while (fetch()) {
+        const AgeTelemetrySample &sample = m_chunk[m_chunkPos];
+        if (sample.timestampUs > targetTs) return;
+        apply(sample);
+        ++m_chunkPos;
+        ++m_next;
+    }
+    if (m_config.loop && m_reader.isComplete()) restart();
+}
+
+// 样本按驱动器的原始单位写回寄存器表 (只写本次刷新过的分组)
+void AgeReplayTransport::apply(const AgeTelemetrySample &sample)
+{
+    if (sample.axis >= m_tables.size()) {
+        const int oldSize = m_tables.size();
+        m_tables.resize(sample.axis + 1);
+        for (int i = oldSize; i < m_tables.size(); ++i) initTable(m_tables[i]);
+    }
+    quint16 *regs = m_tables[sample.axis].data();
+    m_lastTs = sample.timestampUs;
+
+    if (sample.freshGroups & DriveStatusSnapshot::GroupControl) {
+        regs[AgeReg::ADDR_CONTROL] = sample.control;
+        regs[AgeReg::ADDR_ERROR_CODE] = sample.errorCode;
+    }
+    if (sample.freshGroups & DriveStatusSnapshot::GroupPosition) {
+        const qint64 posMms = std::llround(sample.positionUm * AgeMotionDriver::mmsPerUm());
+        const qint64 targetMms = std::llround(sample.targetUm * AgeMotionDriver::mmsPerUm());
+        AgeRtu::packU64((quint64)posMms, regs + AgeReg::ADDR_POS_REAL);
+        AgeRtu::packU64((quint64)targetMms, regs + AgeReg::ADDR_POS_TARGET);
+        const quint32 pulseLength = AgeRtu::unpackU32(regs + AgeReg::ADDR_PULSE_LENGTH);
+        if (pulseLength) AgeRtu::packU32((quint32)(qint32)(posMms / pulseLength), regs + AgeReg::ADDR_PULSE_POS_REAL);
+    }
+    if (sample.freshGroups & DriveStatusSnapshot::GroupVelocity) {
+        regs[AgeReg::ADDR_VEL_REAL] = (quint16)(qint16)std::lround(sample.velocityUmPerSec / AgeMotionDriver::umPerSecPerVelUnit());
+    }
+    if (sample.freshGroups & DriveStatusSnapshot::GroupCurrent) {
+        regs[AgeReg::ADDR_CURRENT_REAL] = (quint16)std::lround(sample.currentA * 100.0);
+    }
+}
+
+// 记录中没有的寄存器取出厂默认值 (与 sim/AgeDriveSim 相同)
+void AgeReplayTransport::initTable(std::vector<quint16> &regs)
+{
+    regs.assign(REGISTER_COUNT, 0);
+    regs[AgeReg::ADDR_CURRENT_MAX] = 300;
+    regs[AgeReg::ADDR_CURRENT_MIN] = 10;
+    regs[AgeReg::ADDR_CURRENT_SET] = 150;
+    regs[AgeReg::ADDR_CURRENT_LOW] = 50;
+    regs[AgeReg::ADDR_CURRENT_LOW_WT] = 500;
+    AgeRtu::packU32(76800, regs.data() + AgeReg::ADDR_T_RESOLUTION);
+    AgeRtu::packU32(640, regs.data() + AgeReg::ADDR_PULSE_LENGTH);
+    AgeRtu::packU32(16000, regs.data() + AgeReg::ADDR_POS_ERR_ALLOW);
+    regs[AgeReg::ADDR_TIME_ERR_ALLOW] = 10;
+    regs[AgeReg::ADDR_VEL_SET] = 50;
+    regs[AgeReg::ADDR_VEL_START] = 1;
+    regs[AgeReg::ADDR_VEL_FILTER] = 50;
+    regs[AgeReg::ADDR_VEL_KV] = 20;
+    regs[AgeReg::ADDR_VEL_ZERO] = 25;
+    AgeRtu::packU32(115200, regs.data() + AgeReg::ADDR_BUS_BAUD);
+    regs[AgeReg::ADDR_CPU_TEMP] = 38;
+
+    const char name[] = "ASD90XX-REPLAY";
+    for (int i = 0; i < (int)sizeof(name) - 1; i += 2) {
+        const quint8 hi = (quint8)name[i];
+        const quint8 lo = (i + 1 < (int)sizeof(name) - 1) ? (quint8)name[i + 1] : 0;
+        regs[AgeReg::ADDR_DRIVER_NAME + i / 2] = (quint16)((hi << 8) | lo);
+    }
+}
+
+// ==========================================
+//          寄存器读写
+// ==========================================
+
+std::vector<quint16> *AgeReplayTransport::table(BYTE station)
+{
+    const int axis = (int)station - (int)m_config.firstStation;
+    if (axis < 0 || axis >= m_tables.size()) return nullptr;
+    return &m_tables[axis];
+}
+
+bool AgeReplayTransport::readRegs(BYTE station, WORD reg, WORD *data, WORD count)
+{
+    ++m_busInfo.busOpCounts;
+    if (!m_open) {
+        ++m_busInfo.busOpErrors;
+        m_lastError = "Replay file not open.";
+        return false;
+    }
+    // 倍速 <= 0 时以位置读取作为回放的节拍
+    const bool step = m_config.speed <= 0.0 && reg <= AgeReg::ADDR_POS_REAL && reg + count > AgeReg::ADDR_POS_REAL;
+    advance(step);
+
+    std::vector<quint16> *regs = table(station);
+    if (!regs || (int)reg + count > REGISTER_COUNT) {
+        ++m_busInfo.busOpErrors;
+        m_lastError = QString("REPLAY: station %1 is not in the recording.").arg((int)station);
+        return false;
+    }
+    for (int i = 0; i < count; ++i) data[i] = (*regs)[reg + i];
+    ++m_busInfo.rxFrames;
+    return true;
+}
+
+bool AgeReplayTransport::writeRegs(BYTE station, WORD reg, const WORD *data, WORD count)
+{
+    ++m_busInfo.busOpCounts;
+    ++m_busInfo.txFrames;
+    if (!m_open) {
+        ++m_busInfo.busOpErrors;
+        m_lastError = "Replay file not open.";
+        return false;
+    }
+    // 广播写入所有轴
+    for (int axis = 0; axis < m_tables.size(); ++axis) {
+        if (station != 0 && station != m_config.firstStation + axis) continue;
+        if ((int)reg + count > REGISTER_COUNT) break;
+        for (int i = 0; i < count; ++i) m_tables[axis][reg + i] = data[i];
+        if (station != 0) return true;
+    }
+    if (station == 0) return true;
+    ++m_busInfo.busOpErrors;
+    m_lastError = QString("REPLAY: station %1 is not in the recording.").arg((int)station);
+    return false;
+}
+
+bool AgeReplayTransport::readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    return readRegs(station, reg, &data, 1);
+}
+
+bool AgeReplayTransport::readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    WORD w[2];
+    if (!readRegs(station, reg, w, 2)) return false;
+    data = (DWORD)AgeRtu::unpackU32(w);
+    return true;
+}
+
+bool AgeReplayTransport::readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    WORD w[4];
+    if (!readRegs(station, reg, w, 4)) return false;
+    data = (QWORD)AgeRtu::unpackU64(w);
+    return true;
+}
+
+bool AgeReplayTransport::readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    return readRegs(station, reg, data, count);
+}
+
+bool AgeReplayTransport::writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    return writeRegs(station, reg, &data, 1);
+}
+
+bool AgeReplayTransport::writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    WORD w[2];
+    AgeRtu::packU32((quint32)data, w);
+    return writeRegs(station, reg, w, 2);
+}
+
+bool AgeReplayTransport::writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    WORD w[4];
+    AgeRtu::packU64((quint64)data, w);
+    return writeRegs(station, reg, w, 4);
+}
+
+bool AgeReplayTransport::writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout)
+{
+    Q_UNUSED(timeout);
+    return writeRegs(station, reg, data, count);
+}
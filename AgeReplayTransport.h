@@ -0,0 +1,86 @@
+#ifndef AGEREPLAYTRANSPORT_H
+#define AGEREPLAYTRANSPORT_H
+
+#include <QVector>
+#include <vector>
+#include "AgeTransport.h"
+#include "AgeTelemetryRecorder.h"
+
+// ==========================================
+//   回放传输: 用 .agetrace 记录文件代替驱动器应答
+// ==========================================
+// - 与其他传输一样挂在 AgeMotionDriver / AgeBusThread 下，界面与对焦算法无需修改
+//   (AGEMOTION_TRANSPORT=replay, AGEMOTION_REPLAY_FILE=<文件>, AGEMOTION_REPLAY_SPEED=<倍速>)
+// - 每个轴一张寄存器表，记录中的位置/目标位置/实时速度/电流/控制字/故障码按驱动器的原始单位写回，
+//   其余寄存器为出厂默认值；轴 n 对应站号 firstStation + n
+// - 打开时扫描一遍记录，每个出现过的轴先写入其第一条样本，各轴连接时即可读到记录中的状态
+// - 回放时钟: speed > 0 时记录时间 = 首条样本时刻 + 实际经过时间 x speed，每次读取前推进到该时刻；
+//   speed <= 0 时不按时间，每次读取状态寄存器前进一条样本 (尽可能快)
+// - 写入只保存到寄存器表，下一条样本会覆盖被记录的寄存器 (运动命令不改变回放轨迹)
+// - 记录结束后保持最后的值 (loop 为 true 时从头开始)；文件仍在写入时会继续读取新样本
+// - 仅在一个线程中使用
+class AgeReplayTransport : public AgeTransport
+{
+public:
+    struct Config {
+        QString path;
+        double speed = 1.0;          // 倍速；<= 0 = 每次状态读取前进一条
+        bool loop = false;
+        quint8 firstStation = 1;
+    };
+
+    explicit AgeReplayTransport(const Config &config);
+
+    bool open() override;
+    void close() override;
+    bool isValid(bool autoConnect) override;
+
+    bool readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout) override;
+    bool readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout) override;
+    bool readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout) override;
+    bool readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout) override;
+
+    bool writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout) override;
+    bool writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout) override;
+    bool writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout) override;
+    bool writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout) override;
+
+    QString name() const override { return "REPLAY"; }
+    bool getBusInfo(AgeBusInfo &info) override;
+
+    // 回放进度: 已应用的样本数 / 文件中的样本数，记录时间 (相对首条样本, µs)
+    qint64 position() const { return m_next; }
+    qint64 sampleCount() const { return m_reader.sampleCount(); }
+    qint64 replayTimeUs() const { return m_lastTs - m_firstTs; }
+    bool atEnd() const { return m_next >= m_reader.sampleCount(); }
+
+private:
+    static constexpr int CHUNK = 512;
+
+    std::vector<quint16> *table(BYTE station);
+    void initTable(std::vector<quint16> &regs);
+    void seedTables();
+    void advance(bool stepOne);
+    void apply(const AgeTelemetrySample &sample);
+    void restart();
+    bool fetch();
+    bool readRegs(BYTE station, WORD reg, WORD *data, WORD count);
+    bool writeRegs(BYTE station, WORD reg, const WORD *data, WORD count);
+
+    Config m_config;
+    AgeTelemetryFileReader m_reader;
+    bool m_open = false;
+    QVector<std::vector<quint16>> m_tables;   // 按轴号
+
+    AgeTelemetrySample m_chunk[CHUNK];
+    int m_chunkSize = 0;
+    int m_chunkPos = 0;
+    qint64 m_next = 0;                        // 下一条要应用的样本序号
+    qint64 m_firstTs = 0;
+    qint64 m_lastTs = 0;
+    qint64 m_startUs = 0;                     // 回放开始的实际时刻
+    qint64 m_lastRefreshUs = 0;
+    AgeBusInfo m_busInfo;
+};
+
+#endif // AGEREPLAYTRANSPORT_H
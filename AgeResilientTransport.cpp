@@ -0,0 +1,334 @@
+#include "AgeResilientTransport.h"
+#include "AgeMotionDriver.h"
+#include <QDebug>
+#include <chrono>
+#include <limits>
+
+namespace {
+
+constexpr int MAX_BACKOFF_SHIFT = 6;
+constexpr qint64 CLOCK_GRANULARITY_US = 1000;  // 超时以 ms 下发
+
+qint64 nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 停止 / 急停 (控制寄存器 Bit 12 / Bit 13，见 AgeMotionDriver::stopMotion() / emergencyStop())
+bool isStopCommand(WORD reg, WORD data)
+{
+    return reg == AgeReg::ADDR_CONTROL && (data & (0x1000 | 0x2000)) != 0;
+}
+
+} // namespace
+
+AgeResilientTransport::AgeResilientTransport(QSharedPointer<AgeTransport> inner)
+    : AgeResilientTransport(inner, Config())
+{
+}
+
+AgeResilientTransport::AgeResilientTransport(QSharedPointer<AgeTransport> inner, const Config &config)
+    : m_inner(inner)
+    , m_config(config)
+{
+}
+
+quint32 AgeResilientTransport::rttKey(BYTE station, bool write, WORD count)
+{
+    return ((quint32)station << 24) | ((quint32)(write ? 1 : 0) << 16) | count;
+}
+
+int AgeResilientTransport::timeoutFor(const Rtt &rtt) const
+{
+    const qint64 rtoUs = rtt.srttUs + qMax(CLOCK_GRANULARITY_US, 4 * rtt.rttvarUs);
+    const qint64 ms = ((rtoUs + 999) / 1000) << rtt.backoff;
+    return (int)qBound<qint64>(m_config.minTimeoutMs, ms, m_config.maxTimeoutMs);
+}
+
+void AgeResilientTransport::trip(Station &s, qint64 now)
+{
+    s.open = true;
+    ++s.trips;
+    s.probeIntervalMs = m_config.probeIntervalMs;
+    s.nextProbeUs = now + (qint64)s.probeIntervalMs * 1000;
+}
+
+// ==========================================
+//          断路检查 / 往返时间估计
+// ==========================================
+
+bool AgeResilientTransport::begin(BYTE station, bool write, WORD count, DWORD &timeout, qint64 &startUs, bool urgent)
+{
+    // 广播与不等待应答的写: 不计时、不受断路限制
+    if (station == 0 || timeout == TIMEOUT_NO_REPLY) {
+        startUs = -1;
+        return true;
+    }
+
+    Station &s = m_stations[station];
+    s.seen = true;
+    const qint64 now = nowUs();
+    // 停止 / 急停不因断路而不发: 驱动器可能只是轮询读失败，命令仍有机会送达；结果按探测处理
+    if (s.open && now < s.nextProbeUs && !urgent) {
+        ++s.shortCircuited;
+        m_lastError = QString("Station %1 not responding (link down, retry in %2 ms).")
+                          .arg((int)station).arg((s.nextProbeUs - now + 999) / 1000);
+        return false;
+    }
+
+    if (timeout == 0) {
+        const Rtt rtt = m_rtt.value(rttKey(station, write, count));
+        if (rtt.srttUs > 0) timeout = (DWORD)timeoutFor(rtt);
+    }
+    startUs = now;
+    return true;
+}
+
+bool AgeResilientTransport::finish(BYTE station, bool write, WORD count, qint64 startUs, bool ok)
+{
+    if (!ok) m_lastError = m_inner->lastError();
+    m_lastException = !ok && m_inner->lastFailureWasException();
+    if (startUs < 0) return ok;
+
+    const qint64 now = nowUs();
+    Station &s = m_stations[station];
+    Rtt &rtt = m_rtt[rttKey(station, write, count)];
+
+    // 异常应答 (非法地址 / 非法值等): 驱动器在线，只是拒绝了请求；
+    // 不计入断路与超时退避，应答帧长与正常应答不同，也不作为往返时间样本
+    if (m_lastException) {
+        s.consecutiveFailures = 0;
+        if (s.open) {
+            s.open = false;
+            qDebug() << "✅ AgeResilientTransport: station" << (int)station << "responding again";
+        }
+        return false;
+    }
+
+    if (ok) {
+        // RFC 6298: 首个样本 SRTT = R, RTTVAR = R/2；之后 α = 1/8, β = 1/4
+        const qint64 r = now - startUs;
+        if (rtt.srttUs == 0) {
+            rtt.srttUs = qMax<qint64>(1, r);
+            rtt.rttvarUs = r / 2;
+        } else {
+            rtt.rttvarUs = (3 * rtt.rttvarUs + qAbs(rtt.srttUs - r)) / 4;
+            rtt.srttUs = (7 * rtt.srttUs + r) / 8;
+        }
+        rtt.backoff = 0;
+
+        s.consecutiveFailures = 0;
+        if (s.open) {
+            s.open = false;
+            qDebug() << "✅ AgeResilientTransport: station" << (int)station << "responding again";
+        }
+        return true;
+    }
+
+    if (rtt.srttUs > 0) rtt.backoff = qMin(rtt.backoff + 1, MAX_BACKOFF_SHIFT);
+    ++s.consecutiveFailures;
+    if (s.open) {
+        // 探测失败: 间隔加倍
+        s.probeIntervalMs = qMin(s.probeIntervalMs * 2, m_config.maxProbeIntervalMs);
+        s.nextProbeUs = now + (qint64)s.probeIntervalMs * 1000;
+    } else if (s.consecutiveFailures >= m_config.failureThreshold) {
+        trip(s, now);
+        qWarning() << "AgeResilientTransport: station" << (int)station << "link down after"
+                   << s.consecutiveFailures << "failures:" << m_lastError;
+    }
+    return false;
+}
+
+// ==========================================
+//          探测与状态
+// ==========================================
+
+bool AgeResilientTransport::probe()
+{
+    const qint64 now = nowUs();
+    bool probed = false;
+    for (int station = 1; station < 256; ++station) {
+        const Station &s = m_stations[station];
+        if (!s.open || s.nextProbeUs > now) continue;
+        WORD value = 0;
+        readWORD((BYTE)station, m_config.probeRegister, value, 0);
+        probed = true;
+    }
+    return probed;
+}
+
+qint64 AgeResilientTransport::nextProbeUs() const
+{
+    qint64 due = std::numeric_limits<qint64>::max();
+    for (const Station &s : m_stations) {
+        if (s.open) due = qMin(due, s.nextProbeUs);
+    }
+    return due;
+}
+
+bool AgeResilientTransport::isOpen(BYTE station) const
+{
+    return m_stations[station].open;
+}
+
+AgeLinkState AgeResilientTransport::linkState(BYTE station) const
+{
+    const Station &s = m_stations[station];
+    AgeLinkState state;
+    state.station = station;
+    state.breaker = s.open ? AgeLinkState::Breaker::Open : AgeLinkState::Breaker::Closed;
+    state.consecutiveFailures = s.consecutiveFailures;
+    state.shortCircuited = s.shortCircuited;
+    state.trips = s.trips;
+    const Rtt rtt = m_rtt.value(rttKey(station, false, 1));
+    if (rtt.srttUs > 0) {
+        state.srttUs = rtt.srttUs;
+        state.rttvarUs = rtt.rttvarUs;
+        state.timeoutMs = timeoutFor(rtt);
+    }
+    if (s.open) state.nextProbeInMs = qMax<qint64>(0, (s.nextProbeUs - nowUs()) / 1000);
+    return state;
+}
+
+QVector<AgeLinkState> AgeResilientTransport::linkStates() const
+{
+    QVector<AgeLinkState> states;
+    for (int station = 1; station < 256; ++station) {
+        if (m_stations[station].seen) states.append(linkState((BYTE)station));
+    }
+    return states;
+}
+
+void AgeResilientTransport::closeBreakers()
+{
+    // 重新建立的链路从闭合状态开始，往返时间估计保留
+    for (Station &s : m_stations) {
+        s.open = false;
+        s.consecutiveFailures = 0;
+    }
+}
+
+// ==========================================
+//          链路管理 (直接转发)
+// ==========================================
+
+bool AgeResilientTransport::open()
+{
+    const bool ok = m_inner->open();
+    if (!ok) {
+        m_lastError = m_inner->lastError();
+        return false;
+    }
+    closeBreakers();
+    return true;
+}
+
+void AgeResilientTransport::close()
+{
+    m_inner->close();
+}
+
+bool AgeResilientTransport::isValid(bool autoConnect)
+{
+    const bool ok = m_inner->isValid(autoConnect);
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+bool AgeResilientTransport::reconnect()
+{
+    if (!m_inner->reconnect()) {
+        m_lastError = m_inner->lastError();
+        return false;
+    }
+    closeBreakers();
+    return true;
+}
+
+bool AgeResilientTransport::getBusInfo(AgeBusInfo &info)
+{
+    const bool ok = m_inner->getBusInfo(info);
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+bool AgeResilientTransport::getSerialConfig(DWORD &baudRate, WORD &parity)
+{
+    const bool ok = m_inner->getSerialConfig(baudRate, parity);
+    if (!ok) m_lastError = m_inner->lastError();
+    return ok;
+}
+
+// 线路时间随波特率变化，已有的往返时间样本全部作废；
+// 换波特率前的失败 (如协商时探测其他波特率) 不计入新波特率下的断路判断
+bool AgeResilientTransport::setSerialConfig(DWORD baudRate, WORD parity)
+{
+    if (!m_inner->setSerialConfig(baudRate, parity)) {
+        m_lastError = m_inner->lastError();
+        return false;
+    }
+    m_rtt.clear();
+    closeBreakers();
+    return true;
+}
+
+// ==========================================
+//          寄存器读写
+// ==========================================
+
+bool AgeResilientTransport::readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, false, 1, timeout, t0)) return false;
+    return finish(station, false, 1, t0, m_inner->readWORD(station, reg, data, timeout));
+}
+
+bool AgeResilientTransport::readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, false, 2, timeout, t0)) return false;
+    return finish(station, false, 2, t0, m_inner->readDWORD(station, reg, data, timeout));
+}
+
+bool AgeResilientTransport::readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, false, 4, timeout, t0)) return false;
+    return finish(station, false, 4, t0, m_inner->readQWORD(station, reg, data, timeout));
+}
+
+bool AgeResilientTransport::readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, false, count, timeout, t0)) return false;
+    return finish(station, false, count, t0, m_inner->readMWORD(station, reg, data, count, timeout));
+}
+
+bool AgeResilientTransport::writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, true, 1, timeout, t0, isStopCommand(reg, data))) return false;
+    return finish(station, true, 1, t0, m_inner->writeWORD(station, reg, data, timeout));
+}
+
+bool AgeResilientTransport::writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, true, 2, timeout, t0)) return false;
+    return finish(station, true, 2, t0, m_inner->writeDWORD(station, reg, data, timeout));
+}
+
+bool AgeResilientTransport::writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, true, 4, timeout, t0)) return false;
+    return finish(station, true, 4, t0, m_inner->writeQWORD(station, reg, data, timeout));
+}
+
+bool AgeResilientTransport::writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout)
+{
+    qint64 t0;
+    if (!begin(station, true, count, timeout, t0)) return false;
+    return finish(station, true, count, t0, m_inner->writeMWORD(station, reg, data, count, timeout));
+}
@@ -0,0 +1,115 @@
+#ifndef AGERESILIENTTRANSPORT_H
+#define AGERESILIENTTRANSPORT_H
+
+#include <QHash>
+#include <QVector>
+#include "AgeTransport.h"
+
+// 单个站号的链路状态 (值类型，供诊断显示)
+struct AgeLinkState
+{
+    enum class Breaker { Closed, Open };
+
+    int station = 0;
+    Breaker breaker = Breaker::Closed;
+    int consecutiveFailures = 0;
+    quint64 shortCircuited = 0;  // 断路期间直接失败的调用数
+    quint64 trips = 0;           // 断开次数
+    qint64 srttUs = 0;           // 单寄存器读的平滑往返时间 (0 = 尚无样本)
+    qint64 rttvarUs = 0;
+    int timeoutMs = 0;           // 单寄存器读当前使用的超时 (0 = 自动)
+    qint64 nextProbeInMs = 0;    // 断路时距下一次探测
+};
+
+// ==========================================
+//   自适应超时 + 断路器的传输装饰器
+// ==========================================
+// - 调用方传入 timeout = 0 (自动) 时，按往返时间估计给出超时:
+//   RTO = SRTT + 4 * RTTVAR (RFC 6298)，限制在 [minTimeoutMs, maxTimeoutMs]；
+//   往返时间按 (站号, 读/写, 字数) 分别估计，帧长不同的请求互不影响；
+//   某种请求尚无样本时仍传 0，由下层自动计算
+// - 超时后该请求的 RTO 加倍 (重新采样成功后恢复)
+// - 同一站号连续 failureThreshold 次无应答或应答损坏后断路 (异常码应答说明链路正常，不计入): 之后的调用立即失败，不再等待超时；
+//   断路期间按 probeIntervalMs 起、逐次加倍至 maxProbeIntervalMs 的间隔读一次 probeRegister，
+//   成功即恢复。探测由 probe() 执行 (总线线程空闲时调用)，到期的普通调用也作为探测放行
+// - 不等待应答的写 (广播、TIMEOUT_NO_REPLY) 不受断路限制，急停广播总会发出；
+//   单站的停止与急停 (控制寄存器写 0x1000 / 0x2000) 在断路时也照常发出，并同时作为一次探测
+// - 不加锁: 只能在总线线程中使用
+class AgeResilientTransport : public AgeTransport
+{
+public:
+    struct Config {
+        int minTimeoutMs = 5;
+        int maxTimeoutMs = 500;
+        int failureThreshold = 3;
+        int probeIntervalMs = 100;
+        int maxProbeIntervalMs = 2000;
+        WORD probeRegister = 0x0000;  // 任意可读寄存器，默认控制寄存器
+    };
+
+    explicit AgeResilientTransport(QSharedPointer<AgeTransport> inner);
+    AgeResilientTransport(QSharedPointer<AgeTransport> inner, const Config &config);
+
+    QSharedPointer<AgeTransport> inner() const { return m_inner; }
+
+    bool open() override;
+    void close() override;
+    bool isValid(bool autoConnect) override;
+    bool reconnect() override;
+
+    bool readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout) override;
+    bool readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout) override;
+    bool readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout) override;
+    bool readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout) override;
+
+    bool writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout) override;
+    bool writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout) override;
+    bool writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout) override;
+    bool writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout) override;
+
+    QString name() const override { return m_inner->name(); }
+    bool getBusInfo(AgeBusInfo &info) override;
+    bool getSerialConfig(DWORD &baudRate, WORD &parity) override;
+    bool setSerialConfig(DWORD baudRate, WORD parity) override;
+
+    // 对到期的断路站号各探测一次；返回是否执行了探测
+    bool probe();
+    // 下一次探测时刻 (单调时钟 µs)，没有断路的站号时返回 INT64 最大值
+    qint64 nextProbeUs() const;
+    bool isOpen(BYTE station) const;
+
+    AgeLinkState linkState(BYTE station) const;
+    QVector<AgeLinkState> linkStates() const;   // 用过的站号
+
+private:
+    struct Rtt {
+        qint64 srttUs = 0;
+        qint64 rttvarUs = 0;
+        int backoff = 0;         // 连续超时次数，RTO 左移位数
+    };
+    struct Station {
+        bool open = false;
+        int consecutiveFailures = 0;
+        quint64 shortCircuited = 0;
+        quint64 trips = 0;
+        int probeIntervalMs = 0;
+        qint64 nextProbeUs = 0;
+        bool seen = false;
+    };
+
+    // 调用前: 断路检查与超时选择；返回 false 表示直接失败
+    // urgent 为 true 时 (停止 / 急停) 不受断路限制
+    bool begin(BYTE station, bool write, WORD count, DWORD &timeout, qint64 &startUs, bool urgent = false);
+    bool finish(BYTE station, bool write, WORD count, qint64 startUs, bool ok);
+    static quint32 rttKey(BYTE station, bool write, WORD count);
+    int timeoutFor(const Rtt &rtt) const;
+    void trip(Station &s, qint64 nowUs);
+    void closeBreakers();
+
+    QSharedPointer<AgeTransport> m_inner;
+    Config m_config;
+    QHash<quint32, Rtt> m_rtt;   // key = station << 24 | write << 16 | count
+    Station m_stations[256];
+};
+
+#endif // AGERESILIENTTRANSPORT_H
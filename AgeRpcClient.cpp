@@ -0,0 +1,250 @@
+#include "AgeRpcClient.h"
+#include <QElapsedTimer>
+#include <limits>
+
+using namespace AgeRpc;
+
+bool AgeRpcClient::connectToServer(const QString &name, int timeoutMs)
+{
+    disconnectFromServer();
+    m_socket.connectToServer(name);
+    if (!m_socket.waitForConnected(timeoutMs)) {
+        m_lastStatus = FAILED;
+        m_lastError = QString("RPC: cannot connect to '%1': %2").arg(name, m_socket.errorString());
+        return false;
+    }
+
+    QByteArray data;
+    if (!request(HELLO, 0, QByteArray(), &data, timeoutMs)) {
+        disconnectFromServer();
+        return false;
+    }
+    Reader r(data);
+    const quint16 version = r.u16();
+    const int count = r.u8();
+    m_stations.clear();
+    for (int i = 0; i < count; ++i) m_stations.append(r.u8());
+    if (!r.ok() || version != PROTOCOL_VERSION) {
+        m_lastStatus = FAILED;
+        m_lastError = QString("RPC: unsupported server protocol version %1 (expected %2).")
+                          .arg(version).arg(PROTOCOL_VERSION);
+        disconnectFromServer();
+        return false;
+    }
+    return true;
+}
+
+void AgeRpcClient::disconnectFromServer()
+{
+    if (m_socket.state() != QLocalSocket::UnconnectedState) m_socket.abort();
+    m_buffer.clear();
+    m_replies.clear();
+    m_events.clear();
+    m_stations.clear();
+}
+
+// ==========================================
+//          请求 / 应答
+// ==========================================
+
+bool AgeRpcClient::request(quint8 type, int axis, const QByteArray &payload, QByteArray *result, int timeoutMs)
+{
+    if (!isConnected()) {
+        m_lastStatus = FAILED;
+        m_lastError = "RPC: not connected.";
+        return false;
+    }
+    const quint32 seq = m_nextSeq++;
+    if (m_nextSeq == 0) m_nextSeq = 1;   // 0 留给服务端推送的事件
+    QByteArray frame;
+    appendFrame(frame, type, (quint8)axis, seq, payload);
+    m_socket.write(frame);
+    m_pendingSeq = seq;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_replies.contains(seq)) {
+        const int remaining = timeoutMs - (int)timer.elapsed();
+        if (remaining <= 0 || !receive(remaining)) {
+            m_pendingSeq = 0;
+            m_lastStatus = FAILED;
+            m_lastError = isConnected() ? QString("RPC: no reply within %1 ms.").arg(timeoutMs)
+                                        : QString("RPC: connection lost: %1").arg(m_socket.errorString());
+            return false;
+        }
+    }
+
+    m_pendingSeq = 0;
+    const QByteArray reply = m_replies.take(seq);
+    Reader r(reply);
+    m_lastStatus = (Status)r.u8();
+    if (!r.ok()) {
+        m_lastStatus = FAILED;
+        m_lastError = "RPC: empty reply.";
+        return false;
+    }
+    if (m_lastStatus != OK) {
+        m_lastError = r.str();
+        return false;
+    }
+    if (result) *result = reply.mid(1);
+    m_lastError.clear();
+    return true;
+}
+
+bool AgeRpcClient::command(quint8 type, int axis, const QByteArray &payload, int timeoutMs)
+{
+    return request(type, axis, payload, nullptr, timeoutMs < 0 ? m_timeoutMs : timeoutMs);
+}
+
+// 等待并解析新数据，连接断开或超时返回 false
+bool AgeRpcClient::receive(int timeoutMs)
+{
+    if (m_socket.bytesAvailable() == 0 && !m_socket.waitForReadyRead(timeoutMs)) return false;
+    m_buffer.append(m_socket.readAll());
+    parseFrames();
+    return true;
+}
+
+void AgeRpcClient::parseFrames()
+{
+    int pos = 0;
+    while (m_buffer.size() - pos >= HEADER_SIZE) {
+        const Header header = readHeader(reinterpret_cast<const uchar *>(m_buffer.constData() + pos));
+        if (m_buffer.size() - pos - HEADER_SIZE < header.length) break;
+        const char *payload = m_buffer.constData() + pos + HEADER_SIZE;
+        pos += HEADER_SIZE + header.length;
+
+        if (header.type == EVENT_TELEMETRY) {
+            Reader r(payload, header.length);
+            AgeTelemetrySample sample;
+            readSample(r, sample);
+            sample.axis = header.axis;
+            if (!r.ok()) continue;
+            if (m_events.size() >= EVENT_QUEUE_LIMIT) {
+                m_events.dequeue();
+                ++m_droppedEvents;
+            }
+            m_events.enqueue(sample);
+        } else if ((header.type & TYPE_REPLY) && header.seq == m_pendingSeq) {
+            m_replies.insert(header.seq, QByteArray(payload, header.length));
+        }
+    }
+    m_buffer.remove(0, pos);
+}
+
+// ==========================================
+//          状态与命令
+// ==========================================
+
+bool AgeRpcClient::status(DriveStatusSnapshot &snapshot, int axis, quint64 *version)
+{
+    QByteArray data;
+    if (!request(STATUS, axis, QByteArray(), &data, m_timeoutMs)) return false;
+    Reader r(data);
+    quint64 v = 0;
+    readStatus(r, snapshot, v);
+    if (!r.ok()) {
+        m_lastStatus = FAILED;
+        m_lastError = "RPC: malformed STATUS reply.";
+        return false;
+    }
+    if (version) *version = v;
+    return true;
+}
+
+bool AgeRpcClient::moveTo(double um, double velocityUmPerSec, int axis)
+{
+    QByteArray payload;
+    Writer w(payload);
+    w.f64(um);
+    w.f64(velocityUmPerSec);
+    return command(MOVE, axis, payload);
+}
+
+bool AgeRpcClient::moveRelative(double um, int axis)
+{
+    QByteArray payload;
+    Writer(payload).f64(um);
+    return command(MOVE_REL, axis, payload);
+}
+
+bool AgeRpcClient::jog(double velocityUmPerSec, int axis)
+{
+    QByteArray payload;
+    Writer(payload).f64(velocityUmPerSec);
+    return command(JOG, axis, payload);
+}
+
+bool AgeRpcClient::setTargetVelocity(double velocityUmPerSec, int axis)
+{
+    QByteArray payload;
+    Writer(payload).f64(velocityUmPerSec);
+    return command(SET_VELOCITY, axis, payload);
+}
+
+bool AgeRpcClient::stop(int axis)
+{
+    return command(STOP, axis);
+}
+
+bool AgeRpcClient::emergencyStop(int axis)
+{
+    return command(ESTOP, axis);
+}
+
+bool AgeRpcClient::setEnable(bool enable, int axis)
+{
+    QByteArray payload;
+    Writer(payload).u8(enable ? 1 : 0);
+    return command(ENABLE, axis, payload);
+}
+
+bool AgeRpcClient::findReference(bool toHigh, int axis)
+{
+    QByteArray payload;
+    Writer(payload).u8(toHigh ? 1 : 0);
+    return command(HOME, axis, payload);
+}
+
+bool AgeRpcClient::moveToLimit(bool toUpper, int axis)
+{
+    QByteArray payload;
+    Writer(payload).u8(toUpper ? 1 : 0);
+    return command(LIMIT, axis, payload);
+}
+
+bool AgeRpcClient::setCurrPositionToZero(int axis)
+{
+    return command(ZERO, axis);
+}
+
+bool AgeRpcClient::waitForMotionComplete(int timeoutMs, int axis)
+{
+    QByteArray payload;
+    Writer(payload).u32((quint32)qMax(0, timeoutMs));
+    // 服务端超时后才应答，本地多等一个请求超时 (两者之和限制在 int 范围内)
+    const qint64 localMs = (qint64)qMax(0, timeoutMs) + qMax(0, m_timeoutMs);
+    return command(WAIT, axis, payload, (int)qMin<qint64>(localMs, std::numeric_limits<int>::max()));
+}
+
+// ==========================================
+//          遥测
+// ==========================================
+
+bool AgeRpcClient::subscribe(quint32 axisMask, quint32 minIntervalUs)
+{
+    QByteArray payload;
+    Writer w(payload);
+    w.u32(axisMask);
+    w.u32(minIntervalUs);
+    return command(SUBSCRIBE, 0, payload);
+}
+
+int AgeRpcClient::readTelemetry(AgeTelemetrySample *out, int max, int timeoutMs)
+{
+    if (m_events.isEmpty() && isConnected()) receive(qMax(0, timeoutMs));
+    int count = 0;
+    while (count < max && !m_events.isEmpty()) out[count++] = m_events.dequeue();
+    return count;
+}
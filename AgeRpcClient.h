@@ -0,0 +1,86 @@
+#ifndef AGERPCCLIENT_H
+#define AGERPCCLIENT_H
+
+#include <QHash>
+#include <QLocalSocket>
+#include <QQueue>
+#include <QVector>
+#include "AgeRpcProtocol.h"
+
+// ==========================================
+//   本机 RPC 客户端 (同步阻塞，连接 AgeRpcServer)
+// ==========================================
+// - 每个调用发出一个请求并等待对应序号的应答，失败时返回 false，原因见 lastError()/lastStatus()；
+//   超时请求的应答之后才到达时直接丢弃
+// - 订阅的遥测事件在等待应答期间同样被接收，暂存后由 readTelemetry() 取出；
+//   暂存超过 EVENT_QUEUE_LIMIT 条时丢弃最旧的，计入 droppedTelemetry()
+// - 不依赖事件循环，可在任意线程中使用，但一个对象只能在一个线程中使用
+// - 不要在 GUI 线程中调用 (与 AgeMotionDriver 一样会阻塞)
+class AgeRpcClient
+{
+public:
+    static constexpr int DEFAULT_TIMEOUT_MS = 5000;
+    static constexpr int EVENT_QUEUE_LIMIT = 1 << 16;
+
+    AgeRpcClient() = default;
+    AgeRpcClient(const AgeRpcClient &) = delete;
+    AgeRpcClient &operator=(const AgeRpcClient &) = delete;
+
+    // 连接并握手 (HELLO)，取得轴数与各轴站号
+    bool connectToServer(const QString &name, int timeoutMs = DEFAULT_TIMEOUT_MS);
+    void disconnectFromServer();
+    bool isConnected() const { return m_socket.state() == QLocalSocket::ConnectedState; }
+
+    int axisCount() const { return m_stations.size(); }
+    quint8 axisStation(int axis) const { return m_stations.value(axis); }
+
+    // 请求超时 (不含 waitForMotionComplete 的等待时间)
+    void setTimeout(int ms) { m_timeoutMs = ms; }
+
+    // --- 状态 (服务端快照，不产生总线事务) ---
+    bool status(DriveStatusSnapshot &snapshot, int axis = 0, quint64 *version = nullptr);
+
+    // --- 命令 (在服务端总线线程执行；被合并替换时返回 false，lastStatus() 为 SUPERSEDED) ---
+    bool moveTo(double um, double velocityUmPerSec = 0.0, int axis = 0);
+    bool moveRelative(double um, int axis = 0);
+    bool jog(double velocityUmPerSec, int axis = 0);
+    bool setTargetVelocity(double velocityUmPerSec, int axis = 0);
+    bool stop(int axis = 0);
+    bool emergencyStop(int axis = 0);
+    bool setEnable(bool enable, int axis = 0);
+    bool findReference(bool toHigh, int axis = 0);
+    bool moveToLimit(bool toUpper, int axis = 0);
+    bool setCurrPositionToZero(int axis = 0);
+    bool waitForMotionComplete(int timeoutMs, int axis = 0);
+
+    // --- 遥测订阅 ---
+    // axisMask 为 0 时取消订阅；minIntervalUs 为每轴的最小推送间隔 (0 = 每条样本)
+    bool subscribe(quint32 axisMask, quint32 minIntervalUs = 0);
+    // 取出已收到的样本，暂存为空时最多等待 timeoutMs，返回条数
+    int readTelemetry(AgeTelemetrySample *out, int max, int timeoutMs = 0);
+    quint64 droppedTelemetry() const { return m_droppedEvents; }
+
+    AgeRpc::Status lastStatus() const { return m_lastStatus; }
+    QString lastError() const { return m_lastError; }
+
+private:
+    bool request(quint8 type, int axis, const QByteArray &payload, QByteArray *result, int timeoutMs);
+    bool command(quint8 type, int axis, const QByteArray &payload = QByteArray(), int timeoutMs = -1);
+    bool receive(int timeoutMs);
+    void parseFrames();
+
+    QLocalSocket m_socket;
+    QByteArray m_buffer;
+    quint32 m_nextSeq = 1;
+    quint32 m_pendingSeq = 0;               // 正在等待应答的序号 (0 = 无)，其他序号的应答丢弃
+    QHash<quint32, QByteArray> m_replies;   // 已收到、尚未取走的应答负载 (按序号)
+    QQueue<AgeTelemetrySample> m_events;
+    quint64 m_droppedEvents = 0;
+    QVector<quint8> m_stations;
+    int m_timeoutMs = DEFAULT_TIMEOUT_MS;
+
+    AgeRpc::Status m_lastStatus = AgeRpc::OK;
+    QString m_lastError;
+};
+
+#endif // AGERPCCLIENT_H
@@ -0,0 +1,268 @@
+#ifndef AGERPCPROTOCOL_H
+#define AGERPCPROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtEndian>
+#include <cstring>
+#include "AgeMotionDriver.h"
+#include "AgeTelemetryRing.h"
+
+// ==========================================
+//   本机 RPC 协议 (AgeRpcServer / AgeRpcClient)
+// ==========================================
+// 传输: QLocalSocket (Linux/macOS 为 Unix 域套接字，Windows 为命名管道)；所有整数与浮点均为小端
+// 帧 = 帧头 8 字节 + 负载 (0-65535 字节):
+//   u16 负载长度 | u8 类型 | u8 轴号 | u32 序号
+// - 请求由客户端发出，序号由客户端分配；应答类型 = 请求类型 | TYPE_REPLY，轴号与序号原样带回
+//   同一连接上的请求可以连续发送 (流水线)，应答顺序不保证与请求顺序一致，按序号匹配
+// - 应答负载: u8 状态 (Status)；OK 时后跟各请求的返回值，其余状态后跟 u16 长度 + UTF-8 错误信息
+// - 遥测事件 (EVENT_TELEMETRY) 由服务端主动推送，序号为 0
+//
+// 请求负载:
+//   HELLO            -                       → u16 版本 | u8 轴数 | 每轴 u8 站号
+//   STATUS           -                       → 快照 (见 writeStatus)，来自总线线程最近一次轮询
+//   SUBSCRIBE        u32 轴掩码 | u32 最小间隔 µs (0 = 每条样本；掩码 0 = 取消)
+//   MOVE             f64 目标 µm | f64 速度 µm/s (0 = 当前目标速度)
+//   MOVE_REL         f64 位移 µm
+//   JOG              f64 速度 µm/s (0 = 停止)
+//   SET_VELOCITY     f64 目标速度 µm/s
+//   STOP / ESTOP / ZERO   -
+//   ENABLE / HOME / LIMIT u8 (使能 / 向高端找原点 / 向上限运动)
+//   WAIT             u32 超时 ms           → 到位后应答 (等待期间不占用总线线程)
+// 遥测事件负载: 见 writeSample (时间戳为本机单调时钟，同一台机器上各进程可直接比较)
+namespace AgeRpc {
+
+static constexpr quint16 PROTOCOL_VERSION = 1;
+static constexpr int HEADER_SIZE = 8;
+static constexpr int MAX_PAYLOAD = 0xFFFF;
+
+enum Type : quint8 {
+    HELLO           = 0x01,
+    STATUS          = 0x02,
+    SUBSCRIBE       = 0x03,
+
+    MOVE            = 0x10,
+    MOVE_REL        = 0x11,
+    JOG             = 0x12,
+    SET_VELOCITY    = 0x13,
+    STOP            = 0x14,
+    ESTOP           = 0x15,
+    ENABLE          = 0x16,
+    HOME            = 0x17,
+    LIMIT           = 0x18,
+    ZERO            = 0x19,
+    WAIT            = 0x1A,
+
+    EVENT_TELEMETRY = 0x40,
+    TYPE_REPLY      = 0x80
+};
+
+enum Status : quint8 {
+    OK          = 0,
+    FAILED      = 1,    // 驱动器或总线返回错误
+    SUPERSEDED  = 2,    // 尚未执行就被后到的同类命令合并替换 (或被停止命令取消)
+    BAD_REQUEST = 3     // 未知类型、轴号越界或负载长度不符
+};
+
+struct Header {
+    quint16 length = 0;
+    quint8 type = 0;
+    quint8 axis = 0;
+    quint32 seq = 0;
+};
+
+// --- 帧头 ---
+inline void writeHeader(uchar *out, const Header &header)
+{
+    qToLittleEndian<quint16>(header.length, out);
+    out[2] = header.type;
+    out[3] = header.axis;
+    qToLittleEndian<quint32>(header.seq, out + 4);
+}
+
+inline Header readHeader(const uchar *in)
+{
+    Header header;
+    header.length = qFromLittleEndian<quint16>(in);
+    header.type = in[2];
+    header.axis = in[3];
+    header.seq = qFromLittleEndian<quint32>(in + 4);
+    return header;
+}
+
+// 把一帧追加到 out (负载超长时截断为 MAX_PAYLOAD，调用方保证不会出现)
+inline void appendFrame(QByteArray &out, quint8 type, quint8 axis, quint32 seq, const QByteArray &payload)
+{
+    Header header;
+    header.length = (quint16)qMin(payload.size(), MAX_PAYLOAD);
+    header.type = type;
+    header.axis = axis;
+    header.seq = seq;
+    uchar raw[HEADER_SIZE];
+    writeHeader(raw, header);
+    out.append(reinterpret_cast<const char *>(raw), HEADER_SIZE);
+    out.append(payload.constData(), header.length);
+}
+
+// ==========================================
+//   负载编解码
+// ==========================================
+class Writer
+{
+public:
+    explicit Writer(QByteArray &out) : m_out(out) {}
+
+    void u8(quint8 v) { m_out.append((char)v); }
+    void u16(quint16 v) { put<quint16>(v); }
+    void i16(qint16 v) { put<quint16>((quint16)v); }
+    void u32(quint32 v) { put<quint32>(v); }
+    void i32(qint32 v) { put<quint32>((quint32)v); }
+    void u64(quint64 v) { put<quint64>(v); }
+    void i64(qint64 v) { put<quint64>((quint64)v); }
+    void f64(double v)
+    {
+        quint64 bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        put<quint64>(bits);
+    }
+    void str(const QString &s)
+    {
+        const QByteArray utf8 = s.toUtf8().left(0xFFFF - 2);
+        u16((quint16)utf8.size());
+        m_out.append(utf8);
+    }
+
+private:
+    template<typename T>
+    void put(T v)
+    {
+        uchar raw[sizeof(T)];
+        qToLittleEndian<T>(v, raw);
+        m_out.append(reinterpret_cast<const char *>(raw), (int)sizeof(T));
+    }
+
+    QByteArray &m_out;
+};
+
+// 越界读取返回 0 并置 ok() 为 false，调用方读完后检查一次即可
+class Reader
+{
+public:
+    Reader(const char *data, int size) : m_data(reinterpret_cast<const uchar *>(data)), m_size(size) {}
+    explicit Reader(const QByteArray &data) : Reader(data.constData(), data.size()) {}
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_pos == m_size; }
+
+    quint8 u8() { return take(1) ? m_data[m_pos - 1] : 0; }
+    quint16 u16() { return get<quint16>(); }
+    qint16 i16() { return (qint16)get<quint16>(); }
+    quint32 u32() { return get<quint32>(); }
+    qint32 i32() { return (qint32)get<quint32>(); }
+    quint64 u64() { return get<quint64>(); }
+    qint64 i64() { return (qint64)get<quint64>(); }
+    double f64()
+    {
+        const quint64 bits = get<quint64>();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    QString str()
+    {
+        const quint16 len = u16();
+        if (!take(len)) return QString();
+        return QString::fromUtf8(reinterpret_cast<const char *>(m_data + m_pos - len), len);
+    }
+
+private:
+    bool take(int n)
+    {
+        if (!m_ok || m_size - m_pos < n) {
+            m_ok = false;
+            return false;
+        }
+        m_pos += n;
+        return true;
+    }
+    template<typename T>
+    T get()
+    {
+        if (!take((int)sizeof(T))) return T();
+        return qFromLittleEndian<T>(m_data + m_pos - sizeof(T));
+    }
+
+    const uchar *m_data;
+    int m_size;
+    int m_pos = 0;
+    bool m_ok = true;
+};
+
+// --- STATUS 应答: 快照版本 + 原始状态字与解码后的物理量 (75 字节) ---
+inline void writeStatus(Writer &w, const DriveStatusSnapshot &s, quint64 version)
+{
+    w.u64(version);
+    w.i64(s.timestampUs);
+    w.u32(s.validGroups);
+    w.u32(s.freshGroups);
+    w.u16(s.control);
+    w.u16(s.errorCode);
+    w.i32(s.pulsePosReal);
+    w.i16(s.cpuTemp);
+    w.u8((s.isMotionDone ? 0x01 : 0) | (s.isHomingDone ? 0x02 : 0));
+    w.f64(s.positionUm);
+    w.f64(s.targetPositionUm);
+    w.f64(s.targetVelocityUmPerSec);
+    w.f64(s.realVelocityUmPerSec);
+    w.f64(s.currentA);
+}
+
+inline void readStatus(Reader &r, DriveStatusSnapshot &s, quint64 &version)
+{
+    version = r.u64();
+    s.timestampUs = r.i64();
+    s.validGroups = r.u32();
+    s.freshGroups = r.u32();
+    s.control = r.u16();
+    s.errorCode = r.u16();
+    s.pulsePosReal = r.i32();
+    s.cpuTemp = r.i16();
+    const quint8 flags = r.u8();
+    s.isMotionDone = (flags & 0x01) != 0;
+    s.isHomingDone = (flags & 0x02) != 0;
+    s.positionUm = r.f64();
+    s.targetPositionUm = r.f64();
+    s.targetVelocityUmPerSec = r.f64();
+    s.realVelocityUmPerSec = r.f64();
+    s.currentA = r.f64();
+}
+
+// --- 遥测事件 (45 字节，轴号在帧头) ---
+inline void writeSample(Writer &w, const AgeTelemetrySample &s)
+{
+    w.i64(s.timestampUs);
+    w.f64(s.positionUm);
+    w.f64(s.targetUm);
+    w.f64(s.velocityUmPerSec);
+    w.f64(s.currentA);
+    w.u16(s.errorCode);
+    w.u16(s.control);
+    w.u8(s.freshGroups);
+}
+
+inline void readSample(Reader &r, AgeTelemetrySample &s)
+{
+    s.timestampUs = r.i64();
+    s.positionUm = r.f64();
+    s.targetUm = r.f64();
+    s.velocityUmPerSec = r.f64();
+    s.currentA = r.f64();
+    s.errorCode = r.u16();
+    s.control = r.u16();
+    s.freshGroups = r.u8();
+}
+
+} // namespace AgeRpc
+
+#endif // AGERPCPROTOCOL_H
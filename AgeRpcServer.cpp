@@ -0,0 +1,463 @@
+#include "AgeRpcServer.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtMath>
+#include <limits>
+
+using namespace AgeRpc;
+
+AgeRpcServer::AgeRpcServer(AgeBusThread *bus, QObject *parent)
+    : QObject(parent)
+    , m_bus(bus)
+    , m_server(new QLocalServer(this))
+    , m_telemetryTimer(new QTimer(this))
+    , m_telemetryBatch(TELEMETRY_BATCH)
+    , m_pending(bus->axisCount())
+{
+    connect(m_server, &QLocalServer::newConnection, this, &AgeRpcServer::onNewConnection);
+    connect(m_telemetryTimer, &QTimer::timeout, this, &AgeRpcServer::forwardTelemetry);
+}
+
+AgeRpcServer::~AgeRpcServer()
+{
+    close();
+}
+
+bool AgeRpcServer::listen(const QString &name)
+{
+    close();
+    // 上次异常退出留下的套接字文件会导致 listen 失败
+    QLocalServer::removeServer(name);
+    if (!m_server->listen(name)) {
+        m_lastError = QString("RPC: cannot listen on '%1': %2").arg(name, m_server->errorString());
+        return false;
+    }
+    return true;
+}
+
+void AgeRpcServer::close()
+{
+    m_server->close();
+    for (const auto &client : m_clients) {
+        client->socket->disconnect(this);
+        client->socket->abort();
+        client->socket->deleteLater();
+    }
+    m_clients.clear();
+    updateTelemetryTimer();
+}
+
+bool AgeRpcServer::isListening() const
+{
+    return m_server->isListening();
+}
+
+QString AgeRpcServer::serverName() const
+{
+    return m_server->fullServerName();
+}
+
+AgeRpcServer::Stats AgeRpcServer::stats() const
+{
+    Stats stats = m_stats;
+    stats.clients = (int)m_clients.size();
+    if (m_telemetryTimer->isActive()) stats.telemetryDropped += m_telemetryReader.overruns();
+    return stats;
+}
+
+// ==========================================
+//          连接与帧解析
+// ==========================================
+
+void AgeRpcServer::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        std::unique_ptr<Client> client(new Client());
+        client->socket = socket;
+        client->lastSentUs.assign(m_bus->axisCount(), std::numeric_limits<qint64>::min());
+        Client *raw = client.get();
+        m_clients.push_back(std::move(client));
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, raw]() { onReadyRead(raw); });
+        // 排队处理: 写失败时 disconnected 可能在 handle() 内同步发出
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { onDisconnected(socket); },
+                Qt::QueuedConnection);
+    }
+}
+
+void AgeRpcServer::onDisconnected(QLocalSocket *socket)
+{
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        if ((*it)->socket != socket) continue;
+        socket->disconnect(this);
+        socket->deleteLater();
+        m_clients.erase(it);
+        break;
+    }
+    updateTelemetryTimer();
+}
+
+void AgeRpcServer::onReadyRead(Client *client)
+{
+    client->buffer.append(client->socket->readAll());
+    int pos = 0;
+    while (client->buffer.size() - pos >= HEADER_SIZE) {
+        const Header header = readHeader(reinterpret_cast<const uchar *>(client->buffer.constData() + pos));
+        if (client->buffer.size() - pos - HEADER_SIZE < header.length) break;
+        const QByteArray payload = client->buffer.mid(pos + HEADER_SIZE, header.length);
+        pos += HEADER_SIZE + header.length;
+        handle(*client, header, payload);
+    }
+    client->buffer.remove(0, pos);
+}
+
+// ==========================================
+//          请求处理
+// ==========================================
+
+void AgeRpcServer::handle(Client &client, const Header &header, const QByteArray &payload)
+{
+    ++m_stats.requests;
+    QLocalSocket *socket = client.socket;
+    const int axisCount = m_bus->axisCount();
+
+    if (header.type == HELLO) {
+        QByteArray data;
+        Writer w(data);
+        w.u16(PROTOCOL_VERSION);
+        w.u8((quint8)axisCount);
+        for (int i = 0; i < axisCount; ++i) w.u8(m_bus->axisStation(i));
+        reply(socket, header.type, header.axis, header.seq, OK, data);
+        return;
+    }
+    if (header.type == SUBSCRIBE) {
+        Reader r(payload);
+        const quint32 mask = r.u32();
+        const quint32 intervalUs = r.u32();
+        if (!r.ok() || !r.atEnd()) {
+            replyError(socket, header.type, header.axis, header.seq, BAD_REQUEST, "Malformed SUBSCRIBE payload.");
+            return;
+        }
+        client.axisMask = mask;
+        client.minIntervalUs = intervalUs;
+        client.lastSentUs.assign(axisCount, std::numeric_limits<qint64>::min());
+        updateTelemetryTimer();
+        reply(socket, header.type, header.axis, header.seq, OK);
+        return;
+    }
+
+    if (header.axis >= axisCount) {
+        replyError(socket, header.type, header.axis, header.seq, BAD_REQUEST,
+                   QString("Axis %1 does not exist (%2 axes).").arg(header.axis).arg(axisCount));
+        return;
+    }
+
+    if (header.type == STATUS) {
+        DriveStatusSnapshot snapshot;
+        if (!m_bus->latestSnapshot(snapshot, header.axis)) {
+            replyError(socket, header.type, header.axis, header.seq, FAILED, "No status available yet.");
+            return;
+        }
+        QByteArray data;
+        Writer w(data);
+        writeStatus(w, snapshot, m_bus->snapshotVersion(header.axis));
+        ++m_stats.statusServed;
+        reply(socket, header.type, header.axis, header.seq, OK, data);
+        return;
+    }
+
+    // 命令: 解码参数后排队 (或合并)
+    Reader r(payload);
+    double a = 0.0;
+    double b = 0.0;
+    switch (header.type) {
+    case MOVE:
+        a = r.f64();
+        b = r.f64();
+        break;
+    case MOVE_REL:
+    case JOG:
+    case SET_VELOCITY:
+        a = r.f64();
+        break;
+    case ENABLE:
+    case HOME:
+    case LIMIT:
+        a = r.u8();
+        break;
+    case WAIT:
+        // 超时 (ms) 来自客户端的 u32，限制在 int 范围内再交给 watchMotion()
+        a = qMin<quint32>(r.u32(), (quint32)std::numeric_limits<int>::max());
+        break;
+    case STOP:
+    case ESTOP:
+    case ZERO:
+        break;
+    default:
+        replyError(socket, header.type, header.axis, header.seq, BAD_REQUEST,
+                   QString("Unknown request type 0x%1.").arg(header.type, 2, 16, QChar('0')));
+        return;
+    }
+    if (!r.ok() || !r.atEnd() || !qIsFinite(a) || !qIsFinite(b) || b < 0.0) {
+        replyError(socket, header.type, header.axis, header.seq, BAD_REQUEST, "Malformed request payload.");
+        return;
+    }
+    postCommand(client, header, a, b);
+}
+
+bool AgeRpcServer::isMotion(quint8 type)
+{
+    return type == MOVE || type == MOVE_REL || type == JOG;
+}
+
+// 回零与走限位也会使轴运动，但目标不同，不与其他运动合并
+bool AgeRpcServer::startsMotion(quint8 type)
+{
+    return isMotion(type) || type == HOME || type == LIMIT;
+}
+
+AgeBusThread::Priority AgeRpcServer::priorityOf(quint8 type)
+{
+    if (type == ESTOP) return AgeBusThread::Priority::Emergency;
+    if (type == STOP || type == ENABLE) return AgeBusThread::Priority::Control;
+    return AgeBusThread::Priority::Command;
+}
+
+void AgeRpcServer::postCommand(Client &client, const Header &header, double a, double b)
+{
+    const int axis = header.axis;
+    PendingCommand::Waiter waiter{client.socket, header.type, header.seq};
+
+    // 停止命令插队执行，先取消尚未开始的运动命令，避免停止之后再启动
+    // 本进程其他来源 (界面、AgeMotionAsync) 排队的运动命令也一并取消；急停由总线线程自动取消
+    if (header.type == STOP || header.type == ESTOP) cancelMotion(axis);
+    if (header.type == STOP) m_bus->cancelCommands(axis);
+
+    QList<PendingPtr> &queue = m_pending[axis];
+    QList<PendingCommand::Waiter> superseded;
+    if (!queue.isEmpty() && tryMerge(queue.last(), header.type, a, b, superseded)) {
+        queue.last()->waiters.append(waiter);
+        ++m_stats.commandsMerged;
+        for (const PendingCommand::Waiter &old : superseded) {
+            replyError(old.socket, old.type, (quint8)axis, old.seq, SUPERSEDED, "Replaced by a later command.");
+        }
+        return;
+    }
+
+    PendingPtr command = std::make_shared<PendingCommand>();
+    command->type = header.type;
+    command->a = a;
+    command->b = b;
+    command->axis = axis;
+    command->waiters.append(waiter);
+    queue.append(command);
+    ++m_stats.commandsPosted;
+
+    QPointer<AgeRpcServer> guard(this);
+    if (header.type == WAIT) {
+        command->started = true;   // 不参与合并
+        m_bus->watchMotion((int)a, [guard, command](const BusResult<bool> &result) {
+            if (!guard) return;
+            QMetaObject::invokeMethod(guard.data(), [guard, command, result]() {
+                if (guard) guard->finishCommand(command, result.ok ? OK : FAILED, result.error);
+            }, Qt::QueuedConnection);
+        }, axis);
+        return;
+    }
+
+    m_bus->post([guard, command](AgeMotionDriver &driver) {
+        quint8 type;
+        double a;
+        double b;
+        {
+            QMutexLocker locker(&command->mutex);
+            if (command->cancelled) return;   // 已由停止命令取消并应答
+            command->started = true;
+            type = command->type;
+            a = command->a;
+            b = command->b;
+        }
+        QString error;
+        const bool ok = execute(driver, type, a, b, error);
+        if (!guard) return;
+        QMetaObject::invokeMethod(guard.data(), [guard, command, ok, error]() {
+            if (guard) guard->finishCommand(command, ok ? OK : FAILED, error);
+        }, Qt::QueuedConnection);
+    }, priorityOf(header.type), axis, [guard, command](const QString &reason) {
+        // 被总线线程的停止取消 (由本服务 cancelMotion() 取消的已应答过)
+        {
+            QMutexLocker locker(&command->mutex);
+            if (command->started || command->cancelled) return;
+            command->cancelled = true;
+        }
+        if (!guard) return;
+        QMetaObject::invokeMethod(guard.data(), [guard, command, reason]() {
+            if (guard) guard->finishCommand(command, SUPERSEDED, reason);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// 与队尾尚未开始的命令合并；被替换的应答方放入 superseded
+bool AgeRpcServer::tryMerge(const PendingPtr &last, quint8 type, double a, double b,
+                            QList<PendingCommand::Waiter> &superseded)
+{
+    QMutexLocker locker(&last->mutex);
+    if (last->started || last->cancelled) return false;
+
+    if (isMotion(type) && isMotion(last->type)) {
+        // 相对位移以前一条运动的终点为基准，只能与相对位移累加
+        if (type == MOVE_REL) {
+            if (last->type != MOVE_REL) return false;
+            last->a += a;   // 各请求共享结果
+            return true;
+        }
+    } else if (!(type == SET_VELOCITY && last->type == SET_VELOCITY)) {
+        // STOP / ESTOP: 重复的只执行一次
+        return (type == STOP || type == ESTOP) && last->type == type;
+    }
+    superseded = last->waiters;
+    last->waiters.clear();
+    last->type = type;
+    last->a = a;
+    last->b = b;
+    return true;
+}
+
+void AgeRpcServer::cancelMotion(int axis)
+{
+    QList<PendingPtr> &queue = m_pending[axis];
+    for (int i = queue.size() - 1; i >= 0; --i) {
+        const PendingPtr command = queue.at(i);
+        if (!startsMotion(command->type)) continue;
+        {
+            QMutexLocker locker(&command->mutex);
+            if (command->started) continue;
+            command->cancelled = true;
+        }
+        queue.removeAt(i);
+        for (const PendingCommand::Waiter &waiter : command->waiters) {
+            replyError(waiter.socket, waiter.type, (quint8)axis, waiter.seq, SUPERSEDED, "Cancelled by a stop command.");
+        }
+    }
+}
+
+void AgeRpcServer::finishCommand(const PendingPtr &command, Status status, const QString &error)
+{
+    m_pending[command->axis].removeOne(command);
+    for (const PendingCommand::Waiter &waiter : command->waiters) {
+        if (status == OK) {
+            reply(waiter.socket, waiter.type, (quint8)command->axis, waiter.seq, OK);
+        } else {
+            replyError(waiter.socket, waiter.type, (quint8)command->axis, waiter.seq, status, error);
+        }
+    }
+}
+
+// 在总线线程执行
+bool AgeRpcServer::execute(AgeMotionDriver &driver, quint8 type, double a, double b, QString &error)
+{
+    bool ok = false;
+    switch (type) {
+    case MOVE:         ok = b > 0.0 ? driver.moveTo(a, b) : driver.setTargetPosition(a); break;
+    case MOVE_REL:     ok = driver.setRelativePosition(a); break;
+    case JOG:          ok = driver.setVelocity(a); break;
+    case SET_VELOCITY: ok = driver.setTargetVelocity(a); break;
+    case STOP:         ok = driver.stopMotion(); break;
+    case ESTOP:        ok = driver.emergencyStop(); break;
+    case ENABLE:       ok = driver.setEnable(a != 0.0); break;
+    case HOME:         ok = driver.findReference(a != 0.0); break;
+    case LIMIT:        ok = driver.moveToLimit(a != 0.0); break;
+    case ZERO:         ok = driver.setCurrPositionToZero(); break;
+    default:
+        error = "Unsupported command.";
+        return false;
+    }
+    if (!ok) error = driver.getLastError();
+    return ok;
+}
+
+// ==========================================
+//          遥测分发
+// ==========================================
+
+void AgeRpcServer::updateTelemetryTimer()
+{
+    bool subscribed = false;
+    for (const auto &client : m_clients) subscribed = subscribed || client->axisMask != 0;
+
+    if (subscribed && !m_telemetryTimer->isActive()) {
+        // 从当前位置开始，不补发订阅之前的历史
+        m_telemetryReader = m_bus->telemetry().reader();
+        m_telemetryTimer->start(TELEMETRY_FORWARD_INTERVAL_MS);
+    } else if (!subscribed && m_telemetryTimer->isActive()) {
+        m_stats.telemetryDropped += m_telemetryReader.overruns();
+        m_telemetryTimer->stop();
+    }
+}
+
+void AgeRpcServer::forwardTelemetry()
+{
+    QByteArray payload;
+    int count;
+    while ((count = m_bus->telemetry().read(m_telemetryReader, m_telemetryBatch.data(), TELEMETRY_BATCH)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            const AgeTelemetrySample &sample = m_telemetryBatch[i];
+            if (sample.axis >= 32) continue;
+            const quint32 bit = 1u << sample.axis;
+            payload.clear();
+
+            for (const auto &client : m_clients) {
+                if (!(client->axisMask & bit)) continue;
+                qint64 &lastSent = client->lastSentUs[sample.axis];
+                if (client->minIntervalUs > 0 && lastSent != std::numeric_limits<qint64>::min() &&
+                    sample.timestampUs - lastSent < client->minIntervalUs) continue;
+                if (client->socket->bytesToWrite() + client->outgoing.size() > MAX_CLIENT_BACKLOG) {
+                    ++m_stats.telemetryDropped;
+                    continue;
+                }
+                if (payload.isEmpty()) {
+                    Writer w(payload);
+                    writeSample(w, sample);
+                }
+                appendFrame(client->outgoing, EVENT_TELEMETRY, sample.axis, 0, payload);
+                lastSent = sample.timestampUs;
+                ++m_stats.telemetrySent;
+            }
+        }
+        if (count < TELEMETRY_BATCH) break;
+    }
+
+    // 每个客户端每周期一次写入
+    for (const auto &client : m_clients) {
+        if (client->outgoing.isEmpty()) continue;
+        client->socket->write(client->outgoing);
+        client->outgoing.clear();
+    }
+}
+
+// ==========================================
+//          应答
+// ==========================================
+
+void AgeRpcServer::reply(QLocalSocket *socket, quint8 type, quint8 axis, quint32 seq,
+                         Status status, const QByteArray &data)
+{
+    if (!socket || socket->state() != QLocalSocket::ConnectedState) return;
+    QByteArray payload;
+    payload.reserve(1 + data.size());
+    payload.append((char)status);
+    payload.append(data);
+    QByteArray frame;
+    appendFrame(frame, (quint8)(type | TYPE_REPLY), axis, seq, payload);
+    socket->write(frame);
+}
+
+void AgeRpcServer::replyError(QLocalSocket *socket, quint8 type, quint8 axis, quint32 seq,
+                              Status status, const QString &message)
+{
+    QByteArray data;
+    Writer w(data);
+    w.str(message);
+    reply(socket, type, axis, seq, status, data);
+}
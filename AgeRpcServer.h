@@ -0,0 +1,130 @@
+#ifndef AGERPCSERVER_H
+#define AGERPCSERVER_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QPointer>
+#include <QTimer>
+#include <memory>
+#include <vector>
+#include "AgeBusThread.h"
+#include "AgeRpcProtocol.h"
+
+class QLocalServer;
+class QLocalSocket;
+
+// ==========================================
+//   本机 RPC 服务: 一个进程持有总线，多个客户端共享 (协议见 AgeRpcProtocol.h)
+// ==========================================
+// - 状态读取 (STATUS) 直接返回总线线程发布的快照，不产生总线事务；
+//   客户端数量不影响总线负载，轮询频率仍由 AgePollScheduler 决定
+// - 遥测订阅: 本对象只持有一个环形缓冲游标，按各客户端的轴掩码与最小间隔分发，
+//   每个周期每个客户端只写一次套接字；客户端积压超过上限时丢弃其事件并计数
+// - 命令合并: 某轴最后排队且尚未开始执行的命令与新到的命令同类时不再排队，而是就地合并:
+//   MOVE / JOG 替换之前的运动命令，连续的 MOVE_REL 位移累加，SET_VELOCITY 取最新值，
+//   STOP / ESTOP 重复的只执行一次；被替换的请求应答 SUPERSEDED，合并后的各请求共享执行结果
+//   只合并与队尾相邻的命令，因此同一轴上命令的执行顺序不变
+// - STOP / ESTOP 同时取消该轴尚未开始的运动命令 (MOVE / MOVE_REL / JOG / HOME / LIMIT，应答 SUPERSEDED)，
+//   不会在停止之后再启动
+// - WAIT 使用 AgeBusThread::watchMotion()，等待期间不占用总线线程
+// - 本对象及其套接字在所属线程 (通常为 GUI 或 agecli 的主线程) 中运行；总线结果经队列连接送回
+class AgeRpcServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        int clients = 0;
+        quint64 requests = 0;
+        quint64 statusServed = 0;      // 由快照应答的状态读取
+        quint64 commandsPosted = 0;    // 实际排队到总线线程的命令
+        quint64 commandsMerged = 0;    // 合并到已排队命令中的请求
+        quint64 telemetrySent = 0;
+        quint64 telemetryDropped = 0;  // 客户端积压或环形缓冲溢出丢弃的样本
+    };
+
+    // bus 的轴须已添加完毕 (addAxis 在 start() 之前)
+    explicit AgeRpcServer(AgeBusThread *bus, QObject *parent = nullptr);
+    ~AgeRpcServer() override;
+
+    // 开始监听 (名称在 Unix 上对应 /tmp 下的套接字文件，残留的旧文件会被删除)
+    bool listen(const QString &name);
+    void close();
+    bool isListening() const;
+    QString serverName() const;
+    QString lastError() const { return m_lastError; }
+
+    Stats stats() const;
+
+private:
+    static constexpr int TELEMETRY_FORWARD_INTERVAL_MS = 10;
+    static constexpr int TELEMETRY_BATCH = 256;
+    static constexpr qint64 MAX_CLIENT_BACKLOG = 1 << 20;   // 客户端未读字节上限
+
+    struct Client {
+        QLocalSocket *socket = nullptr;
+        QByteArray buffer;              // 未解析的输入
+        QByteArray outgoing;            // 本周期待发送的遥测事件
+        quint32 axisMask = 0;
+        qint64 minIntervalUs = 0;
+        std::vector<qint64> lastSentUs; // 按轴
+    };
+
+    // 排队到总线线程的一条命令；mutex 保护的字段在总线线程开始执行时读取
+    struct PendingCommand {
+        QMutex mutex;
+        quint8 type = 0;
+        double a = 0.0;
+        double b = 0.0;
+        bool started = false;
+        bool cancelled = false;
+
+        // 以下仅在本对象线程中访问
+        struct Waiter {
+            QPointer<QLocalSocket> socket;
+            quint8 type;
+            quint32 seq;
+        };
+        int axis = 0;
+        QList<Waiter> waiters;
+    };
+    typedef std::shared_ptr<PendingCommand> PendingPtr;
+
+    void onNewConnection();
+    void onReadyRead(Client *client);
+    void onDisconnected(QLocalSocket *socket);
+    void updateTelemetryTimer();
+    void handle(Client &client, const AgeRpc::Header &header, const QByteArray &payload);
+
+    void postCommand(Client &client, const AgeRpc::Header &header, double a, double b);
+    bool tryMerge(const PendingPtr &last, quint8 type, double a, double b,
+                  QList<PendingCommand::Waiter> &superseded);
+    void cancelMotion(int axis);
+    void finishCommand(const PendingPtr &command, AgeRpc::Status status, const QString &error);
+    static bool execute(AgeMotionDriver &driver, quint8 type, double a, double b, QString &error);
+    static bool isMotion(quint8 type);       // 可互相合并的运动命令
+    static bool startsMotion(quint8 type);   // 会使轴运动、须被停止取消的命令
+    static AgeBusThread::Priority priorityOf(quint8 type);
+
+    void forwardTelemetry();
+
+    void reply(QLocalSocket *socket, quint8 type, quint8 axis, quint32 seq,
+               AgeRpc::Status status, const QByteArray &data = QByteArray());
+    void replyError(QLocalSocket *socket, quint8 type, quint8 axis, quint32 seq,
+                    AgeRpc::Status status, const QString &message);
+
+    AgeBusThread *m_bus;
+    QLocalServer *m_server;
+    QTimer *m_telemetryTimer;
+    AgeTelemetryRing::Reader m_telemetryReader;
+    std::vector<AgeTelemetrySample> m_telemetryBatch;
+
+    std::vector<std::unique_ptr<Client>> m_clients;
+    std::vector<QList<PendingPtr>> m_pending;       // 按轴，排队顺序 (执行完成后移除)
+
+    Stats m_stats;
+    QString m_lastError;
+};
+
+#endif // AGERPCSERVER_H
@@ -0,0 +1,249 @@
+#ifndef AGERTUFRAME_H
+#define AGERTUFRAME_H
+
+#include <QtGlobal>
+
+// ==========================================
+//   Modbus RTU 帧编解码 (FC03 / FC06 / FC16)
+// ==========================================
+// 全部在调用方提供的缓冲区上操作，不做任何内存分配
+namespace AgeRtu {
+
+static constexpr quint8 FC_READ_HOLDING   = 0x03;
+static constexpr quint8 FC_WRITE_SINGLE   = 0x06;
+static constexpr quint8 FC_WRITE_MULTIPLE = 0x10;
+static constexpr quint8 FC_EXCEPTION_FLAG = 0x80;
+
+static constexpr quint8 EX_ILLEGAL_FUNCTION = 0x01;
+static constexpr quint8 EX_ILLEGAL_ADDRESS  = 0x02;
+static constexpr quint8 EX_ILLEGAL_VALUE    = 0x03;
+static constexpr quint8 EX_DEVICE_FAILURE   = 0x04;
+
+static constexpr int MAX_FRAME = 256;       // RTU 帧最大长度
+static constexpr int EXCEPTION_FRAME = 5;   // 地址 + 功能码 + 异常码 + CRC
+
+// --- 多字寄存器字序: 低地址为低字 (与 AgeCOMReadDWORD/ReadQWORD 一致) ---
+inline quint32 unpackU32(const quint16 *w)
+{
+    return (quint32)w[0] | ((quint32)w[1] << 16);
+}
+
+inline quint64 unpackU64(const quint16 *w)
+{
+    return (quint64)unpackU32(w) | ((quint64)unpackU32(w + 2) << 32);
+}
+
+inline void packU32(quint32 v, quint16 *w)
+{
+    w[0] = (quint16)(v & 0xFFFF);
+    w[1] = (quint16)(v >> 16);
+}
+
+inline void packU64(quint64 v, quint16 *w)
+{
+    packU32((quint32)(v & 0xFFFFFFFFu), w);
+    packU32((quint32)(v >> 32), w + 2);
+}
+
+// --- CRC16 (Modbus, 多项式 0xA001, 查表) ---
+inline quint16 crc16(const quint8 *data, int len)
+{
+    struct Table {
+        quint16 v[256];
+        Table() {
+            for (int i = 0; i < 256; ++i) {
+                quint16 c = (quint16)i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? (quint16)((c >> 1) ^ 0xA001) : (quint16)(c >> 1);
+                v[i] = c;
+            }
+        }
+    };
+    static const Table table;
+
+    quint16 crc = 0xFFFF;
+    for (int i = 0; i < len; ++i) {
+        crc = (quint16)((crc >> 8) ^ table.v[(crc ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+// 追加 CRC (低字节在前)，返回帧总长
+inline int appendCrc(quint8 *frame, int len)
+{
+    const quint16 crc = crc16(frame, len);
+    frame[len] = (quint8)(crc & 0xFF);
+    frame[len + 1] = (quint8)(crc >> 8);
+    return len + 2;
+}
+
+inline bool checkCrc(const quint8 *frame, int len)
+{
+    if (len < 4) return false;
+    const quint16 crc = crc16(frame, len - 2);
+    return frame[len - 2] == (quint8)(crc & 0xFF) && frame[len - 1] == (quint8)(crc >> 8);
+}
+
+inline quint16 getU16(const quint8 *p) { return (quint16)((p[0] << 8) | p[1]); }
+inline void putU16(quint8 *p, quint16 v) { p[0] = (quint8)(v >> 8); p[1] = (quint8)(v & 0xFF); }
+
+// ==========================================
+//          主站请求编码
+// ==========================================
+
+inline int encodeReadRequest(quint8 *out, quint8 station, quint16 reg, quint16 count)
+{
+    out[0] = station;
+    out[1] = FC_READ_HOLDING;
+    putU16(out + 2, reg);
+    putU16(out + 4, count);
+    return appendCrc(out, 6);
+}
+
+inline int encodeWriteSingleRequest(quint8 *out, quint8 station, quint16 reg, quint16 value)
+{
+    out[0] = station;
+    out[1] = FC_WRITE_SINGLE;
+    putU16(out + 2, reg);
+    putU16(out + 4, value);
+    return appendCrc(out, 6);
+}
+
+inline int encodeWriteMultipleRequest(quint8 *out, quint8 station, quint16 reg,
+                                      const quint16 *values, quint16 count)
+{
+    out[0] = station;
+    out[1] = FC_WRITE_MULTIPLE;
+    putU16(out + 2, reg);
+    putU16(out + 4, count);
+    out[6] = (quint8)(count * 2);
+    for (int i = 0; i < count; ++i) putU16(out + 7 + i * 2, values[i]);
+    return appendCrc(out, 7 + count * 2);
+}
+
+// 正常应答的预期长度
+inline int expectedResponseLength(quint8 function, quint16 count)
+{
+    switch (function) {
+    case FC_READ_HOLDING:   return 5 + count * 2;  // 地址 功能码 字节数 数据 CRC
+    case FC_WRITE_SINGLE:   return 8;              // 原样回显
+    case FC_WRITE_MULTIPLE: return 8;              // 地址 功能码 起始 数量 CRC
+    default:                return EXCEPTION_FRAME;
+    }
+}
+
+// ==========================================
+//          主站应答解码
+// ==========================================
+enum class DecodeStatus {
+    Ok,
+    Incomplete,   // 数据不足，继续接收
+    CrcError,
+    Exception,    // 从站返回异常码
+    Mismatch      // 地址/功能码/长度与请求不符
+};
+
+// 根据已收到的字节判断应答总长 (异常帧为 5 字节)，不足 2 字节时返回 0
+inline int responseLength(const quint8 *rx, int got, quint8 function, quint16 count)
+{
+    if (got < 2) return 0;
+    if (rx[1] & FC_EXCEPTION_FLAG) return EXCEPTION_FRAME;
+    return expectedResponseLength(function, count);
+}
+
+// 解码应答；读请求时数据写入 words (至少 count 个)，异常时 exceptionCode 返回异常码
+inline DecodeStatus decodeResponse(const quint8 *rx, int got, quint8 station, quint8 function,
+                                   quint16 reg, quint16 count, quint16 *words, quint8 *exceptionCode = nullptr)
+{
+    const int need = responseLength(rx, got, function, count);
+    if (need == 0 || got < need) return DecodeStatus::Incomplete;
+    if (!checkCrc(rx, need)) return DecodeStatus::CrcError;
+    if (rx[0] != station) return DecodeStatus::Mismatch;
+
+    if (rx[1] == (quint8)(function | FC_EXCEPTION_FLAG)) {
+        if (exceptionCode) *exceptionCode = rx[2];
+        return DecodeStatus::Exception;
+    }
+    if (rx[1] != function) return DecodeStatus::Mismatch;
+
+    switch (function) {
+    case FC_READ_HOLDING:
+        if (rx[2] != count * 2) return DecodeStatus::Mismatch;
+        for (int i = 0; i < count; ++i) words[i] = getU16(rx + 3 + i * 2);
+        return DecodeStatus::Ok;
+    case FC_WRITE_SINGLE:
+        if (getU16(rx + 2) != reg) return DecodeStatus::Mismatch;
+        return DecodeStatus::Ok;
+    case FC_WRITE_MULTIPLE:
+        if (getU16(rx + 2) != reg || getU16(rx + 4) != count) return DecodeStatus::Mismatch;
+        return DecodeStatus::Ok;
+    default:
+        return DecodeStatus::Mismatch;
+    }
+}
+
+// ==========================================
+//          从站请求解析与应答编码 (模拟器使用)
+// ==========================================
+
+// 根据已收到的字节判断请求帧总长；数据不足时返回 0，无法识别的功能码返回 -1
+inline int requestLength(const quint8 *rx, int got)
+{
+    if (got < 2) return 0;
+    switch (rx[1]) {
+    case FC_READ_HOLDING:
+    case FC_WRITE_SINGLE:
+        return 8;
+    case FC_WRITE_MULTIPLE:
+        return got < 7 ? 0 : 9 + rx[6];
+    default:
+        return -1;
+    }
+}
+
+inline int encodeReadResponse(quint8 *out, quint8 station, const quint16 *words, quint16 count)
+{
+    out[0] = station;
+    out[1] = FC_READ_HOLDING;
+    out[2] = (quint8)(count * 2);
+    for (int i = 0; i < count; ++i) putU16(out + 3 + i * 2, words[i]);
+    return appendCrc(out, 3 + count * 2);
+}
+
+inline int encodeWriteSingleResponse(quint8 *out, quint8 station, quint16 reg, quint16 value)
+{
+    return encodeWriteSingleRequest(out, station, reg, value); // 原样回显
+}
+
+inline int encodeWriteMultipleResponse(quint8 *out, quint8 station, quint16 reg, quint16 count)
+{
+    out[0] = station;
+    out[1] = FC_WRITE_MULTIPLE;
+    putU16(out + 2, reg);
+    putU16(out + 4, count);
+    return appendCrc(out, 6);
+}
+
+inline int encodeException(quint8 *out, quint8 station, quint8 function, quint8 code)
+{
+    out[0] = station;
+    out[1] = (quint8)(function | FC_EXCEPTION_FLAG);
+    out[2] = code;
+    return appendCrc(out, 3);
+}
+
+// 3.5 个字符的帧间隔 (微秒)，波特率高于 19200 时按规范固定为 1750us
+inline int interFrameGapUs(int baudRate)
+{
+    if (baudRate > 19200) return 1750;
+    return (int)(3.5 * 11 * 1000000.0 / baudRate);
+}
+
+// 传输 bytes 个字节所需时间 (微秒，11 位/字符: 起始 + 8 数据 + 校验 + 停止)
+inline qint64 wireTimeUs(int bytes, int baudRate)
+{
+    return (qint64)bytes * 11 * 1000000 / baudRate;
+}
+
+} // namespace AgeRtu
+
+#endif // AGERTUFRAME_H
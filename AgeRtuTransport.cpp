@@ -0,0 +1,305 @@
+#include "AgeRtuTransport.h"
+#include <QSerialPort>
+#include <QThread>
+
+AgeRtuTransport::AgeRtuTransport(const Config &config)
+    : m_config(config)
+{
+    m_runTimer.start();
+}
+
+AgeRtuTransport::~AgeRtuTransport()
+{
+    close();
+    delete m_port;
+}
+
+bool AgeRtuTransport::open()
+{
+    if (m_port && m_port->isOpen()) return true;
+
+    // 串口对象在首次打开时创建，保证其线程归属与调用线程一致
+    if (!m_port) m_port = new QSerialPort();
+
+    m_port->setPortName(m_config.portName);
+    applyLineSettings();
+    m_port->setDataBits(QSerialPort::Data8);
+    m_port->setFlowControl(QSerialPort::NoFlowControl);
+
+    if (!m_port->open(QIODevice::ReadWrite)) {
+        m_lastError = QString("Failed to open serial port %1: %2").arg(m_config.portName, m_port->errorString());
+        return false;
+    }
+    m_port->clear();
+    m_lastFrameEnd.invalidate();
+    m_lastTimedOut = false;
+    return true;
+}
+
+void AgeRtuTransport::close()
+{
+    if (m_port && m_port->isOpen()) {
+        m_port->close();
+    }
+}
+
+bool AgeRtuTransport::isValid(bool autoConnect)
+{
+    if (m_port && m_port->isOpen()) return true;
+    if (!autoConnect) return false;
+    return open();
+}
+
+// ==========================================
+//          单次事务: 发送请求 -> 接收应答
+// ==========================================
+
+int AgeRtuTransport::autoTimeoutMs(int txLength, int rxLength) const
+{
+    const qint64 wireUs = AgeRtu::wireTimeUs(txLength + rxLength, m_config.baudRate);
+    return (int)((wireUs + 999) / 1000) + m_config.responseMarginMs;
+}
+
+bool AgeRtuTransport::sendFrame(int length)
+{
+    // 1. 保证与上一帧之间至少有 3.5 字符的静默间隔
+    if (m_lastFrameEnd.isValid()) {
+        const int gapUs = m_config.interFrameGapUs > 0 ? m_config.interFrameGapUs
+                                                        : AgeRtu::interFrameGapUs(m_config.baudRate);
+        const qint64 elapsedUs = m_lastFrameEnd.nsecsElapsed() / 1000;
+        if (elapsedUs < gapUs) {
+            QThread::usleep((unsigned long)(gapUs - elapsedUs));
+        }
+    }
+
+    // 2. 丢弃上一事务迟到的应答，避免错位；上一事务超时才取一次已到达的字节计入 lateRxBytes
+    if (m_lastTimedOut) {
+        m_lastTimedOut = false;
+        m_port->waitForReadyRead(0);
+        m_busInfo.lateRxBytes += m_port->bytesAvailable();
+    }
+    m_port->clear(QSerialPort::Input);
+
+    if (m_port->write(reinterpret_cast<const char*>(m_tx), length) != length ||
+        !m_port->waitForBytesWritten(autoTimeoutMs(length, 0))) {
+        m_lastError = "Failed to write RTU frame: " + m_port->errorString();
+        ++m_busInfo.txFrameErrors;
+        return false;
+    }
+    ++m_busInfo.txFrames;
+    m_busInfo.txBytes += length;
+    return true;
+}
+
+void AgeRtuTransport::finishOp(const QElapsedTimer &opTimer, bool ok)
+{
+    const qint64 ms = opTimer.elapsed();
+    m_busInfo.lastOpTime = ms;
+    if (m_busInfo.busOpCounts == 0 || ms < m_busInfo.minOpTime) m_busInfo.minOpTime = ms;
+    if (ms > m_busInfo.maxOpTime) m_busInfo.maxOpTime = ms;
+    m_busInfo.busRunTime += ms;
+    ++m_busInfo.busOpCounts;
+    if (!ok) ++m_busInfo.busOpErrors;
+}
+
+bool AgeRtuTransport::getBusInfo(AgeBusInfo &info)
+{
+    info = m_busInfo;
+    info.hostRunTime = m_runTimer.elapsed();
+    return true;
+}
+
+// 波特率与校验 (打开前或打开后均可设置)
+bool AgeRtuTransport::applyLineSettings()
+{
+    bool ok = m_port->setBaudRate(m_config.baudRate);
+    switch (m_config.parity) {
+    case 1:  ok = m_port->setParity(QSerialPort::OddParity) && ok; break;
+    case 2:  ok = m_port->setParity(QSerialPort::EvenParity) && ok; break;
+    default: ok = m_port->setParity(QSerialPort::NoParity) && ok; break;
+    }
+    // Modbus RTU 规定无校验时使用 2 个停止位，保持每字符 11 位
+    ok = m_port->setStopBits(m_config.parity == 0 ? QSerialPort::TwoStop : QSerialPort::OneStop) && ok;
+    return ok;
+}
+
+bool AgeRtuTransport::getSerialConfig(DWORD &baudRate, WORD &parity)
+{
+    baudRate = (DWORD)m_config.baudRate;
+    parity = (WORD)m_config.parity;
+    return true;
+}
+
+bool AgeRtuTransport::setSerialConfig(DWORD baudRate, WORD parity)
+{
+    const Config previous = m_config;
+    m_config.baudRate = (int)baudRate;
+    m_config.parity = parity;
+    if (!m_port || !m_port->isOpen()) return true;   // 下次 open() 时生效
+
+    if (!applyLineSettings()) {
+        m_lastError = QString("Serial port %1 rejected %2 baud: %3")
+                          .arg(m_config.portName).arg((quint32)baudRate).arg(m_port->errorString());
+        m_config = previous;
+        applyLineSettings();
+        return false;
+    }
+    // 旧波特率下残留的字节与帧间隔计时不再有效
+    m_port->clear();
+    m_lastFrameEnd.invalidate();
+    return true;
+}
+
+bool AgeRtuTransport::transact(quint8 station, quint8 function, quint16 reg, quint16 count,
+                               int txLength, quint16 *words, DWORD timeout)
+{
+    m_lastException = false;
+    if (!isValid(true)) {
+        ++m_busInfo.hostErrors;
+        return false;
+    }
+    QElapsedTimer opTimer;
+    opTimer.start();
+    if (!sendFrame(txLength)) {
+        finishOp(opTimer, false);
+        return false;
+    }
+
+    // 广播或不等待应答: 发送后按线路时间记帧尾
+    if (station == 0 || timeout == TIMEOUT_NO_REPLY) {
+        QThread::usleep((unsigned long)AgeRtu::wireTimeUs(txLength, m_config.baudRate));
+        m_lastFrameEnd.start();
+        finishOp(opTimer, true);
+        return true;
+    }
+
+    const int rxLength = AgeRtu::expectedResponseLength(function, count);
+    const int waitMs = (timeout == 0) ? autoTimeoutMs(txLength, rxLength) : (int)timeout;
+
+    QElapsedTimer timer;
+    timer.start();
+    int got = 0;
+    quint8 exceptionCode = 0;
+    AgeRtu::DecodeStatus status = AgeRtu::DecodeStatus::Incomplete;
+
+    for (;;) {
+        const qint64 n = m_port->read(reinterpret_cast<char*>(m_rx) + got, AgeRtu::MAX_FRAME - got);
+        if (n < 0) {
+            m_lastError = "Failed to read RTU frame: " + m_port->errorString();
+            break;
+        }
+        got += (int)n;
+
+        status = AgeRtu::decodeResponse(m_rx, got, station, function, reg, count, words, &exceptionCode);
+        if (status != AgeRtu::DecodeStatus::Incomplete) break;
+
+        const qint64 remainMs = waitMs - timer.elapsed();
+        if (remainMs <= 0) {
+            m_lastTimedOut = true;
+            m_lastError = QString("RTU timeout (station %1, reg 0x%2, %3 ms).")
+                              .arg((int)station).arg(reg, 4, 16, QChar('0')).arg(waitMs);
+            break;
+        }
+        m_port->waitForReadyRead((int)remainMs);
+    }
+    m_lastFrameEnd.start();
+
+    m_busInfo.rxBytes += got;
+    if (status == AgeRtu::DecodeStatus::Ok || status == AgeRtu::DecodeStatus::Exception) {
+        ++m_busInfo.rxFrames;
+    } else if (status == AgeRtu::DecodeStatus::CrcError || status == AgeRtu::DecodeStatus::Mismatch) {
+        ++m_busInfo.rxFrameErrors;
+    }
+    finishOp(opTimer, status == AgeRtu::DecodeStatus::Ok);
+
+    switch (status) {
+    case AgeRtu::DecodeStatus::Ok:
+        return true;
+    case AgeRtu::DecodeStatus::CrcError:
+        m_lastError = QString("RTU CRC error (station %1, reg 0x%2).").arg((int)station).arg(reg, 4, 16, QChar('0'));
+        return false;
+    case AgeRtu::DecodeStatus::Exception:
+        m_lastError = QString("RTU exception %1 (station %2, reg 0x%3).")
+                          .arg((int)exceptionCode).arg((int)station).arg(reg, 4, 16, QChar('0'));
+        m_lastException = true;
+        return false;
+    case AgeRtu::DecodeStatus::Mismatch:
+        m_lastError = QString("RTU response mismatch (station %1, reg 0x%2).").arg((int)station).arg(reg, 4, 16, QChar('0'));
+        return false;
+    default:
+        return false; // 超时或读错误，m_lastError 已设置
+    }
+}
+
+// ==========================================
+//          寄存器读 (FC03)
+// ==========================================
+
+bool AgeRtuTransport::readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout)
+{
+    return readMWORD(station, reg, &data, 1, timeout);
+}
+
+bool AgeRtuTransport::readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout)
+{
+    WORD w[2];
+    if (!readMWORD(station, reg, w, 2, timeout)) return false;
+    data = (DWORD)AgeRtu::unpackU32(w);
+    return true;
+}
+
+bool AgeRtuTransport::readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout)
+{
+    WORD w[4];
+    if (!readMWORD(station, reg, w, 4, timeout)) return false;
+    data = (QWORD)AgeRtu::unpackU64(w);
+    return true;
+}
+
+bool AgeRtuTransport::readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout)
+{
+    if (count == 0 || count > MAX_READ_WORDS) {
+        m_lastError = QString("Invalid read length %1.").arg(count);
+        return false;
+    }
+    if (station == 0) {
+        m_lastError = "Broadcast address can't read.";
+        return false;
+    }
+    const int len = AgeRtu::encodeReadRequest(m_tx, station, reg, count);
+    return transact(station, AgeRtu::FC_READ_HOLDING, reg, count, len, data, timeout);
+}
+
+// ==========================================
+//          寄存器写 (FC06 / FC16)
+// ==========================================
+
+bool AgeRtuTransport::writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout)
+{
+    const int len = AgeRtu::encodeWriteSingleRequest(m_tx, station, reg, data);
+    return transact(station, AgeRtu::FC_WRITE_SINGLE, reg, 1, len, nullptr, timeout);
+}
+
+bool AgeRtuTransport::writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout)
+{
+    WORD w[2];
+    AgeRtu::packU32((quint32)data, w);
+    return writeMWORD(station, reg, w, 2, timeout);
+}
+
+bool AgeRtuTransport::writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout)
+{
+    WORD w[4];
+    AgeRtu::packU64((quint64)data, w);
+    return writeMWORD(station, reg, w, 4, timeout);
+}
+
+bool AgeRtuTransport::writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout)
+{
+    if (count == 0 || count > MAX_WRITE_WORDS) {
+        m_lastError = QString("Invalid write length %1.").arg(count);
+        return false;
+    }
+    const int len = AgeRtu::encodeWriteMultipleRequest(m_tx, station, reg, data, count);
+    return transact(station, AgeRtu::FC_WRITE_MULTIPLE, reg, count, len, nullptr, timeout);
+}
@@ -0,0 +1,71 @@
+#ifndef AGERTUTRANSPORT_H
+#define AGERTUTRANSPORT_H
+
+#include <QElapsedTimer>
+#include "AgeTransport.h"
+#include "AgeRtuFrame.h"
+
+class QSerialPort;
+
+// ==========================================
+//   原生 Modbus RTU 传输 (QSerialPort，跨平台)
+// ==========================================
+// - 支持 FC03 读保持寄存器、FC06 写单寄存器、FC16 写多寄存器
+// - 收发缓冲区为成员数组，单次事务不做内存分配
+// - 帧间隔与应答超时由本类控制，不依赖厂商 DLL
+// - 串口在 open() 时创建，所属线程即为后续调用线程
+class AgeRtuTransport : public AgeTransport
+{
+public:
+    struct Config {
+        QString portName;
+        int baudRate = 115200;
+        int parity = 2;              // 0 None, 1 Odd, 2 Even (与 AgeCOMSetCOM 相同)
+        int responseMarginMs = 20;   // 自动超时 = 线路传输时间 + 余量
+        int interFrameGapUs = 0;     // 0 = 按波特率取 3.5 字符时间
+    };
+
+    explicit AgeRtuTransport(const Config &config);
+    ~AgeRtuTransport() override;
+
+    bool open() override;
+    void close() override;
+    bool isValid(bool autoConnect) override;
+
+    bool readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout) override;
+    bool readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout) override;
+    bool readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout) override;
+    bool readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout) override;
+
+    bool writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout) override;
+    bool writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout) override;
+    bool writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout) override;
+    bool writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout) override;
+
+    QString name() const override { return "RTU:" + m_config.portName; }
+    // 与 AgeCOMGetBusInfo 同义的本地计数 (自构造起累计)
+    bool getBusInfo(AgeBusInfo &info) override;
+    bool getSerialConfig(DWORD &baudRate, WORD &parity) override;
+    bool setSerialConfig(DWORD baudRate, WORD parity) override;
+    const Config &config() const { return m_config; }
+
+private:
+    bool transact(quint8 station, quint8 function, quint16 reg, quint16 count,
+                  int txLength, quint16 *words, DWORD timeout);
+    bool sendFrame(int length);
+    bool applyLineSettings();
+    int autoTimeoutMs(int txLength, int rxLength) const;
+    void finishOp(const QElapsedTimer &opTimer, bool ok);
+
+    Config m_config;
+    QSerialPort *m_port = nullptr;
+    QElapsedTimer m_lastFrameEnd;    // 上一帧结束时刻，用于保证帧间隔
+    bool m_lastTimedOut = false;     // 上一事务等待应答超时 (下一帧发送前统计迟到的字节)
+    QElapsedTimer m_runTimer;        // 构造时刻，用于 hostRunTime
+    AgeBusInfo m_busInfo;
+
+    quint8 m_tx[AgeRtu::MAX_FRAME];
+    quint8 m_rx[AgeRtu::MAX_FRAME];
+};
+
+#endif // AGERTUTRANSPORT_H
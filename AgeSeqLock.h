@@ -0,0 +1,69 @@
+#ifndef AGESEQLOCK_H
+#define AGESEQLOCK_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+// ==========================================
+//   单写多读 SeqLock (写端不阻塞，读端无锁重试)
+// ==========================================
+// 写端: 序号置奇数 -> 写数据 -> 序号置偶数
+// 读端: 读到奇数或前后序号不一致则重试
+// 数据按 8 字节原子字保存，避免读写竞争时的未定义行为
+template<typename T>
+class AgeSeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "AgeSeqLock requires a trivially copyable type");
+
+public:
+    AgeSeqLock() = default;
+    AgeSeqLock(const AgeSeqLock &) = delete;
+    AgeSeqLock &operator=(const AgeSeqLock &) = delete;
+
+    // 仅允许单一写线程调用
+    void store(const T &value)
+    {
+        quint64 words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        const quint64 seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            m_data[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // 任意线程可调用；尚未写入过时返回 false
+    bool load(T &out) const
+    {
+        quint64 words[WORDS];
+        for (;;) {
+            const quint64 before = m_seq.load(std::memory_order_acquire);
+            if (before == 0) return false;
+            if (before & 1) continue; // 写入进行中
+
+            for (size_t i = 0; i < WORDS; ++i) {
+                words[i] = m_data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_seq.load(std::memory_order_relaxed) == before) break;
+        }
+        memcpy(&out, words, sizeof(T));
+        return true;
+    }
+
+    // 已完成的写入次数，读端可据此判断是否有新数据
+    quint64 version() const { return m_seq.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(quint64) - 1) / sizeof(quint64);
+
+    alignas(64) std::atomic<quint64> m_seq{0};
+    alignas(64) std::atomic<quint64> m_data[WORDS];
+};
+
+#endif // AGESEQLOCK_H
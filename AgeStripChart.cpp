@@ -0,0 +1,405 @@
+#include "AgeStripChart.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr qint64 SHRINK_CHECK_US = 1000000;
+constexpr int LANE_MARGIN = 3;
+
+const QColor BACKGROUND(24, 26, 30);
+const QColor GRID(60, 63, 70);
+const QColor TEXT(200, 200, 200);
+
+// 量程: 两端各留 10%，常值时给一个最小跨度
+void paddedRange(double lo, double hi, double &outLo, double &outHi)
+{
+    const double span = hi - lo;
+    const double pad = span > 0.0 ? span * 0.1 : qMax(0.5, std::fabs(hi) * 1e-3);
+    outLo = lo - pad;
+    outHi = hi + pad;
+}
+
+// 刻度间隔取 1/2/5 x 10^n ms，使可见范围内约 5-10 条
+qint64 tickInterval(qint64 spanUs)
+{
+    const qint64 target = qMax<qint64>(1, spanUs / 8);
+    qint64 step = 1000;
+    for (;;) {
+        for (int m : {1, 2, 5}) {
+            if (step * m >= target) return step * m;
+        }
+        step *= 10;
+    }
+}
+
+} // namespace
+
+AgeStripChart::AgeStripChart(QWidget *parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumHeight(120);
+}
+
+int AgeStripChart::addChannel(const QString &name, const QString &unit, const QColor &color)
+{
+    Channel channel;
+    channel.name = name;
+    channel.unit = unit;
+    channel.color = color;
+    if (!m_channels.empty()) channel.columns.resize(m_channels.front().columns.size());
+    m_channels.push_back(channel);
+    resizeStorage();
+    m_needFullRedraw = true;
+    return (int)m_channels.size() - 1;
+}
+
+void AgeStripChart::setTimeSpan(qint64 spanUs)
+{
+    m_spanUs = qMax<qint64>(plotWidth(), spanUs);
+    resizeStorage();
+    if (m_headIndex >= 0 && isVisible()) redrawAll();
+}
+
+void AgeStripChart::setDroppedSamples(quint64 count)
+{
+    if (count == m_dropped) return;
+    m_dropped = count;
+    update();
+}
+
+void AgeStripChart::clear()
+{
+    for (Channel &channel : m_channels) {
+        std::fill(channel.columns.begin(), channel.columns.end(), Column());
+        channel.hasRange = false;
+        channel.hasValue = false;
+    }
+    m_headIndex = -1;
+    m_dirtyFrom = -1;
+    m_dropped = 0;
+    m_needFullRedraw = true;
+    m_pixmap.fill(BACKGROUND);
+    update();
+}
+
+// ==========================================
+//          列存储
+// ==========================================
+
+const AgeStripChart::Column *AgeStripChart::column(const Channel &channel, qint64 index) const
+{
+    const Column &slot = channel.columns[(size_t)(index % (qint64)channel.columns.size())];
+    return slot.index == index ? &slot : nullptr;
+}
+
+// 列宽 = 时间跨度 / 像素宽度；列宽或宽度变化时按新列宽重新归并
+void AgeStripChart::resizeStorage()
+{
+    if (m_channels.empty()) return;
+    const qint64 columnUs = qMax<qint64>(1, m_spanUs / plotWidth());
+    if (columnUs == m_columnUs && capacity() == plotWidth()) return;
+
+    const qint64 oldColumnUs = m_columnUs;
+    m_columnUs = columnUs;
+    m_tickUs = tickInterval(m_spanUs);
+    rebin(oldColumnUs);
+    if (m_headIndex >= 0 && oldColumnUs > 0) m_headIndex = m_headIndex * oldColumnUs / m_columnUs;
+    m_dirtyFrom = -1;
+    m_needFullRedraw = true;
+}
+
+void AgeStripChart::rebin(qint64 oldColumnUs)
+{
+    const size_t cap = (size_t)plotWidth();
+    for (Channel &channel : m_channels) {
+        std::vector<Column> old;
+        old.swap(channel.columns);
+        channel.columns.assign(cap, Column());
+        if (oldColumnUs <= 0) continue;
+
+        // 按时间顺序归并，保证首值/末值正确
+        old.erase(std::remove_if(old.begin(), old.end(), [](const Column &c) { return c.index < 0; }), old.end());
+        std::sort(old.begin(), old.end(), [](const Column &a, const Column &b) { return a.index < b.index; });
+        for (const Column &c : old) {
+            const qint64 index = c.index * oldColumnUs / m_columnUs;
+            Column &slot = channel.columns[(size_t)(index % (qint64)cap)];
+            if (slot.index == index) {
+                slot.min = qMin(slot.min, c.min);
+                slot.max = qMax(slot.max, c.max);
+                slot.last = c.last;
+            } else {
+                slot = c;
+                slot.index = index;
+            }
+        }
+    }
+}
+
+void AgeStripChart::addSample(int channel, qint64 timestampUs, double value)
+{
+    if (channel < 0 || channel >= (int)m_channels.size() || m_columnUs <= 0) return;
+    Channel &ch = m_channels[(size_t)channel];
+    const qint64 index = timestampUs / m_columnUs;
+    if (m_headIndex >= 0 && index <= m_headIndex - capacity()) return; // 已滚出可见范围
+
+    Column &slot = ch.columns[(size_t)(index % (qint64)capacity())];
+    if (slot.index == index) {
+        slot.min = qMin(slot.min, value);
+        slot.max = qMax(slot.max, value);
+        slot.last = value;
+    } else if (slot.index < index) {
+        slot.index = index;
+        slot.min = slot.max = slot.first = slot.last = value;
+    } else {
+        return;
+    }
+    ch.lastValue = value;
+    ch.hasValue = true;
+
+    // 落在已画出的列上: 下一帧重画该列
+    if (m_headIndex >= 0 && index <= m_headIndex) {
+        m_dirtyFrom = m_dirtyFrom < 0 ? index : qMin(m_dirtyFrom, index);
+    }
+}
+
+// ==========================================
+//          量程
+// ==========================================
+
+bool AgeStripChart::fitRange(Channel &channel, double lo, double hi)
+{
+    double newLo, newHi;
+    paddedRange(lo, hi, newLo, newHi);
+    if (channel.hasRange && newLo == channel.lo && newHi == channel.hi) return false;
+    channel.lo = newLo;
+    channel.hi = newHi;
+    channel.hasRange = true;
+    return true;
+}
+
+// 待画的列超出当前量程时扩展量程，返回 true 表示需要整幅重画
+bool AgeStripChart::expandRanges(qint64 fromIndex, qint64 toIndex)
+{
+    bool changed = false;
+    for (Channel &channel : m_channels) {
+        bool any = false;
+        double lo = 0.0, hi = 0.0;
+        for (qint64 i = fromIndex; i <= toIndex; ++i) {
+            const Column *c = column(channel, i);
+            if (!c) continue;
+            lo = any ? qMin(lo, c->min) : c->min;
+            hi = any ? qMax(hi, c->max) : c->max;
+            any = true;
+        }
+        if (!any) continue;
+        if (!channel.hasRange) {
+            changed |= fitRange(channel, lo, hi);
+        } else if (lo < channel.lo || hi > channel.hi) {
+            changed |= fitRange(channel, qMin(lo, channel.lo), qMax(hi, channel.hi));
+        }
+    }
+    return changed;
+}
+
+// 可见数据的范围不到当前量程的一半时收缩
+void AgeStripChart::shrinkRanges()
+{
+    const qint64 first = m_headIndex - plotWidth() + 1;
+    for (Channel &channel : m_channels) {
+        if (!channel.hasRange) continue;
+        bool any = false;
+        double lo = 0.0, hi = 0.0;
+        for (qint64 i = first; i <= m_headIndex; ++i) {
+            const Column *c = column(channel, i);
+            if (!c) continue;
+            lo = any ? qMin(lo, c->min) : c->min;
+            hi = any ? qMax(hi, c->max) : c->max;
+            any = true;
+        }
+        if (!any) continue;
+        double fitLo, fitHi;
+        paddedRange(lo, hi, fitLo, fitHi);
+        if ((channel.hi - channel.lo) > 2.0 * (fitHi - fitLo) && fitRange(channel, lo, hi)) {
+            m_needFullRedraw = true;
+        }
+    }
+}
+
+// ==========================================
+//          绘制
+// ==========================================
+
+QRect AgeStripChart::laneRect(int lane) const
+{
+    const int count = qMax(1, (int)m_channels.size());
+    const int h = height() / count;
+    const int top = lane * h;
+    const int bottom = (lane == count - 1) ? height() : top + h;
+    return QRect(0, top, width(), bottom - top);
+}
+
+double AgeStripChart::toY(const Channel &channel, const QRect &lane, double value) const
+{
+    const double top = lane.top() + LANE_MARGIN;
+    const double bottom = lane.bottom() - LANE_MARGIN;
+    if (!channel.hasRange || channel.hi <= channel.lo) return (top + bottom) / 2.0;
+    const double t = (value - channel.lo) / (channel.hi - channel.lo);
+    return qBound(top, bottom - t * (bottom - top), bottom);
+}
+
+// 清除并重画 [fromIndex, toIndex] 对应的像素列
+void AgeStripChart::drawColumns(qint64 fromIndex, qint64 toIndex)
+{
+    const int w = plotWidth();
+    fromIndex = qMax(fromIndex, m_headIndex - w + 1);
+    toIndex = qMin(toIndex, m_headIndex);
+    if (fromIndex > toIndex) return;
+
+    auto xOf = [this, w](qint64 index) { return (int)(w - 1 - (m_headIndex - index)); };
+    const int x0 = xOf(fromIndex);
+    const int x1 = xOf(toIndex);
+
+    QPainter p(&m_pixmap);
+    p.fillRect(QRect(x0, 0, x1 - x0 + 1, height()), BACKGROUND);
+
+    // 时间刻度与泳道分隔线随底图一起滚动
+    p.setPen(GRID);
+    for (qint64 i = fromIndex; i <= toIndex; ++i) {
+        if ((i * m_columnUs) / m_tickUs != ((i - 1) * m_columnUs) / m_tickUs) {
+            const int x = xOf(i);
+            p.drawLine(x, 0, x, height() - 1);
+        }
+    }
+    for (int lane = 1; lane < (int)m_channels.size(); ++lane) {
+        const int y = laneRect(lane).top();
+        p.drawLine(x0, y, x1, y);
+    }
+
+    // 每列画一条 min-max 竖线，并与前一个有数据的列的末值相连
+    for (int lane = 0; lane < (int)m_channels.size(); ++lane) {
+        const Channel &channel = m_channels[(size_t)lane];
+        const QRect rect = laneRect(lane);
+        p.setPen(channel.color);
+
+        qint64 prevIndex = -1;
+        for (qint64 i = fromIndex - 1; i > m_headIndex - w; --i) {
+            if (column(channel, i)) {
+                prevIndex = i;
+                break;
+            }
+        }
+        for (qint64 i = fromIndex; i <= toIndex; ++i) {
+            const Column *c = column(channel, i);
+            if (!c) continue;
+            const int x = xOf(i);
+            const int yFirst = (int)toY(channel, rect, c->first);
+            if (prevIndex >= 0) {
+                const Column *prev = column(channel, prevIndex);
+                p.drawLine(xOf(prevIndex), (int)toY(channel, rect, prev->last), x, yFirst);
+            }
+            const int yMin = (int)toY(channel, rect, c->min);
+            const int yMax = (int)toY(channel, rect, c->max);
+            if (yMin == yMax) p.drawPoint(x, yMin);
+            else p.drawLine(x, yMax, x, yMin);
+            prevIndex = i;
+        }
+    }
+}
+
+void AgeStripChart::redrawAll()
+{
+    if (m_pixmap.size() != size()) m_pixmap = QPixmap(size());
+    m_pixmap.fill(BACKGROUND);
+    m_needFullRedraw = false;
+    m_dirtyFrom = -1;
+    if (m_headIndex < 0 || m_channels.empty()) {
+        update();
+        return;
+    }
+    const qint64 first = m_headIndex - plotWidth() + 1;
+    expandRanges(first, m_headIndex);
+    drawColumns(first, m_headIndex);
+    update();
+}
+
+void AgeStripChart::advanceTo(qint64 nowUs)
+{
+    if (m_channels.empty() || m_columnUs <= 0) return;
+    const qint64 head = nowUs / m_columnUs;
+    if (m_headIndex < 0 || !isVisible()) {
+        // 隐藏时只推进时间，显示时整幅重画
+        m_headIndex = qMax(m_headIndex, head);
+        m_needFullRedraw = true;
+        return;
+    }
+
+    if (nowUs - m_lastShrinkUs >= SHRINK_CHECK_US) {
+        m_lastShrinkUs = nowUs;
+        shrinkRanges();
+    }
+
+    const qint64 shift = qMax<qint64>(0, head - m_headIndex);
+    qint64 from = m_headIndex + 1;
+    if (m_dirtyFrom >= 0) from = qMin(from, m_dirtyFrom);
+    const qint64 to = m_headIndex + shift;
+    if (expandRanges(from, to)) m_needFullRedraw = true;
+
+    if (m_needFullRedraw || m_pixmap.size() != size() || shift >= plotWidth()) {
+        m_headIndex += shift;
+        redrawAll();
+        return;
+    }
+    if (shift == 0 && from > to) return;
+
+    if (shift > 0) m_pixmap.scroll(-(int)shift, 0, m_pixmap.rect());
+    m_headIndex += shift;
+    drawColumns(from, to);
+    m_dirtyFrom = -1;
+    update();
+}
+
+void AgeStripChart::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter p(this);
+    if (m_pixmap.size() == size()) p.drawPixmap(0, 0, m_pixmap);
+    else p.fillRect(rect(), BACKGROUND);
+
+    // 叠加文字每帧重画，不进入底图
+    for (int lane = 0; lane < (int)m_channels.size(); ++lane) {
+        const Channel &channel = m_channels[(size_t)lane];
+        const QRect r = laneRect(lane).adjusted(4, 2, -4, -2);
+        p.setPen(channel.color);
+        QString title = channel.name;
+        if (channel.hasValue) title += QString(": %1 %2").arg(channel.lastValue, 0, 'f', 2).arg(channel.unit);
+        p.drawText(r, Qt::AlignLeft | Qt::AlignTop, title);
+        if (channel.hasRange) {
+            p.setPen(TEXT);
+            p.drawText(r, Qt::AlignRight | Qt::AlignTop, QString::number(channel.hi, 'g', 6));
+            p.drawText(r, Qt::AlignRight | Qt::AlignBottom, QString::number(channel.lo, 'g', 6));
+        }
+    }
+
+    p.setPen(TEXT);
+    QString footer = QString("span %1 s, grid %2 s").arg(m_spanUs / 1e6, 0, 'g', 4).arg(m_tickUs / 1e6, 0, 'g', 4);
+    if (m_dropped) footer += QString(", dropped %1").arg(m_dropped);
+    p.drawText(rect().adjusted(4, 0, -4, -2), Qt::AlignLeft | Qt::AlignBottom, footer);
+}
+
+void AgeStripChart::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    resizeStorage();
+    redrawAll();
+}
+
+void AgeStripChart::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (m_needFullRedraw) redrawAll();
+}
@@ -0,0 +1,95 @@
+#ifndef AGESTRIPCHART_H
+#define AGESTRIPCHART_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QColor>
+#include <QString>
+#include <vector>
+
+// ==========================================
+//   滚动曲线图: 每像素列 min/max 抽取，增量绘制
+// ==========================================
+// - 每个通道占一条水平泳道，横轴为时间 (右端 = advanceTo() 给出的当前时刻)
+// - 样本按所在像素列累计 min/max/首值/末值，只保留可见宽度的列，
+//   内存与每帧绘制量只取决于控件宽度，与采样率和时长无关
+// - 增量绘制: 时间前进 k 列时把底图左移 k 像素，只清除并重画最右侧的新列
+//   (以及迟到样本所在的列)；量程变化、改变尺寸或时间跨度时才整幅重画
+// - 量程自动扩展；每秒检查一次，可见数据明显收缩时缩小量程
+// - 只在 GUI 线程使用；控件隐藏时只累计数据，显示时整幅重画
+class AgeStripChart : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit AgeStripChart(QWidget *parent = nullptr);
+
+    // 添加通道，返回通道号
+    int addChannel(const QString &name, const QString &unit, const QColor &color);
+
+    // 可见时间跨度 (µs)；已有数据按新的像素列宽重新归并 (放大时会变稀疏)
+    void setTimeSpan(qint64 spanUs);
+    qint64 timeSpan() const { return m_spanUs; }
+
+    // 时间戳与 advanceTo() 使用同一时钟 (AgeMotionDriver::monotonicUs)
+    void addSample(int channel, qint64 timestampUs, double value);
+    // 推进右端时刻并增量重画，通常每帧调用一次
+    void advanceTo(qint64 nowUs);
+    // 数据源丢失的样本数 (如遥测环形缓冲溢出)，非零时在图上提示
+    void setDroppedSamples(quint64 count);
+    void clear();
+
+    QSize sizeHint() const override { return QSize(600, 240); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+
+private:
+    struct Column {
+        qint64 index = -1;     // 像素列的绝对序号 (timestamp / m_columnUs)，-1 = 空
+        double min = 0.0;
+        double max = 0.0;
+        double first = 0.0;
+        double last = 0.0;
+    };
+
+    struct Channel {
+        QString name;
+        QString unit;
+        QColor color;
+        std::vector<Column> columns;   // 按绝对列号取模的环形存储
+        double lo = 0.0;
+        double hi = 0.0;
+        bool hasRange = false;
+        bool hasValue = false;
+        double lastValue = 0.0;
+    };
+
+    int plotWidth() const { return qMax(1, width()); }
+    int capacity() const { return (int)m_channels.front().columns.size(); }
+    const Column *column(const Channel &channel, qint64 index) const;
+    void resizeStorage();
+    void rebin(qint64 oldColumnUs);
+    QRect laneRect(int lane) const;
+    double toY(const Channel &channel, const QRect &lane, double value) const;
+    bool fitRange(Channel &channel, double lo, double hi);
+    bool expandRanges(qint64 fromIndex, qint64 toIndex);
+    void shrinkRanges();
+    void drawColumns(qint64 fromIndex, qint64 toIndex);
+    void redrawAll();
+
+    std::vector<Channel> m_channels;
+    qint64 m_spanUs = 10 * 1000000LL;
+    qint64 m_columnUs = 0;            // 每像素列的时长
+    qint64 m_headIndex = -1;          // 最右一列的绝对序号
+    qint64 m_dirtyFrom = -1;          // 需要重画的最早列 (迟到样本)，-1 = 无
+    qint64 m_lastShrinkUs = 0;
+    qint64 m_tickUs = 1000000;        // 时间刻度间隔
+    quint64 m_dropped = 0;
+    bool m_needFullRedraw = true;
+    QPixmap m_pixmap;
+};
+
+#endif // AGESTRIPCHART_H
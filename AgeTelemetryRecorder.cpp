@@ -0,0 +1,332 @@
+#include "AgeTelemetryRecorder.h"
+#include <QDateTime>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char MAGIC[8] = {'A', 'G', 'E', 'T', 'R', 'C', '0', '1'};
+constexpr quint32 FORMAT_VERSION = 1;
+constexpr qint64 FILE_HEADER_SIZE = 4096;
+constexpr qint64 BLOCK_HEADER_SIZE = 64;
+constexpr qint64 N = AgeTelemetryRecorder::BLOCK_SAMPLES;
+
+// 映射内存中的计数按原子变量访问，读端在另一进程中也能看到完整的样本
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 blockSize;
+    quint32 blockSamples;
+    quint32 maxBlocks;
+    std::atomic<quint32> blocksUsed;
+    std::atomic<quint32> closed;
+    qint64 startMonotonicUs;
+    qint64 startEpochMs;
+};
+
+struct BlockHeader {
+    std::atomic<quint32> count;
+    quint32 reserved;
+    qint64 baseTimestampUs;
+    qint64 basePositionNm;
+    qint64 baseTargetNm;
+    qint64 baseVelocityNmPerSec;
+    qint32 baseCurrentMa;
+};
+
+static_assert(sizeof(FileHeader) <= FILE_HEADER_SIZE, "file header too large");
+static_assert(sizeof(BlockHeader) <= BLOCK_HEADER_SIZE, "block header too large");
+static_assert(std::atomic<quint32>::is_always_lock_free, "mapped counters must be lock-free");
+
+// 列偏移 (相对块起点)
+constexpr qint64 OFF_TIMESTAMP = BLOCK_HEADER_SIZE;
+constexpr qint64 OFF_POSITION = OFF_TIMESTAMP + 4 * N;
+constexpr qint64 OFF_TARGET = OFF_POSITION + 4 * N;
+constexpr qint64 OFF_VELOCITY = OFF_TARGET + 4 * N;
+constexpr qint64 OFF_CURRENT = OFF_VELOCITY + 4 * N;
+constexpr qint64 OFF_ERROR = OFF_CURRENT + 2 * N;
+constexpr qint64 OFF_CONTROL = OFF_ERROR + 2 * N;
+constexpr qint64 OFF_AXIS = OFF_CONTROL + 2 * N;
+constexpr qint64 OFF_GROUPS = OFF_AXIS + N;
+constexpr qint64 BLOCK_SIZE = ((OFF_GROUPS + N) + 4095) / 4096 * 4096;
+
+template<typename T>
+T *col(uchar *block, qint64 offset) { return reinterpret_cast<T *>(block + offset); }
+template<typename T>
+const T *col(const uchar *block, qint64 offset) { return reinterpret_cast<const T *>(block + offset); }
+
+template<typename T>
+bool fitsIn(qint64 delta)
+{
+    return delta >= (qint64)std::numeric_limits<T>::min() && delta <= (qint64)std::numeric_limits<T>::max();
+}
+
+} // namespace
+
+// ==========================================
+//          写入
+// ==========================================
+
+AgeTelemetryRecorder::~AgeTelemetryRecorder()
+{
+    close();
+}
+
+bool AgeTelemetryRecorder::open(const QString &path, qint64 maxBytes)
+{
+    close();
+    m_recorded.store(0);
+    m_dropped.store(0);
+
+    m_maxBlocks = (quint32)qMax<qint64>(1, (maxBytes - FILE_HEADER_SIZE) / BLOCK_SIZE);
+    const qint64 size = FILE_HEADER_SIZE + (qint64)m_maxBlocks * BLOCK_SIZE;
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        m_lastError = QString("Cannot open %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+    // 一次性预分配，写入期间不再改变文件大小
+    if (!m_file.resize(size)) {
+        m_lastError = QString("Cannot allocate %1 bytes for %2: %3").arg(size).arg(path, m_file.errorString());
+        m_file.close();
+        return false;
+    }
+    m_base = m_file.map(0, size);
+    if (!m_base) {
+        m_lastError = QString("Cannot map %1: %2").arg(path, m_file.errorString());
+        m_file.close();
+        return false;
+    }
+
+    FileHeader *header = reinterpret_cast<FileHeader *>(m_base);
+    memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    header->version = FORMAT_VERSION;
+    header->blockSize = (quint32)BLOCK_SIZE;
+    header->blockSamples = (quint32)N;
+    header->maxBlocks = m_maxBlocks;
+    header->startMonotonicUs = AgeMotionDriver::monotonicUs();
+    header->startEpochMs = QDateTime::currentMSecsSinceEpoch();
+    header->closed.store(0, std::memory_order_relaxed);
+    header->blocksUsed.store(0, std::memory_order_release);
+
+    m_block = nullptr;
+    m_count = 0;
+    m_lastError.clear();
+    return true;
+}
+
+void AgeTelemetryRecorder::close()
+{
+    if (!m_base) return;
+    FileHeader *header = reinterpret_cast<FileHeader *>(m_base);
+    const qint64 used = FILE_HEADER_SIZE + (qint64)header->blocksUsed.load(std::memory_order_relaxed) * BLOCK_SIZE;
+    header->closed.store(1, std::memory_order_release);
+    m_file.unmap(m_base);
+    m_base = nullptr;
+    m_block = nullptr;
+    m_file.resize(used);   // 截去未使用的预分配空间
+    m_file.close();
+}
+
+qint64 AgeTelemetryRecorder::bytesUsed() const
+{
+    if (!m_base) return 0;
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(m_base);
+    return FILE_HEADER_SIZE + (qint64)header->blocksUsed.load(std::memory_order_relaxed) * BLOCK_SIZE;
+}
+
+AgeTelemetryRecorder::Quantized AgeTelemetryRecorder::quantize(const AgeTelemetrySample &sample)
+{
+    Quantized q;
+    q.timestampUs = sample.timestampUs;
+    q.positionNm = std::llround(sample.positionUm * 1000.0);
+    q.targetNm = std::llround(sample.targetUm * 1000.0);
+    q.velocityNmPerSec = std::llround(sample.velocityUmPerSec * 1000.0);
+    q.currentMa = (qint32)std::lround(sample.currentA * 1000.0);
+    q.errorCode = sample.errorCode;
+    q.control = sample.control;
+    q.axis = sample.axis;
+    q.freshGroups = sample.freshGroups;
+    return q;
+}
+
+// 相对上一条样本的差分是否都放得进列宽
+bool AgeTelemetryRecorder::fits(const Quantized &q) const
+{
+    return fitsIn<quint32>(q.timestampUs - m_prev.timestampUs)
+        && fitsIn<qint32>(q.positionNm - m_prev.positionNm)
+        && fitsIn<qint32>(q.targetNm - m_prev.targetNm)
+        && fitsIn<qint32>(q.velocityNmPerSec - m_prev.velocityNmPerSec)
+        && fitsIn<qint16>((qint64)q.currentMa - m_prev.currentMa);
+}
+
+bool AgeTelemetryRecorder::startBlock(const Quantized &q)
+{
+    FileHeader *header = reinterpret_cast<FileHeader *>(m_base);
+    const quint32 used = header->blocksUsed.load(std::memory_order_relaxed);
+    if (used >= m_maxBlocks) return false;
+
+    m_block = m_base + FILE_HEADER_SIZE + (qint64)used * BLOCK_SIZE;
+    BlockHeader *block = reinterpret_cast<BlockHeader *>(m_block);
+    block->baseTimestampUs = q.timestampUs;
+    block->basePositionNm = q.positionNm;
+    block->baseTargetNm = q.targetNm;
+    block->baseVelocityNmPerSec = q.velocityNmPerSec;
+    block->baseCurrentMa = q.currentMa;
+    block->count.store(0, std::memory_order_relaxed);
+    m_count = 0;
+    m_prev = q;
+    header->blocksUsed.store(used + 1, std::memory_order_release);
+    return true;
+}
+
+bool AgeTelemetryRecorder::append(const AgeTelemetrySample &sample)
+{
+    if (!m_base) return false;
+    const Quantized q = quantize(sample);
+    if (!m_block || m_count >= (quint32)N || !fits(q)) {
+        if (!startBlock(q)) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    const qint64 i = m_count;
+    col<quint32>(m_block, OFF_TIMESTAMP)[i] = (quint32)(q.timestampUs - m_prev.timestampUs);
+    col<qint32>(m_block, OFF_POSITION)[i] = (qint32)(q.positionNm - m_prev.positionNm);
+    col<qint32>(m_block, OFF_TARGET)[i] = (qint32)(q.targetNm - m_prev.targetNm);
+    col<qint32>(m_block, OFF_VELOCITY)[i] = (qint32)(q.velocityNmPerSec - m_prev.velocityNmPerSec);
+    col<qint16>(m_block, OFF_CURRENT)[i] = (qint16)(q.currentMa - m_prev.currentMa);
+    col<quint16>(m_block, OFF_ERROR)[i] = q.errorCode;
+    col<quint16>(m_block, OFF_CONTROL)[i] = q.control;
+    col<quint8>(m_block, OFF_AXIS)[i] = q.axis;
+    col<quint8>(m_block, OFF_GROUPS)[i] = q.freshGroups;
+
+    // 各列写完后再发布计数
+    reinterpret_cast<BlockHeader *>(m_block)->count.store(++m_count, std::memory_order_release);
+    m_prev = q;
+    m_recorded.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// ==========================================
+//          读取
+// ==========================================
+
+AgeTelemetryFileReader::~AgeTelemetryFileReader()
+{
+    close();
+}
+
+bool AgeTelemetryFileReader::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_lastError = QString("Cannot open %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size < FILE_HEADER_SIZE || !(m_base = m_file.map(0, m_size))) {
+        m_lastError = QString("Cannot map %1.").arg(path);
+        close();
+        return false;
+    }
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(m_base);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != FORMAT_VERSION
+        || header->blockSize != (quint32)BLOCK_SIZE || header->blockSamples != (quint32)N) {
+        m_lastError = QString("%1 is not a telemetry recording of a supported version.").arg(path);
+        close();
+        return false;
+    }
+    refresh();
+    return true;
+}
+
+void AgeTelemetryFileReader::close()
+{
+    if (m_base) m_file.unmap(m_base);
+    m_base = nullptr;
+    m_file.close();
+    m_blockStart.clear();
+    m_blockCount.clear();
+    m_total = 0;
+}
+
+qint64 AgeTelemetryFileReader::refresh()
+{
+    if (!m_base) return 0;
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(m_base);
+    // 只看映射范围内的块 (写端关闭时会截短文件)
+    const qint64 mappedBlocks = (m_size - FILE_HEADER_SIZE) / BLOCK_SIZE;
+    const qint64 blocks = qMin<qint64>(header->blocksUsed.load(std::memory_order_acquire), mappedBlocks);
+
+    m_blockStart.resize((int)blocks);
+    m_blockCount.resize((int)blocks);
+    m_total = 0;
+    for (int b = 0; b < (int)blocks; ++b) {
+        const BlockHeader *block = reinterpret_cast<const BlockHeader *>(m_base + FILE_HEADER_SIZE + b * BLOCK_SIZE);
+        m_blockStart[b] = m_total;
+        m_blockCount[b] = qMin<quint32>(block->count.load(std::memory_order_acquire), (quint32)N);
+        m_total += m_blockCount[b];
+    }
+    return m_total;
+}
+
+bool AgeTelemetryFileReader::isComplete() const
+{
+    return m_base && reinterpret_cast<const FileHeader *>(m_base)->closed.load(std::memory_order_acquire) != 0;
+}
+
+qint64 AgeTelemetryFileReader::startMonotonicUs() const
+{
+    return m_base ? reinterpret_cast<const FileHeader *>(m_base)->startMonotonicUs : 0;
+}
+
+qint64 AgeTelemetryFileReader::startEpochMs() const
+{
+    return m_base ? reinterpret_cast<const FileHeader *>(m_base)->startEpochMs : 0;
+}
+
+int AgeTelemetryFileReader::read(qint64 first, AgeTelemetrySample *out, int max) const
+{
+    if (!m_base || first < 0 || first >= m_total || max <= 0) return 0;
+
+    // 所在块: 最后一个起点 <= first 的块
+    int b = (int)(std::upper_bound(m_blockStart.begin(), m_blockStart.end(), first) - m_blockStart.begin()) - 1;
+    int written = 0;
+    for (; b < m_blockStart.size() && written < max; ++b) {
+        const uchar *data = m_base + FILE_HEADER_SIZE + b * BLOCK_SIZE;
+        const BlockHeader *block = reinterpret_cast<const BlockHeader *>(data);
+        qint64 ts = block->baseTimestampUs;
+        qint64 pos = block->basePositionNm;
+        qint64 target = block->baseTargetNm;
+        qint64 vel = block->baseVelocityNmPerSec;
+        qint64 cur = block->baseCurrentMa;
+
+        // 差分需从块首累加
+        for (quint32 i = 0; i < m_blockCount[b] && written < max; ++i) {
+            ts += col<quint32>(data, OFF_TIMESTAMP)[i];
+            pos += col<qint32>(data, OFF_POSITION)[i];
+            target += col<qint32>(data, OFF_TARGET)[i];
+            vel += col<qint32>(data, OFF_VELOCITY)[i];
+            cur += col<qint16>(data, OFF_CURRENT)[i];
+            if (m_blockStart[b] + i < first) continue;
+
+            AgeTelemetrySample &s = out[written++];
+            s.timestampUs = ts;
+            s.positionUm = pos / 1000.0;
+            s.targetUm = target / 1000.0;
+            s.velocityUmPerSec = vel / 1000.0;
+            s.currentA = cur / 1000.0;
+            s.errorCode = col<quint16>(data, OFF_ERROR)[i];
+            s.control = col<quint16>(data, OFF_CONTROL)[i];
+            s.axis = col<quint8>(data, OFF_AXIS)[i];
+            s.freshGroups = col<quint8>(data, OFF_GROUPS)[i];
+        }
+    }
+    return written;
+}
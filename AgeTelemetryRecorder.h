@@ -0,0 +1,113 @@
+#ifndef AGETELEMETRYRECORDER_H
+#define AGETELEMETRYRECORDER_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "AgeTelemetryRing.h"
+
+// ==========================================
+//   遥测记录文件 (.agetrace): 内存映射、预分配、分块列式差分
+// ==========================================
+// 文件布局 (小端):
+//   [文件头 4096 字节] [块 0] [块 1] ...   每块大小固定 (按 4096 对齐)
+//   块 = 块头 (样本数 + 各差分列的基准值) + 各列的定宽数组 (每列 BLOCK_SAMPLES 项):
+//     时间戳 u32 (µs 差分) | 位置 i32 (nm 差分) | 目标位置 i32 (nm 差分) | 实时速度 i32 (nm/s 差分)
+//     | 电流 i16 (mA 差分) | 故障码 u16 | 控制字 u16 | 轴号 u8 | 新鲜分组 u8
+//   每条样本 24 字节 (AgeTelemetrySample 为 48 字节)；差分超出列宽时提前结束当前块，
+//   下一块以该样本为新基准
+// - 边写边读: 先写各列，再以 release 语义递增块头的样本数与文件头的块数，
+//   读端 (AgeTelemetryFileReader) 只读取已计数的样本，可随时重新打开或 refresh()
+// - 写入 (append) 不分配内存、不加锁，只写映射内存；文件在 open() 时一次性预分配，
+//   写满后丢弃后续样本并计数；close() 时截去未使用的块
+// - append() 只能在一个线程中调用 (AgeBusThread::setRecorder() 挂到总线线程)，计数可在任意线程读取
+class AgeTelemetryRecorder
+{
+public:
+    static constexpr int BLOCK_SAMPLES = 4096;
+    static constexpr qint64 DEFAULT_MAX_BYTES = 512LL * 1024 * 1024;
+
+    AgeTelemetryRecorder() = default;
+    ~AgeTelemetryRecorder();
+    AgeTelemetryRecorder(const AgeTelemetryRecorder &) = delete;
+    AgeTelemetryRecorder &operator=(const AgeTelemetryRecorder &) = delete;
+
+    // 创建并预分配文件 (已存在则覆盖)；maxBytes 决定可容纳的块数
+    bool open(const QString &path, qint64 maxBytes = DEFAULT_MAX_BYTES);
+    void close();
+    bool isOpen() const { return m_base != nullptr; }
+
+    // 追加一条样本；文件已满或未打开时返回 false
+    bool append(const AgeTelemetrySample &sample);
+
+    quint64 recorded() const { return m_recorded.load(std::memory_order_relaxed); }
+    quint64 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    qint64 bytesUsed() const;
+    QString fileName() const { return m_file.fileName(); }
+    QString lastError() const { return m_lastError; }
+
+private:
+    struct Quantized {
+        qint64 timestampUs;
+        qint64 positionNm;
+        qint64 targetNm;
+        qint64 velocityNmPerSec;
+        qint32 currentMa;
+        quint16 errorCode;
+        quint16 control;
+        quint8 axis;
+        quint8 freshGroups;
+    };
+
+    static Quantized quantize(const AgeTelemetrySample &sample);
+    bool fits(const Quantized &q) const;
+    bool startBlock(const Quantized &q);
+
+    QFile m_file;
+    uchar *m_base = nullptr;
+    quint32 m_maxBlocks = 0;
+    uchar *m_block = nullptr;          // 当前块
+    quint32 m_count = 0;               // 当前块已写样本数
+    Quantized m_prev = {};
+    std::atomic<quint64> m_recorded{0};
+    std::atomic<quint64> m_dropped{0};
+    QString m_lastError;
+};
+
+// ==========================================
+//   记录文件读取 (可在写入过程中读取)
+// ==========================================
+class AgeTelemetryFileReader
+{
+public:
+    ~AgeTelemetryFileReader();
+
+    bool open(const QString &path);
+    void close();
+
+    // 重新读取文件头与块头中的计数 (写端仍在追加时)，返回当前可读样本数
+    qint64 refresh();
+    qint64 sampleCount() const { return m_total; }
+    // 写端已正常关闭
+    bool isComplete() const;
+    // 起始时刻: 单调时钟与对应的系统时间 (ms since epoch)
+    qint64 startMonotonicUs() const;
+    qint64 startEpochMs() const;
+
+    // 从第 first 条开始解码最多 max 条，返回实际条数
+    int read(qint64 first, AgeTelemetrySample *out, int max) const;
+
+    QString lastError() const { return m_lastError; }
+
+private:
+    QFile m_file;
+    uchar *m_base = nullptr;
+    qint64 m_size = 0;
+    QVector<qint64> m_blockStart;     // 每块第一条样本的全局序号
+    QVector<quint32> m_blockCount;
+    qint64 m_total = 0;
+    QString m_lastError;
+};
+
+#endif // AGETELEMETRYRECORDER_H
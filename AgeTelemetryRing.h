@@ -0,0 +1,186 @@
+#ifndef AGETELEMETRYRING_H
+#define AGETELEMETRYRING_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include "AgeMotionDriver.h"
+
+// ==========================================
+//   遥测样本: 每次状态读取成功后由总线线程写入一条
+// ==========================================
+// 未在本次读取中刷新的分组沿用上一次的值，freshGroups 标明哪些字段是新采样的
+struct AgeTelemetrySample
+{
+    qint64 timestampUs = 0;            // 单调时钟 (AgeMotionDriver::monotonicUs)
+    double positionUm = 0.0;
+    double targetUm = 0.0;
+    double velocityUmPerSec = 0.0;
+    double currentA = 0.0;
+    quint16 errorCode = 0;
+    quint16 control = 0;
+    quint8 axis = 0;
+    quint8 freshGroups = 0;            // DriveStatusSnapshot::Group
+
+    static AgeTelemetrySample fromSnapshot(int axis, const DriveStatusSnapshot &snapshot)
+    {
+        AgeTelemetrySample sample;
+        sample.timestampUs = snapshot.timestampUs;
+        sample.positionUm = snapshot.positionUm;
+        sample.targetUm = snapshot.targetPositionUm;
+        sample.velocityUmPerSec = snapshot.realVelocityUmPerSec;
+        sample.currentA = snapshot.currentA;
+        sample.errorCode = snapshot.errorCode;
+        sample.control = snapshot.control;
+        sample.axis = (quint8)axis;
+        sample.freshGroups = (quint8)snapshot.freshGroups;
+        return sample;
+    }
+};
+
+// ==========================================
+//   单写多读环形缓冲 (无锁、无分配，写端从不等待读端)
+// ==========================================
+// - 写端: 只允许一个线程 push()；写满后覆盖最旧的样本
+// - 读端: 每个消费者持有自己的 Reader (游标)，互不影响，可在任意线程读取
+// - 溢出: 读端落后超过容量时跳到现存最旧的样本，丢失的条数累计到 Reader::overruns()
+// - 每个槽位带序号 (同 AgeSeqLock: 奇数 = 写入中)，读端拷贝后复查序号，读到被覆盖的槽位按溢出处理
+// - 槽位按缓存行对齐，数据按 8 字节原子字保存，避免读写竞争时的未定义行为
+template<typename T>
+class AgeSampleRing
+{
+    static_assert(std::is_trivially_copyable<T>::value, "AgeSampleRing requires a trivially copyable type");
+
+public:
+    class Reader
+    {
+    public:
+        // 已丢失 (被覆盖而未读到) 的样本总数
+        quint64 overruns() const { return m_overruns; }
+        // 自上次调用以来是否发生过溢出
+        bool takeOverrun()
+        {
+            const bool overrun = m_overrunFlag;
+            m_overrunFlag = false;
+            return overrun;
+        }
+        // 下一条要读的样本序号 (从 0 开始的全局写入序号)
+        quint64 position() const { return m_next; }
+
+    private:
+        friend class AgeSampleRing;
+        quint64 m_next = 0;
+        quint64 m_overruns = 0;
+        bool m_overrunFlag = false;
+    };
+
+    // capacity 向上取整为 2 的幂
+    explicit AgeSampleRing(int capacity)
+    {
+        size_t n = 1;
+        while (n < (size_t)qMax(2, capacity)) n <<= 1;
+        m_capacity = n;
+        m_mask = n - 1;
+        m_slots.reset(new Slot[n]);
+    }
+    AgeSampleRing(const AgeSampleRing &) = delete;
+    AgeSampleRing &operator=(const AgeSampleRing &) = delete;
+
+    int capacity() const { return (int)m_capacity; }
+    // 已写入的样本总数
+    quint64 written() const { return m_head.load(std::memory_order_acquire); }
+
+    // 仅允许单一写线程调用
+    void push(const T &value)
+    {
+        quint64 words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        const quint64 index = m_head.load(std::memory_order_relaxed);
+        Slot &slot = m_slots[index & m_mask];
+        slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            slot.data[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.seq.store(2 * index + 2, std::memory_order_release);
+        m_head.store(index + 1, std::memory_order_release);
+    }
+
+    // 新建读端: fromOldest 为 true 时从现存最旧的样本开始，否则只读之后写入的样本
+    Reader reader(bool fromOldest = false) const
+    {
+        Reader r;
+        const quint64 head = written();
+        if (!fromOldest) r.m_next = head;
+        else r.m_next = head > m_capacity ? head - m_capacity : 0;
+        return r;
+    }
+
+    // 读出最多 max 条样本，返回实际条数；没有新样本时返回 0
+    int read(Reader &reader, T *out, int max) const
+    {
+        int count = 0;
+        while (count < max && readOne(reader, out[count])) ++count;
+        return count;
+    }
+
+    bool readOne(Reader &reader, T &out) const
+    {
+        quint64 words[WORDS];
+        for (;;) {
+            const quint64 head = written();
+            if (reader.m_next >= head) return false;
+            if (head - reader.m_next > m_capacity) {
+                skipTo(reader, head - m_capacity);
+                continue;
+            }
+
+            const Slot &slot = m_slots[reader.m_next & m_mask];
+            const quint64 expected = 2 * reader.m_next + 2;
+            if (slot.seq.load(std::memory_order_acquire) != expected) {
+                // 读取期间写端已绕回覆盖该槽位
+                skipTo(reader, reader.m_next + 1);
+                continue;
+            }
+            for (size_t i = 0; i < WORDS; ++i) {
+                words[i] = slot.data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != expected) {
+                skipTo(reader, reader.m_next + 1);
+                continue;
+            }
+            break;
+        }
+        memcpy(&out, words, sizeof(T));
+        ++reader.m_next;
+        return true;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(quint64) - 1) / sizeof(quint64);
+
+    struct alignas(64) Slot {
+        std::atomic<quint64> seq{0};
+        std::atomic<quint64> data[WORDS];
+    };
+
+    static void skipTo(Reader &reader, quint64 next)
+    {
+        reader.m_overruns += next - reader.m_next;
+        reader.m_overrunFlag = true;
+        reader.m_next = next;
+    }
+
+    size_t m_capacity = 0;
+    size_t m_mask = 0;
+    std::unique_ptr<Slot[]> m_slots;
+    alignas(64) std::atomic<quint64> m_head{0};
+};
+
+typedef AgeSampleRing<AgeTelemetrySample> AgeTelemetryRing;
+
+#endif // AGETELEMETRYRING_H
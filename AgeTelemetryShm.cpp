@@ -0,0 +1,384 @@
+#include "AgeTelemetryShm.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+std::wstring nativeName(const QString &name)
+{
+    return (QString("Local\\") + name).toStdWString();
+}
+#else
+QByteArray nativeName(const QString &name)
+{
+    return (name.startsWith('/') ? name : "/" + name).toLocal8Bit();
+}
+
+// 已有同名段的发布进程仍在运行时返回其进程号，否则 (残留段、未初始化完成或无法读取) 返回 0
+quint64 livePublisherPid(const QByteArray &path)
+{
+    const int fd = shm_open(path.constData(), O_RDONLY, 0);
+    if (fd < 0) return 0;
+    quint64 pid = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(AgeShmHeader)) {
+        void *base = mmap(nullptr, sizeof(AgeShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (base != MAP_FAILED) {
+            const AgeShmHeader *header = static_cast<const AgeShmHeader *>(base);
+            if (header->magic == AgeShmHeader::MAGIC) pid = header->publisherPid;
+            munmap(base, sizeof(AgeShmHeader));
+        }
+    }
+    ::close(fd);
+    if (pid == 0) return 0;
+    return (kill((pid_t)pid, 0) == 0 || errno == EPERM) ? pid : 0;
+}
+#endif
+
+constexpr quint64 align64(quint64 v)
+{
+    return (v + 63) & ~quint64(63);
+}
+
+} // namespace
+
+// ==========================================
+//          共享内存段 (平台相关)
+// ==========================================
+
+bool AgeShmRegion::create(const QString &name, qint64 size)
+{
+    close();
+#ifdef Q_OS_WIN
+    HANDLE handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                       (DWORD)((quint64)size >> 32), (DWORD)(size & 0xFFFFFFFF),
+                                       nativeName(name).c_str());
+    if (!handle) {
+        m_lastError = QString("SHM: CreateFileMapping(%1) failed: error %2").arg(name).arg(GetLastError());
+        return false;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(handle);
+        m_lastError = QString("SHM: %1 is already published by another process.").arg(name);
+        return false;
+    }
+    void *base = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size);
+    if (!base) {
+        m_lastError = QString("SHM: MapViewOfFile(%1) failed: error %2").arg(name).arg(GetLastError());
+        CloseHandle(handle);
+        return false;
+    }
+    m_handle = (quintptr)handle;
+#else
+    const QByteArray path = nativeName(name);
+    int fd = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        if (const quint64 pid = livePublisherPid(path)) {
+            m_lastError = QString("SHM: %1 is already published by another process (pid %2).").arg(name).arg(pid);
+            return false;
+        }
+        // 上次异常退出留下的段: 先删除名字，已映射旧段的读端不受影响
+        shm_unlink(path.constData());
+        fd = shm_open(path.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) {
+        m_lastError = QString("SHM: shm_open(%1) failed: %2").arg(name, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        m_lastError = QString("SHM: cannot size %1: %2").arg(name, QString::fromLocal8Bit(strerror(errno)));
+        ::close(fd);
+        shm_unlink(path.constData());
+        return false;
+    }
+    void *base = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        m_lastError = QString("SHM: mmap(%1) failed: %2").arg(name, QString::fromLocal8Bit(strerror(errno)));
+        shm_unlink(path.constData());
+        return false;
+    }
+#endif
+    m_base = static_cast<uchar *>(base);
+    m_size = size;
+    m_owner = true;
+    m_name = name;
+    return true;
+}
+
+bool AgeShmRegion::open(const QString &name)
+{
+    close();
+#ifdef Q_OS_WIN
+    HANDLE handle = OpenFileMappingW(FILE_MAP_READ, FALSE, nativeName(name).c_str());
+    if (!handle) {
+        m_lastError = QString("SHM: %1 is not published (error %2).").arg(name).arg(GetLastError());
+        return false;
+    }
+    void *base = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (!base || !VirtualQuery(base, &info, sizeof(info))) {
+        m_lastError = QString("SHM: MapViewOfFile(%1) failed: error %2").arg(name).arg(GetLastError());
+        if (base) UnmapViewOfFile(base);
+        CloseHandle(handle);
+        return false;
+    }
+    m_handle = (quintptr)handle;
+    m_size = (qint64)info.RegionSize;
+#else
+    const int fd = shm_open(nativeName(name).constData(), O_RDONLY, 0);
+    if (fd < 0) {
+        m_lastError = QString("SHM: %1 is not published: %2").arg(name, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        m_lastError = QString("SHM: cannot stat %1.").arg(name);
+        ::close(fd);
+        return false;
+    }
+    void *base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        m_lastError = QString("SHM: mmap(%1) failed: %2").arg(name, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    m_size = (qint64)st.st_size;
+#endif
+    m_base = static_cast<uchar *>(base);
+    m_owner = false;
+    m_name = name;
+    return true;
+}
+
+void AgeShmRegion::close()
+{
+    if (!m_base) return;
+#ifdef Q_OS_WIN
+    UnmapViewOfFile(m_base);
+    CloseHandle((HANDLE)m_handle);
+    m_handle = 0;
+#else
+    munmap(m_base, (size_t)m_size);
+    if (m_owner) shm_unlink(nativeName(m_name).constData());
+#endif
+    m_base = nullptr;
+    m_size = 0;
+    m_owner = false;
+}
+
+// ==========================================
+//          发布端
+// ==========================================
+
+bool AgeTelemetryPublisher::create(const QString &name, int axisCount, int capacity)
+{
+    close();
+    quint64 n = 1;
+    while (n < (quint64)qMax(2, capacity)) n <<= 1;
+    const quint64 latestOffset = align64(sizeof(AgeShmHeader));
+    const quint64 ringOffset = align64(latestOffset + (quint64)qMax(1, axisCount) * sizeof(AgeShmSlot));
+    const quint64 totalSize = ringOffset + n * sizeof(AgeShmSlot);
+
+    if (!m_region.create(name, (qint64)totalSize)) {
+        m_lastError = m_region.lastError();
+        return false;
+    }
+
+    // 新段内容为 0；先构造各槽，最后写魔数，读端以魔数判断段已初始化
+    uchar *base = m_region.data();
+    m_header = new (base) AgeShmHeader();
+    m_latest = reinterpret_cast<AgeShmSlot *>(base + latestOffset);
+    m_ring = reinterpret_cast<AgeShmSlot *>(base + ringOffset);
+    for (int i = 0; i < qMax(1, axisCount); ++i) new (&m_latest[i]) AgeShmSlot();
+    for (quint64 i = 0; i < n; ++i) new (&m_ring[i]) AgeShmSlot();
+    m_mask = n - 1;
+
+    m_header->version = AgeShmHeader::VERSION;
+    m_header->sampleSize = (quint16)sizeof(AgeTelemetrySample);
+    m_header->axisCount = (quint32)axisCount;
+    m_header->capacity = (quint32)n;
+    m_header->latestOffset = latestOffset;
+    m_header->ringOffset = ringOffset;
+    m_header->totalSize = totalSize;
+    m_header->createdEpochMs = QDateTime::currentMSecsSinceEpoch();
+    m_header->publisherPid = (quint64)QCoreApplication::applicationPid();
+    m_header->head.store(0, std::memory_order_relaxed);
+    m_header->heartbeatUs.store(AgeMotionDriver::monotonicUs(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = AgeShmHeader::MAGIC;
+    return true;
+}
+
+void AgeTelemetryPublisher::close()
+{
+    m_header = nullptr;
+    m_latest = nullptr;
+    m_ring = nullptr;
+    m_region.close();
+}
+
+void AgeTelemetryPublisher::publish(const AgeTelemetrySample &sample)
+{
+    if (!m_header || sample.axis >= m_header->axisCount) return;
+    quint64 words[AgeShmSlot::WORDS] = {};
+    memcpy(words, &sample, sizeof(sample));
+
+    // 最新样本槽: SeqLock
+    AgeShmSlot &latest = m_latest[sample.axis];
+    const quint64 seq = latest.seq.load(std::memory_order_relaxed);
+    latest.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < AgeShmSlot::WORDS; ++i) latest.data[i].store(words[i], std::memory_order_relaxed);
+    latest.seq.store(seq + 2, std::memory_order_release);
+
+    // 环形缓冲: 槽序号 2i+1 (写入中) -> 2i+2 (完成)，再推进 head
+    const quint64 index = m_header->head.load(std::memory_order_relaxed);
+    AgeShmSlot &slot = m_ring[index & m_mask];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < AgeShmSlot::WORDS; ++i) slot.data[i].store(words[i], std::memory_order_relaxed);
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+    m_header->head.store(index + 1, std::memory_order_release);
+    m_header->heartbeatUs.store(sample.timestampUs, std::memory_order_release);
+}
+
+// ==========================================
+//          读端
+// ==========================================
+
+bool AgeTelemetrySubscriber::attach(const QString &name)
+{
+    detach();
+    if (!m_region.open(name)) {
+        m_lastError = m_region.lastError();
+        return false;
+    }
+    const uchar *base = m_region.data();
+    const qint64 size = m_region.size();
+    const AgeShmHeader *header = reinterpret_cast<const AgeShmHeader *>(base);
+
+    QString error;
+    if (size < (qint64)sizeof(AgeShmHeader) || header->magic != AgeShmHeader::MAGIC) {
+        error = "not an AgeMotion telemetry segment (or not initialised yet)";
+    } else if (header->version != AgeShmHeader::VERSION || header->sampleSize != sizeof(AgeTelemetrySample)) {
+        error = QString("unsupported layout version %1").arg(header->version);
+    } else if (header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+               (qint64)header->totalSize > size ||
+               header->latestOffset + header->axisCount * sizeof(AgeShmSlot) > header->ringOffset ||
+               header->ringOffset + (quint64)header->capacity * sizeof(AgeShmSlot) > header->totalSize) {
+        error = "inconsistent header";
+    }
+    if (!error.isEmpty()) {
+        m_lastError = QString("SHM: %1: %2.").arg(name, error);
+        m_region.close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    m_header = header;
+    m_latest = reinterpret_cast<const AgeShmSlot *>(base + header->latestOffset);
+    m_ring = reinterpret_cast<const AgeShmSlot *>(base + header->ringOffset);
+    m_capacity = header->capacity;
+    m_mask = m_capacity - 1;
+    return true;
+}
+
+void AgeTelemetrySubscriber::detach()
+{
+    m_header = nullptr;
+    m_latest = nullptr;
+    m_ring = nullptr;
+    m_region.close();
+}
+
+bool AgeTelemetrySubscriber::latest(int axis, AgeTelemetrySample &out, quint64 *version) const
+{
+    if (!m_header || axis < 0 || axis >= (int)m_header->axisCount) return false;
+    const AgeShmSlot &slot = m_latest[axis];
+    quint64 words[AgeShmSlot::WORDS];
+    quint64 before = 0;
+    bool consistent = false;
+    for (int attempt = 0; attempt < LATEST_READ_ATTEMPTS && !consistent; ++attempt) {
+        before = slot.seq.load(std::memory_order_acquire);
+        if (before == 0) return false;
+        if (before & 1) {
+            // 写入进行中 (或发布端在写入中途退出，序号不会再变)
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < AgeShmSlot::WORDS; ++i) words[i] = slot.data[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        consistent = slot.seq.load(std::memory_order_relaxed) == before;
+    }
+    if (!consistent) return false;
+    memcpy(&out, words, sizeof(out));
+    if (version) *version = before / 2;
+    return true;
+}
+
+AgeTelemetrySubscriber::Cursor AgeTelemetrySubscriber::cursor(bool fromOldest) const
+{
+    Cursor c;
+    if (!m_header) return c;
+    const quint64 head = m_header->head.load(std::memory_order_acquire);
+    if (!fromOldest) c.m_next = head;
+    else c.m_next = head > m_capacity ? head - m_capacity : 0;
+    return c;
+}
+
+int AgeTelemetrySubscriber::read(Cursor &cursor, AgeTelemetrySample *out, int max) const
+{
+    int count = 0;
+    while (count < max && readOne(cursor, out[count])) ++count;
+    return count;
+}
+
+bool AgeTelemetrySubscriber::readOne(Cursor &cursor, AgeTelemetrySample &out) const
+{
+    if (!m_header) return false;
+    quint64 words[AgeShmSlot::WORDS];
+    for (;;) {
+        const quint64 head = m_header->head.load(std::memory_order_acquire);
+        if (cursor.m_next >= head) return false;
+        if (head - cursor.m_next > m_capacity) {
+            cursor.m_overruns += head - m_capacity - cursor.m_next;
+            cursor.m_next = head - m_capacity;
+            continue;
+        }
+        const AgeShmSlot &slot = m_ring[cursor.m_next & m_mask];
+        const quint64 expected = 2 * cursor.m_next + 2;
+        if (slot.seq.load(std::memory_order_acquire) == expected) {
+            for (size_t i = 0; i < AgeShmSlot::WORDS; ++i) words[i] = slot.data[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == expected) break;
+        }
+        // 读取期间写端已绕回覆盖该槽位
+        ++cursor.m_overruns;
+        ++cursor.m_next;
+    }
+    memcpy(&out, words, sizeof(out));
+    ++cursor.m_next;
+    return true;
+}
+
+bool AgeTelemetrySubscriber::isPublisherAlive(qint64 staleUs) const
+{
+    if (!m_header) return false;
+    return AgeMotionDriver::monotonicUs() - heartbeatUs() <= staleUs;
+}
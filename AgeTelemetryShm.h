@@ -0,0 +1,187 @@
+#ifndef AGETELEMETRYSHM_H
+#define AGETELEMETRYSHM_H
+
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include "AgeTelemetryRing.h"
+
+// ==========================================
+//   共享内存遥测: 总线持有进程发布，本机其他进程无系统调用读取
+// ==========================================
+// 段名: POSIX 为 shm_open("/<name>") (Linux 下即 /dev/shm/<name>)，Windows 为 "Local\<name>" 文件映射
+// 布局 (小端，偏移见 AgeShmHeader，其他语言可按此直接映射读取):
+//   [头 128 字节] [每轴最新样本槽 x axisCount] [环形缓冲槽 x capacity]
+//   槽 = 64 字节: u64 序号 + AgeTelemetrySample (48 字节，偏移见文件末尾的 static_assert) + 填充
+// - 最新样本槽 (SeqLock，同 AgeSeqLock): 写入时序号先置奇数，写完置偶数；
+//   读端读到奇数或拷贝前后序号不同则重试；序号 / 2 = 该轴的发布次数
+// - 环形缓冲 (同 AgeSampleRing): 第 i 条样本 (从 0 计) 写在槽 i & (capacity - 1)，写完后槽序号为 2i + 2，
+//   再把头部的 head 置为 i + 1；读端按序号校验，序号不符说明已被覆盖 (溢出)
+// - heartbeatUs 为发布端最近一次写入的单调时钟 (与 AgeMotionDriver::monotonicUs() 相同，本机各进程可比较)，
+//   读端据此判断发布端是否仍在运行
+// - 写端只能有一个 (总线线程，AgeBusThread::setPublisher())；读端任意数量，互不影响，只读映射
+// - 读端每次读取只有内存访问；映射建立 (attach) 之后不再有系统调用
+struct AgeShmHeader
+{
+    static constexpr quint32 MAGIC = 0x53544741;   // "AGTS"
+    static constexpr quint16 VERSION = 1;
+
+    quint32 magic;
+    quint16 version;
+    quint16 sampleSize;          // sizeof(AgeTelemetrySample)
+    quint32 axisCount;
+    quint32 capacity;            // 环形缓冲槽数 (2 的幂)
+    quint64 latestOffset;        // 最新样本槽数组的偏移
+    quint64 ringOffset;          // 环形缓冲槽数组的偏移
+    quint64 totalSize;
+    qint64 createdEpochMs;
+    quint64 publisherPid;
+    quint8 reserved[8];
+    alignas(64) std::atomic<quint64> head;         // 偏移 64: 已写入环形缓冲的样本总数
+    std::atomic<qint64> heartbeatUs;               // 偏移 72
+    quint8 reserved2[48];
+};
+
+struct alignas(64) AgeShmSlot
+{
+    static constexpr size_t WORDS = (sizeof(AgeTelemetrySample) + sizeof(quint64) - 1) / sizeof(quint64);
+
+    std::atomic<quint64> seq;
+    std::atomic<quint64> data[WORDS];
+};
+
+// 共享内存段的创建 / 打开与映射 (平台相关部分)
+class AgeShmRegion
+{
+public:
+    AgeShmRegion() = default;
+    ~AgeShmRegion() { close(); }
+    AgeShmRegion(const AgeShmRegion &) = delete;
+    AgeShmRegion &operator=(const AgeShmRegion &) = delete;
+
+    // 创建并以读写方式映射；同名段的发布进程仍在运行时返回 false (两个平台相同)
+    // - Windows: 段随最后一个句柄释放，同名段存在即说明另一进程正在发布
+    // - POSIX: 段名一直保留到 shm_unlink，按头部的 publisherPid 判断发布进程是否还在，
+    //   已退出 (上次异常退出留下的残留段) 才删除重建
+    bool create(const QString &name, qint64 size);
+    // 打开已有的段并以只读方式映射
+    bool open(const QString &name);
+    void close();
+
+    uchar *data() const { return m_base; }
+    qint64 size() const { return m_size; }
+    QString lastError() const { return m_lastError; }
+
+private:
+    uchar *m_base = nullptr;
+    qint64 m_size = 0;
+    bool m_owner = false;
+    QString m_name;
+    quintptr m_handle = 0;   // Windows: 文件映射句柄
+    QString m_lastError;
+};
+
+// ==========================================
+//   发布端 (总线持有进程)
+// ==========================================
+class AgeTelemetryPublisher
+{
+public:
+    static constexpr int DEFAULT_CAPACITY = 1 << 14;   // 约 1 MB
+
+    AgeTelemetryPublisher() = default;
+    ~AgeTelemetryPublisher() { close(); }
+    AgeTelemetryPublisher(const AgeTelemetryPublisher &) = delete;
+    AgeTelemetryPublisher &operator=(const AgeTelemetryPublisher &) = delete;
+
+    // 创建共享内存段；capacity 向上取整为 2 的幂
+    bool create(const QString &name, int axisCount, int capacity = DEFAULT_CAPACITY);
+    // 关闭并删除段名 (已映射的读端仍可读到最后的内容，之后不再更新)
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    // 写入一条样本: 更新该轴的最新样本槽并追加到环形缓冲 (只能在一个线程中调用)
+    void publish(const AgeTelemetrySample &sample);
+
+    quint64 published() const { return m_header ? m_header->head.load(std::memory_order_relaxed) : 0; }
+    QString lastError() const { return m_lastError; }
+
+private:
+    AgeShmRegion m_region;
+    AgeShmHeader *m_header = nullptr;
+    AgeShmSlot *m_latest = nullptr;
+    AgeShmSlot *m_ring = nullptr;
+    quint64 m_mask = 0;
+    QString m_lastError;
+};
+
+// ==========================================
+//   读端 (其他进程)
+// ==========================================
+class AgeTelemetrySubscriber
+{
+public:
+    // 读端游标 (同 AgeTelemetryRing::Reader)
+    class Cursor
+    {
+    public:
+        quint64 overruns() const { return m_overruns; }
+        quint64 position() const { return m_next; }
+
+    private:
+        friend class AgeTelemetrySubscriber;
+        quint64 m_next = 0;
+        quint64 m_overruns = 0;
+    };
+
+    AgeTelemetrySubscriber() = default;
+    AgeTelemetrySubscriber(const AgeTelemetrySubscriber &) = delete;
+    AgeTelemetrySubscriber &operator=(const AgeTelemetrySubscriber &) = delete;
+
+    // 映射发布端创建的段并校验布局
+    bool attach(const QString &name);
+    void detach();
+    bool isAttached() const { return m_header != nullptr; }
+
+    int axisCount() const { return m_header ? (int)m_header->axisCount : 0; }
+
+    // 轴的最新样本 (例如给每帧图像标注 Z 位置)；尚未发布过时返回 false；
+    // 连续 LATEST_READ_ATTEMPTS 次读到写入中 (例如发布端在写入中途退出) 时也返回 false
+    static constexpr int LATEST_READ_ATTEMPTS = 64;
+    bool latest(int axis, AgeTelemetrySample &out, quint64 *version = nullptr) const;
+
+    // 环形缓冲: 与 AgeTelemetryRing 相同的游标语义
+    Cursor cursor(bool fromOldest = false) const;
+    int read(Cursor &cursor, AgeTelemetrySample *out, int max) const;
+
+    // 发布端最近 staleUs 内写入过 (发布端退出或总线停止轮询时为 false)
+    bool isPublisherAlive(qint64 staleUs = 1000000) const;
+    qint64 heartbeatUs() const { return m_header ? m_header->heartbeatUs.load(std::memory_order_acquire) : 0; }
+
+    QString lastError() const { return m_lastError; }
+
+private:
+    bool readOne(Cursor &cursor, AgeTelemetrySample &out) const;
+
+    AgeShmRegion m_region;
+    const AgeShmHeader *m_header = nullptr;
+    const AgeShmSlot *m_latest = nullptr;
+    const AgeShmSlot *m_ring = nullptr;
+    quint64 m_capacity = 0;
+    quint64 m_mask = 0;
+    QString m_lastError;
+};
+
+// 共享内存中的布局是对外接口，改动须提升 AgeShmHeader::VERSION
+static_assert(std::atomic<quint64>::is_always_lock_free, "shared-memory telemetry requires lock-free 64-bit atomics");
+static_assert(sizeof(AgeShmHeader) == 128 && offsetof(AgeShmHeader, head) == 64 &&
+              offsetof(AgeShmHeader, heartbeatUs) == 72, "AgeShmHeader layout changed");
+static_assert(sizeof(AgeShmSlot) == 64, "AgeShmSlot layout changed");
+static_assert(sizeof(AgeTelemetrySample) == 48 &&
+              offsetof(AgeTelemetrySample, timestampUs) == 0 && offsetof(AgeTelemetrySample, positionUm) == 8 &&
+              offsetof(AgeTelemetrySample, targetUm) == 16 && offsetof(AgeTelemetrySample, velocityUmPerSec) == 24 &&
+              offsetof(AgeTelemetrySample, currentA) == 32 && offsetof(AgeTelemetrySample, errorCode) == 40 &&
+              offsetof(AgeTelemetrySample, control) == 42 && offsetof(AgeTelemetrySample, axis) == 44 &&
+              offsetof(AgeTelemetrySample, freshGroups) == 45, "AgeTelemetrySample layout changed");
+
+#endif // AGETELEMETRYSHM_H
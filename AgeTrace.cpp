@@ -0,0 +1,209 @@
+#include "AgeTrace.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr quint64 CAPACITY = 1 << 15;   // 每线程事件数 (约 1.3 MB)
+
+struct Event {
+    const char *category;
+    const char *name;
+    qint64 startUs;
+    qint64 durationUs;
+    qint64 arg;
+};
+
+// 单线程写入的环形缓冲区: 先写槽位，再以 release 发布 head；
+// 读端按 head 前后两次读数丢弃期间可能被覆盖的槽位
+struct ThreadBuffer {
+    std::atomic<int> tid{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<quint64> head{0};
+    std::atomic<quint64> floor{0};      // clear() 或复用时的 head，导出从此处开始
+    Event events[CAPACITY];
+};
+
+std::atomic<bool> g_enabled{true};
+QMutex g_registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;   // 全部缓冲区 (导出时遍历)，不释放
+std::vector<ThreadBuffer *> g_free;                      // 所属线程已退出、可复用的缓冲区
+int g_nextTid = 0;
+
+// 线程退出时把缓冲区交回空闲表，缓冲区总数不超过同时记录过事件的线程数
+// (发现/探测等短命线程不会各自留下一块缓冲区)；其中的事件保留到被新线程复用为止
+struct BufferLease {
+    ThreadBuffer *buffer = nullptr;
+    ~BufferLease()
+    {
+        if (!buffer) return;
+        QMutexLocker locker(&g_registryMutex);
+        g_free.push_back(buffer);
+    }
+};
+thread_local BufferLease t_lease;
+
+ThreadBuffer *currentBuffer()
+{
+    if (t_lease.buffer) return t_lease.buffer;
+
+    QMutexLocker locker(&g_registryMutex);
+    ThreadBuffer *b = nullptr;
+    if (!g_free.empty()) {
+        // 复用: 换新的线程编号，之前线程的事件不再导出 (避免显示在新线程名下)
+        b = g_free.back();
+        g_free.pop_back();
+        b->name.store(nullptr, std::memory_order_release);
+        b->floor.store(b->head.load(std::memory_order_relaxed), std::memory_order_release);
+    } else {
+        g_buffers.emplace_back(new ThreadBuffer());
+        b = g_buffers.back().get();
+    }
+    b->tid.store(++g_nextTid, std::memory_order_relaxed);
+    t_lease.buffer = b;
+    return b;
+}
+
+void appendEscaped(QByteArray &out, const char *s)
+{
+    for (; s && *s; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\') out.append('\\');
+        if ((unsigned char)c < 0x20) continue;
+        out.append(c);
+    }
+}
+
+} // namespace
+
+namespace AgeTrace
+{
+
+bool isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void setThreadName(const char *name)
+{
+    currentBuffer()->name.store(name, std::memory_order_release);
+}
+
+qint64 nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char *category, const char *name, qint64 startUs, qint64 durationUs, qint64 arg)
+{
+    if (!isEnabled()) return;
+    ThreadBuffer *b = currentBuffer();
+    const quint64 index = b->head.load(std::memory_order_relaxed);
+    Event &e = b->events[index % CAPACITY];
+    e.category = category;
+    e.name = name;
+    e.startUs = startUs;
+    e.durationUs = durationUs;
+    e.arg = arg;
+    b->head.store(index + 1, std::memory_order_release);
+}
+
+// ==========================================
+//          导出 (Chrome Trace Event Format)
+// ==========================================
+
+QByteArray toChromeJson()
+{
+    std::vector<ThreadBuffer *> buffers;
+    {
+        QMutexLocker locker(&g_registryMutex);
+        for (const auto &b : g_buffers) buffers.push_back(b.get());
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QByteArray out;
+    out.reserve(1 << 20);
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    auto separator = [&out, &first]() {
+        if (!first) out.append(",\n");
+        first = false;
+    };
+
+    std::vector<Event> copy;
+    for (ThreadBuffer *b : buffers) {
+        const int tid = b->tid.load(std::memory_order_relaxed);
+        if (const char *name = b->name.load(std::memory_order_acquire)) {
+            separator();
+            out.append("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":").append(QByteArray::number(pid));
+            out.append(",\"tid\":").append(QByteArray::number(tid)).append(",\"args\":{\"name\":\"");
+            appendEscaped(out, name);
+            out.append("\"}}");
+        }
+
+        const quint64 head = b->head.load(std::memory_order_acquire);
+        const quint64 begin = qMax(head > CAPACITY ? head - CAPACITY : 0,
+                                   b->floor.load(std::memory_order_acquire));
+        copy.clear();
+        for (quint64 i = begin; i < head; ++i) copy.push_back(b->events[i % CAPACITY]);
+
+        // 拷贝期间写端若继续前进，最旧的一段可能已被覆盖；
+        // 槽 headAfter % CAPACITY (即事件 headAfter - CAPACITY) 可能正在被写入，也不可用
+        const quint64 headAfter = b->head.load(std::memory_order_acquire);
+        const quint64 valid = headAfter + 1 > CAPACITY ? headAfter + 1 - CAPACITY : 0;
+        const size_t skip = valid > begin ? (size_t)qMin<quint64>(valid - begin, copy.size()) : 0;
+
+        for (size_t i = skip; i < copy.size(); ++i) {
+            const Event &e = copy[i];
+            separator();
+            out.append("{\"ph\":\"X\",\"cat\":\"");
+            appendEscaped(out, e.category);
+            out.append("\",\"name\":\"");
+            appendEscaped(out, e.name);
+            out.append("\",\"ts\":").append(QByteArray::number(e.startUs));
+            out.append(",\"dur\":").append(QByteArray::number(e.durationUs));
+            out.append(",\"pid\":").append(QByteArray::number(pid));
+            out.append(",\"tid\":").append(QByteArray::number(tid));
+            if (e.arg >= 0) out.append(",\"args\":{\"arg\":").append(QByteArray::number(e.arg)).append("}");
+            out.append("}");
+        }
+    }
+    out.append("]}\n");
+    return out;
+}
+
+bool dump(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    const QByteArray json = toChromeJson();
+    if (file.write(json) != json.size()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void clear()
+{
+    // 不改写 head (只属于写端)，只把导出起点移到当前位置
+    QMutexLocker locker(&g_registryMutex);
+    for (const auto &b : g_buffers) b->floor.store(b->head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+} // namespace AgeTrace
@@ -0,0 +1,83 @@
+#ifndef AGETRACE_H
+#define AGETRACE_H
+
+// ==========================================
+//   轻量时间线追踪 (Chrome Trace / Perfetto JSON)
+// ==========================================
+// - 构建时启用: qmake CONFIG+=trace (定义 AGE_TRACE_ENABLED 并编译 AgeTrace.cpp)；
+//   未启用时所有宏展开为空语句，不产生任何代码
+// - 每个线程写自己的环形缓冲区 (单写者，无锁)，只在线程第一次记录时登记一次
+//   线程退出后缓冲区回到空闲表，由之后第一次记录的线程复用 (短命线程不会累积缓冲区)
+// - 缓冲区满后覆盖最旧的事件；dump() 时各线程可继续记录
+// - 用法:
+//       AGE_TRACE_FUNCTION("driver");               // 以函数名为跨度名
+//       AGE_TRACE_SCOPE("focus", "computeMetric");  // 名称必须是静态字符串
+//       AGE_TRACE_RECORD("bus", "readMWORD", t0, dt, reg); // 已自行计时的跨度
+//       AgeTrace::dump("autofocus.trace.json");     // chrome://tracing 或 ui.perfetto.dev 打开
+
+#ifdef AGE_TRACE_ENABLED
+
+#include <QString>
+#include <QByteArray>
+
+namespace AgeTrace
+{
+// 运行时开关 (默认开启)，关闭时每个跨度只剩一次原子读取
+bool isEnabled();
+void setEnabled(bool enabled);
+
+// 当前线程在时间线上显示的名称 (静态字符串)
+void setThreadName(const char *name);
+
+qint64 nowUs();  // 单调时钟 (微秒)，与 std::chrono::steady_clock 一致
+
+// 记录一个已完成的跨度；arg >= 0 时作为 args.arg 输出 (如寄存器地址)
+void record(const char *category, const char *name, qint64 startUs, qint64 durationUs, qint64 arg = -1);
+
+// 导出所有线程缓冲区中的事件
+QByteArray toChromeJson();
+bool dump(const QString &path, QString *error = nullptr);
+void clear();
+
+class Scope
+{
+public:
+    Scope(const char *category, const char *name, qint64 arg = -1)
+        : m_category(category), m_name(name), m_arg(arg), m_startUs(isEnabled() ? nowUs() : -1) {}
+    ~Scope()
+    {
+        if (m_startUs >= 0) record(m_category, m_name, m_startUs, nowUs() - m_startUs, m_arg);
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *m_category;
+    const char *m_name;
+    qint64 m_arg;
+    qint64 m_startUs;
+};
+} // namespace AgeTrace
+
+#define AGE_TRACE_CONCAT_(a, b) a##b
+#define AGE_TRACE_CONCAT(a, b) AGE_TRACE_CONCAT_(a, b)
+#define AGE_TRACE_SCOPE(category, name) \
+    AgeTrace::Scope AGE_TRACE_CONCAT(ageTraceScope_, __LINE__)(category, name)
+#define AGE_TRACE_SCOPE_ARG(category, name, arg) \
+    AgeTrace::Scope AGE_TRACE_CONCAT(ageTraceScope_, __LINE__)(category, name, arg)
+#define AGE_TRACE_FUNCTION(category) AGE_TRACE_SCOPE(category, __func__)
+#define AGE_TRACE_RECORD(category, name, startUs, durationUs, arg) \
+    AgeTrace::record(category, name, startUs, durationUs, arg)
+#define AGE_TRACE_THREAD_NAME(name) AgeTrace::setThreadName(name)
+
+#else
+
+#define AGE_TRACE_SCOPE(category, name) do {} while (0)
+#define AGE_TRACE_SCOPE_ARG(category, name, arg) do {} while (0)
+#define AGE_TRACE_FUNCTION(category) do {} while (0)
+#define AGE_TRACE_RECORD(category, name, startUs, durationUs, arg) do {} while (0)
+#define AGE_TRACE_THREAD_NAME(name) do {} while (0)
+
+#endif // AGE_TRACE_ENABLED
+
+#endif // AGETRACE_H
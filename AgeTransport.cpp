@@ -0,0 +1,38 @@
+#include "AgeTransport.h"
+#include "AgeComTransport.h"
+#include "AgeRtuTransport.h"
+#include "AgeReplayTransport.h"
+#include <QtGlobal>
+
+QSharedPointer<AgeTransport> AgeTransport::createDefault()
+{
+#ifdef Q_OS_WIN
+    QString kind = "dll";
+    const QString defaultPort = "COM1";
+#else
+    QString kind = "rtu";
+    const QString defaultPort = "/dev/ttyUSB0";
+#endif
+    if (qEnvironmentVariableIsSet("AGEMOTION_TRANSPORT")) {
+        kind = qEnvironmentVariable("AGEMOTION_TRANSPORT").toLower();
+    }
+
+    if (kind == "replay") {
+        AgeReplayTransport::Config config;
+        config.path = qEnvironmentVariable("AGEMOTION_REPLAY_FILE");
+        bool ok = false;
+        const double speed = qEnvironmentVariable("AGEMOTION_REPLAY_SPEED").toDouble(&ok);
+        if (ok) config.speed = speed;
+        config.loop = qEnvironmentVariableIntValue("AGEMOTION_REPLAY_LOOP") != 0;
+        return QSharedPointer<AgeTransport>(new AgeReplayTransport(config));
+    }
+    if (kind == "rtu") {
+        AgeRtuTransport::Config config;
+        config.portName = qEnvironmentVariable("AGEMOTION_PORT", defaultPort);
+        bool ok = false;
+        const int baud = qEnvironmentVariable("AGEMOTION_BAUD").toInt(&ok);
+        if (ok && baud > 0) config.baudRate = baud;
+        return QSharedPointer<AgeTransport>(new AgeRtuTransport(config));
+    }
+    return QSharedPointer<AgeTransport>(new AgeComTransport());
+}
@@ -0,0 +1,90 @@
+#ifndef AGETRANSPORT_H
+#define AGETRANSPORT_H
+
+#include <QString>
+#include <QSharedPointer>
+
+// --- AgeCOM 类型定义 ---
+typedef long BOOL32;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned long DWORD;
+typedef unsigned long long QWORD;
+
+// 总线统计 (字段与 AgeCOMGetBusInfo 一一对应，时间单位 ms)
+struct AgeBusInfo
+{
+    qint64 hostRunTime = 0;     // DLL 启动至今
+    qint64 busRunTime = 0;      // 总线收发累计耗时
+    qint64 lastOpTime = 0;
+    qint64 maxOpTime = 0;
+    qint64 minOpTime = 0;
+    qint64 busOpCounts = 0;
+    qint64 txFrames = 0;
+    qint64 rxFrames = 0;
+    qint64 txBytes = 0;
+    qint64 rxBytes = 0;
+    qint64 hostErrors = 0;      // 主机软硬件错误
+    qint64 busOpErrors = 0;     // 总线操作错误 (超时、校验错等)
+    qint64 txFrameErrors = 0;
+    qint64 rxFrameErrors = 0;
+    qint64 lateRxBytes = 0;     // 超时后迟到、在下一帧发送前丢弃的应答字节 (原生 RTU)
+};
+
+// ==========================================
+//   总线传输接口 (AgeCOM.dll / 原生 Modbus RTU)
+// ==========================================
+// 接口与 AgeCOM 的读写函数一一对应，参数含义相同：
+// - station: RTU 地址 (0 为广播，只能写)
+// - timeout: 0 = 自动计算, TIMEOUT_NO_REPLY = 不等待应答, 其他 = 等待毫秒数
+class AgeTransport
+{
+public:
+    static constexpr DWORD TIMEOUT_NO_REPLY = 0xFFFFFFFF;
+    static constexpr int MAX_READ_WORDS = 125;  // FC03 单帧上限
+    static constexpr int MAX_WRITE_WORDS = 123; // FC16 单帧上限
+
+    virtual ~AgeTransport() = default;
+
+    // 打开链路 (DLL: 加载并授权; RTU: 打开串口)，重复调用无副作用
+    virtual bool open() = 0;
+    virtual void close() = 0;
+    // 链路是否可用，autoConnect 为 true 时尝试自动连接
+    virtual bool isValid(bool autoConnect) = 0;
+    // 拔插或掉线后重建链路，已加载的库与授权应保留；默认实现为关闭后重新打开
+    virtual bool reconnect() { close(); return open() && isValid(true); }
+
+    virtual bool readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout) = 0;
+    virtual bool readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout) = 0;
+    virtual bool readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout) = 0;
+    virtual bool readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout) = 0;
+
+    virtual bool writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout) = 0;
+    virtual bool writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout) = 0;
+    virtual bool writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout) = 0;
+    virtual bool writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout) = 0;
+
+    virtual QString name() const = 0;
+    // 链路层统计，不支持时返回 false
+    virtual bool getBusInfo(AgeBusInfo &info) { Q_UNUSED(info); m_lastError = "Bus info not supported."; return false; }
+    // 主机侧串口参数 (parity 与 AgeCOMSetCOM 相同: 0 None, 1 Odd, 2 Even)，不支持时返回 false；
+    // 修改后立即生效，驱动器一侧的波特率见 AgeReg::ADDR_BUS_BAUD
+    virtual bool getSerialConfig(DWORD &baudRate, WORD &parity) { Q_UNUSED(baudRate); Q_UNUSED(parity); m_lastError = "Serial config not supported."; return false; }
+    virtual bool setSerialConfig(DWORD baudRate, WORD parity) { Q_UNUSED(baudRate); Q_UNUSED(parity); m_lastError = "Serial config not supported."; return false; }
+    QString lastError() const { return m_lastError; }
+    // 最近一次读写失败是否为从站应答了 Modbus 异常码 (链路正常，只是请求被拒绝)；
+    // 超时、校验错等为 false，无法区分的传输 (AgeCOM.dll) 总是 false
+    bool lastFailureWasException() const { return m_lastException; }
+
+    // 按环境变量创建默认传输:
+    // AGEMOTION_TRANSPORT = dll | rtu | replay (Windows 默认 dll，其他平台默认 rtu)
+    // AGEMOTION_PORT / AGEMOTION_BAUD 为 rtu 的串口名与波特率
+    // AGEMOTION_REPLAY_FILE / AGEMOTION_REPLAY_SPEED / AGEMOTION_REPLAY_LOOP 为 replay 的记录文件、倍速与循环
+    static QSharedPointer<AgeTransport> createDefault();
+
+protected:
+    QString m_lastError;
+    bool m_lastException = false;
+};
+
+#endif // AGETRANSPORT_H
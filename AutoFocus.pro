@@ -1,4 +1,4 @@
-QT       += core gui serialport
+QT       += core gui network serialport
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -9,15 +9,66 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    AgeBaudNegotiator.cpp \
+    AgeBusThread.cpp \
+    AgeComTransport.cpp \
+    AgeConnectionManager.cpp \
+    AgeDiscovery.cpp \
+    AgeInstrumentedTransport.cpp \
+    AgeMotionAsync.cpp \
     AgeMotionDriver.cpp \
+    AgeMotionGroup.cpp \
+    AgeMotionWaiter.cpp \
+    AgePollScheduler.cpp \
+    AgeReplayTransport.cpp \
+    AgeResilientTransport.cpp \
+    AgeRpcServer.cpp \
+    AgeRtuTransport.cpp \
+    AgeStripChart.cpp \
+    AgeTelemetryRecorder.cpp \
+    AgeTelemetryShm.cpp \
+    AgeTransport.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    AgeBaudNegotiator.h \
+    AgeBusThread.h \
+    AgeComTransport.h \
+    AgeConnectionManager.h \
+    AgeDiscovery.h \
+    AgeInstrumentedTransport.h \
+    AgeLatencyHistogram.h \
+    AgeMotionAsync.h \
     AgeMotionDriver.h \
+    AgeMotionGroup.h \
+    AgeMotionWaiter.h \
+    AgePollScheduler.h \
     AgeMotionForDriver/x64/AgeCOM.h \
+    AgeReplayTransport.h \
+    AgeResilientTransport.h \
+    AgeRpcProtocol.h \
+    AgeRpcServer.h \
+    AgeRtuFrame.h \
+    AgeRtuTransport.h \
+    AgeSeqLock.h \
+    AgeStripChart.h \
+    AgeTelemetryRecorder.h \
+    AgeTelemetryRing.h \
+    AgeTelemetryShm.h \
+    AgeTrace.h \
+    AgeTransport.h \
     mainwindow.h
 
+# 共享内存遥测 (AgeTelemetryShm): 旧版 glibc 的 shm_open 在 librt 中
+unix:!macx: LIBS += -lrt
+
+# 时间线追踪: qmake CONFIG+=trace 启用，默认不编译
+CONFIG(trace) {
+    DEFINES += AGE_TRACE_ENABLED
+    SOURCES += AgeTrace.cpp
+}
+
 FORMS += \
     mainwindow.ui
 
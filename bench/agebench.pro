@@ -0,0 +1,71 @@
+QT       = core network serialport
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = agebench
+
+INCLUDEPATH += .. ../sim
+
+# 共享内存遥测 (AgeTelemetryShm，经 AgeBusThread 引入): 旧版 glibc 的 shm_open 在 librt 中
+unix:!macx: LIBS += -lrt
+
+# 伪终端模式 (--transport pty) 仅 Linux / macOS
+unix {
+    DEFINES += AGEBENCH_HAVE_PTY
+    SOURCES += ../sim/AgeSimPty.cpp
+    HEADERS += ../sim/AgeSimPty.h
+}
+
+# 时间线追踪 (--trace): qmake CONFIG+=trace
+CONFIG(trace) {
+    DEFINES += AGE_TRACE_ENABLED
+    SOURCES += ../AgeTrace.cpp
+}
+
+SOURCES += \
+    ../AgeBusThread.cpp \
+    ../AgeComTransport.cpp \
+    ../AgeInstrumentedTransport.cpp \
+    ../AgeMotionDriver.cpp \
+    ../AgeMotionGroup.cpp \
+    ../AgeMotionWaiter.cpp \
+    ../AgePollScheduler.cpp \
+    ../AgeReplayTransport.cpp \
+    ../AgeResilientTransport.cpp \
+    ../AgeRpcClient.cpp \
+    ../AgeRpcServer.cpp \
+    ../AgeRtuTransport.cpp \
+    ../AgeTelemetryRecorder.cpp \
+    ../AgeTelemetryShm.cpp \
+    ../AgeTransport.cpp \
+    ../sim/AgeDriveSim.cpp \
+    ../sim/AgeSimTransport.cpp \
+    checks.cpp \
+    main.cpp
+
+HEADERS += \
+    ../AgeBusThread.h \
+    ../AgeComTransport.h \
+    ../AgeInstrumentedTransport.h \
+    ../AgeLatencyHistogram.h \
+    ../AgeMotionDriver.h \
+    ../AgeMotionGroup.h \
+    ../AgeMotionWaiter.h \
+    ../AgePollScheduler.h \
+    ../AgeReplayTransport.h \
+    ../AgeResilientTransport.h \
+    ../AgeRpcClient.h \
+    ../AgeRpcProtocol.h \
+    ../AgeRpcServer.h \
+    ../AgeRtuFrame.h \
+    ../AgeRtuTransport.h \
+    ../AgeSeqLock.h \
+    ../AgeTelemetryRecorder.h \
+    ../AgeTelemetryRing.h \
+    ../AgeTelemetryShm.h \
+    ../AgeTrace.h \
+    ../AgeTransport.h \
+    ../sim/AgeDriveSim.h \
+    ../sim/AgeSimTransport.h \
+    checks.h
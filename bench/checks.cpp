@@ -0,0 +1,1028 @@
+#include "checks.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSharedPointer>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "AgeBusThread.h"
+#include "AgeMotionDriver.h"
+#include "AgeMotionGroup.h"
+#include "AgePollScheduler.h"
+#include "AgeReplayTransport.h"
+#include "AgeResilientTransport.h"
+#include "AgeRpcClient.h"
+#include "AgeRpcServer.h"
+#include "AgeRtuFrame.h"
+#include "AgeTelemetryRing.h"
+#include "AgeTelemetryRecorder.h"
+#include "AgeTelemetryShm.h"
+#include "AgeDriveSim.h"
+#include "AgeSimTransport.h"
+
+namespace {
+
+constexpr double POS_TOLERANCE_UM = 0.5;   // 与 isMotionComplete 的到位阈值相同
+constexpr double MOVE_VELOCITY = 500.0;    // um/s，检查中的运动都在 1 s 内完成
+
+// 一项检查内的断言: 记录第一条失败的表达式与行号，后续断言照常执行
+class Check
+{
+public:
+    void expect(bool ok, const char *expr, int line)
+    {
+        if (ok || !m_failure.isEmpty()) return;
+        m_failure = QString("%1 (checks.cpp:%2)").arg(expr).arg(line);
+    }
+    bool passed() const { return m_failure.isEmpty(); }
+    const QString &failure() const { return m_failure; }
+
+private:
+    QString m_failure;
+};
+
+#define EXPECT(cond) c.expect((cond), #cond, __LINE__)
+
+bool near(double a, double b, double tolerance = POS_TOLERANCE_UM)
+{
+    return std::fabs(a - b) <= tolerance;
+}
+
+// 一条模拟总线 + 若干虚拟驱动器 (站号 1..n)，每项检查独立搭建，互不影响
+// 默认不模拟线路时间 (baudRate = 0)；驱动器按实际经过的单调时钟运动
+class SimRig
+{
+public:
+    explicit SimRig(int axes = 1, int baudRate = 0)
+    {
+        AgeSimTransport::Config config;
+        config.baudRate = baudRate;
+        AgeSimTransport *sim = new AgeSimTransport(config);
+        m_transport = QSharedPointer<AgeTransport>(sim);
+        for (int i = 0; i < axes; ++i) {
+            const quint8 station = (quint8)(AgeMotionDriver::DEFAULT_STATION_ID + i);
+            m_drives.emplace_back(new AgeDriveSim(station));
+            sim->addDrive(m_drives.back().get());
+            m_drivers.emplace_back(new AgeMotionDriver(m_transport, station));
+        }
+    }
+
+    bool connect()
+    {
+        for (auto &driver : m_drivers) {
+            if (!driver->connectDevice() || !driver->setEnable(true)) return false;
+        }
+        return true;
+    }
+
+    AgeDriveSim &drive(int axis = 0) { return *m_drives[axis]; }
+    AgeMotionDriver &driver(int axis = 0) { return *m_drivers[axis]; }
+
+private:
+    QSharedPointer<AgeTransport> m_transport;
+    std::vector<std::unique_ptr<AgeDriveSim>> m_drives;
+    std::vector<std::unique_ptr<AgeMotionDriver>> m_drivers;
+};
+
+// 总线线程 + 模拟总线: 命令经 AgeBusThread 排队执行，自适应超时/断路与轮询调度都在路径上
+// 虚拟驱动器只能在总线线程的 job 内访问 (inBus())
+class BusRig
+{
+public:
+    explicit BusRig(int axes = 1)
+        : m_sim(new AgeSimTransport(AgeSimTransport::Config()))
+    {
+        for (int i = 0; i < axes; ++i) {
+            m_drives.emplace_back(new AgeDriveSim((quint8)(AgeMotionDriver::DEFAULT_STATION_ID + i)));
+            m_sim->addDrive(m_drives.back().get());
+        }
+        m_bus.reset(new AgeBusThread(nullptr, QSharedPointer<AgeTransport>(m_sim)));
+        for (int i = 1; i < axes; ++i) m_bus->addAxis((quint8)(AgeMotionDriver::DEFAULT_STATION_ID + i));
+    }
+    ~BusRig() { m_bus->shutdown(); }
+
+    bool connect()
+    {
+        m_bus->start();
+        for (int i = 0; i < m_bus->axisCount(); ++i) {
+            if (!inBus([](AgeMotionDriver &d) { return d.connectDevice() && d.setEnable(true); }, i)) return false;
+        }
+        return true;
+    }
+
+    AgeBusThread &bus() { return *m_bus; }
+    AgeDriveSim &drive(int axis = 0) { return *m_drives[axis]; }
+
+    // 在总线线程执行 fn 并等待结果
+    template<typename Fn>
+    auto inBus(Fn fn, int axis = 0) -> decltype(fn(std::declval<AgeMotionDriver &>()))
+    {
+        return m_bus->submit(fn, AgeBusThread::Priority::Command, axis).get();
+    }
+
+    bool waitMotion(int axis, int timeoutMs = 3000)
+    {
+        return inBus([timeoutMs](AgeMotionDriver &d) { return d.waitForMotionComplete(timeoutMs); }, axis);
+    }
+
+    double position(int axis)
+    {
+        return inBus([](AgeMotionDriver &d) { double pos = 0.0; d.getPosition(pos); return pos; }, axis);
+    }
+
+private:
+    AgeSimTransport *m_sim;   // 由 m_bus 持有
+    std::vector<std::unique_ptr<AgeDriveSim>> m_drives;
+    std::unique_ptr<AgeBusThread> m_bus;
+};
+
+// 轮询 done 直到返回 true 或超时
+bool waitUntil(const std::function<bool()> &done, int timeoutMs)
+{
+    const qint64 deadline = AgeMotionDriver::monotonicUs() + (qint64)timeoutMs * 1000;
+    while (!done()) {
+        if (AgeMotionDriver::monotonicUs() > deadline) return false;
+        QThread::msleep(2);
+    }
+    return true;
+}
+
+// ==========================================
+//          RTU 帧
+// ==========================================
+
+void checkRtuFrames(Check &c)
+{
+    quint8 tx[AgeRtu::MAX_FRAME];
+    quint8 rx[AgeRtu::MAX_FRAME];
+    quint16 words[8] = {};
+    quint8 exception = 0;
+
+    // Modbus 规范中的示例帧: 01 03 0000 000A -> CRC C5 CD
+    int txLen = AgeRtu::encodeReadRequest(tx, 0x01, 0x0000, 10);
+    EXPECT(txLen == 8);
+    EXPECT(tx[6] == 0xC5 && tx[7] == 0xCD);
+    EXPECT(AgeRtu::checkCrc(tx, txLen));
+    EXPECT(AgeRtu::requestLength(tx, txLen) == txLen);
+
+    AgeDriveSim drive(1);
+
+    // FC16 写入目标位置，再用 FC03 读回
+    quint16 target[4];
+    AgeRtu::packU64((quint64)(qint64)-123456789, target);
+    txLen = AgeRtu::encodeWriteMultipleRequest(tx, 1, AgeReg::ADDR_POS_TARGET, target, 4);
+    EXPECT(AgeRtu::requestLength(tx, txLen) == txLen);
+    int rxLen = drive.handleRequest(tx, txLen, rx);
+    EXPECT(AgeRtu::decodeResponse(rx, rxLen, 1, AgeRtu::FC_WRITE_MULTIPLE, AgeReg::ADDR_POS_TARGET, 4, words)
+           == AgeRtu::DecodeStatus::Ok);
+
+    txLen = AgeRtu::encodeReadRequest(tx, 1, AgeReg::ADDR_POS_TARGET, 4);
+    rxLen = drive.handleRequest(tx, txLen, rx);
+    EXPECT(rxLen == 5 + 4 * 2);
+    EXPECT(AgeRtu::decodeResponse(rx, rxLen, 1, AgeRtu::FC_READ_HOLDING, AgeReg::ADDR_POS_TARGET, 4, words)
+           == AgeRtu::DecodeStatus::Ok);
+    EXPECT((qint64)AgeRtu::unpackU64(words) == -123456789);
+
+    // 应答分段到达、错误站号、CRC 损坏
+    EXPECT(AgeRtu::decodeResponse(rx, rxLen - 1, 1, AgeRtu::FC_READ_HOLDING, AgeReg::ADDR_POS_TARGET, 4, words)
+           == AgeRtu::DecodeStatus::Incomplete);
+    EXPECT(AgeRtu::decodeResponse(rx, rxLen, 2, AgeRtu::FC_READ_HOLDING, AgeReg::ADDR_POS_TARGET, 4, words)
+           == AgeRtu::DecodeStatus::Mismatch);
+    rx[3] ^= 0x01;
+    EXPECT(AgeRtu::decodeResponse(rx, rxLen, 1, AgeRtu::FC_READ_HOLDING, AgeReg::ADDR_POS_TARGET, 4, words)
+           == AgeRtu::DecodeStatus::CrcError);
+
+    // FC06 原样回显
+    txLen = AgeRtu::encodeWriteSingleRequest(tx, 1, AgeReg::ADDR_VEL_SET, 40);
+    rxLen = drive.handleRequest(tx, txLen, rx);
+    EXPECT(rxLen == txLen);
+    EXPECT(AgeRtu::decodeResponse(rx, rxLen, 1, AgeRtu::FC_WRITE_SINGLE, AgeReg::ADDR_VEL_SET, 1, words)
+           == AgeRtu::DecodeStatus::Ok);
+    EXPECT(drive.reg(AgeReg::ADDR_VEL_SET) == 40);
+
+    // 未定义的地址: 非法地址异常
+    txLen = AgeRtu::encodeReadRequest(tx, 1, 0x7000, 1);
+    rxLen = drive.handleRequest(tx, txLen, rx);
+    EXPECT(rxLen == AgeRtu::EXCEPTION_FRAME);
+    EXPECT(AgeRtu::decodeResponse(rx, rxLen, 1, AgeRtu::FC_READ_HOLDING, 0x7000, 1, words, &exception)
+           == AgeRtu::DecodeStatus::Exception);
+    EXPECT(exception == AgeRtu::EX_ILLEGAL_ADDRESS);
+
+    // 其他站号的请求不应答
+    txLen = AgeRtu::encodeReadRequest(tx, 2, AgeReg::ADDR_CONTROL, 1);
+    EXPECT(drive.handleRequest(tx, txLen, rx) == 0);
+}
+
+// ==========================================
+//          运动
+// ==========================================
+
+void checkMoveTo(Check &c)
+{
+    SimRig rig;
+    EXPECT(rig.connect());
+    AgeMotionDriver &d = rig.driver();
+    double pos = 0.0;
+
+    EXPECT(d.moveTo(50.0, MOVE_VELOCITY));
+    EXPECT(d.waitForMotionComplete(3000));
+    EXPECT(d.getPosition(pos) && near(pos, 50.0));
+    EXPECT(!rig.drive().isMoving());
+
+    EXPECT(d.setRelativePosition(-20.0));
+    EXPECT(d.waitForMotionComplete(3000));
+    EXPECT(d.getPosition(pos) && near(pos, 30.0));
+
+    bool done = false;
+    EXPECT(d.isMotionComplete(done) && done);
+}
+
+// 驱动器自行改写目标位置后 (其他主站、故障、驱动器侧回零)，重新下发相同目标必须真正发出
+void checkRetarget(Check &c)
+{
+    SimRig rig;
+    EXPECT(rig.connect());
+    AgeMotionDriver &d = rig.driver();
+    AgeDriveSim &sim = rig.drive();
+    double pos = 0.0;
+
+    EXPECT(d.moveTo(20.0, MOVE_VELOCITY) && d.waitForMotionComplete(3000));
+    quint16 words[4];
+    AgeRtu::packU64(0, words);
+    for (int i = 0; i < 4; ++i) sim.setReg((quint16)(AgeReg::ADDR_POS_TARGET + i), words[i]);
+    EXPECT(waitUntil([&]() { return d.getPosition(pos) && !sim.isMoving(); }, 3000)); // 模拟器随总线访问推进
+    EXPECT(near(pos, 0.0) && d.getTargetPosition(pos) && near(pos, 0.0));
+
+    EXPECT(d.moveTo(20.0, MOVE_VELOCITY));
+    EXPECT(sim.isMoving());
+    EXPECT(d.waitForMotionComplete(3000));
+    EXPECT(d.getPosition(pos) && near(pos, 20.0));
+}
+
+// 停止: 按加速度减速，驱动器把目标位置改写为停止点；急停: 立即停在当前位置
+void checkStop(Check &c)
+{
+    SimRig rig;
+    EXPECT(rig.connect());
+    AgeMotionDriver &d = rig.driver();
+    AgeDriveSim &sim = rig.drive();
+    double pos = 0.0, target = 0.0, later = 0.0;
+    bool done = false;
+
+    EXPECT(d.moveTo(2000.0, MOVE_VELOCITY));
+    QThread::msleep(150);
+    EXPECT(sim.isMoving());
+    EXPECT(d.getPosition(pos) && pos > 0.0);
+    EXPECT(d.stopMotion());
+    EXPECT(d.getTargetPosition(target) && target >= pos && target < 2000.0);
+    EXPECT(d.waitForMotionComplete(2000));
+    EXPECT(d.getPosition(pos) && near(pos, target));
+    EXPECT(pos < 200.0);
+
+    EXPECT(d.moveTo(-2000.0, MOVE_VELOCITY));
+    QThread::msleep(150);
+    EXPECT(sim.isMoving());
+    EXPECT(d.emergencyStop());
+    EXPECT(sim.velocityMmsPerSec() == 0.0);
+    EXPECT(d.getPosition(pos) && d.getTargetPosition(target) && near(pos, target));
+    EXPECT(d.isMotionComplete(done) && done);
+    QThread::msleep(50);
+    EXPECT(d.getPosition(later) && later == pos);
+}
+
+// 回零: 0x0400/0x0800 在到达参考点前保持为 1，完成后清零且该处记为 0；停止会中止回零
+void checkHoming(Check &c)
+{
+    SimRig rig;
+    AgeDriveSim &sim = rig.drive();
+    sim.setReference(std::llround(-5.0 * AgeMotionDriver::mmsPerUm()));
+    sim.setReg(AgeReg::ADDR_VEL_ZERO, 200);   // 约 125 um/s
+    EXPECT(rig.connect());
+    AgeMotionDriver &d = rig.driver();
+    double pos = 0.0;
+    bool done = false;
+
+    struct Pass { double startUm; bool toHigh; quint16 bit; };
+    const Pass passes[] = {{20.0, false, 0x0400}, {-20.0, true, 0x0800}};
+    for (const Pass &p : passes) {
+        EXPECT(d.moveTo(p.startUm, MOVE_VELOCITY) && d.waitForMotionComplete(3000));
+        EXPECT(d.findReference(p.toHigh));
+        EXPECT((sim.reg(AgeReg::ADDR_CONTROL) & 0x0C00) == p.bit);
+        EXPECT(d.isHomingComplete(done) && !done);
+        EXPECT(waitUntil([&d, &done]() { return d.isHomingComplete(done) && done; }, 3000));
+        EXPECT(d.getPosition(pos) && near(pos, 0.0));
+        EXPECT(d.getTargetPosition(pos) && near(pos, 0.0));
+    }
+
+    // 停止中止回零: 运行位清除，判定为完成，停在参考点之前
+    EXPECT(d.moveTo(40.0, MOVE_VELOCITY) && d.waitForMotionComplete(3000));
+    EXPECT(d.findReference(false));
+    QThread::msleep(50);
+    EXPECT(d.stopMotion());
+    EXPECT((sim.reg(AgeReg::ADDR_CONTROL) & 0x0C00) == 0);
+    EXPECT(d.isHomingComplete(done) && done);
+    EXPECT(d.waitForMotionComplete(2000));
+    EXPECT(d.getPosition(pos) && pos > 1.0);
+}
+
+// ==========================================
+//          多轴同步启动
+// ==========================================
+
+// 逐轴连写: 每个暂存轴都发出目标帧 (目标与上次相同也发出)，偏差只统计发出的帧；广播需显式启用
+void checkGroupStart(Check &c)
+{
+    BusRig rig(2);
+    EXPECT(rig.connect());
+    AgeMotionGroup group(&rig.bus());
+
+    group.stage(0, 20.0, MOVE_VELOCITY);
+    group.stage(1, -20.0, MOVE_VELOCITY);
+    AgeMotionGroup::StartReport r = group.start().get();
+    EXPECT(r.ok && !r.broadcast);
+    EXPECT(r.offsetsUs.size() == 2 && r.offsetsUs[0] == 0 && r.skewUs == r.offsetsUs[1] && r.skewUs >= 0);
+    EXPECT(rig.waitMotion(0) && rig.waitMotion(1));
+    EXPECT(near(rig.position(0), 20.0) && near(rig.position(1), -20.0));
+
+    // 驱动器自行改写目标 (如其他主站) 后，相同的暂存目标再次启动仍须运动
+    for (int axis = 0; axis < 2; ++axis) {
+        rig.inBus([&rig, axis](AgeMotionDriver &) {
+            quint16 words[4];
+            AgeRtu::packU64(0, words);
+            for (int i = 0; i < 4; ++i) rig.drive(axis).setReg((quint16)(AgeReg::ADDR_POS_TARGET + i), words[i]);
+            return true;
+        }, axis);
+        EXPECT(rig.waitMotion(axis) && near(rig.position(axis), 0.0));
+    }
+    r = group.start().get();
+    EXPECT(r.ok && r.offsetsUs.size() == 2);
+    EXPECT(rig.waitMotion(0) && rig.waitMotion(1));
+    EXPECT(near(rig.position(0), 20.0) && near(rig.position(1), -20.0));
+
+    // 目标相同: 未启用广播时仍逐轴写入；启用后一帧广播触发
+    group.stage(0, 5.0);
+    group.stage(1, 5.0);
+    r = group.start().get();
+    EXPECT(r.ok && !r.broadcast && r.offsetsUs.size() == 2);
+    EXPECT(rig.waitMotion(0) && rig.waitMotion(1));
+    group.setUseBroadcast(true);
+    group.stage(0, 10.0);
+    group.stage(1, 10.0);
+    r = group.start().get();
+    EXPECT(r.ok && r.broadcast && r.skewUs == 0);
+    EXPECT(rig.waitMotion(0) && rig.waitMotion(1));
+    EXPECT(near(rig.position(0), 10.0) && near(rig.position(1), 10.0));
+}
+
+// ==========================================
+//          总线队列
+// ==========================================
+
+// 让总线线程停在一个 job 中，期间排入的命令按队列规则等待；release() 之后依次执行
+class BusGate
+{
+public:
+    void hold(AgeBusThread &bus)
+    {
+        auto started = std::make_shared<std::promise<void>>();
+        std::shared_future<void> open = m_open.get_future().share();
+        bus.post([started, open](AgeMotionDriver &) {
+            started->set_value();
+            open.wait();
+        }, AgeBusThread::Priority::Control);
+        started->get_future().wait();
+    }
+    void release() { m_open.set_value(); }
+
+private:
+    std::promise<void> m_open;
+};
+
+// 出队顺序: 控制 > 运动命令 > 遥测，与入队先后无关
+void checkQueuePriority(Check &c)
+{
+    BusRig rig(2);
+    EXPECT(rig.connect());
+    std::vector<char> order;   // 只在总线线程写入，取走最后一个 job 的结果后读取
+    auto mark = [&order](char tag) { return [&order, tag](AgeMotionDriver &) { order.push_back(tag); }; };
+
+    BusGate gate;
+    gate.hold(rig.bus());
+    rig.bus().post(mark('T'), AgeBusThread::Priority::Telemetry, 0);
+    rig.bus().post(mark('A'), AgeBusThread::Priority::Command, 0);
+    rig.bus().post(mark('B'), AgeBusThread::Priority::Command, 1);
+    rig.bus().post(mark('C'), AgeBusThread::Priority::Control, 1);
+    // 同一轴同一优先级先进先出: 排在 T 之后，最后执行
+    std::future<bool> last = rig.bus().submit([](AgeMotionDriver &) { return true; },
+                                              AgeBusThread::Priority::Telemetry, 0);
+    gate.release();
+    EXPECT(last.get());
+    EXPECT(order.size() == 4);
+    if (order.size() == 4) {
+        EXPECT(order[0] == 'C' && order[3] == 'T');
+        EXPECT((order[1] == 'A' && order[2] == 'B') || (order[1] == 'B' && order[2] == 'A'));
+    }
+}
+
+// cancelCommands() 与急停入队只取消该轴排队的运动命令，之后入队的命令照常执行
+void checkCancelCommands(Check &c)
+{
+    BusRig rig(2);
+    EXPECT(rig.connect());
+    auto command = [&rig](int axis) {
+        return rig.bus().submit([](AgeMotionDriver &) {
+            BusResult<bool> r;
+            r.ok = r.value = true;
+            return r;
+        }, AgeBusThread::Priority::Command, axis);
+    };
+
+    BusGate gate;
+    gate.hold(rig.bus());
+    std::future<BusResult<bool>> a0 = command(0);
+    std::future<BusResult<bool>> b0 = command(1);
+    std::future<BusResult<bool>> a1 = command(0);
+    EXPECT(rig.bus().cancelCommands(0, "check stop") == 2);
+    EXPECT(rig.bus().cancelCommands(0) == 0);
+    rig.bus().post([](AgeMotionDriver &) {}, AgeBusThread::Priority::Emergency, 1);
+    std::future<BusResult<bool>> a2 = command(0);
+    std::future<BusResult<bool>> b1 = command(1);
+    gate.release();
+
+    BusResult<bool> r = a0.get();
+    EXPECT(!r.ok && r.error == "check stop");
+    r = a1.get();
+    EXPECT(!r.ok && r.error == "check stop");
+    r = b0.get();
+    EXPECT(!r.ok && !r.error.isEmpty());
+    r = a2.get();
+    EXPECT(r.ok && r.value);
+    r = b1.get();
+    EXPECT(r.ok && r.value);
+}
+
+// ==========================================
+//          本机 RPC
+// ==========================================
+
+// 总线线程 + AgeRpcServer (在自己的线程中运行事件循环)；每个请求由独立线程中的客户端同步发出
+class RpcRig
+{
+public:
+    RpcRig()
+        : m_name(QString("agebench-check-%1").arg(QCoreApplication::applicationPid()))
+        , m_server(new AgeRpcServer(&m_bus.bus()))
+    {
+        m_server->moveToThread(&m_thread);
+        m_thread.start();
+    }
+    ~RpcRig()
+    {
+        AgeRpcServer *server = m_server;
+        QMetaObject::invokeMethod(server, [server]() { delete server; }, Qt::BlockingQueuedConnection);
+        m_thread.quit();
+        m_thread.wait();
+    }
+
+    bool connect()
+    {
+        if (!m_bus.connect()) return false;
+        bool ok = false;
+        QMetaObject::invokeMethod(m_server, [this, &ok]() { ok = m_server->listen(m_name); },
+                                  Qt::BlockingQueuedConnection);
+        return ok;
+    }
+
+    BusRig &bus() { return m_bus; }
+
+    AgeRpcServer::Stats stats()
+    {
+        AgeRpcServer::Stats stats;
+        QMetaObject::invokeMethod(m_server, [this, &stats]() { stats = m_server->stats(); },
+                                  Qt::BlockingQueuedConnection);
+        return stats;
+    }
+
+    // 新建客户端发出一个请求，等到服务端处理 (排队、合并或取消) 之后返回；结果为该请求的应答状态
+    std::future<AgeRpc::Status> call(const std::function<bool(AgeRpcClient &)> &request)
+    {
+        const quint64 before = stats().requests;
+        const QString name = m_name;
+        std::future<AgeRpc::Status> result = std::async(std::launch::async, [name, request]() {
+            AgeRpcClient client;
+            if (!client.connectToServer(name)) return AgeRpc::FAILED;
+            request(client);
+            return client.lastStatus();
+        });
+        // HELLO + 请求
+        waitUntil([this, before]() { return stats().requests >= before + 2; }, 3000);
+        return result;
+    }
+
+private:
+    QString m_name;
+    BusRig m_bus;
+    QThread m_thread;
+    AgeRpcServer *m_server;
+};
+
+// 排队中的同类运动命令就地合并: MOVE 替换 (被替换的应答 SUPERSEDED)，MOVE_REL 累加 (共享结果)
+void checkRpcMerge(Check &c)
+{
+    RpcRig rig;
+    EXPECT(rig.connect());
+    BusGate gate;
+    gate.hold(rig.bus().bus());
+    std::future<AgeRpc::Status> first = rig.call([](AgeRpcClient &client) { return client.moveTo(20.0, MOVE_VELOCITY); });
+    std::future<AgeRpc::Status> second = rig.call([](AgeRpcClient &client) { return client.moveTo(30.0, MOVE_VELOCITY); });
+    EXPECT(first.get() == AgeRpc::SUPERSEDED);
+    AgeRpcServer::Stats stats = rig.stats();
+    EXPECT(stats.commandsPosted == 1 && stats.commandsMerged == 1);
+    gate.release();
+    EXPECT(second.get() == AgeRpc::OK);
+    EXPECT(rig.bus().waitMotion(0) && near(rig.bus().position(0), 30.0));
+
+    BusGate relative;
+    relative.hold(rig.bus().bus());
+    first = rig.call([](AgeRpcClient &client) { return client.moveRelative(5.0); });
+    second = rig.call([](AgeRpcClient &client) { return client.moveRelative(5.0); });
+    relative.release();
+    EXPECT(first.get() == AgeRpc::OK && second.get() == AgeRpc::OK);
+    EXPECT(rig.stats().commandsMerged == 2);
+    EXPECT(rig.bus().waitMotion(0) && near(rig.bus().position(0), 40.0));
+}
+
+// STOP 取消该轴尚未开始的运动命令 (应答 SUPERSEDED)，停止之后不再启动；之后的命令照常执行
+void checkRpcStopCancels(Check &c)
+{
+    RpcRig rig;
+    EXPECT(rig.connect());
+    BusGate gate;
+    gate.hold(rig.bus().bus());
+    std::future<AgeRpc::Status> move = rig.call([](AgeRpcClient &client) { return client.moveTo(100.0, MOVE_VELOCITY); });
+    std::future<AgeRpc::Status> stop = rig.call([](AgeRpcClient &client) { return client.stop(); });
+    EXPECT(move.get() == AgeRpc::SUPERSEDED);
+    gate.release();
+    EXPECT(stop.get() == AgeRpc::OK);
+    EXPECT(rig.bus().waitMotion(0) && near(rig.bus().position(0), 0.0));
+    EXPECT(!rig.bus().drive(0).isMoving());
+
+    move = rig.call([](AgeRpcClient &client) { return client.moveTo(10.0, MOVE_VELOCITY); });
+    EXPECT(move.get() == AgeRpc::OK);
+    EXPECT(rig.bus().waitMotion(0) && near(rig.bus().position(0), 10.0));
+}
+
+// ==========================================
+//          断路器
+// ==========================================
+
+// 连续无应答后断路、断路期间立即失败；停止照常发出并作为探测；异常应答不计入；probe() 恢复
+void checkBreaker(Check &c)
+{
+    AgeSimTransport *sim = new AgeSimTransport(AgeSimTransport::Config());
+    AgeDriveSim drive(AgeMotionDriver::DEFAULT_STATION_ID);
+    sim->addDrive(&drive);
+    AgeResilientTransport::Config config;
+    AgeResilientTransport link(QSharedPointer<AgeTransport>(sim), config);
+    const BYTE station = AgeMotionDriver::DEFAULT_STATION_ID;
+    WORD word = 0;
+    EXPECT(link.readWORD(station, AgeReg::ADDR_CONTROL, word, 0));
+
+    AgeDriveSim::Faults faults;
+    faults.dropRate = 1.0;
+    drive.setFaults(faults);
+    for (int i = 0; i < config.failureThreshold; ++i) {
+        EXPECT(!link.isOpen(station));
+        EXPECT(!link.readWORD(station, AgeReg::ADDR_CONTROL, word, 0));
+    }
+    EXPECT(link.isOpen(station));
+    AgeLinkState state = link.linkState(station);
+    EXPECT(state.trips == 1 && state.shortCircuited == 0);
+
+    // 驱动器已恢复，但探测间隔未到: 普通读仍立即失败
+    drive.setFaults(AgeDriveSim::Faults());
+    EXPECT(!link.readWORD(station, AgeReg::ADDR_CONTROL, word, 0));
+    EXPECT(link.linkState(station).shortCircuited == 1);
+    EXPECT(!link.probe());
+
+    // 停止不受断路限制，成功即恢复
+    EXPECT(link.writeWORD(station, AgeReg::ADDR_CONTROL, 0x1000, 0));
+    EXPECT(!link.isOpen(station));
+    EXPECT(link.linkState(station).shortCircuited == 1);
+
+    // 异常应答说明链路正常: 连续异常也不断路
+    faults = AgeDriveSim::Faults();
+    faults.exceptionRate = 1.0;
+    drive.setFaults(faults);
+    for (int i = 0; i < 2 * config.failureThreshold; ++i) {
+        EXPECT(!link.readWORD(station, AgeReg::ADDR_CONTROL, word, 0));
+    }
+    EXPECT(!link.isOpen(station) && link.linkState(station).trips == 1);
+
+    // 再次断路后由 probe() 在探测间隔到期时恢复
+    faults = AgeDriveSim::Faults();
+    faults.dropRate = 1.0;
+    drive.setFaults(faults);
+    for (int i = 0; i < config.failureThreshold; ++i) link.readWORD(station, AgeReg::ADDR_CONTROL, word, 0);
+    EXPECT(link.isOpen(station) && link.linkState(station).trips == 2);
+    drive.setFaults(AgeDriveSim::Faults());
+    QThread::msleep(config.probeIntervalMs + 20);
+    EXPECT(link.probe());
+    EXPECT(!link.isOpen(station));
+    EXPECT(link.readWORD(station, AgeReg::ADDR_CONTROL, word, 0));
+}
+
+// ==========================================
+//          轮询调度
+// ==========================================
+
+// 多轴运动中的轮询需求超过预算: 轮询占用的总线时间不超过 busBudget 比例 (加令牌桶容量与一次读取)，
+// 也不因推迟而明显低于预算
+void checkPollBudget(Check &c)
+{
+    const int axes = 4;
+    SimRig rig(axes, 115200);   // 驱动器默认波特率，按线路时间真实等待
+    EXPECT(rig.connect());
+    for (int axis = 0; axis < axes; ++axis) EXPECT(rig.driver(axis).moveTo(1000.0, MOVE_VELOCITY));
+
+    AgePollScheduler::Config config;
+    config.busBudget = 0.2;
+    AgePollScheduler scheduler;
+    scheduler.setConfig(config);
+    scheduler.setAxisCount(axes);
+    for (int axis = 0; axis < axes; ++axis) {
+        scheduler.setEnabled(axis, true);
+        scheduler.onCommand(axis, AgeMotionDriver::monotonicUs());
+    }
+
+    std::vector<DriveStatusSnapshot> snapshots(axes);
+    const qint64 beginUs = AgeMotionDriver::monotonicUs();
+    const qint64 endUs = beginUs + 500 * 1000;
+    qint64 busyUs = 0;
+    qint64 longestUs = 0;
+    int polls = 0;
+    bool ok = true;
+    for (qint64 now = beginUs; now < endUs; now = AgeMotionDriver::monotonicUs()) {
+        int axis = 0;
+        quint32 groups = 0;
+        if (!scheduler.takeDue(now, axis, groups)) {
+            const qint64 waitUs = qBound<qint64>(0, scheduler.nextDueUs() - now, 1000);
+            if (waitUs > 0) QThread::usleep((unsigned long)waitUs);
+            continue;
+        }
+        const qint64 startUs = AgeMotionDriver::monotonicUs();
+        ok = rig.driver(axis).readStatusSnapshot(snapshots[axis], groups) && ok;
+        const qint64 doneUs = AgeMotionDriver::monotonicUs();
+        scheduler.onPolled(axis, groups, snapshots[axis], startUs, doneUs);
+        busyUs += doneUs - startUs;
+        longestUs = qMax(longestUs, doneUs - startUs);
+        ++polls;
+    }
+    const qint64 elapsedUs = AgeMotionDriver::monotonicUs() - beginUs;
+    const double budgetUs = config.busBudget * elapsedUs;
+    EXPECT(ok && polls > axes);
+    EXPECT(busyUs <= budgetUs + config.burstMs * 1000 + longestUs);
+    EXPECT(busyUs >= budgetUs / 2);
+    for (int axis = 0; axis < axes; ++axis) EXPECT(scheduler.isMoving(axis, AgeMotionDriver::monotonicUs()));
+}
+
+// ==========================================
+//          遥测环形缓冲
+// ==========================================
+
+// 第 i 条样本: 各字段都由 i 推出，读到混合了两次写入的样本即可识别
+AgeTelemetrySample numberedSample(quint64 i)
+{
+    AgeTelemetrySample s;
+    s.timestampUs = (qint64)i;
+    s.positionUm = 2.0 * i;
+    s.targetUm = -1.0 * i;
+    s.velocityUmPerSec = 3.0 * i;
+    s.currentA = 0.5 * i;
+    s.errorCode = (quint16)i;
+    s.control = (quint16)(i >> 16);
+    s.axis = (quint8)(i & 0x03);
+    s.freshGroups = (quint8)(i >> 2);
+    return s;
+}
+
+bool isNumberedSample(const AgeTelemetrySample &s)
+{
+    const AgeTelemetrySample e = numberedSample((quint64)s.timestampUs);
+    return s.positionUm == e.positionUm && s.targetUm == e.targetUm && s.velocityUmPerSec == e.velocityUmPerSec
+           && s.currentA == e.currentA && s.errorCode == e.errorCode && s.control == e.control
+           && s.axis == e.axis && s.freshGroups == e.freshGroups;
+}
+
+// 读端落后超过容量: 跳到现存最旧的样本，丢失条数计入 overruns()
+void checkRingOverrun(Check &c)
+{
+    AgeTelemetryRing ring(64);
+    AgeTelemetryRing::Reader reader = ring.reader(true);
+    const int extra = 10;
+    for (int i = 0; i < ring.capacity() + extra; ++i) ring.push(numberedSample(i));
+
+    QVector<AgeTelemetrySample> out(ring.capacity() + extra);
+    EXPECT(ring.read(reader, out.data(), out.size()) == ring.capacity());
+    EXPECT(reader.overruns() == (quint64)extra);
+    EXPECT(reader.takeOverrun() && !reader.takeOverrun());
+    EXPECT(out[0].timestampUs == extra && out[ring.capacity() - 1].timestampUs == ring.capacity() + extra - 1);
+    EXPECT(reader.position() == ring.written());
+
+    // 从最新位置开始的读端只读之后写入的样本
+    AgeTelemetryRing::Reader late = ring.reader();
+    AgeTelemetrySample sample;
+    EXPECT(!ring.readOne(late, sample));
+    ring.push(numberedSample(ring.written()));
+    EXPECT(ring.readOne(late, sample) && sample.timestampUs == ring.capacity() + extra);
+    EXPECT(late.overruns() == 0);
+}
+
+// 写端全速绕回覆盖时，读端读到的每条样本都完整且按序；读到 + 丢失 = 写入
+void checkRingTornRead(Check &c)
+{
+    AgeTelemetryRing ring(16);
+    const quint64 total = 200000;
+    std::atomic<bool> done(false);
+    std::thread writer([&ring, &done, total]() {
+        for (quint64 i = 0; i < total; ++i) ring.push(numberedSample(i));
+        done.store(true);
+    });
+
+    AgeTelemetryRing::Reader reader = ring.reader(true);
+    AgeTelemetrySample out[8];
+    quint64 received = 0;
+    qint64 last = -1;
+    bool intact = true;
+    bool ordered = true;
+    for (;;) {
+        const bool finished = done.load();
+        int n;
+        while ((n = ring.read(reader, out, 8)) > 0) {
+            for (int i = 0; i < n; ++i) {
+                intact = intact && isNumberedSample(out[i]);
+                ordered = ordered && out[i].timestampUs > last;
+                last = out[i].timestampUs;
+            }
+            received += n;
+        }
+        if (finished) break;
+    }
+    writer.join();
+    EXPECT(intact);
+    EXPECT(ordered);
+    EXPECT(received > 0 && last == (qint64)total - 1);
+    EXPECT(received + reader.overruns() == total);
+}
+
+// ==========================================
+//          共享内存遥测
+// ==========================================
+
+QString shmCheckName()
+{
+    return QString("agebench-check-%1").arg(QCoreApplication::applicationPid());
+}
+
+// 读端溢出计数与环形缓冲相同；每轴最新样本；同名段的发布进程仍在运行时不能再创建
+void checkShmOverrun(Check &c)
+{
+    const int axes = 4;
+    AgeTelemetryPublisher publisher;
+    EXPECT(publisher.create(shmCheckName(), axes, 64));
+    AgeTelemetryPublisher second;
+    EXPECT(!second.create(shmCheckName(), axes, 64));
+    AgeTelemetrySubscriber subscriber;
+    EXPECT(subscriber.attach(shmCheckName()));
+    EXPECT(subscriber.axisCount() == axes);
+
+    AgeTelemetrySample sample;
+    EXPECT(!subscriber.latest(0, sample));
+    AgeTelemetrySubscriber::Cursor cursor = subscriber.cursor(true);
+    const int capacity = 64;
+    const int extra = 10;
+    for (int i = 0; i < capacity + extra; ++i) publisher.publish(numberedSample(i));
+
+    QVector<AgeTelemetrySample> out(capacity + extra);
+    EXPECT(subscriber.read(cursor, out.data(), out.size()) == capacity);
+    EXPECT(cursor.overruns() == (quint64)extra);
+    EXPECT(out[0].timestampUs == extra && isNumberedSample(out[capacity - 1]));
+    EXPECT(cursor.position() == publisher.published());
+
+    quint64 version = 0;
+    for (int axis = 0; axis < axes; ++axis) {
+        EXPECT(subscriber.latest(axis, sample, &version));
+        EXPECT(sample.axis == axis && isNumberedSample(sample));
+        EXPECT(sample.timestampUs >= capacity + extra - axes);
+        EXPECT(version == (quint64)(capacity + extra) / axes + (axis < (capacity + extra) % axes ? 1 : 0));
+    }
+    subscriber.detach();
+    publisher.close();
+}
+
+// 发布端全速写入时，最新样本与环形缓冲的读取都不会读到不完整的样本
+void checkShmTornRead(Check &c)
+{
+    const int axes = 4;
+    AgeTelemetryPublisher publisher;
+    EXPECT(publisher.create(shmCheckName(), axes, 16));
+    AgeTelemetrySubscriber subscriber;
+    EXPECT(subscriber.attach(shmCheckName()));
+    if (!publisher.isOpen() || !subscriber.isAttached()) return;
+
+    const quint64 total = 200000;
+    std::atomic<bool> done(false);
+    std::thread writer([&publisher, &done, total]() {
+        for (quint64 i = 0; i < total; ++i) publisher.publish(numberedSample(i));
+        done.store(true);
+    });
+
+    AgeTelemetrySubscriber::Cursor cursor = subscriber.cursor(true);
+    AgeTelemetrySample out[8];
+    quint64 received = 0;
+    quint64 versions[axes] = {};
+    qint64 last = -1;
+    bool intact = true;
+    bool ordered = true;
+    for (;;) {
+        const bool finished = done.load();
+        for (int axis = 0; axis < axes; ++axis) {
+            AgeTelemetrySample sample;
+            quint64 version = 0;
+            if (!subscriber.latest(axis, sample, &version)) continue;
+            intact = intact && sample.axis == axis && isNumberedSample(sample);
+            ordered = ordered && version >= versions[axis];
+            versions[axis] = version;
+        }
+        int n;
+        while ((n = subscriber.read(cursor, out, 8)) > 0) {
+            for (int i = 0; i < n; ++i) {
+                intact = intact && isNumberedSample(out[i]);
+                ordered = ordered && out[i].timestampUs > last;
+                last = out[i].timestampUs;
+            }
+            received += n;
+        }
+        if (finished) break;
+    }
+    writer.join();
+    EXPECT(intact);
+    EXPECT(ordered);
+    EXPECT(received > 0 && last == (qint64)total - 1);
+    EXPECT(received + cursor.overruns() == total);
+    subscriber.detach();
+    publisher.close();
+}
+
+// ==========================================
+//          记录 / 回放
+// ==========================================
+
+QString recordingPath(const char *name)
+{
+    return QDir::tempPath() + QString("/agebench-%1-%2.agetrace").arg(name).arg(QCoreApplication::applicationPid());
+}
+
+// 两轴反向运动 (轴 0 -> 30 um，轴 1 -> -30 um)，交替采样写入记录文件；samples 为写入的样本
+void recordSession(Check &c, const QString &path, QVector<AgeTelemetrySample> &samples)
+{
+    SimRig rig(2);
+    EXPECT(rig.connect());
+    AgeTelemetryRecorder recorder;
+    EXPECT(recorder.open(path, 4 * 1024 * 1024));
+
+    auto sample = [&](int axis) {
+        DriveStatusSnapshot snap;
+        if (!rig.driver(axis).readStatusSnapshot(snap)) return false;
+        const AgeTelemetrySample s = AgeTelemetrySample::fromSnapshot(axis, snap);
+        samples.append(s);
+        return recorder.append(s);
+    };
+    EXPECT(rig.driver(0).moveTo(30.0, MOVE_VELOCITY));
+    EXPECT(rig.driver(1).moveTo(-30.0, MOVE_VELOCITY));
+    EXPECT(waitUntil([&]() {
+        const bool ok = sample(0) && sample(1);
+        return !ok || (!rig.drive(0).isMoving() && !rig.drive(1).isMoving());
+    }, 3000));
+    EXPECT(sample(0) && sample(1));
+    EXPECT(recorder.recorded() == (quint64)samples.size() && recorder.dropped() == 0);
+    recorder.close();
+    EXPECT(samples.size() > 4);
+}
+
+// 记录 -> 读回: 时间戳与状态字原样，物理量按记录精度 (nm)
+void checkRecord(Check &c)
+{
+    const QString path = recordingPath("record");
+    QVector<AgeTelemetrySample> samples;
+    recordSession(c, path, samples);
+
+    AgeTelemetryFileReader reader;
+    EXPECT(reader.open(path));
+    EXPECT(reader.isComplete());
+    EXPECT(reader.sampleCount() == samples.size());
+    QVector<AgeTelemetrySample> back(samples.size());
+    EXPECT(reader.read(0, back.data(), back.size()) == samples.size());
+    for (int i = 0; i < samples.size() && i < back.size(); ++i) {
+        const AgeTelemetrySample &a = samples[i];
+        const AgeTelemetrySample &b = back[i];
+        EXPECT(a.timestampUs == b.timestampUs && a.axis == b.axis && a.control == b.control
+               && a.freshGroups == b.freshGroups);
+        EXPECT(near(a.positionUm, b.positionUm, 1e-3) && near(a.targetUm, b.targetUm, 1e-3));
+    }
+    QFile::remove(path);
+}
+
+// 记录 -> 逐条回放 (speed = 0: 每次位置读取前进一条)
+void checkReplay(Check &c)
+{
+    const QString path = recordingPath("replay");
+    QVector<AgeTelemetrySample> samples;
+    recordSession(c, path, samples);
+    if (samples.size() <= 4) {
+        QFile::remove(path);
+        return;
+    }
+
+    AgeReplayTransport::Config config;
+    config.path = path;
+    config.speed = 0.0;
+    config.firstStation = AgeMotionDriver::DEFAULT_STATION_ID;
+    AgeReplayTransport *replay = new AgeReplayTransport(config);
+    QSharedPointer<AgeTransport> transport(replay);
+    AgeMotionDriver d0(transport, config.firstStation);
+    AgeMotionDriver d1(transport, (quint8)(config.firstStation + 1));
+    double pos = 0.0;
+
+    // 打开时各轴已写入各自的第一条样本: 轴 1 在回放到它之前即可连接、读到记录中的状态
+    EXPECT(d0.connectDevice());
+    EXPECT(d1.connectDevice());
+    int firstOfAxis1 = 0;
+    while (firstOfAxis1 < samples.size() && samples[firstOfAxis1].axis != 1) ++firstOfAxis1;
+    EXPECT(firstOfAxis1 < samples.size());
+    EXPECT(d1.getTargetPosition(pos) && near(pos, samples[firstOfAxis1].targetUm, 1e-3));
+
+    double last[2] = {samples[0].positionUm, samples[1].positionUm};
+    for (int i = 1; i < samples.size(); ++i) {
+        EXPECT(d0.getPosition(pos));
+        last[samples[i].axis] = samples[i].positionUm;
+        if (samples[i].axis == 0) EXPECT(near(pos, samples[i].positionUm, 1e-3));
+    }
+    EXPECT(replay->atEnd());
+    EXPECT(d0.getPosition(pos) && near(pos, last[0], 1e-3));
+    EXPECT(d1.getPosition(pos) && near(pos, last[1], 1e-3));
+    EXPECT(near(last[0], 30.0) && near(last[1], -30.0));
+    transport->close();
+    QFile::remove(path);
+}
+
+} // namespace
+
+int runBehaviourChecks()
+{
+    struct Entry { const char *name; void (*run)(Check &); };
+    const Entry checks[] = {
+        {"rtu.frames", checkRtuFrames},
+        {"motion.moveTo", checkMoveTo},
+        {"motion.retarget", checkRetarget},
+        {"motion.stop", checkStop},
+        {"motion.homing", checkHoming},
+        {"group.start", checkGroupStart},
+        {"bus.queuePriority", checkQueuePriority},
+        {"bus.cancelCommands", checkCancelCommands},
+        {"rpc.merge", checkRpcMerge},
+        {"rpc.stopCancels", checkRpcStopCancels},
+        {"link.breaker", checkBreaker},
+        {"poll.budget", checkPollBudget},
+        {"ring.overrun", checkRingOverrun},
+        {"ring.tornRead", checkRingTornRead},
+        {"shm.overrun", checkShmOverrun},
+        {"shm.tornRead", checkShmTornRead},
+        {"telemetry.record", checkRecord},
+        {"telemetry.replay", checkReplay},
+    };
+
+    QTextStream err(stderr);
+    int failures = 0;
+    for (const Entry &e : checks) {
+        Check c;
+        e.run(c);
+        if (c.passed()) {
+            err << "PASS " << e.name << "\n";
+        } else {
+            err << "FAIL " << e.name << ": " << c.failure() << "\n";
+            ++failures;
+        }
+        err.flush();
+    }
+    err << (failures ? QString("%1 check(s) failed\n").arg(failures) : QString("all checks passed\n"));
+    return failures;
+}
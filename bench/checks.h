@@ -0,0 +1,20 @@
+#ifndef AGEBENCH_CHECKS_H
+#define AGEBENCH_CHECKS_H
+
+// ==========================================
+//   agebench --check: 驱动层行为检查 (虚拟驱动器，无需硬件，供 CI 回归)
+// ==========================================
+// - RTU 帧编码/解码/CRC 往返 (经 AgeDriveSim::handleRequest)
+// - moveTo 到位、停止/急停语义、0x0400/0x0800 回零完成判定
+// - 总线队列按优先级出队，停止/急停取消该轴排队的运动命令
+// - 本机 RPC: 排队命令合并、STOP 取消尚未开始的运动命令
+// - 断路器: 连续无应答断路、停止照常发出、异常应答不计入、探测恢复
+// - 轮询调度: 多轴运动时轮询占用的总线时间受预算约束
+// - 遥测环形缓冲: 读端溢出计数、写端并发绕回时不读到不完整的样本
+// - 共享内存遥测: 同上，另含每轴最新样本与同名段的重复发布
+// - 遥测记录 -> 文件读取往返
+// - 遥测记录 -> AgeReplayTransport 逐条回放
+// 每项检查在 stderr 输出 PASS/FAIL，返回失败的检查数 (0 = 全部通过)
+int runBehaviourChecks();
+
+#endif // AGEBENCH_CHECKS_H
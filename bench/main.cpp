@@ -0,0 +1,403 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QThread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "AgeMotionDriver.h"
+#include "AgeLatencyHistogram.h"
+#include "AgeDriveSim.h"
+#include "AgeSimTransport.h"
+#include "AgeTrace.h"
+#include "checks.h"
+#ifdef AGEBENCH_HAVE_PTY
+#include "AgeRtuTransport.h"
+#include "AgeSimPty.h"
+#endif
+
+// ==========================================
+//   agebench: AgeMotionDriver 吞吐与延迟基准 (虚拟驱动器，无需硬件)
+// ==========================================
+// 用法示例:
+//   agebench                                   进程内模拟，不模拟线路时间 (主机侧开销)
+//   agebench --baud 115200 --latency-us 300    进程内模拟，按线路时间与应答延迟等待
+//   agebench --transport pty --baud 115200     经伪终端 + AgeRtuTransport (含串口栈)
+//   agebench --filter 'sweep|status' --output result.json --label v1.2.0
+//   agebench --check                           行为检查 (见 checks.h)，有失败时退出码非 0，供 CI 使用
+// 结果为 JSON (stdout 或 --output)，人类可读的汇总输出到 stderr
+
+namespace {
+
+struct Result {
+    QString name;
+    int iterations = 0;
+    int errors = 0;
+    qint64 totalUs = 0;
+    AgeLatencyHistogram latency;
+};
+
+class Bench
+{
+public:
+    Bench(int iterations, const QRegularExpression &filter)
+        : m_iterations(iterations), m_filter(filter) {}
+
+    bool enabled(const QString &name) const { return m_filter.match(name).hasMatch(); }
+
+    // 运行 n 次 op，记录每次耗时；after 在每次之后执行但不计时 (恢复状态等)
+    void run(const QString &name, int n, const std::function<bool(int)> &op,
+             const std::function<void()> &after = std::function<void()>())
+    {
+        if (!enabled(name)) return;
+
+        std::unique_ptr<Result> r(new Result());
+        r->name = name;
+        for (int i = 0; i < n; ++i) {
+            const qint64 t0 = AgeMotionDriver::monotonicUs();
+            const bool ok = op(i);
+            const qint64 dt = AgeMotionDriver::monotonicUs() - t0;
+            r->latency.record(dt);
+            r->totalUs += dt;
+            ++r->iterations;
+            if (!ok) ++r->errors;
+            if (after) after();
+        }
+        m_results.emplace_back(std::move(r));
+    }
+
+    void run(const QString &name, const std::function<bool(int)> &op,
+             const std::function<void()> &after = std::function<void()>())
+    {
+        run(name, m_iterations, op, after);
+    }
+
+    // 由场景自行采集的分段耗时 (如扫描中的单步)
+    void add(const QString &name, const AgeLatencyHistogram &latency, int errors)
+    {
+        if (!enabled(name) || latency.count() == 0) return;
+        std::unique_ptr<Result> r(new Result());
+        r->name = name;
+        r->latency = latency;
+        r->iterations = (int)latency.count();
+        r->errors = errors;
+        r->totalUs = (qint64)(latency.mean() * latency.count());
+        m_results.emplace_back(std::move(r));
+    }
+
+    int iterations() const { return m_iterations; }
+    const std::vector<std::unique_ptr<Result>> &results() const { return m_results; }
+
+private:
+    int m_iterations;
+    QRegularExpression m_filter;
+    std::vector<std::unique_ptr<Result>> m_results;
+};
+
+// 运动类命令之后停下并等待静止，保证后续基准从静止状态开始
+void settle(AgeMotionDriver &driver)
+{
+    driver.stopMotion();
+    driver.waitForMotionComplete(2000);
+}
+
+// ==========================================
+//          单个驱动接口
+// ==========================================
+
+void runMethodBenches(Bench &b, AgeMotionDriver &d)
+{
+    double dv = 0.0;
+    int iv = 0;
+    unsigned int uv = 0;
+    bool f1 = false, f2 = false;
+    DriveStatusSnapshot snap;
+    AgeMotionWaiter::Profile profile;
+    const auto stop = [&d]() { settle(d); };
+
+    // --- 读取 ---
+    b.run("getPosition", [&](int) { return d.getPosition(dv); });
+    b.run("getTargetPosition", [&](int) { return d.getTargetPosition(dv); });
+    b.run("getTargetRPM", [&](int) { return d.getTargetRPM(dv); });
+    b.run("getTargetVelocity", [&](int) { return d.getTargetVelocity(dv); });
+    b.run("getVelocity", [&](int) { return d.getVelocity(dv); });
+    b.run("checkError", [&](int) { return d.checkError() >= 0; });
+    b.run("isMotionComplete", [&](int) { return d.isMotionComplete(f1); });
+    b.run("isHomingComplete", [&](int) { return d.isHomingComplete(f1); });
+    b.run("isLimitSensorTriggered", [&](int) { return d.isLimitSensorTriggered(f1, f2); });
+    b.run("getPulsePosition", [&](int) { return d.getPulsePosition(iv); });
+    b.run("getRealTimeCurrent", [&](int) { return d.getRealTimeCurrent(dv); });
+    b.run("getCpuTemperature", [&](int) { return d.getCpuTemperature(iv); });
+    b.run("getSingleToothResolution", [&](int) { return d.getSingleToothResolution(uv); });
+    b.run("getPulseStepLength", [&](int) { return d.getPulseStepLength(uv); });
+    b.run("getMinStepUm", [&](int) { return d.getMinStepUm(dv); });
+    b.run("getMotionProfile", [&](int) { return d.getMotionProfile(profile); });
+    b.run("readStatusSnapshot.all", [&](int) { return d.readStatusSnapshot(snap); });
+    b.run("readStatusSnapshot.position", [&](int) {
+        return d.readStatusSnapshot(snap, DriveStatusSnapshot::GroupPosition);
+    });
+
+    // --- 参数写入: 交替两个值测实际写入，固定值测影子省略 ---
+    b.run("setTargetRPM", [&](int i) { return d.setTargetRPM(i & 1 ? 60.0 : 61.0); });
+    b.run("setTargetVelocity", [&](int i) { return d.setTargetVelocity(i & 1 ? 1000.0 : 1001.0); });
+    b.run("setTargetVelocity.elided", [&](int) { return d.setTargetVelocity(1000.0); });
+    b.run("setPulseStepLength", [&](int i) { return d.setPulseStepLength(i & 1 ? 3840 : 3841); });
+    b.run("setMinStepUm", [&](int i) { return d.setMinStepUm(i & 1 ? 0.05 : 0.06); });
+    b.run("setEnable", [&](int) { return d.setEnable(true); });
+
+    // --- 运动命令: 每次之后停下，不计入命令耗时 ---
+    b.run("setTargetPosition", [&](int i) { return d.setTargetPosition(i & 1 ? 5.0 : -5.0); }, stop);
+    b.run("setRelativePosition", [&](int i) { return d.setRelativePosition(i & 1 ? 1.0 : -1.0); }, stop);
+    b.run("moveTo", [&](int i) { return d.moveTo(i & 1 ? 5.0 : -5.0, i & 2 ? 1000.0 : 2000.0); }, stop);
+    b.run("moveTo.sameVelocity", [&](int i) { return d.moveTo(i & 1 ? 5.0 : -5.0, 1000.0); }, stop);
+    b.run("setTargetPulsePosition", [&](int i) { return d.setTargetPulsePosition(i & 1 ? 100 : -100); }, stop);
+    b.run("setVelocity", [&](int i) { return d.setVelocity(i & 1 ? 500.0 : -500.0); }, stop);
+    b.run("stopMotion", [&](int) { return d.stopMotion(); });
+    b.run("emergencyStop", [&](int) { return d.emergencyStop(); }, [&d]() { d.setEnable(true); });
+    b.run("moveToLimit", [&](int i) { return d.moveToLimit(i & 1); }, stop);
+    b.run("findReference", [&](int i) { return d.findReference(i & 1); }, stop);
+    b.run("setCurrPositionToZero", [&](int) { return d.setCurrPositionToZero(); });
+    b.run("broadcastStop", [&](int) { return d.broadcastStop(); });
+    b.run("connectDevice", [&](int) { return d.connectDevice(); });
+}
+
+// ==========================================
+//          组合场景
+// ==========================================
+
+void runScenarioBenches(Bench &b, AgeMotionDriver &d)
+{
+    double dv = 0.0;
+    int iv = 0;
+    bool f1 = false;
+    DriveStatusSnapshot snap;
+
+    // 界面刷新一次所需的总线访问: 当前实现 (块读取快照) 与逐项读取对比
+    b.run("scenario.updateStatus", [&](int) { return d.readStatusSnapshot(snap); });
+    b.run("scenario.updateStatus.perField", [&](int) {
+        bool ok = d.getPosition(dv);
+        ok &= d.getPulsePosition(iv);
+        ok &= d.getTargetRPM(dv);
+        ok &= d.getVelocity(dv);
+        ok &= d.getRealTimeCurrent(dv);
+        ok &= d.getCpuTemperature(iv);
+        ok &= d.isMotionComplete(f1);
+        ok &= d.checkError() >= 0;
+        return ok;
+    });
+
+    // 100 步相对运动对焦扫描: 每步相对运动 + 等待到位；单步耗时另行统计
+    std::unique_ptr<AgeLatencyHistogram> steps(new AgeLatencyHistogram());
+    int stepErrors = 0;
+    const int sweeps = qMax(3, b.iterations() / 50);
+    d.setTargetVelocity(1000.0);
+    b.run("scenario.focusSweep100", sweeps, [&](int) {
+        bool ok = true;
+        for (int s = 0; s < 100 && ok; ++s) {
+            AGE_TRACE_SCOPE_ARG("focus", "sweepStep", s);
+            const qint64 t0 = AgeMotionDriver::monotonicUs();
+            ok = d.setRelativePosition(1.0) && d.waitForMotionComplete(2000);
+            steps->record(AgeMotionDriver::monotonicUs() - t0);
+            if (!ok) ++stepErrors;
+        }
+        return ok;
+    }, [&d]() { d.setTargetPosition(0.0); d.waitForMotionComplete(5000); });
+    b.add("scenario.focusSweepStep", *steps, stepErrors);
+
+    // 点动启动与停止: 启动命令 + 运行 20ms + 停止命令 + 等待停稳
+    b.run("scenario.jogStartStop", qMax(5, b.iterations() / 10), [&](int i) {
+        bool ok = d.setVelocity(i & 1 ? 500.0 : -500.0);
+        QThread::msleep(20);
+        ok &= d.stopMotion();
+        ok &= d.waitForMotionComplete(2000);
+        return ok;
+    });
+}
+
+QJsonObject toJson(const Result &r)
+{
+    QJsonObject o;
+    o["name"] = r.name;
+    o["iterations"] = r.iterations;
+    o["errors"] = r.errors;
+    o["opsPerSec"] = r.totalUs > 0 ? r.iterations * 1e6 / r.totalUs : 0.0;
+    o["meanUs"] = r.latency.mean();
+    o["minUs"] = r.latency.min();
+    o["p50Us"] = r.latency.percentile(0.50);
+    o["p90Us"] = r.latency.percentile(0.90);
+    o["p99Us"] = r.latency.percentile(0.99);
+    o["maxUs"] = r.latency.max();
+    return o;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("agebench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Throughput/latency benchmark of AgeMotionDriver against a virtual ASD90XX.");
+    parser.addHelpOption();
+
+    QCommandLineOption transportOpt("transport", "sim (in-process) or pty (AgeRtuTransport over a pseudo terminal).", "kind", "sim");
+    QCommandLineOption baudOpt("baud", "Emulated baud rate (0 = no wire time, sim only).", "baud", "0");
+    QCommandLineOption latencyOpt("latency-us", "Fixed drive response latency.", "us", "0");
+    QCommandLineOption jitterOpt("jitter-us", "Random extra latency 0..N.", "us", "0");
+    QCommandLineOption dropOpt("drop-rate", "Probability of an unanswered request.", "p", "0");
+    QCommandLineOption iterOpt("iterations", "Iterations per single-method benchmark.", "n", "200");
+    QCommandLineOption filterOpt("filter", "Only run benchmarks whose name matches this regex.", "regex", ".*");
+    QCommandLineOption outputOpt("output", "Write JSON results to this file instead of stdout.", "file");
+    QCommandLineOption labelOpt("label", "Free-form label stored in the results (release, commit).", "text");
+    QCommandLineOption verboseOpt("verbose", "Keep driver debug output.");
+    QCommandLineOption checkOpt("check", "Run behaviour checks against the simulator instead of benchmarks; non-zero exit on failure.");
+    parser.addOptions({transportOpt, baudOpt, latencyOpt, jitterOpt, dropOpt, iterOpt,
+                       filterOpt, outputOpt, labelOpt, verboseOpt, checkOpt});
+#ifdef AGE_TRACE_ENABLED
+    QCommandLineOption traceOpt("trace", "Write a Chrome trace (chrome://tracing, ui.perfetto.dev) to this file.", "file");
+    parser.addOption(traceOpt);
+#endif
+    parser.process(app);
+
+    if (!parser.isSet(verboseOpt)) QLoggingCategory::setFilterRules("*.debug=false");
+    if (parser.isSet(checkOpt)) return runBehaviourChecks() == 0 ? 0 : 1;
+
+    const QString kind = parser.value(transportOpt);
+    const int baud = parser.value(baudOpt).toInt();
+    const int iterations = qMax(1, parser.value(iterOpt).toInt());
+    const QRegularExpression filter(parser.value(filterOpt));
+    if (!filter.isValid()) {
+        qCritical() << "Invalid --filter:" << filter.errorString();
+        return 1;
+    }
+
+    AgeDriveSim::Faults faults;
+    faults.latencyUs = parser.value(latencyOpt).toInt();
+    faults.jitterUs = parser.value(jitterOpt).toInt();
+    faults.dropRate = parser.value(dropOpt).toDouble();
+    AgeDriveSim drive(AgeMotionDriver::DEFAULT_STATION_ID);
+    drive.setFaults(faults);
+
+    // --- 传输 ---
+    QSharedPointer<AgeTransport> transport;
+#ifdef AGEBENCH_HAVE_PTY
+    std::unique_ptr<AgeSimPty> pty;
+    std::atomic<bool> stopPty(false);
+    std::thread ptyThread;
+#endif
+    if (kind == "sim") {
+        AgeSimTransport::Config config;
+        config.baudRate = baud;
+        AgeSimTransport *sim = new AgeSimTransport(config);
+        sim->addDrive(&drive);
+        transport = QSharedPointer<AgeTransport>(sim);
+    } else if (kind == "pty") {
+#ifdef AGEBENCH_HAVE_PTY
+        AgeSimPty::Config ptyConfig;
+        ptyConfig.baudRate = baud;
+        pty.reset(new AgeSimPty(ptyConfig));
+        pty->addDrive(&drive);
+        if (!pty->open()) {
+            qCritical() << pty->lastError();
+            return 1;
+        }
+        ptyThread = std::thread([&pty, &stopPty]() { pty->serve(stopPty); });
+        AgeRtuTransport::Config rtuConfig;
+        rtuConfig.portName = pty->slavePath();
+        if (baud > 0) rtuConfig.baudRate = baud;
+        transport = QSharedPointer<AgeTransport>(new AgeRtuTransport(rtuConfig));
+#else
+        qCritical() << "--transport pty requires a POSIX pseudo terminal.";
+        return 1;
+#endif
+    } else {
+        qCritical() << "Unknown --transport" << kind;
+        return 1;
+    }
+
+    int rc = 0;
+    QJsonArray results;
+    {
+        AgeMotionDriver driver(transport);
+        if (!driver.connectDevice()) {
+            qCritical() << "connectDevice failed:" << driver.getLastError();
+            rc = 1;
+        } else {
+            driver.setEnable(true);
+            Bench bench(iterations, filter);
+            runMethodBenches(bench, driver);
+            runScenarioBenches(bench, driver);
+
+            QTextStream err(stderr);
+            err << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                       .arg("benchmark", -32).arg("n", 6).arg("err", 5).arg("ops/s", 10)
+                       .arg("p50(us)", 9).arg("p99(us)", 9).arg("max(us)", 9);
+            for (const auto &r : bench.results()) {
+                const QJsonObject o = toJson(*r);
+                results.append(o);
+                err << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                           .arg(r->name, -32).arg(r->iterations, 6).arg(r->errors, 5)
+                           .arg(o["opsPerSec"].toDouble(), 10, 'f', 1)
+                           .arg(r->latency.percentile(0.50), 9).arg(r->latency.percentile(0.99), 9)
+                           .arg(r->latency.max(), 9);
+            }
+        }
+    }
+
+#ifdef AGEBENCH_HAVE_PTY
+    if (ptyThread.joinable()) {
+        stopPty.store(true);
+        ptyThread.join();
+    }
+#endif
+    if (rc != 0) return rc;
+
+    // --- 结果 (JSON) ---
+    QJsonObject config;
+    config["transport"] = kind;
+    config["baud"] = baud;
+    config["latencyUs"] = faults.latencyUs;
+    config["jitterUs"] = faults.jitterUs;
+    config["dropRate"] = faults.dropRate;
+    config["iterations"] = iterations;
+
+    QJsonObject root;
+    root["tool"] = "agebench";
+    root["schema"] = 1;
+    root["label"] = parser.value(labelOpt);
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["config"] = config;
+    root["results"] = results;
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOpt)) {
+        QFile file(parser.value(outputOpt));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical() << "Failed to write" << file.fileName() << file.errorString();
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+#ifdef AGE_TRACE_ENABLED
+    if (parser.isSet(traceOpt)) {
+        QString error;
+        if (!AgeTrace::dump(parser.value(traceOpt), &error)) {
+            qCritical() << "Failed to write trace" << error;
+            return 1;
+        }
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,64 @@
+QT       = core network serialport
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = agecli
+
+INCLUDEPATH += .. ../sim
+
+# 共享内存遥测 (AgeTelemetryShm): 旧版 glibc 的 shm_open 在 librt 中
+unix:!macx: LIBS += -lrt
+
+# 时间线追踪 (驱动层 AGE_TRACE 宏): qmake CONFIG+=trace
+CONFIG(trace) {
+    DEFINES += AGE_TRACE_ENABLED
+    SOURCES += ../AgeTrace.cpp
+}
+
+SOURCES += \
+    ../AgeBaudNegotiator.cpp \
+    ../AgeBusThread.cpp \
+    ../AgeComTransport.cpp \
+    ../AgeConnectionManager.cpp \
+    ../AgeInstrumentedTransport.cpp \
+    ../AgeMotionDriver.cpp \
+    ../AgeMotionWaiter.cpp \
+    ../AgePollScheduler.cpp \
+    ../AgeReplayTransport.cpp \
+    ../AgeResilientTransport.cpp \
+    ../AgeRpcClient.cpp \
+    ../AgeRpcServer.cpp \
+    ../AgeRtuTransport.cpp \
+    ../AgeTelemetryRecorder.cpp \
+    ../AgeTelemetryShm.cpp \
+    ../AgeTransport.cpp \
+    ../sim/AgeDriveSim.cpp \
+    ../sim/AgeSimTransport.cpp \
+    main.cpp
+
+HEADERS += \
+    ../AgeBaudNegotiator.h \
+    ../AgeBusThread.h \
+    ../AgeComTransport.h \
+    ../AgeConnectionManager.h \
+    ../AgeInstrumentedTransport.h \
+    ../AgeLatencyHistogram.h \
+    ../AgeMotionDriver.h \
+    ../AgeMotionWaiter.h \
+    ../AgePollScheduler.h \
+    ../AgeReplayTransport.h \
+    ../AgeResilientTransport.h \
+    ../AgeRpcClient.h \
+    ../AgeRpcProtocol.h \
+    ../AgeRpcServer.h \
+    ../AgeRtuFrame.h \
+    ../AgeRtuTransport.h \
+    ../AgeSeqLock.h \
+    ../AgeTelemetryRecorder.h \
+    ../AgeTelemetryRing.h \
+    ../AgeTelemetryShm.h \
+    ../AgeTrace.h \
+    ../AgeTransport.h \
+    ../sim/AgeDriveSim.h \
+    ../sim/AgeSimTransport.h
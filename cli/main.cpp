@@ -0,0 +1,488 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "AgeMotionDriver.h"
+#include "AgeBusThread.h"
+#include "AgeComTransport.h"
+#include "AgeConnectionManager.h"
+#include "AgeReplayTransport.h"
+#include "AgeRpcClient.h"
+#include "AgeRpcServer.h"
+#include "AgeRtuTransport.h"
+#include "AgeDriveSim.h"
+#include "AgeSimTransport.h"
+
+// ==========================================
+//   agecli: 无界面命令行 (QtCore / QtNetwork + 驱动层，不依赖 QtWidgets)
+// ==========================================
+// 用法示例:
+//   agecli status                               读取一次状态 (key=value)
+//   agecli move 1500 --wait                     绝对运动到 1500um 并等待到位
+//   agecli --transport rtu --port COM3 read position
+//   agecli < script.txt                         从 stdin 逐行执行 (# 开头为注释)
+//   coproc agecli -                             常驻: 每行一条命令，每条应答一行
+//   agecli --serve agemotion                    持有总线，经本机套接字供多个进程共享 (AgeRpcServer)
+//   agecli --connect agemotion move 1500        经持有总线的进程执行 (该进程可以是界面或 agecli --serve)
+//   agecli --serve agemotion --shm agemotion    同时把遥测发布到共享内存 (AgeTelemetrySubscriber 读取)
+//   agecli --serve agemotion --negotiate-baud   连接后协商总线波特率 (默认不改写驱动器的串口设置)
+// 每条命令输出一行: 成功为 "ok [值]"，失败为 "error <原因>"；
+// 退出码: 0 全部成功, 1 有命令失败 (批量模式默认在第一条失败处停止), 2 用法错误或连接失败
+// 驱动直接在主线程中使用，不启动总线线程与轮询，单次调用只做连接与该命令所需的读写；
+// --serve 时才启动总线线程、轮询与自动重连
+
+namespace {
+
+const char *const HELP_TEXT =
+    "Commands:\n"
+    "  status                       all status groups as key=value\n"
+    "  read <what>                  position | target | velocity | realvelocity | current | temp | error | pulse\n"
+    "  move <um> [um/s]             absolute move (default velocity, or the given one)\n"
+    "  moverel <um>                 relative move\n"
+    "  jog <um/s>                   run at constant velocity (sign = direction, 0 = stop)\n"
+    "  velocity <um/s>              set the target velocity for later moves\n"
+    "  home <low|high>              homing towards the low/high reference\n"
+    "  limit <upper|lower>          move to a limit switch\n"
+    "  stop | estop                 stop / emergency stop\n"
+    "  enable <on|off>              enable or free the motor\n"
+    "  zero                         set the current position to 0\n"
+    "  wait [ms]                    wait until the move completes (default --timeout)\n"
+    "  sleep <ms>                   pause the script\n"
+    "  help                         this list\n";
+
+// 命令的执行对象: 本进程直接持有总线 (DriverTarget)，或经 AgeRpcServer 由另一进程代为执行 (RemoteTarget)
+class Target
+{
+public:
+    virtual ~Target() = default;
+    virtual bool readStatus(DriveStatusSnapshot &snapshot, quint32 groups) = 0;
+    // position | target | velocity | realvelocity | current
+    virtual bool readValue(const QString &what, double &value) = 0;
+    virtual bool moveTo(double um, double velocityUmPerSec) = 0;   // 速度 0 = 当前目标速度
+    virtual bool moveRelative(double um) = 0;
+    virtual bool jog(double velocityUmPerSec) = 0;
+    virtual bool setTargetVelocity(double velocityUmPerSec) = 0;
+    virtual bool findReference(bool toHigh) = 0;
+    virtual bool moveToLimit(bool toUpper) = 0;
+    virtual bool stop() = 0;
+    virtual bool emergencyStop() = 0;
+    virtual bool setEnable(bool enable) = 0;
+    virtual bool setZero() = 0;
+    virtual bool waitForMotionComplete(int timeoutMs) = 0;
+    virtual QString lastError() const = 0;
+};
+
+class DriverTarget : public Target
+{
+public:
+    explicit DriverTarget(AgeMotionDriver &driver) : m_driver(driver) {}
+
+    bool readStatus(DriveStatusSnapshot &snapshot, quint32 groups) override
+    {
+        return m_driver.readStatusSnapshot(snapshot, groups);
+    }
+    bool readValue(const QString &what, double &value) override
+    {
+        if (what == "position") return m_driver.getPosition(value);
+        if (what == "target") return m_driver.getTargetPosition(value);
+        if (what == "velocity") return m_driver.getTargetVelocity(value);
+        if (what == "realvelocity") return m_driver.getVelocity(value);
+        return m_driver.getRealTimeCurrent(value);
+    }
+    bool moveTo(double um, double velocityUmPerSec) override
+    {
+        return velocityUmPerSec > 0.0 ? m_driver.moveTo(um, velocityUmPerSec) : m_driver.setTargetPosition(um);
+    }
+    bool moveRelative(double um) override { return m_driver.setRelativePosition(um); }
+    bool jog(double velocityUmPerSec) override { return m_driver.setVelocity(velocityUmPerSec); }
+    bool setTargetVelocity(double velocityUmPerSec) override { return m_driver.setTargetVelocity(velocityUmPerSec); }
+    bool findReference(bool toHigh) override { return m_driver.findReference(toHigh); }
+    bool moveToLimit(bool toUpper) override { return m_driver.moveToLimit(toUpper); }
+    bool stop() override { return m_driver.stopMotion(); }
+    bool emergencyStop() override { return m_driver.emergencyStop(); }
+    bool setEnable(bool enable) override { return m_driver.setEnable(enable); }
+    bool setZero() override { return m_driver.setCurrPositionToZero(); }
+    bool waitForMotionComplete(int timeoutMs) override { return m_driver.waitForMotionComplete(timeoutMs); }
+    QString lastError() const override { return m_driver.getLastError(); }
+
+private:
+    AgeMotionDriver &m_driver;
+};
+
+// 状态读取返回服务端最近一次轮询的快照 (不产生总线事务)
+class RemoteTarget : public Target
+{
+public:
+    RemoteTarget(AgeRpcClient &client, int axis) : m_client(client), m_axis(axis) {}
+
+    bool readStatus(DriveStatusSnapshot &snapshot, quint32 groups) override
+    {
+        Q_UNUSED(groups);
+        return m_client.status(snapshot, m_axis);
+    }
+    bool readValue(const QString &what, double &value) override
+    {
+        DriveStatusSnapshot s;
+        if (!m_client.status(s, m_axis)) return false;
+        if (what == "position") value = s.positionUm;
+        else if (what == "target") value = s.targetPositionUm;
+        else if (what == "velocity") value = s.targetVelocityUmPerSec;
+        else if (what == "realvelocity") value = s.realVelocityUmPerSec;
+        else value = s.currentA;
+        return true;
+    }
+    bool moveTo(double um, double velocityUmPerSec) override { return m_client.moveTo(um, velocityUmPerSec, m_axis); }
+    bool moveRelative(double um) override { return m_client.moveRelative(um, m_axis); }
+    bool jog(double velocityUmPerSec) override { return m_client.jog(velocityUmPerSec, m_axis); }
+    bool setTargetVelocity(double velocityUmPerSec) override { return m_client.setTargetVelocity(velocityUmPerSec, m_axis); }
+    bool findReference(bool toHigh) override { return m_client.findReference(toHigh, m_axis); }
+    bool moveToLimit(bool toUpper) override { return m_client.moveToLimit(toUpper, m_axis); }
+    bool stop() override { return m_client.stop(m_axis); }
+    bool emergencyStop() override { return m_client.emergencyStop(m_axis); }
+    bool setEnable(bool enable) override { return m_client.setEnable(enable, m_axis); }
+    bool setZero() override { return m_client.setCurrPositionToZero(m_axis); }
+    bool waitForMotionComplete(int timeoutMs) override { return m_client.waitForMotionComplete(timeoutMs, m_axis); }
+    QString lastError() const override { return m_client.lastError(); }
+
+private:
+    AgeRpcClient &m_client;
+    int m_axis;
+};
+
+struct Context {
+    Target *target = nullptr;
+    bool waitAfterMove = false;
+    int timeoutMs = 30000;
+};
+
+bool toDouble(const QString &text, double &value)
+{
+    bool ok = false;
+    value = text.toDouble(&ok);
+    return ok;
+}
+
+// 执行一条命令；out 为成功时的输出值或失败原因
+bool execute(Context &ctx, const QStringList &args, QString &out)
+{
+    Target &target = *ctx.target;
+    const QString cmd = args.value(0).toLower();
+    const QString arg = args.value(1).toLower();
+    double value = 0.0;
+
+    auto fail = [&out](const QString &message) {
+        out = message;
+        return false;
+    };
+    auto result = [&target, &out](bool ok) {
+        if (!ok) out = target.lastError();
+        return ok;
+    };
+    auto moved = [&](bool ok) {
+        if (!ok) return result(false);
+        return ctx.waitAfterMove ? result(target.waitForMotionComplete(ctx.timeoutMs)) : true;
+    };
+
+    if (cmd == "help") {
+        out = QString(HELP_TEXT).trimmed();
+        return true;
+    }
+    if (cmd == "status") {
+        DriveStatusSnapshot s;
+        if (!target.readStatus(s, DriveStatusSnapshot::GroupsAll)) return result(false);
+        out = QString("position=%1 target=%2 velocity=%3 current=%4 temp=%5 error=%6 control=0x%7 done=%8 homed=%9")
+                  .arg(s.positionUm, 0, 'f', 3).arg(s.targetPositionUm, 0, 'f', 3)
+                  .arg(s.realVelocityUmPerSec, 0, 'f', 3).arg(s.currentA, 0, 'f', 2).arg(s.cpuTemp)
+                  .arg(s.errorCode).arg(s.control, 4, 16, QChar('0'))
+                  .arg(s.isMotionDone ? 1 : 0).arg(s.isHomingDone ? 1 : 0);
+        return true;
+    }
+    if (cmd == "read") {
+        if (arg == "temp" || arg == "error" || arg == "pulse") {
+            DriveStatusSnapshot s;
+            const quint32 group = arg == "temp" ? DriveStatusSnapshot::GroupTemperature
+                                : arg == "error" ? DriveStatusSnapshot::GroupControl
+                                                 : DriveStatusSnapshot::GroupPosition;
+            if (!target.readStatus(s, group)) return result(false);
+            out = QString::number(arg == "temp" ? (int)s.cpuTemp : arg == "error" ? (int)s.errorCode : (int)s.pulsePosReal);
+            return true;
+        }
+        if (arg != "position" && arg != "target" && arg != "velocity" && arg != "realvelocity" && arg != "current") {
+            return fail(QString("unknown read target '%1'").arg(arg));
+        }
+        if (!target.readValue(arg, value)) return result(false);
+        out = QString::number(value, 'f', 3);
+        return true;
+    }
+    if (cmd == "move" || cmd == "moverel" || cmd == "jog" || cmd == "velocity") {
+        if (!toDouble(args.value(1), value)) return fail(QString("%1: number expected").arg(cmd));
+        if (cmd == "move") {
+            double velocity = 0.0;
+            if (args.size() > 2 && (!toDouble(args.value(2), velocity) || velocity <= 0.0)) {
+                return fail("move: velocity must be > 0");
+            }
+            return moved(target.moveTo(value, velocity));
+        }
+        if (cmd == "moverel") return moved(target.moveRelative(value));
+        if (cmd == "jog") return result(target.jog(value));
+        return result(target.setTargetVelocity(value));
+    }
+    if (cmd == "home") {
+        if (arg != "low" && arg != "high") return fail("home: low or high expected");
+        return moved(target.findReference(arg == "high"));
+    }
+    if (cmd == "limit") {
+        if (arg != "upper" && arg != "lower") return fail("limit: upper or lower expected");
+        return moved(target.moveToLimit(arg == "upper"));
+    }
+    if (cmd == "stop") return result(target.stop());
+    if (cmd == "estop") return result(target.emergencyStop());
+    if (cmd == "enable") {
+        if (arg != "on" && arg != "off") return fail("enable: on or off expected");
+        return result(target.setEnable(arg == "on"));
+    }
+    if (cmd == "zero") return result(target.setZero());
+    if (cmd == "wait") {
+        int ms = ctx.timeoutMs;
+        if (args.size() > 1) {
+            bool ok = false;
+            ms = args.value(1).toInt(&ok);
+            if (!ok || ms <= 0) return fail("wait: timeout in ms expected");
+        }
+        return result(target.waitForMotionComplete(ms));
+    }
+    if (cmd == "sleep") {
+        bool ok = false;
+        const int ms = args.value(1).toInt(&ok);
+        if (!ok || ms < 0) return fail("sleep: ms expected");
+        QThread::msleep((unsigned long)ms);
+        return true;
+    }
+    return fail(QString("unknown command '%1' (try 'help')").arg(cmd));
+}
+
+// 输出一行应答并立即刷新 (常驻模式下调用方逐行读取)
+void reply(bool ok, const QString &out)
+{
+    const QByteArray line = (ok ? (out.isEmpty() ? QString("ok") : "ok " + out) : "error " + out).toUtf8();
+    fwrite(line.constData(), 1, (size_t)line.size(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+// 批量 / 常驻: stdin 逐行执行，EOF 结束
+int runScript(Context &ctx, bool keepGoing)
+{
+    QTextStream in(stdin);
+    const QRegularExpression whitespace("\\s+");
+    int rc = 0;
+    QString line;
+    while (in.readLineInto(&line)) {
+        line = line.trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        const QStringList args = line.split(whitespace, Qt::SkipEmptyParts);
+        if (args.value(0).toLower() == "quit" || args.value(0).toLower() == "exit") break;
+        QString out;
+        const bool ok = execute(ctx, args, out);
+        reply(ok, out);
+        if (!ok) {
+            rc = 1;
+            if (!keepGoing) break;
+        }
+    }
+    return rc;
+}
+
+// --serve: SIGINT/SIGTERM 只置标志，由事件循环中的定时器退出 app.exec()
+constexpr int QUIT_POLL_INTERVAL_MS = 100;
+std::atomic<bool> g_quit(false);
+
+void onQuitSignal(int)
+{
+    g_quit.store(true);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("agecli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString("Headless AgeMotion control. Without a command (or with '-') "
+                                             "commands are read from stdin, one per line.\n\n") + HELP_TEXT);
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "Command and its arguments (see above).", "[command [args...]]");
+
+    QCommandLineOption transportOpt("transport", "dll | rtu | replay | sim (default: AGEMOTION_TRANSPORT or the platform default).", "kind");
+    QCommandLineOption portOpt("port", "Serial port for rtu.", "name");
+    QCommandLineOption baudOpt("baud", "Baud rate for rtu.", "baud");
+    QCommandLineOption replayOpt("replay-file", "Recording (.agetrace) for replay.", "file");
+    QCommandLineOption speedOpt("replay-speed", "Replay speed multiplier (<= 0 = one sample per status read).", "x", "1");
+    QCommandLineOption stationOpt("station", "Drive station number.", "n", QString::number(AgeMotionDriver::DEFAULT_STATION_ID));
+    QCommandLineOption serveOpt("serve", "Own the bus and serve it to other processes on local socket <name> (see AgeRpcServer).", "name");
+    QCommandLineOption addStationOpt("add-station", "--serve: serve another station on the same bus as the next axis (repeatable).", "n");
+    QCommandLineOption negotiateBaudOpt("negotiate-baud", "--serve: negotiate the fastest baud rate the drives support (rewrites their serial settings).");
+    QCommandLineOption shmOpt("shm", "--serve: also publish telemetry to shared memory segment <name> (see AgeTelemetryShm.h).", "name");
+    QCommandLineOption connectOpt("connect", "Run commands through the process serving local socket <name> instead of opening the bus.", "name");
+    QCommandLineOption axisOpt("axis", "--connect: axis index on the server.", "n", "0");
+    QCommandLineOption waitOpt("wait", "Wait for completion after move/moverel/home/limit.");
+    QCommandLineOption timeoutOpt("timeout", "Timeout for --wait and 'wait' (ms).", "ms", "30000");
+    QCommandLineOption keepGoingOpt("keep-going", "Batch mode: continue after a failed command.");
+    QCommandLineOption verboseOpt("verbose", "Keep driver debug output (stderr).");
+    parser.addOptions({transportOpt, portOpt, baudOpt, replayOpt, speedOpt, stationOpt, serveOpt, addStationOpt,
+                       negotiateBaudOpt, shmOpt, connectOpt, axisOpt, waitOpt, timeoutOpt, keepGoingOpt, verboseOpt});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOpt)) QLoggingCategory::setFilterRules("*.debug=false");
+
+    Context ctx;
+    ctx.waitAfterMove = parser.isSet(waitOpt);
+    ctx.timeoutMs = qMax(1, parser.value(timeoutOpt).toInt());
+    const QStringList positional = parser.positionalArguments();
+    const bool single = !positional.isEmpty() && positional != QStringList{"-"};
+
+    // --- 客户端: 总线由另一进程 (agecli --serve 或界面) 持有 ---
+    if (parser.isSet(connectOpt)) {
+        AgeRpcClient client;
+        if (!client.connectToServer(parser.value(connectOpt))) {
+            reply(false, client.lastError());
+            return 2;
+        }
+        const int axis = parser.value(axisOpt).toInt();
+        if (axis < 0 || axis >= client.axisCount()) {
+            reply(false, QString("axis %1 does not exist (server has %2)").arg(axis).arg(client.axisCount()));
+            return 2;
+        }
+        RemoteTarget target(client, axis);
+        ctx.target = &target;
+        if (single) {
+            QString out;
+            const bool ok = execute(ctx, positional, out);
+            reply(ok, out);
+            return ok ? 0 : 1;
+        }
+        return runScript(ctx, parser.isSet(keepGoingOpt));
+    }
+
+    const int station = parser.value(stationOpt).toInt();
+    if (station < 1 || station > 247) {
+        fprintf(stderr, "agecli: --station must be 1-247\n");
+        return 2;
+    }
+    if (parser.isSet(serveOpt) && station != AgeMotionDriver::DEFAULT_STATION_ID) {
+        fprintf(stderr, "agecli: --serve always serves station %d as axis 0; use --add-station for others\n",
+                (int)AgeMotionDriver::DEFAULT_STATION_ID);
+        return 2;
+    }
+
+    // --- 传输 ---
+    QSharedPointer<AgeTransport> transport;
+    std::vector<std::unique_ptr<AgeDriveSim>> simDrives;
+    const QString kind = parser.value(transportOpt).toLower();
+    if (kind.isEmpty()) {
+        transport = AgeTransport::createDefault();
+    } else if (kind == "dll") {
+        transport = QSharedPointer<AgeTransport>(new AgeComTransport());
+    } else if (kind == "rtu") {
+        AgeRtuTransport::Config config;
+        if (parser.isSet(portOpt)) config.portName = parser.value(portOpt);
+        if (parser.isSet(baudOpt)) config.baudRate = parser.value(baudOpt).toInt();
+        transport = QSharedPointer<AgeTransport>(new AgeRtuTransport(config));
+    } else if (kind == "replay") {
+        AgeReplayTransport::Config config;
+        config.path = parser.value(replayOpt);
+        config.speed = parser.value(speedOpt).toDouble();
+        config.firstStation = (quint8)station;
+        transport = QSharedPointer<AgeTransport>(new AgeReplayTransport(config));
+    } else if (kind == "sim") {
+        // 进程内虚拟驱动器，用于不接硬件时调试脚本 (状态不跨进程保留)
+        AgeSimTransport *sim = new AgeSimTransport(AgeSimTransport::Config());
+        QStringList stations{QString::number(station)};
+        if (parser.isSet(serveOpt)) stations += parser.values(addStationOpt);
+        for (const QString &n : stations) {
+            simDrives.emplace_back(new AgeDriveSim((quint8)n.toInt()));
+            sim->addDrive(simDrives.back().get());
+        }
+        transport = QSharedPointer<AgeTransport>(sim);
+    } else {
+        fprintf(stderr, "agecli: unknown --transport '%s'\n", qPrintable(kind));
+        return 2;
+    }
+
+    // --- 服务端: 总线线程 + 自动重连，直到进程被结束 ---
+    if (parser.isSet(serveOpt)) {
+        AgeBusThread bus(nullptr, transport);
+        for (const QString &n : parser.values(addStationOpt)) {
+            const int extra = n.toInt();
+            if (extra < 1 || extra > 247) {
+                fprintf(stderr, "agecli: --add-station must be 1-247\n");
+                return 2;
+            }
+            bus.addAxis((quint8)extra);
+        }
+        AgeConnectionManager connection(&bus);
+        connection.setBaudNegotiation(parser.isSet(negotiateBaudOpt));
+        QObject::connect(&connection, &AgeConnectionManager::stateChanged,
+                         [](AgeConnectionManager::State state, const QString &message) {
+            fprintf(stderr, "agecli: %s %s\n", qPrintable(AgeConnectionManager::stateName(state)), qPrintable(message));
+        });
+        AgeRpcServer server(&bus);
+        if (!server.listen(parser.value(serveOpt))) {
+            reply(false, server.lastError());
+            return 2;
+        }
+        QSharedPointer<AgeTelemetryPublisher> publisher;
+        if (parser.isSet(shmOpt)) {
+            publisher.reset(new AgeTelemetryPublisher());
+            if (!publisher->create(parser.value(shmOpt), bus.axisCount())) {
+                reply(false, publisher->lastError());
+                return 2;
+            }
+            bus.setPublisher(publisher);
+        }
+        bus.start();
+        connection.start();
+        reply(true, "listening " + server.serverName());
+
+        // 收到 SIGINT/SIGTERM 时正常退出事件循环，执行下面的清理 (停止重连、关闭服务、停止总线线程)
+        std::signal(SIGINT, onQuitSignal);
+        std::signal(SIGTERM, onQuitSignal);
+        QTimer quitPoll;
+        QObject::connect(&quitPoll, &QTimer::timeout, &app, []() {
+            if (g_quit.load()) QCoreApplication::quit();
+        });
+        quitPoll.start(QUIT_POLL_INTERVAL_MS);
+        const int rc = app.exec();
+        connection.stop();
+        server.close();
+        bus.shutdown();
+        return rc;
+    }
+
+    AgeMotionDriver driver(transport, (quint8)station);
+    if (!driver.connectDevice()) {
+        reply(false, "connect: " + driver.getLastError());
+        return 2;
+    }
+    DriverTarget target(driver);
+    ctx.target = &target;
+
+    // --- 单条命令 ---
+    if (single) {
+        QString out;
+        const bool ok = execute(ctx, positional, out);
+        reply(ok, out);
+        return ok ? 0 : 1;
+    }
+    return runScript(ctx, parser.isSet(keepGoingOpt));
+}
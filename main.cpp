@@ -281,7 +281,7 @@ int main(int argc, char *argv[])
             qDebug() << "[Comm] AgeCOMGetCOM: Current BaudRate =" << dwBaudRate << ", Parity =" << wParity;
         }
 
-        // 设置为 115200, Even (2)
+        // 设置为 115200, Even (2)；连接时 AgeBaudNegotiator 会改回上次协商保存的波特率
         if (pAgeCOMSetCOM(115200, 2)) {
             qDebug() << "[Comm] AgeCOMSetCOM: Set to 115200, Even Parity Success";
         }
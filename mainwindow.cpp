@@ -5,121 +5,341 @@
 #include <QDebug>
 #include <QMessageBox>
 #include <QInputDialog>
+#include <QFontDatabase>
+#include <QComboBox>
+#include <QFileDialog>
+#include "AgeTrace.h"
+#include "AgeDiscovery.h"
+#include <thread>
+
+namespace {
+// 界面刷新周期 (ms)；总线轮询频率由 AgePollScheduler::Config 按分组与运动状态决定
+constexpr int GUI_REFRESH_INTERVAL_MS = 50;
+constexpr int DIAG_REFRESH_INTERVAL_MS = 1000;
+constexpr int CHART_FRAME_INTERVAL_MS = 16;  // 约 60 fps
+constexpr int CHART_DRAIN_BATCH = 256;
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , m_driver(new AgeMotionDriver())
+    , m_bus(new AgeBusThread(this))
+    , m_connection(new AgeConnectionManager(m_bus, this))
     , m_timer(new QTimer(this))
+    , m_diagDock(new QDockWidget("Bus Diagnostics", this))
+    , m_diagText(new QPlainTextEdit())
+    , m_diagTimer(new QTimer(this))
+    , m_chartDock(new QDockWidget("Telemetry Chart", this))
+    , m_chart(new AgeStripChart())
+    , m_chartTimer(new QTimer(this))
 {
     ui->setupUi(this);
+    AGE_TRACE_THREAD_NAME("GUI");
+
+    // 总线诊断面板: 延迟分位数 + AgeCOMGetBusInfo 计数
+    QWidget *diagPanel = new QWidget();
+    QVBoxLayout *diagLayout = new QVBoxLayout(diagPanel);
+    QPushButton *btnDiagReset = new QPushButton("Reset Statistics");
+    m_diagText->setReadOnly(true);
+    m_diagText->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_diagText->setLineWrapMode(QPlainTextEdit::NoWrap);
+    diagLayout->addWidget(m_diagText);
+    diagLayout->addWidget(btnDiagReset);
+    m_diagDock->setWidget(diagPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_diagDock);
+    connect(btnDiagReset, &QPushButton::clicked, this, [this]() { refreshDiagnostics(true); });
+    connect(m_diagTimer, &QTimer::timeout, this, [this]() { refreshDiagnostics(false); });
+
+    // 设备发现: 并行扫描全部串口与站号 (已连接的串口被占用，会被跳过)
+    QPushButton *btnDiscover = new QPushButton("Discover Devices...");
+    diagLayout->addWidget(btnDiscover);
+    connect(btnDiscover, &QPushButton::clicked, this, [this, btnDiscover]() {
+        btnDiscover->setEnabled(false);
+        ui->statusbar->showMessage("Scanning serial ports...");
+        QPointer<MainWindow> guard(this);
+        std::thread([guard, btnDiscover]() {
+            const AgeDiscovery::Result result = AgeDiscovery::scanAll(AgeDiscovery::Options());
+            if (!guard) return;
+            QMetaObject::invokeMethod(guard.data(), [guard, btnDiscover, result]() {
+                if (!guard) return;
+                btnDiscover->setEnabled(true);
+                guard->ui->statusbar->showMessage(QString("Found %1 device(s)").arg(result.devices.size()), 3000);
+                QMessageBox box(QMessageBox::Information, "Discover Devices",
+                                AgeDiscovery::formatTable(result), QMessageBox::Ok, guard.data());
+                box.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+                box.exec();
+            }, Qt::QueuedConnection);
+        }).detach();
+    });
+    // 遥测记录: 全速率样本写入内存映射文件 (.agetrace)，写入在总线线程，不经过 GUI
+    QPushButton *btnRecord = new QPushButton("Start Recording...");
+    btnRecord->setCheckable(true);
+    diagLayout->addWidget(btnRecord);
+    connect(btnRecord, &QPushButton::toggled, this, [this, btnRecord](bool checked) {
+        if (!checked) {
+            if (!m_recorder) return;
+            m_bus->setRecorder(QSharedPointer<AgeTelemetryRecorder>());
+            ui->statusbar->showMessage(QString("Recording stopped: %1 samples, %2 dropped")
+                                       .arg(m_recorder->recorded()).arg(m_recorder->dropped()), 5000);
+            m_recorder.reset();
+            btnRecord->setText("Start Recording...");
+            return;
+        }
+        const QString path = QFileDialog::getSaveFileName(this, "Record Telemetry", "telemetry.agetrace",
+                                                          "Telemetry Recording (*.agetrace)");
+        QSharedPointer<AgeTelemetryRecorder> recorder(new AgeTelemetryRecorder());
+        if (path.isEmpty() || !recorder->open(path)) {
+            if (!path.isEmpty()) QMessageBox::warning(this, "Record Telemetry", recorder->lastError());
+            QSignalBlocker blocker(btnRecord);
+            btnRecord->setChecked(false);
+            return;
+        }
+        m_recorder = recorder;
+        m_bus->setRecorder(recorder);
+        btnRecord->setText("Stop Recording");
+    });
+#ifdef AGE_TRACE_ENABLED
+    // 时间线导出 (CONFIG+=trace 构建时才有)
+    QPushButton *btnSaveTrace = new QPushButton("Save Trace...");
+    diagLayout->addWidget(btnSaveTrace);
+    connect(btnSaveTrace, &QPushButton::clicked, this, [this]() {
+        const QString path = QFileDialog::getSaveFileName(this, "Save Trace", "autofocus.trace.json",
+                                                          "Chrome Trace (*.json)");
+        if (path.isEmpty()) return;
+        QString error;
+        if (!AgeTrace::dump(path, &error)) QMessageBox::warning(this, "Save Trace", error);
+    });
+#endif
+    m_diagTimer->start(DIAG_REFRESH_INTERVAL_MS);
+
+    // 曲线图: 轴 0 的位置与实时速度，数据来自总线线程的遥测环形缓冲
+    QWidget *chartPanel = new QWidget();
+    QVBoxLayout *chartLayout = new QVBoxLayout(chartPanel);
+    QComboBox *cmbSpan = new QComboBox();
+    const QList<QPair<QString, qint64>> spans = {
+        {"1 s", 1000000LL}, {"10 s", 10000000LL}, {"1 min", 60000000LL},
+        {"10 min", 600000000LL}, {"1 h", 3600000000LL}
+    };
+    for (const auto &span : spans) cmbSpan->addItem(span.first, span.second);
+    cmbSpan->setCurrentIndex(1);
+    m_chartPosition = m_chart->addChannel("Position", "um", QColor(80, 200, 120));
+    m_chartVelocity = m_chart->addChannel("Real Velocity", "um/s", QColor(90, 160, 240));
+    m_chart->setTimeSpan(cmbSpan->currentData().toLongLong());
+    chartLayout->addWidget(m_chart, 1);
+    chartLayout->addWidget(cmbSpan);
+    m_chartDock->setWidget(chartPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_chartDock);
+    connect(cmbSpan, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this, cmbSpan]() {
+        m_chart->setTimeSpan(cmbSpan->currentData().toLongLong());
+    });
+    m_chartReader = m_bus->telemetry().reader();
+    connect(m_chartTimer, &QTimer::timeout, this, &MainWindow::updateChart);
+    m_chartTimer->start(CHART_FRAME_INTERVAL_MS);
+
+    // 波特率协商 (AGEMOTION_BAUD_NEGOTIATE=1): 会改写驱动器的串口设置，默认关闭
+    m_connection->setBaudNegotiation(qEnvironmentVariableIntValue("AGEMOTION_BAUD_NEGOTIATE") != 0);
+
+    // 本机 RPC 服务 (AGEMOTION_RPC_SERVER=<名称>): 其他进程经 AgeRpcServer 共享本进程持有的总线
+    const QString rpcName = qEnvironmentVariable("AGEMOTION_RPC_SERVER");
+    if (!rpcName.isEmpty()) {
+        m_rpc = new AgeRpcServer(m_bus, this);
+        if (!m_rpc->listen(rpcName)) qWarning() << m_rpc->lastError();
+    }
+
+    // 共享内存遥测 (AGEMOTION_SHM=<名称>): 本机其他进程经 AgeTelemetrySubscriber 直接读取样本
+    const QString shmName = qEnvironmentVariable("AGEMOTION_SHM");
+    if (!shmName.isEmpty()) {
+        QSharedPointer<AgeTelemetryPublisher> publisher(new AgeTelemetryPublisher());
+        if (publisher->create(shmName, m_bus->axisCount())) {
+            m_shm = publisher;
+            m_shmName = shmName;
+            m_bus->setPublisher(publisher);
+        } else {
+            qWarning() << publisher->lastError();
+        }
+    }
+
+    // 总线线程负责轮询设备，界面定时器只读取其发布的快照
+    m_bus->start();
 
-    // 设置定时器，每 200ms 更新一次状态
     connect(m_timer, &QTimer::timeout, this, &MainWindow::updateStatus);
+
+    // 连接状态: 首次连接成功提示一次，之后掉线/重连只在状态栏显示
+    connect(m_connection, &AgeConnectionManager::connected, this, [this](bool firstTime) {
+        ui->statusbar->showMessage(firstTime ? "Connected" : "Reconnected", 3000);
+        if (!m_timer->isActive()) {
+            m_timer->start(GUI_REFRESH_INTERVAL_MS);
+        }
+        if (firstTime) {
+            QMessageBox::information(this, "Success", "Device connected successfully!");
+        }
+    });
+    connect(m_connection, &AgeConnectionManager::baudRateChanged, this, [this](int baudRate, const QString &reason) {
+        ui->statusbar->showMessage(QString("Bus baud rate: %1 (%2)").arg(baudRate).arg(reason), 5000);
+    });
+    connect(m_connection, &AgeConnectionManager::stateChanged, this,
+            [this](AgeConnectionManager::State state, const QString &message) {
+        // 已连接时只显示个别轴的掉线/重试信息
+        if (state == AgeConnectionManager::State::Idle) return;
+        if (state == AgeConnectionManager::State::Connected && message.isEmpty()) return;
+        QString text = AgeConnectionManager::stateName(state) + "...";
+        if (!message.isEmpty()) text += " " + message;
+        ui->statusbar->showMessage(text);
+    });
 }
 
 MainWindow::~MainWindow()
 {
     m_timer->stop();
-    delete m_driver;
+    m_diagTimer->stop();
+    m_connection->stop();
+    if (m_rpc) m_rpc->close();
+    m_bus->shutdown();
     delete ui;
 }
 
 void MainWindow::on_btnConnect_clicked()
 {
-    if (m_driver->connectDevice()) {
-        QMessageBox::information(this, "Success", "Device connected successfully!");
-        // 连接成功后启动定时器
-        if (!m_timer->isActive()) {
-            m_timer->start(200); 
-        }
-    } else {
-        QMessageBox::critical(this, "Error", "Failed to connect: " + m_driver->getLastError());
-    }
+    AGE_TRACE_FUNCTION("gui");
+    // 失败时连接管理器按退避自动重试 (重试期间再次点击立即重试)，连接后掉线自动重连
+    m_connection->start();
 }
 
 void MainWindow::on_btnSetVel_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     bool ok;
     double vel = QInputDialog::getDouble(this, "Set Velocity", "Enter velocity (RPM):", 60, 0, 3000, 1, &ok);
     if (ok) {
-        if (m_driver->setTargetRPM(vel)) {
-            QMessageBox::information(this, "Success", QString("Velocity set to %1 RPM").arg(vel));
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to set velocity: " + m_driver->getLastError());
-        }
+        m_bus->call([vel](AgeMotionDriver &driver) {
+            BusResult<bool> r;
+            r.ok = driver.setTargetRPM(vel);
+            r.error = driver.getLastError();
+            return r;
+        }, this, [this, vel](const BusResult<bool> &r) {
+            if (r.ok) {
+                QMessageBox::information(this, "Success", QString("Velocity set to %1 RPM").arg(vel));
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to set velocity: " + r.error);
+            }
+        });
     }
 }
 
 void MainWindow::on_btnMove_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     bool ok;
     double pos = QInputDialog::getDouble(this, "Move to Position", "Enter position (um):", 0, -100000, 100000, 1, &ok);
     if (ok) {
-        if (m_driver->setTargetPosition(pos)) {
-            qDebug() << "Moving to" << pos << "um";
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to move: " + m_driver->getLastError());
-        }
+        m_bus->call([pos](AgeMotionDriver &driver) {
+            BusResult<bool> r;
+            r.ok = driver.setTargetPosition(pos);
+            r.error = driver.getLastError();
+            return r;
+        }, this, [this, pos](const BusResult<bool> &r) {
+            if (r.ok) {
+                qDebug() << "Moving to" << pos << "um";
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to move: " + r.error);
+            }
+        });
     }
 }
 
 void MainWindow::on_btnMoveRel_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     bool ok;
     double delta = QInputDialog::getDouble(this, "Move Relative", "Enter distance (um):", 0, -100000, 100000, 1, &ok);
     if (ok) {
-        if (m_driver->setRelativePosition(delta)) {
-            qDebug() << "Moving relative by" << delta << "um";
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to move relative: " + m_driver->getLastError());
-        }
+        m_bus->call([delta](AgeMotionDriver &driver) {
+            BusResult<bool> r;
+            r.ok = driver.setRelativePosition(delta);
+            r.error = driver.getLastError();
+            return r;
+        }, this, [this, delta](const BusResult<bool> &r) {
+            if (r.ok) {
+                qDebug() << "Moving relative by" << delta << "um";
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to move relative: " + r.error);
+            }
+        });
     }
 }
 
 void MainWindow::on_btnStop_clicked()
 {
-    if (m_driver->stopMotion()) {
-        qDebug() << "Motion stopped.";
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to stop: " + m_driver->getLastError());
-    }
+    AGE_TRACE_FUNCTION("gui");
+    // 排队中的运动命令不能在停止之后再启动 (急停由总线线程自动取消)
+    m_bus->cancelCommands();
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<bool> r;
+        r.ok = driver.stopMotion();
+        r.error = driver.getLastError();
+        return r;
+    }, this, [this](const BusResult<bool> &r) {
+        if (r.ok) {
+            qDebug() << "Motion stopped.";
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to stop: " + r.error);
+        }
+    }, AgeBusThread::Priority::Control);
 }
 
 void MainWindow::on_btnGetPos_clicked()
 {
-    double pos = 0;
-    if (m_driver->getPosition(pos)) {
-        QMessageBox::information(this, "Position", QString("Current Position: %1 um").arg(pos));
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to get position: " + m_driver->getLastError());
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<double> r;
+        r.ok = driver.getPosition(r.value);
+        r.error = driver.getLastError();
+        return r;
+    }, this, [this](const BusResult<double> &r) {
+        if (r.ok) {
+            QMessageBox::information(this, "Position", QString("Current Position: %1 um").arg(r.value));
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to get position: " + r.error);
+        }
+    });
 }
 
 void MainWindow::on_btnGetVel_clicked()
 {
-    double vel = 0;
-    if (m_driver->getTargetRPM(vel)) {
-        QMessageBox::information(this, "Velocity", QString("Target Velocity: %1 RPM").arg(vel));
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to get velocity: " + m_driver->getLastError());
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<double> r;
+        r.ok = driver.getTargetRPM(r.value);
+        r.error = driver.getLastError();
+        return r;
+    }, this, [this](const BusResult<double> &r) {
+        if (r.ok) {
+            QMessageBox::information(this, "Velocity", QString("Target Velocity: %1 RPM").arg(r.value));
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to get velocity: " + r.error);
+        }
+    });
 }
 
 void MainWindow::on_btnCheckError_clicked()
 {
-    int err = m_driver->checkError();
-    if (err == 0) {
-        QMessageBox::information(this, "Status", "No Error.");
-    } else if (err > 0) {
-        QMessageBox::warning(this, "Error", QString("Error Code: %1").arg(err));
-    } else {
-        QMessageBox::warning(this, "Error", "Communication failed.");
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        return driver.checkError();
+    }, this, [this](int err) {
+        if (err == 0) {
+            QMessageBox::information(this, "Status", "No Error.");
+        } else if (err > 0) {
+            QMessageBox::warning(this, "Error", QString("Error Code: %1").arg(err));
+        } else {
+            QMessageBox::warning(this, "Error", "Communication failed.");
+        }
+    });
 }
 
 void MainWindow::on_testbutton_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
 
 }
 
@@ -129,140 +349,201 @@ void MainWindow::on_testbutton_clicked()
 
 void MainWindow::on_btnEnable_clicked(bool checked)
 {
-    if (m_driver->setEnable(checked)) {
-        ui->btnEnable->setText(checked ? "Enabled (Click to Disable)" : "Disabled (Click to Enable)");
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to set enable state.");
-        // 恢复按钮状态
-        ui->btnEnable->setChecked(!checked);
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([checked](AgeMotionDriver &driver) {
+        return driver.setEnable(checked);
+    }, this, [this, checked](bool ok) {
+        if (ok) {
+            ui->btnEnable->setText(checked ? "Enabled (Click to Disable)" : "Disabled (Click to Enable)");
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to set enable state.");
+            // 恢复按钮状态
+            ui->btnEnable->setChecked(!checked);
+        }
+    }, AgeBusThread::Priority::Control);
 }
 
 void MainWindow::on_btnEmergencyStop_clicked()
 {
-    if (m_driver->emergencyStop()) {
-        QMessageBox::critical(this, "STOP", "Emergency Stop command sent!");
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to send Emergency Stop.");
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        return driver.emergencyStop();
+    }, this, [this](bool ok) {
+        if (ok) {
+            QMessageBox::critical(this, "STOP", "Emergency Stop command sent!");
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to send Emergency Stop.");
+        }
+    }, AgeBusThread::Priority::Emergency);
 }
 
 void MainWindow::on_btnMoveToLimit_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     QStringList items;
     items << "Upper Limit" << "Lower Limit";
     bool ok;
     QString item = QInputDialog::getItem(this, "Move to Limit", "Select Direction:", items, 0, false, &ok);
     if (ok && !item.isEmpty()) {
         bool toUpper = (item == "Upper Limit");
-        if (m_driver->moveToLimit(toUpper)) {
-            qDebug() << "Moving to" << item;
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to move to limit sensor.");
-        }
+        m_bus->call([toUpper](AgeMotionDriver &driver) {
+            return driver.moveToLimit(toUpper);
+        }, this, [this, item](bool ok) {
+            if (ok) {
+                qDebug() << "Moving to" << item;
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to move to limit sensor.");
+            }
+        });
     }
 }
 
 void MainWindow::on_btnSetZeroOffset_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     if (QMessageBox::question(this, "Confirm", "Set current position offset to zero?", QMessageBox::Yes|QMessageBox::No) == QMessageBox::Yes) {
-        if (m_driver->setCurrPositionToZero()) {
-            QMessageBox::information(this, "Success", "Position offset set to zero.");
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to set position offset.");
-        }
+        m_bus->call([](AgeMotionDriver &driver) {
+            return driver.setCurrPositionToZero();
+        }, this, [this](bool ok) {
+            if (ok) {
+                QMessageBox::information(this, "Success", "Position offset set to zero.");
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to set position offset.");
+            }
+        });
     }
 }
 
 void MainWindow::on_btnHoming_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     QStringList items;
     items << "To High (Positive)" << "To Low (Negative)";
     bool ok;
     QString item = QInputDialog::getItem(this, "Homing", "Select Homing Direction:", items, 0, false, &ok);
     if (ok && !item.isEmpty()) {
         bool toHigh = (item == "To High (Positive)");
-        if (m_driver->findReference(toHigh)) {
-            qDebug() << "Homing " << item;
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to start homing.");
-        }
+        m_bus->call([toHigh](AgeMotionDriver &driver) {
+            return driver.findReference(toHigh);
+        }, this, [this, item](bool ok) {
+            if (ok) {
+                qDebug() << "Homing " << item;
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to start homing.");
+            }
+        });
     }
 }
 
 void MainWindow::on_btnPulsePos_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     // 1. 读取当前脉冲位置
-    int currentPulses = 0;
-    if (m_driver->getPulsePosition(currentPulses)) {
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<int> r;
+        r.ok = driver.getPulsePosition(r.value);
+        return r;
+    }, this, [this](const BusResult<int> &r) {
+        if (!r.ok) {
+            QMessageBox::warning(this, "Error", "Failed to read pulse position.");
+            return;
+        }
+
         // 2. 询问新位置
+        int currentPulses = r.value;
         bool ok;
-        int newPulses = QInputDialog::getInt(this, "Pulse Position", 
-            QString("Current Pulses: %1\nEnter target pulses:").arg(currentPulses), 
+        int newPulses = QInputDialog::getInt(this, "Pulse Position",
+            QString("Current Pulses: %1\nEnter target pulses:").arg(currentPulses),
             currentPulses, -2147483647, 2147483647, 1, &ok);
-        
+
         if (ok) {
-            if (m_driver->setTargetPulsePosition(newPulses)) {
-                qDebug() << "Target pulses set to" << newPulses;
-            } else {
-                QMessageBox::warning(this, "Error", "Failed to set target pulse position.");
-            }
+            m_bus->call([newPulses](AgeMotionDriver &driver) {
+                return driver.setTargetPulsePosition(newPulses);
+            }, this, [this, newPulses](bool ok) {
+                if (ok) {
+                    qDebug() << "Target pulses set to" << newPulses;
+                } else {
+                    QMessageBox::warning(this, "Error", "Failed to set target pulse position.");
+                }
+            });
         }
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to read pulse position.");
-    }
+    });
+}
+
+void MainWindow::refreshDiagnostics(bool reset)
+{
+    AGE_TRACE_FUNCTION("gui");
+    if (!m_diagDock->isVisible() && !reset) return;
+    AgeBusThread *bus = m_bus;
+    m_bus->call([bus, reset](AgeMotionDriver &) {
+        return bus->collectDiagnostics(reset);
+    }, this, [this](const AgeBusDiagnostics &diag) {
+        QString text = diag.toText();
+        if (m_recorder) {
+            text += QString("\nRecording %1: %2 samples, %3 dropped, %4 MB\n")
+                        .arg(m_recorder->fileName()).arg(m_recorder->recorded()).arg(m_recorder->dropped())
+                        .arg(m_recorder->bytesUsed() / (1024.0 * 1024.0), 0, 'f', 1);
+        }
+        if (m_rpc) {
+            const AgeRpcServer::Stats rpc = m_rpc->stats();
+            text += QString("\nRPC %1: %2 client(s), %3 requests, %4 status from snapshot, "
+                            "%5 commands posted, %6 merged, %7 telemetry sent, %8 dropped\n")
+                        .arg(m_rpc->serverName()).arg(rpc.clients).arg(rpc.requests).arg(rpc.statusServed)
+                        .arg(rpc.commandsPosted).arg(rpc.commandsMerged).arg(rpc.telemetrySent).arg(rpc.telemetryDropped);
+        }
+        if (m_shm) {
+            text += QString("\nShared memory %1: %2 samples published\n").arg(m_shmName).arg(m_shm->published());
+        }
+        m_diagText->setPlainText(text);
+    }, AgeBusThread::Priority::Telemetry);
 }
 
 void MainWindow::updateStatus()
 {
-    // 1. 基础运动信息
-    double pos = 0;
-    if (m_driver->getPosition(pos)) {
-        ui->lblPosition->setText(QString("Position: %1 um").arg(pos, 0, 'f', 2));
-    }
+    AGE_TRACE_FUNCTION("gui");
+    // 只读取总线线程发布的最新快照，不在 GUI 线程访问总线
+    const quint64 version = m_bus->snapshotVersion();
+    if (version == m_lastSnapshotVersion) return; // 没有新数据
 
-    double vel = 0;
-    if (m_driver->getTargetRPM(vel)) {
-        ui->lblVelocity->setText(QString("Target Velocity: %1 RPM").arg(vel, 0, 'f', 2));
-    }
+    DriveStatusSnapshot snap;
+    if (!m_bus->latestSnapshot(snap)) return;
+    m_lastSnapshotVersion = version;
 
-    double realVel = 0;
-    if (m_driver->getVelocity(realVel)) {
-        ui->lblRealVelocity->setText(QString("Real Velocity: %1 um/s").arg(realVel, 0, 'f', 2));
+    // 1. 基础运动信息
+    if (snap.has(DriveStatusSnapshot::GroupPosition)) {
+        ui->lblPosition->setText(QString("Position: %1 um").arg(snap.positionUm, 0, 'f', 2));
+        ui->lblPulse->setText(QString("Pulse: %1").arg(snap.pulsePosReal));
     }
 
-    // 2. 扩展信息 (脉冲、电流、温度)
-    int pulses = 0;
-    if (m_driver->getPulsePosition(pulses)) {
-        ui->lblPulse->setText(QString("Pulse: %1").arg(pulses));
+    if (snap.has(DriveStatusSnapshot::GroupVelocity)) {
+        ui->lblVelocity->setText(QString("Target Velocity: %1 RPM").arg(snap.targetRPM, 0, 'f', 2));
+        ui->lblRealVelocity->setText(QString("Real Velocity: %1 um/s").arg(snap.realVelocityUmPerSec, 0, 'f', 2));
     }
 
-    double current = 0;
-    if (m_driver->getRealTimeCurrent(current)) {
-        ui->lblCurrent->setText(QString("Current: %1 A").arg(current, 0, 'f', 2));
+    // 2. 扩展信息 (电流、温度)
+    if (snap.has(DriveStatusSnapshot::GroupCurrent)) {
+        ui->lblCurrent->setText(QString("Current: %1 A").arg(snap.currentA, 0, 'f', 2));
     }
 
-    int temp = 0;
-    if (m_driver->getCpuTemperature(temp)) {
-        ui->lblTemp->setText(QString("Temp: %1 C").arg(temp));
+    if (snap.has(DriveStatusSnapshot::GroupTemperature)) {
+        ui->lblTemp->setText(QString("Temp: %1 C").arg(snap.cpuTemp));
     }
-    
+
     // 3. 状态标志位更新
+    // 注意：限位状态 (isLimitSensorTriggered) 尚未实现，暂不显示
     QString statusStr;
-    bool upper = false, lower = false;
-    if (m_driver->isLimitSensorTriggered(upper, lower)) {
-        if (upper) statusStr += "[UPPER] ";
-        if (lower) statusStr += "[LOWER] ";
-    }
 
-    bool isMotionDone = false;
-    if (m_driver->isMotionComplete(isMotionDone)) {
-        if (isMotionDone) statusStr += "[IDLE] ";
+    if (snap.has(DriveStatusSnapshot::GroupPosition)) {
+        if (snap.isMotionDone) statusStr += "[IDLE] ";
         else statusStr += "[MOVING] ";
     }
 
-    int err = m_driver->checkError();
-    if (err > 0) {
+    const bool noResponse = (snap.freshGroups == 0);
+    if (noResponse) statusStr += "[NO RESPONSE] ";
+
+    // 各分组按不同频率刷新，故障码取最近一次读到的值
+    int err = snap.has(DriveStatusSnapshot::GroupControl) ? (int)snap.errorCode : -1;
+    if (err > 0 || noResponse) {
         statusStr += QString("[ERR: %1]").arg(err);
         ui->lblStatusInfo->setStyleSheet("color: red; font-weight: bold;");
     } else {
@@ -271,9 +552,9 @@ void MainWindow::updateStatus()
 
     if (statusStr.isEmpty()) statusStr = "Status: OK";
     ui->lblStatusInfo->setText(statusStr);
-    
+
     // 状态栏同步显示
-    if (err > 0 || upper || lower) {
+    if (err > 0 || noResponse) {
          ui->statusbar->showMessage(statusStr);
     } else {
          ui->statusbar->clearMessage();
@@ -282,83 +563,152 @@ void MainWindow::updateStatus()
 
 void MainWindow::on_btnTestResolution_clicked()
 {
-    unsigned int currentRes = 0;
-    if (m_driver->getSingleToothResolution(currentRes)) {
-        QMessageBox::information(this, "Single Tooth Resolution", 
-            QString("Current Resolution: %1").arg(currentRes));
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to read resolution.");
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<unsigned int> r;
+        r.ok = driver.getSingleToothResolution(r.value);
+        return r;
+    }, this, [this](const BusResult<unsigned int> &r) {
+        if (r.ok) {
+            QMessageBox::information(this, "Single Tooth Resolution",
+                QString("Current Resolution: %1").arg(r.value));
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to read resolution.");
+        }
+    });
 }
 
 void MainWindow::on_btnTestPulseStep_clicked()
 {
-    double currentStepUm = 0.0;
-    if (m_driver->getMinStepUm(currentStepUm)) {
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<double> r;
+        r.ok = driver.getMinStepUm(r.value);
+        return r;
+    }, this, [this](const BusResult<double> &r) {
+        if (!r.ok) {
+            QMessageBox::warning(this, "Error", "Failed to read min step length.");
+            return;
+        }
+
+        double currentStepUm = r.value;
         bool ok;
         double newStepUm = QInputDialog::getDouble(this, "Min Step Length (um)",
             QString("Current Step Length: %1 um\nEnter new step length (um):").arg(currentStepUm),
             currentStepUm, 0.001, 1000.0, 3, &ok);
 
         if (ok) {
-            if (m_driver->setMinStepUm(newStepUm)) {
-                QMessageBox::information(this, "Success", QString("Min Step Length set to %1 um").arg(newStepUm));
-            } else {
-                QMessageBox::warning(this, "Error", "Failed to set min step length.");
-            }
+            m_bus->call([newStepUm](AgeMotionDriver &driver) {
+                return driver.setMinStepUm(newStepUm);
+            }, this, [this, newStepUm](bool ok) {
+                if (ok) {
+                    QMessageBox::information(this, "Success", QString("Min Step Length set to %1 um").arg(newStepUm));
+                } else {
+                    QMessageBox::warning(this, "Error", "Failed to set min step length.");
+                }
+            });
         }
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to read min step length.");
-    }
+    });
 }
 
 void MainWindow::on_btnGetTargetVelUm_clicked()
 {
-    double vel = 0;
-    if (m_driver->getTargetVelocity(vel)) {
-        QMessageBox::information(this, "Target Velocity", QString("Target Velocity: %1 um/s").arg(vel));
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to get target velocity: " + m_driver->getLastError());
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<double> r;
+        r.ok = driver.getTargetVelocity(r.value);
+        r.error = driver.getLastError();
+        return r;
+    }, this, [this](const BusResult<double> &r) {
+        if (r.ok) {
+            QMessageBox::information(this, "Target Velocity", QString("Target Velocity: %1 um/s").arg(r.value));
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to get target velocity: " + r.error);
+        }
+    });
 }
 
 void MainWindow::on_btnSetTargetVelUm_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     bool ok;
     double vel = QInputDialog::getDouble(this, "Set Target Velocity", "Enter velocity (um/s):", 1000, 0, 100000, 1, &ok);
     if (ok) {
-        if (m_driver->setTargetVelocity(vel)) {
-            QMessageBox::information(this, "Success", QString("Target Velocity set to %1 um/s").arg(vel));
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to set target velocity: " + m_driver->getLastError());
-        }
+        m_bus->call([vel](AgeMotionDriver &driver) {
+            BusResult<bool> r;
+            r.ok = driver.setTargetVelocity(vel);
+            r.error = driver.getLastError();
+            return r;
+        }, this, [this, vel](const BusResult<bool> &r) {
+            if (r.ok) {
+                QMessageBox::information(this, "Success", QString("Target Velocity set to %1 um/s").arg(vel));
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to set target velocity: " + r.error);
+            }
+        });
     }
 }
 
 void MainWindow::on_btnSetJogVel_clicked()
 {
+    AGE_TRACE_FUNCTION("gui");
     bool ok;
     double vel  = QInputDialog::getDouble(this, "Set Jog Velocity", "Enter velocity (um/s):", 0, -100000, 100000, 1, &ok);
     if (ok) {
-        if (m_driver->setVelocity(vel)) {
-            if (qAbs(vel) < 0.001)
-                qDebug() << "Jog Motion Stopped.";
-            else
-                qDebug() << "Jogging at" << vel << "um/s";
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to set jog velocity: " + m_driver->getLastError());
-        }
+        m_bus->call([vel](AgeMotionDriver &driver) {
+            BusResult<bool> r;
+            r.ok = driver.setVelocity(vel);
+            r.error = driver.getLastError();
+            return r;
+        }, this, [this, vel](const BusResult<bool> &r) {
+            if (r.ok) {
+                if (qAbs(vel) < 0.001)
+                    qDebug() << "Jog Motion Stopped.";
+                else
+                    qDebug() << "Jogging at" << vel << "um/s";
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to set jog velocity: " + r.error);
+            }
+        });
     }
 }
 
 void MainWindow::on_btnGetRealVel_clicked()
 {
-    double vel = 0;
-    if (m_driver->getVelocity(vel)) {
-        QMessageBox::information(this, "Real Velocity", QString("Real Velocity: %1 um/s").arg(vel));
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to get real velocity: " + m_driver->getLastError());
-    }
+    AGE_TRACE_FUNCTION("gui");
+    m_bus->call([](AgeMotionDriver &driver) {
+        BusResult<double> r;
+        r.ok = driver.getVelocity(r.value);
+        r.error = driver.getLastError();
+        return r;
+    }, this, [this](const BusResult<double> &r) {
+        if (r.ok) {
+            QMessageBox::information(this, "Real Velocity", QString("Real Velocity: %1 um/s").arg(r.value));
+        } else {
+            QMessageBox::warning(this, "Error", "Failed to get real velocity: " + r.error);
+        }
+    });
 }
 
-
+void MainWindow::updateChart()
+{
+    AGE_TRACE_FUNCTION("gui");
+    // 面板隐藏时也取出样本，曲线图只累计不绘制，再次显示时历史完整
+    AgeTelemetrySample samples[CHART_DRAIN_BATCH];
+    int count;
+    while ((count = m_bus->telemetry().read(m_chartReader, samples, CHART_DRAIN_BATCH)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            const AgeTelemetrySample &sample = samples[i];
+            if (sample.axis != 0) continue;
+            if (sample.freshGroups & DriveStatusSnapshot::GroupPosition) {
+                m_chart->addSample(m_chartPosition, sample.timestampUs, sample.positionUm);
+            }
+            if (sample.freshGroups & DriveStatusSnapshot::GroupVelocity) {
+                m_chart->addSample(m_chartVelocity, sample.timestampUs, sample.velocityUmPerSec);
+            }
+        }
+        if (count < CHART_DRAIN_BATCH) break;
+    }
+    m_chart->setDroppedSamples(m_chartReader.overruns());
+    m_chart->advanceTo(AgeMotionDriver::monotonicUs());
+}
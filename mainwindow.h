@@ -3,7 +3,12 @@
 
 #include <QMainWindow>
 #include <QTimer>
-#include "AgeMotionDriver.h"
+#include <QPlainTextEdit>
+#include <QDockWidget>
+#include "AgeBusThread.h"
+#include "AgeConnectionManager.h"
+#include "AgeRpcServer.h"
+#include "AgeStripChart.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -44,11 +49,31 @@ private slots:
     void on_btnSetJogVel_clicked();
     void on_btnGetRealVel_clicked();
 
-    void updateStatus(); // 定时更新状态槽函数
+    void updateStatus(); // 定时刷新显示 (只读总线线程发布的快照)
+    void refreshDiagnostics(bool reset = false); // 总线诊断面板 (面板可见时每秒刷新)
+    void updateChart();  // 取出遥测环形缓冲的新样本送入曲线图 (每帧)
 
 private:
     Ui::MainWindow *ui;
-    AgeMotionDriver *m_driver;
+    AgeBusThread *m_bus;   // 总线线程，独占 AgeMotionDriver
+    AgeConnectionManager *m_connection; // 连接与掉线自动重连
     QTimer *m_timer;
+    quint64 m_lastSnapshotVersion = 0;
+
+    QDockWidget *m_diagDock;
+    QPlainTextEdit *m_diagText;
+    QTimer *m_diagTimer;
+
+    QDockWidget *m_chartDock;
+    AgeStripChart *m_chart;
+    QTimer *m_chartTimer;
+    AgeTelemetryRing::Reader m_chartReader;
+    int m_chartPosition = -1;
+    int m_chartVelocity = -1;
+
+    QSharedPointer<AgeTelemetryRecorder> m_recorder;  // 记录中时非空 (写入在总线线程)
+    AgeRpcServer *m_rpc = nullptr;  // 设置了 AGEMOTION_RPC_SERVER 时非空
+    QSharedPointer<AgeTelemetryPublisher> m_shm;  // 设置了 AGEMOTION_SHM 时非空 (写入在总线线程)
+    QString m_shmName;
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,440 @@
+#include "AgeDriveSim.h"
+#include "AgeRtuFrame.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+AgeDriveSim::AgeDriveSim(quint8 station)
+    : m_station(station)
+    , m_rng(station)
+{
+    std::memset(m_regs, 0, sizeof(m_regs));
+
+    // --- 寄存器表: 只有定义过的地址可以访问 ---
+    define(ADDR_CONTROL, 10, true);          // 0x0000-0x0009 控制/故障/输入类型
+    define(0x0010, 16, false);               // 0x0010-0x001F 电流
+    define(ADDR_CURRENT_SET, 3, true);       //   设定电流/降流百分比/降流等待
+    define(0x001E, 1, true);                 //   刹车电压
+    define(ADDR_POS_REAL, 0x20, false);      // 0x0020-0x003F 位置
+    define(ADDR_POS_TARGET, 4, true);
+    define(ADDR_T_RESOLUTION, 4, true);      //   单齿分辨率 + 脉冲步进长度
+    define(ADDR_PULSE_POS_SET, 2, true);
+    define(0x0030, 6, true);                 //   位差报错/到位误差/到位时间
+    define(ADDR_VEL_SET, 7, false);          // 0x0040-0x0046 速度
+    define(ADDR_VEL_SET, 5, true);
+    define(ADDR_VEL_ZERO, 1, true);
+    define(0x0060, 5, true);                 // 0x0060-0x0064 总线
+    define(0x0080, 1, false);                // IO 端口状态
+    define(0x0091, 2, true);                 // 输入带宽
+    define(ADDR_CPU_TEMP, 1, false);
+    define(ADDR_MOTOR_SN0, 4, false);
+    define(ADDR_DRIVER_NAME, 16, false);
+
+    // --- 出厂默认值 ---
+    m_regs[0x0010] = 300;                    // 最大 3.00A
+    m_regs[0x0011] = 10;
+    m_regs[ADDR_CURRENT_SET] = 150;          // 1.50A
+    m_regs[ADDR_CURRENT_LOW] = 50;           // 闲时 50%
+    m_regs[0x0014] = 500;
+    set32(ADDR_T_RESOLUTION, 76800);
+    set32(ADDR_PULSE_LENGTH, 640);
+    set32(0x0032, 16000);                    // 到位允许误差 0.5um
+    m_regs[0x0034] = 10;
+    m_regs[ADDR_VEL_SET] = 50;               // 50 * 20 * 1000 MMS/s ≈ 31um/s
+    m_regs[ADDR_VEL_START] = 1;
+    m_regs[ADDR_VEL_FILTER] = 50;            // 加减速时间 (ms)
+    m_regs[ADDR_VEL_KV] = 20;
+    m_regs[ADDR_VEL_ZERO] = 25;
+    m_regs[ADDR_BUS_ADDR] = station;
+    set32(ADDR_BUS_BAUD, 115200);
+    m_regs[ADDR_CPU_TEMP] = 38;
+    set64(ADDR_MOTOR_SN0, 0x5349'4D00'0000'0000ULL | station);
+
+    // 型号字符串: 每个寄存器两个字符，高字节在前
+    const char name[] = "ASD9010-SIM";
+    for (int i = 0; i < (int)sizeof(name) - 1; i += 2) {
+        const quint8 hi = (quint8)name[i];
+        const quint8 lo = (i + 1 < (int)sizeof(name) - 1) ? (quint8)name[i + 1] : 0;
+        m_regs[ADDR_DRIVER_NAME + i / 2] = (quint16)((hi << 8) | lo);
+    }
+
+    syncStatusRegisters();
+}
+
+void AgeDriveSim::define(quint16 addr, int words, bool writable)
+{
+    for (int i = 0; i < words; ++i) {
+        m_readable.set(addr + i);
+        if (writable) m_writable.set(addr + i);
+    }
+}
+
+bool AgeDriveSim::readable(quint16 addr, int count) const
+{
+    if (addr + count > 0x10000) return false;
+    for (int i = 0; i < count; ++i) {
+        if (!m_readable.test(addr + i)) return false;
+    }
+    return true;
+}
+
+bool AgeDriveSim::writable(quint16 addr, int count) const
+{
+    if (addr + count > 0x10000) return false;
+    for (int i = 0; i < count; ++i) {
+        if (!m_writable.test(addr + i)) return false;
+    }
+    return true;
+}
+
+// --- 多字寄存器: 低地址为低字，与 AgeRtu::packU32/packU64 一致 ---
+
+qint64 AgeDriveSim::get64(quint16 addr) const
+{
+    return (qint64)AgeRtu::unpackU64(m_regs + addr);
+}
+
+void AgeDriveSim::set64(quint16 addr, qint64 value)
+{
+    AgeRtu::packU64((quint64)value, m_regs + addr);
+}
+
+quint32 AgeDriveSim::get32(quint16 addr) const
+{
+    return AgeRtu::unpackU32(m_regs + addr);
+}
+
+void AgeDriveSim::set32(quint16 addr, quint32 value)
+{
+    AgeRtu::packU32(value, m_regs + addr);
+}
+
+bool AgeDriveSim::chance(double rate)
+{
+    if (rate <= 0.0) return false;
+    return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) < rate;
+}
+
+int AgeDriveSim::nextResponseDelayUs()
+{
+    int delay = m_faults.latencyUs;
+    if (m_faults.jitterUs > 0) {
+        delay += std::uniform_int_distribution<int>(0, m_faults.jitterUs)(m_rng);
+    }
+    return delay;
+}
+
+// ==========================================
+//          请求处理 (FC03 / FC06 / FC16)
+// ==========================================
+
+int AgeDriveSim::handleRequest(const quint8 *request, int length, quint8 *response)
+{
+    if (length < 4) return 0;
+    const quint8 station = request[0];
+    const quint8 function = request[1];
+    const bool broadcast = (station == 0);
+    if (!broadcast && station != m_station) return 0;
+
+    // 注入: 请求丢失 (不执行、不应答)
+    if (!broadcast && chance(m_faults.dropRate)) return 0;
+
+    int len = 0;
+    if (!broadcast && chance(m_faults.exceptionRate)) {
+        len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_DEVICE_FAILURE);
+    } else {
+        switch (function) {
+        case AgeRtu::FC_READ_HOLDING: {
+            const quint16 reg = AgeRtu::getU16(request + 2);
+            const quint16 count = AgeRtu::getU16(request + 4);
+            if (broadcast) return 0; // 广播不允许读
+            if (count == 0 || count > 125) {
+                len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_VALUE);
+            } else if (!readable(reg, count)) {
+                len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_ADDRESS);
+            } else {
+                len = AgeRtu::encodeReadResponse(response, m_station, m_regs + reg, count);
+            }
+            break;
+        }
+        case AgeRtu::FC_WRITE_SINGLE: {
+            const quint16 reg = AgeRtu::getU16(request + 2);
+            const quint16 value = AgeRtu::getU16(request + 4);
+            if (!writable(reg, 1)) {
+                len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_ADDRESS);
+            } else if (!acceptsWrite(reg, &value, 1)) {
+                len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_VALUE);
+            } else {
+                writeRegisters(reg, &value, 1);
+                len = AgeRtu::encodeWriteSingleResponse(response, m_station, reg, value);
+            }
+            break;
+        }
+        case AgeRtu::FC_WRITE_MULTIPLE: {
+            const quint16 reg = AgeRtu::getU16(request + 2);
+            const quint16 count = AgeRtu::getU16(request + 4);
+            if (count == 0 || count > 123 || request[6] != count * 2 || length != 9 + count * 2) {
+                len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_VALUE);
+            } else if (!writable(reg, count)) {
+                len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_ADDRESS);
+            } else {
+                quint16 values[123];
+                for (int i = 0; i < count; ++i) values[i] = AgeRtu::getU16(request + 7 + i * 2);
+                if (!acceptsWrite(reg, values, count)) {
+                    len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_VALUE);
+                } else {
+                    writeRegisters(reg, values, count);
+                    len = AgeRtu::encodeWriteMultipleResponse(response, m_station, reg, count);
+                }
+            }
+            break;
+        }
+        default:
+            len = AgeRtu::encodeException(response, m_station, function, AgeRtu::EX_ILLEGAL_FUNCTION);
+            break;
+        }
+    }
+
+    if (broadcast) return 0; // 广播执行但不应答
+
+    // 注入: 应答 CRC 损坏
+    if (len > 0 && chance(m_faults.crcErrorRate)) {
+        response[len - 1] ^= 0x5A;
+    }
+    return len;
+}
+
+// 波特率只接受 9600-m_maxBaudRate 的标准值 (只写一半的 ADDR_BUS_BAUD 不检查)
+bool AgeDriveSim::acceptsWrite(quint16 addr, const quint16 *values, int count) const
+{
+    if (addr > ADDR_BUS_BAUD || addr + count < ADDR_BUS_BAUD + 2) return true;
+    const quint32 baud = AgeRtu::unpackU32(values + (ADDR_BUS_BAUD - addr));
+    static const quint32 standard[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600};
+    for (quint32 rate : standard) {
+        if (rate == baud) return baud <= m_maxBaudRate;
+    }
+    return false;
+}
+
+void AgeDriveSim::writeRegisters(quint16 addr, const quint16 *values, int count)
+{
+    const int end = addr + count;
+    auto touches = [addr, end](int reg, int words) { return addr < reg + words && end > reg; };
+
+    for (int i = 0; i < count; ++i) {
+        if (addr + i == ADDR_CONTROL) continue; // 控制字单独处理
+        m_regs[addr + i] = values[i];
+    }
+
+    if (touches(ADDR_PULSE_POS_SET, 2)) {
+        // 脉冲目标位置 -> 目标位置 (MMS)
+        const qint64 pulses = (qint32)get32(ADDR_PULSE_POS_SET);
+        set64(ADDR_POS_TARGET, pulses * (qint64)get32(ADDR_PULSE_LENGTH));
+    }
+    if (touches(ADDR_POS_TARGET, 4) || touches(ADDR_PULSE_POS_SET, 2)) {
+        m_mode = Mode::Position;
+        m_regs[ADDR_CONTROL] &= (quint16)~(CTRL_HOME_LOW | CTRL_HOME_HIGH | CTRL_LIMIT_UPPER | CTRL_LIMIT_LOWER);
+    }
+    if (touches(ADDR_CONTROL, 1)) {
+        onControlWritten(values[ADDR_CONTROL - addr]);
+    }
+}
+
+// ==========================================
+//          控制字
+// ==========================================
+// 停止/急停/复位/清零为一次性命令，执行后不保留；
+// 回零与限位运动位在动作完成前保持为 1 (isHomingComplete 依赖此行为)；
+// 0x0004 为保持位，仅在不含一次性命令的写入中更新 (setEnable 为读-改-写)
+void AgeDriveSim::onControlWritten(quint16 ctrl)
+{
+    quint16 state = m_regs[ADDR_CONTROL];
+    const quint16 oneShot = CTRL_RESET | CTRL_ZERO_OFFSET | CTRL_STOP | CTRL_ESTOP;
+    const quint16 running = CTRL_HOME_LOW | CTRL_HOME_HIGH | CTRL_LIMIT_UPPER | CTRL_LIMIT_LOWER;
+
+    if ((ctrl & oneShot) == 0) {
+        state = (quint16)((state & ~CTRL_FREE) | (ctrl & CTRL_FREE));
+    }
+
+    if (ctrl & (CTRL_ESTOP | CTRL_RESET)) {
+        // 急停/复位: 立即停在当前位置
+        if (ctrl & CTRL_RESET) m_regs[ADDR_ERROR_CODE] = 0;
+        m_velMms = 0.0;
+        m_mode = Mode::Position;
+        set64(ADDR_POS_TARGET, std::llround(m_posMms));
+        state &= (quint16)~running;
+    } else if (ctrl & CTRL_STOP) {
+        // 停止: 按当前加速度减速，目标位置改为停止点
+        const double a = accelerationMms();
+        double stopPoint = m_posMms;
+        if (a > 0.0) {
+            const double dist = m_velMms * m_velMms / (2.0 * a);
+            stopPoint += (m_velMms >= 0.0 ? dist : -dist);
+        }
+        m_mode = Mode::Position;
+        set64(ADDR_POS_TARGET, std::llround(stopPoint));
+        state &= (quint16)~running;
+    } else if (ctrl & (CTRL_HOME_LOW | CTRL_HOME_HIGH)) {
+        const quint16 dir = (ctrl & CTRL_HOME_HIGH) ? CTRL_HOME_HIGH : CTRL_HOME_LOW;
+        if (!(m_mode == Mode::Homing && (state & dir))) { // 回零中重复写入相同方向不重新开始
+            m_mode = Mode::Homing;
+            state = (quint16)((state & ~running) | dir);
+        }
+    } else if (ctrl & (CTRL_LIMIT_UPPER | CTRL_LIMIT_LOWER)) {
+        const bool up = (ctrl & CTRL_LIMIT_UPPER) != 0;
+        m_mode = up ? Mode::LimitUpper : Mode::LimitLower;
+        state = (quint16)((state & ~running) | (up ? CTRL_LIMIT_UPPER : CTRL_LIMIT_LOWER));
+    }
+
+    if (ctrl & CTRL_ZERO_OFFSET) {
+        // 当前位置清零，目标位置随之平移
+        const qint64 offset = std::llround(m_posMms);
+        set64(ADDR_POS_TARGET, get64(ADDR_POS_TARGET) - offset);
+        m_posMms -= (double)offset;
+    }
+
+    m_regs[ADDR_CONTROL] = state;
+    syncStatusRegisters();
+}
+
+// ==========================================
+//          运动模型
+// ==========================================
+
+double AgeDriveSim::speedLimitMms() const
+{
+    // MMS/s = VelSet * KV * 1000 (与 AgeMotionDriver 的 RPM 换算一致)
+    const quint16 vel = (m_mode == Mode::Homing) ? m_regs[ADDR_VEL_ZERO] : m_regs[ADDR_VEL_SET];
+    return (double)vel * m_regs[ADDR_VEL_KV] * 1000.0;
+}
+
+double AgeDriveSim::accelerationMms() const
+{
+    // VEL_FILTER 视为 0 -> 最高速度的加速时间 (ms)，0 表示不做加减速
+    const double vmax = speedLimitMms();
+    const quint16 filterMs = m_regs[ADDR_VEL_FILTER];
+    if (filterMs == 0) return vmax * 1000.0;
+    return vmax / (filterMs / 1000.0);
+}
+
+double AgeDriveSim::targetMms() const
+{
+    switch (m_mode) {
+    case Mode::Homing:
+        return (double)m_referenceMms; // 两个方向的搜索都停在同一个参考开关
+    case Mode::LimitUpper:
+        return (double)m_upperLimitMms;
+    case Mode::LimitLower:
+        return (double)m_lowerLimitMms;
+    default:
+        return (double)get64(ADDR_POS_TARGET);
+    }
+}
+
+bool AgeDriveSim::isMoving() const
+{
+    return m_velMms != 0.0 || std::llround(m_posMms) != std::llround(targetMms());
+}
+
+void AgeDriveSim::advance(qint64 nowUs)
+{
+    if (m_lastUs == 0 || nowUs <= m_lastUs) {
+        if (m_lastUs == 0) m_lastUs = nowUs;
+        return;
+    }
+    qint64 elapsed = nowUs - m_lastUs;
+    m_lastUs = nowUs;
+    if (elapsed > 10000000) elapsed = 10000000; // 长时间未推进时最多补 10 s
+
+    // 1 ms 步长积分
+    while (elapsed > 0) {
+        const qint64 step = elapsed > 1000 ? 1000 : elapsed;
+        stepMotion(step / 1e6);
+        elapsed -= step;
+    }
+    syncStatusRegisters();
+}
+
+void AgeDriveSim::stepMotion(double dt)
+{
+    if (m_freeBlocksMotion && (m_regs[ADDR_CONTROL] & CTRL_FREE)) {
+        m_velMms = 0.0;
+        return;
+    }
+
+    const double target = targetMms();
+    const double d = target - m_posMms;
+    if (d == 0.0 && m_velMms == 0.0) return;
+
+    const double vmax = speedLimitMms();
+    const double a = accelerationMms();
+    if (vmax <= 0.0 || a <= 0.0) {
+        m_velMms = 0.0;
+        return;
+    }
+
+    const double dir = d >= 0.0 ? 1.0 : -1.0;
+    double speed = m_velMms * dir; // 沿目标方向的速度，负值表示正在反向运动
+    const double floorSpeed = std::max((double)m_regs[ADDR_VEL_START] * m_regs[ADDR_VEL_KV] * 1000.0, a * dt);
+
+    if (speed < 0.0) {
+        speed += a * dt;                              // 先减速反向
+    } else if (speed * speed / (2.0 * a) >= std::fabs(d)) {
+        speed = std::max(speed - a * dt, floorSpeed);  // 减速段
+    } else {
+        speed = std::min(std::max(speed + a * dt, std::min(floorSpeed, vmax)), vmax); // 加速/匀速段
+    }
+
+    const double stepMms = speed * dt;
+    if (speed > 0.0 && stepMms >= std::fabs(d)) {
+        m_posMms = target;
+        m_velMms = 0.0;
+        onArrived();
+        return;
+    }
+    m_posMms += dir * stepMms;
+    m_velMms = dir * speed;
+}
+
+void AgeDriveSim::onArrived()
+{
+    switch (m_mode) {
+    case Mode::Homing:
+        // 回零完成: 参考点即为零点
+        m_posMms = 0.0;
+        set64(ADDR_POS_TARGET, 0);
+        m_regs[ADDR_CONTROL] &= (quint16)~(CTRL_HOME_LOW | CTRL_HOME_HIGH);
+        break;
+    case Mode::LimitUpper:
+    case Mode::LimitLower:
+        set64(ADDR_POS_TARGET, std::llround(m_posMms));
+        m_regs[ADDR_CONTROL] &= (quint16)~(CTRL_LIMIT_UPPER | CTRL_LIMIT_LOWER);
+        break;
+    default:
+        break;
+    }
+    m_mode = Mode::Position;
+}
+
+void AgeDriveSim::syncStatusRegisters()
+{
+    const qint64 pos = std::llround(m_posMms);
+    set64(ADDR_POS_REAL, pos);
+    set64(ADDR_POS_ERROR, 0);
+
+    const quint32 pulseLength = get32(ADDR_PULSE_LENGTH);
+    set32(ADDR_PULSE_POS_REAL, (quint32)(qint32)(pulseLength ? pos / (qint64)pulseLength : 0));
+
+    const quint16 kv = m_regs[ADDR_VEL_KV] ? m_regs[ADDR_VEL_KV] : 1;
+    m_regs[ADDR_VEL_REAL] = (quint16)(qint16)std::lround(m_velMms / (kv * 1000.0));
+
+    // 运行时为设定电流，静止时按降流百分比，脱机为 0
+    quint16 current = m_regs[ADDR_CURRENT_SET];
+    if (m_freeBlocksMotion && (m_regs[ADDR_CONTROL] & CTRL_FREE)) {
+        current = 0;
+    } else if (m_velMms == 0.0) {
+        current = (quint16)(current * m_regs[ADDR_CURRENT_LOW] / 100);
+    }
+    m_regs[ADDR_CURRENT_REAL] = current;
+    m_regs[ADDR_CPU_TEMP] = (quint16)(qint16)(35 + current / 50);
+}
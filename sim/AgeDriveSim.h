@@ -0,0 +1,138 @@
+#ifndef AGEDRIVESIM_H
+#define AGEDRIVESIM_H
+
+#include <QtGlobal>
+#include <bitset>
+#include <random>
+
+// ==========================================
+//   ASD90XX 虚拟驱动器 (寄存器表 + 运动模型)
+// ==========================================
+// - 寄存器地址与 AgeReg 一致，未定义的地址返回非法地址异常
+// - 控制字: 0x0001 复位, 0x0004 使能/脱机, 0x0010/0x0020 上/下限位运动,
+//           0x0100 位置清零, 0x0400/0x0800 向低/高回零, 0x1000 停止, 0x2000 急停
+// - 运动: 目标位置写入后按 ADDR_VEL_SET 限速、ADDR_VEL_FILTER 加减速时间做梯形运动
+// - 可注入应答延迟、丢帧、CRC 错误、异常应答与故障码
+// 非线程安全，由调用方 (AgeSimPty / 基准程序) 在单线程中使用
+class AgeDriveSim
+{
+public:
+    struct Faults {
+        int latencyUs = 0;            // 固定应答延迟 (微秒)
+        int jitterUs = 0;             // 附加随机延迟 0 ~ jitterUs
+        double dropRate = 0.0;        // 不应答概率 (主站超时)
+        double crcErrorRate = 0.0;    // 应答 CRC 损坏概率
+        double exceptionRate = 0.0;   // 返回从站故障异常的概率
+    };
+
+    explicit AgeDriveSim(quint8 station = 1);
+
+    quint8 station() const { return m_station; }
+    void setFaults(const Faults &faults) { m_faults = faults; }
+    const Faults &faults() const { return m_faults; }
+
+    // 处理一帧请求 (已通过 CRC 校验)，返回应答长度；0 表示不应答 (广播或注入丢帧)
+    int handleRequest(const quint8 *request, int length, quint8 *response);
+    // 本次应答的延迟 (固定延迟 + 抖动)
+    int nextResponseDelayUs();
+
+    // 推进仿真时钟 (单调时钟, 微秒)
+    void advance(qint64 nowUs);
+
+    // 直接访问寄存器与状态 (测试/基准使用)
+    quint16 reg(quint16 addr) const { return m_regs[addr]; }
+    void setReg(quint16 addr, quint16 value) { m_regs[addr] = value; }
+    void injectError(quint16 code) { m_regs[ADDR_ERROR_CODE] = code; }
+    // 总线波特率 (ADDR_BUS_BAUD)；写入在应答发出后生效。超过上限或非标准值的写入返回非法数据异常
+    quint32 busBaudRate() const { return get32(ADDR_BUS_BAUD); }
+    void setMaxBaudRate(quint32 baud) { m_maxBaudRate = baud; }
+    double positionMms() const { return m_posMms; }
+    double velocityMmsPerSec() const { return m_velMms; }
+    bool isMoving() const;
+
+    // 0x0004 的含义: 驱动层按"使能"使用，厂商示例称其为"Free"(脱机)。
+    // 默认只保存该位；置 true 时按脱机处理，该位为 1 期间不执行运动
+    void setFreeBitBlocksMotion(bool blocks) { m_freeBlocksMotion = blocks; }
+
+    // 限位位置 (MMS)，限位运动的终点；回零开关位置 (MMS)，回零完成后该处记为 0
+    void setLimits(qint64 lowerMms, qint64 upperMms) { m_lowerLimitMms = lowerMms; m_upperLimitMms = upperMms; }
+    void setReference(qint64 referenceMms) { m_referenceMms = referenceMms; }
+
+private:
+    enum class Mode { Position, Homing, LimitUpper, LimitLower };
+
+    // 与 AgeReg 相同的地址 (模拟器不依赖驱动头文件)
+    static constexpr quint16 ADDR_CONTROL        = 0x0000;
+    static constexpr quint16 ADDR_ERROR_CODE     = 0x0002;
+    static constexpr quint16 ADDR_CURRENT_SET    = 0x0012;
+    static constexpr quint16 ADDR_CURRENT_LOW    = 0x0013;
+    static constexpr quint16 ADDR_CURRENT_REAL   = 0x0015;
+    static constexpr quint16 ADDR_POS_REAL       = 0x0020;
+    static constexpr quint16 ADDR_POS_TARGET     = 0x0024;
+    static constexpr quint16 ADDR_T_RESOLUTION   = 0x0028;
+    static constexpr quint16 ADDR_PULSE_LENGTH   = 0x002A;
+    static constexpr quint16 ADDR_PULSE_POS_REAL = 0x002C;
+    static constexpr quint16 ADDR_PULSE_POS_SET  = 0x002E;
+    static constexpr quint16 ADDR_POS_ERROR      = 0x003A;
+    static constexpr quint16 ADDR_VEL_SET        = 0x0040;
+    static constexpr quint16 ADDR_VEL_START      = 0x0041;
+    static constexpr quint16 ADDR_VEL_FILTER     = 0x0042;
+    static constexpr quint16 ADDR_VEL_KV         = 0x0043;
+    static constexpr quint16 ADDR_VEL_REAL       = 0x0045;
+    static constexpr quint16 ADDR_VEL_ZERO       = 0x0046;
+    static constexpr quint16 ADDR_BUS_ADDR       = 0x0061;
+    static constexpr quint16 ADDR_BUS_BAUD       = 0x0063;
+    static constexpr quint16 ADDR_CPU_TEMP       = 0x0300;
+    static constexpr quint16 ADDR_MOTOR_SN0      = 0x2000;
+    static constexpr quint16 ADDR_DRIVER_NAME    = 0x8000;
+
+    static constexpr quint16 CTRL_RESET       = 0x0001;
+    static constexpr quint16 CTRL_FREE        = 0x0004;
+    static constexpr quint16 CTRL_LIMIT_UPPER = 0x0010;
+    static constexpr quint16 CTRL_LIMIT_LOWER = 0x0020;
+    static constexpr quint16 CTRL_ZERO_OFFSET = 0x0100;
+    static constexpr quint16 CTRL_HOME_LOW    = 0x0400;
+    static constexpr quint16 CTRL_HOME_HIGH   = 0x0800;
+    static constexpr quint16 CTRL_STOP       = 0x1000;
+    static constexpr quint16 CTRL_ESTOP      = 0x2000;
+
+    void define(quint16 addr, int words, bool writable);
+    bool readable(quint16 addr, int count) const;
+    bool writable(quint16 addr, int count) const;
+    void writeRegisters(quint16 addr, const quint16 *values, int count);
+    void onControlWritten(quint16 ctrl);
+    bool acceptsWrite(quint16 addr, const quint16 *values, int count) const;
+
+    qint64 get64(quint16 addr) const;
+    void set64(quint16 addr, qint64 value);
+    quint32 get32(quint16 addr) const;
+    void set32(quint16 addr, quint32 value);
+
+    double speedLimitMms() const;
+    double accelerationMms() const;
+    double targetMms() const;
+    void stepMotion(double dt);
+    void onArrived();
+    void syncStatusRegisters();
+    bool chance(double rate);
+
+    quint8 m_station;
+    Faults m_faults;
+    std::mt19937 m_rng;
+
+    quint16 m_regs[0x10000];
+    std::bitset<0x10000> m_readable;
+    std::bitset<0x10000> m_writable;
+
+    Mode m_mode = Mode::Position;
+    bool m_freeBlocksMotion = false;
+    quint32 m_maxBaudRate = 921600;
+    double m_posMms = 0.0;
+    double m_velMms = 0.0;
+    qint64 m_lastUs = 0;
+    qint64 m_lowerLimitMms = -2LL * 32000 * 1000;  // 默认 ±2mm
+    qint64 m_upperLimitMms = 2LL * 32000 * 1000;
+    qint64 m_referenceMms = -100LL * 32000;        // 默认 -100um
+};
+
+#endif // AGEDRIVESIM_H
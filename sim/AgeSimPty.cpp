@@ -0,0 +1,209 @@
+#include "AgeSimPty.h"
+#include "AgeDriveSim.h"
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+qint64 nowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+}
+
+AgeSimPty::AgeSimPty(const Config &config)
+    : m_config(config)
+{
+}
+
+AgeSimPty::~AgeSimPty()
+{
+    close();
+}
+
+bool AgeSimPty::open()
+{
+    if (m_masterFd >= 0) return true;
+
+    m_masterFd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (m_masterFd < 0 || ::grantpt(m_masterFd) != 0 || ::unlockpt(m_masterFd) != 0) {
+        m_lastError = QString("Failed to create pty: %1").arg(std::strerror(errno));
+        close();
+        return false;
+    }
+    const char *name = ::ptsname(m_masterFd);
+    if (!name) {
+        m_lastError = QString("ptsname failed: %1").arg(std::strerror(errno));
+        close();
+        return false;
+    }
+    m_slavePath = QString::fromLocal8Bit(name);
+
+    // 从端设为原始模式，否则行规程会改写 0x0D/0x11 等字节
+    m_slaveFd = ::open(name, O_RDWR | O_NOCTTY);
+    if (m_slaveFd < 0) {
+        m_lastError = QString("Failed to open %1: %2").arg(m_slavePath, std::strerror(errno));
+        close();
+        return false;
+    }
+    termios tio;
+    if (::tcgetattr(m_slaveFd, &tio) == 0) {
+        ::cfmakeraw(&tio);
+        ::tcsetattr(m_slaveFd, TCSANOW, &tio);
+    }
+
+    if (!m_config.linkPath.isEmpty()) {
+        const QByteArray link = m_config.linkPath.toLocal8Bit();
+        struct stat st;
+        if (::lstat(link.constData(), &st) == 0 && S_ISLNK(st.st_mode)) {
+            ::unlink(link.constData()); // 只替换旧的符号链接，不删除普通文件
+        }
+        if (::symlink(name, link.constData()) != 0) {
+            m_lastError = QString("Failed to link %1: %2").arg(m_config.linkPath, std::strerror(errno));
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AgeSimPty::close()
+{
+    if (!m_config.linkPath.isEmpty() && !m_slavePath.isEmpty()) {
+        ::unlink(m_config.linkPath.toLocal8Bit().constData());
+    }
+    if (m_slaveFd >= 0) ::close(m_slaveFd);
+    if (m_masterFd >= 0) ::close(m_masterFd);
+    m_slaveFd = -1;
+    m_masterFd = -1;
+    m_slavePath.clear();
+    m_rxLength = 0;
+}
+
+// ==========================================
+//          主循环
+// ==========================================
+
+bool AgeSimPty::serve(const std::atomic<bool> &stop)
+{
+    if (m_masterFd < 0 && !open()) return false;
+
+    // 帧间静默超时: 未完成的帧在 3.5 字符时间内没有后续字节则丢弃
+    const int gapUs = m_config.baudRate > 0 ? AgeRtu::interFrameGapUs(m_config.baudRate) : 20000;
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        pollfd pfd;
+        pfd.fd = m_masterFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        const int ready = ::poll(&pfd, 1, 5);
+        advanceAll();
+
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            m_lastError = QString("poll failed: %1").arg(std::strerror(errno));
+            return false;
+        }
+        if (ready == 0 || !(pfd.revents & POLLIN)) {
+            if (m_rxLength > 0 && nowUs() - m_lastByteUs > gapUs) {
+                m_stats.discardedBytes += m_rxLength;
+                m_rxLength = 0;
+            }
+            continue;
+        }
+
+        const ssize_t n = ::read(m_masterFd, m_rx + m_rxLength, sizeof(m_rx) - m_rxLength);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EIO) continue; // EIO: 从端暂时无人打开
+            m_lastError = QString("read failed: %1").arg(std::strerror(errno));
+            return false;
+        }
+        m_rxLength += (int)n;
+        m_lastByteUs = nowUs();
+        consume();
+    }
+    return true;
+}
+
+void AgeSimPty::advanceAll()
+{
+    const qint64 now = nowUs();
+    for (AgeDriveSim *drive : m_drives) drive->advance(now);
+}
+
+// 从接收缓冲区中切出完整帧；无法识别或 CRC 错误时丢弃首字节重新同步
+void AgeSimPty::consume()
+{
+    for (;;) {
+        const int need = AgeRtu::requestLength(m_rx, m_rxLength);
+        if (need == 0 || (need > 0 && m_rxLength < need)) {
+            if (m_rxLength == (int)sizeof(m_rx)) {
+                m_stats.discardedBytes += m_rxLength;
+                m_rxLength = 0;
+            }
+            return;
+        }
+
+        int frameLength = need;
+        if (need < 0 || need > AgeRtu::MAX_FRAME || !AgeRtu::checkCrc(m_rx, need)) {
+            if (need > 0) ++m_stats.crcErrors;
+            frameLength = 1;
+            ++m_stats.discardedBytes;
+        } else {
+            dispatch(need);
+        }
+
+        m_rxLength -= frameLength;
+        std::memmove(m_rx, m_rx + frameLength, m_rxLength);
+        if (m_rxLength == 0) return;
+    }
+}
+
+void AgeSimPty::dispatch(int length)
+{
+    ++m_stats.requests;
+    const quint8 station = m_rx[0];
+
+    if (station == 0) {
+        ++m_stats.broadcasts;
+        for (AgeDriveSim *drive : m_drives) drive->handleRequest(m_rx, length, m_tx);
+        return;
+    }
+
+    for (AgeDriveSim *drive : m_drives) {
+        if (drive->station() != station) continue;
+        const int reply = drive->handleRequest(m_rx, length, m_tx);
+        if (reply <= 0) return;
+
+        qint64 delayUs = drive->nextResponseDelayUs();
+        if (m_config.baudRate > 0) {
+            delayUs += AgeRtu::wireTimeUs(length + reply, m_config.baudRate);
+        }
+        if (delayUs > 0) std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+
+        if (writeAll(m_tx, reply)) ++m_stats.responses;
+        return;
+    }
+}
+
+bool AgeSimPty::writeAll(const quint8 *data, int length)
+{
+    int written = 0;
+    while (written < length) {
+        const ssize_t n = ::write(m_masterFd, data + written, length - written);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return false;
+        }
+        written += (int)n;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef AGESIMPTY_H
+#define AGESIMPTY_H
+
+#include <QString>
+#include <QList>
+#include <atomic>
+#include "AgeRtuFrame.h"
+
+class AgeDriveSim;
+
+// ==========================================
+//   伪终端 RTU 从站 (Linux / macOS)
+// ==========================================
+// - 创建 pty 主从对，从端路径交给 AgeRtuTransport 当作普通串口打开
+// - 按功能码确定帧长，CRC 错误时逐字节重新同步
+// - 一条总线可挂多个虚拟驱动器，按站号分发；站号 0 为广播
+// - baudRate > 0 时按线路时间延迟应答，模拟真实串口吞吐
+class AgeSimPty
+{
+public:
+    struct Config {
+        QString linkPath;          // 非空时创建指向从端的符号链接 (如 /tmp/ttyAGE0)
+        int baudRate = 0;          // 0 = 不模拟线路时间
+    };
+
+    struct Stats {
+        quint64 requests = 0;
+        quint64 responses = 0;
+        quint64 broadcasts = 0;
+        quint64 crcErrors = 0;     // 收到的请求 CRC 错误
+        quint64 discardedBytes = 0;
+    };
+
+    explicit AgeSimPty(const Config &config);
+    ~AgeSimPty();
+
+    bool open();
+    void close();
+    QString slavePath() const { return m_slavePath; }
+    QString lastError() const { return m_lastError; }
+
+    // 驱动器由调用方持有，生命周期需覆盖 serve()
+    void addDrive(AgeDriveSim *drive) { m_drives.append(drive); }
+
+    // 阻塞运行直到 stop 置位
+    bool serve(const std::atomic<bool> &stop);
+    const Stats &stats() const { return m_stats; }
+
+private:
+    void advanceAll();
+    void consume();
+    void dispatch(int length);
+    bool writeAll(const quint8 *data, int length);
+
+    Config m_config;
+    int m_masterFd = -1;
+    int m_slaveFd = -1;          // 保持打开，避免主站关闭串口时主端收到 HUP
+    QString m_slavePath;
+    QString m_lastError;
+    QList<AgeDriveSim*> m_drives;
+    Stats m_stats;
+
+    quint8 m_rx[AgeRtu::MAX_FRAME * 2];
+    int m_rxLength = 0;
+    qint64 m_lastByteUs = 0;
+    quint8 m_tx[AgeRtu::MAX_FRAME];
+};
+
+#endif // AGESIMPTY_H
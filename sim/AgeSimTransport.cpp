@@ -0,0 +1,186 @@
+#include "AgeSimTransport.h"
+#include "AgeDriveSim.h"
+#include <chrono>
+#include <thread>
+
+namespace {
+qint64 nowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+}
+
+AgeSimTransport::AgeSimTransport(const Config &config)
+    : m_config(config)
+    , m_lineBaud(config.baudRate > 0 ? (DWORD)config.baudRate : 115200)
+    , m_startUs(nowUs())
+{
+}
+
+bool AgeSimTransport::getSerialConfig(DWORD &baudRate, WORD &parity)
+{
+    baudRate = m_lineBaud;
+    parity = m_parity;
+    return true;
+}
+
+bool AgeSimTransport::setSerialConfig(DWORD baudRate, WORD parity)
+{
+    m_lineBaud = baudRate;
+    m_parity = parity;
+    if (m_config.baudRate > 0) m_config.baudRate = (int)baudRate;  // 线路时间按新波特率模拟
+    return true;
+}
+
+// 主机与驱动器波特率不一致时，驱动器只收到乱码
+bool AgeSimTransport::hears(const AgeDriveSim *drive) const
+{
+    return drive->busBaudRate() == m_lineBaud;
+}
+
+void AgeSimTransport::waitUs(qint64 us)
+{
+    if (us > 0) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+bool AgeSimTransport::getBusInfo(AgeBusInfo &info)
+{
+    info = m_busInfo;
+    info.hostRunTime = (nowUs() - m_startUs) / 1000;
+    return true;
+}
+
+// ==========================================
+//          单次事务: 编码 -> 驱动器 -> 解码
+// ==========================================
+
+bool AgeSimTransport::transact(quint8 station, quint8 function, quint16 reg, quint16 count,
+                               int txLength, quint16 *words, DWORD timeout)
+{
+    const qint64 startUs = nowUs();
+    const int baud = m_config.baudRate;
+    m_lastException = false;
+    ++m_busInfo.busOpCounts;
+    ++m_busInfo.txFrames;
+    m_busInfo.txBytes += txLength;
+
+    for (AgeDriveSim *drive : m_drives) drive->advance(startUs);
+
+    auto finish = [this, startUs](bool ok) {
+        const qint64 ms = (nowUs() - startUs) / 1000;
+        m_busInfo.lastOpTime = ms;
+        if (m_busInfo.busOpCounts == 1 || ms < m_busInfo.minOpTime) m_busInfo.minOpTime = ms;
+        if (ms > m_busInfo.maxOpTime) m_busInfo.maxOpTime = ms;
+        m_busInfo.busRunTime += ms;
+        if (!ok) ++m_busInfo.busOpErrors;
+        return ok;
+    };
+
+    // 广播或不等待应答: 所有驱动器执行，不回帧
+    if (station == 0 || timeout == TIMEOUT_NO_REPLY) {
+        for (AgeDriveSim *drive : m_drives) {
+            if ((station == 0 || drive->station() == station) && hears(drive)) drive->handleRequest(m_tx, txLength, m_rx);
+        }
+        if (baud > 0) waitUs(AgeRtu::wireTimeUs(txLength, baud));
+        return finish(true);
+    }
+
+    AgeDriveSim *target = nullptr;
+    for (AgeDriveSim *drive : m_drives) {
+        if (drive->station() == station && hears(drive)) target = drive;
+    }
+    const int rxLength = target ? target->handleRequest(m_tx, txLength, m_rx) : 0;
+    if (rxLength > 0 && m_config.maxReliableBaud > 0 && m_lineBaud > (DWORD)m_config.maxReliableBaud
+        && std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) < 0.2) {
+        m_rx[rxLength - 1] ^= 0x5A;
+    }
+    if (rxLength <= 0) {
+        if (baud > 0) waitUs((qint64)(timeout ? timeout : (DWORD)m_config.timeoutMs) * 1000);
+        m_lastError = QString("SIM timeout (station %1, reg 0x%2).").arg((int)station).arg(reg, 4, 16, QChar('0'));
+        return finish(false);
+    }
+    if (baud > 0) waitUs(target->nextResponseDelayUs() + AgeRtu::wireTimeUs(txLength + rxLength, baud));
+    ++m_busInfo.rxFrames;
+    m_busInfo.rxBytes += rxLength;
+
+    quint8 exceptionCode = 0;
+    switch (AgeRtu::decodeResponse(m_rx, rxLength, station, function, reg, count, words, &exceptionCode)) {
+    case AgeRtu::DecodeStatus::Ok:
+        return finish(true);
+    case AgeRtu::DecodeStatus::Exception:
+        m_lastError = QString("SIM exception %1 (station %2, reg 0x%3).")
+                          .arg((int)exceptionCode).arg((int)station).arg(reg, 4, 16, QChar('0'));
+        m_lastException = true;
+        return finish(false);
+    default:
+        ++m_busInfo.rxFrameErrors;
+        m_lastError = QString("SIM bad response (station %1, reg 0x%2).").arg((int)station).arg(reg, 4, 16, QChar('0'));
+        return finish(false);
+    }
+}
+
+// ==========================================
+//          寄存器读写
+// ==========================================
+
+bool AgeSimTransport::readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout)
+{
+    return readMWORD(station, reg, &data, 1, timeout);
+}
+
+bool AgeSimTransport::readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout)
+{
+    WORD w[2];
+    if (!readMWORD(station, reg, w, 2, timeout)) return false;
+    data = (DWORD)AgeRtu::unpackU32(w);
+    return true;
+}
+
+bool AgeSimTransport::readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout)
+{
+    WORD w[4];
+    if (!readMWORD(station, reg, w, 4, timeout)) return false;
+    data = (QWORD)AgeRtu::unpackU64(w);
+    return true;
+}
+
+bool AgeSimTransport::readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout)
+{
+    if (count == 0 || count > MAX_READ_WORDS || station == 0) {
+        m_lastError = QString("Invalid read (station %1, count %2).").arg((int)station).arg(count);
+        return false;
+    }
+    const int len = AgeRtu::encodeReadRequest(m_tx, station, reg, count);
+    return transact(station, AgeRtu::FC_READ_HOLDING, reg, count, len, data, timeout);
+}
+
+bool AgeSimTransport::writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout)
+{
+    const int len = AgeRtu::encodeWriteSingleRequest(m_tx, station, reg, data);
+    return transact(station, AgeRtu::FC_WRITE_SINGLE, reg, 1, len, nullptr, timeout);
+}
+
+bool AgeSimTransport::writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout)
+{
+    WORD w[2];
+    AgeRtu::packU32((quint32)data, w);
+    return writeMWORD(station, reg, w, 2, timeout);
+}
+
+bool AgeSimTransport::writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout)
+{
+    WORD w[4];
+    AgeRtu::packU64((quint64)data, w);
+    return writeMWORD(station, reg, w, 4, timeout);
+}
+
+bool AgeSimTransport::writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout)
+{
+    if (count == 0 || count > MAX_WRITE_WORDS) {
+        m_lastError = QString("Invalid write length %1.").arg(count);
+        return false;
+    }
+    const int len = AgeRtu::encodeWriteMultipleRequest(m_tx, station, reg, data, count);
+    return transact(station, AgeRtu::FC_WRITE_MULTIPLE, reg, count, len, nullptr, timeout);
+}
@@ -0,0 +1,72 @@
+#ifndef AGESIMTRANSPORT_H
+#define AGESIMTRANSPORT_H
+
+#include <QList>
+#include <random>
+#include "AgeTransport.h"
+#include "AgeRtuFrame.h"
+
+class AgeDriveSim;
+
+// ==========================================
+//   进程内模拟总线 (不经过串口/伪终端)
+// ==========================================
+// - 请求按 RTU 帧编码后直接交给 AgeDriveSim，应答按同一套解码器校验，
+//   因此驱动层走的代码路径与 AgeRtuTransport 相同
+// - baudRate > 0 时按线路时间 (请求 + 应答) 和驱动器应答延迟真实等待，
+//   baudRate = 0 时不等待，只测主机侧开销
+// - 主机波特率 (setSerialConfig，初始为 baudRate 或 115200) 与驱动器 ADDR_BUS_BAUD 不同时
+//   该驱动器收不到请求 (主站超时)
+// - 驱动器由调用方持有；仅在一个线程中使用
+class AgeSimTransport : public AgeTransport
+{
+public:
+    struct Config {
+        int baudRate = 0;            // 0 = 不模拟线路时间
+        int timeoutMs = 50;          // 丢帧时的等待时间 (仅 baudRate > 0 时等待)
+        int maxReliableBaud = 0;     // 0 = 不限; 主机波特率高于此值时应答按 20% 概率损坏 (线缆/收发器极限)
+    };
+
+    explicit AgeSimTransport(const Config &config);
+
+    void addDrive(AgeDriveSim *drive) { m_drives.append(drive); }
+
+    bool open() override { return true; }
+    void close() override {}
+    bool isValid(bool autoConnect) override { Q_UNUSED(autoConnect); return true; }
+
+    bool readWORD(BYTE station, WORD reg, WORD &data, DWORD timeout) override;
+    bool readDWORD(BYTE station, WORD reg, DWORD &data, DWORD timeout) override;
+    bool readQWORD(BYTE station, WORD reg, QWORD &data, DWORD timeout) override;
+    bool readMWORD(BYTE station, WORD reg, WORD *data, WORD count, DWORD timeout) override;
+
+    bool writeWORD(BYTE station, WORD reg, WORD data, DWORD timeout) override;
+    bool writeDWORD(BYTE station, WORD reg, DWORD data, DWORD timeout) override;
+    bool writeQWORD(BYTE station, WORD reg, QWORD data, DWORD timeout) override;
+    bool writeMWORD(BYTE station, WORD reg, const WORD *data, WORD count, DWORD timeout) override;
+
+    QString name() const override { return "SIM"; }
+    bool getBusInfo(AgeBusInfo &info) override;
+    bool getSerialConfig(DWORD &baudRate, WORD &parity) override;
+    bool setSerialConfig(DWORD baudRate, WORD parity) override;
+
+private:
+    bool transact(quint8 station, quint8 function, quint16 reg, quint16 count,
+                  int txLength, quint16 *words, DWORD timeout);
+    void waitUs(qint64 us);
+
+    bool hears(const AgeDriveSim *drive) const;
+
+    Config m_config;
+    QList<AgeDriveSim *> m_drives;
+    DWORD m_lineBaud = 115200;
+    WORD m_parity = 2;
+    std::mt19937 m_rng;
+    AgeBusInfo m_busInfo;
+    qint64 m_startUs = 0;
+
+    quint8 m_tx[AgeRtu::MAX_FRAME];
+    quint8 m_rx[AgeRtu::MAX_FRAME];
+};
+
+#endif // AGESIMTRANSPORT_H
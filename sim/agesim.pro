@@ -0,0 +1,21 @@
+QT       = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = agesim
+
+# 仅支持 Linux / macOS (依赖 POSIX 伪终端)
+win32: error("agesim requires a POSIX pseudo terminal (Linux/macOS).")
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    AgeDriveSim.cpp \
+    AgeSimPty.cpp \
+    main.cpp
+
+HEADERS += \
+    ../AgeRtuFrame.h \
+    AgeDriveSim.h \
+    AgeSimPty.h
@@ -0,0 +1,100 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QStringList>
+#include <atomic>
+#include <csignal>
+#include <memory>
+#include <vector>
+#include "AgeDriveSim.h"
+#include "AgeSimPty.h"
+
+// ==========================================
+//   agesim: 虚拟 ASD90XX 驱动器 (无需硬件)
+// ==========================================
+// 用法示例:
+//   agesim --link /tmp/ttyAGE0 --stations 1,2 --latency-us 500 --drop-rate 0.01
+//   AGEMOTION_TRANSPORT=rtu AGEMOTION_PORT=/tmp/ttyAGE0 ./AutoFocus
+
+namespace {
+std::atomic<bool> g_stop(false);
+
+void onSignal(int)
+{
+    g_stop.store(true);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("agesim");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Virtual ASD90XX drive on a pseudo terminal (Modbus RTU).");
+    parser.addHelpOption();
+
+    QCommandLineOption linkOpt("link", "Create a symlink to the pty slave.", "path");
+    QCommandLineOption stationsOpt("stations", "Comma separated station ids.", "list", "1");
+    QCommandLineOption baudOpt("baud", "Emulate wire time at this baud rate (0 = off).", "baud", "0");
+    QCommandLineOption latencyOpt("latency-us", "Fixed response latency.", "us", "0");
+    QCommandLineOption jitterOpt("jitter-us", "Random extra latency 0..N.", "us", "0");
+    QCommandLineOption dropOpt("drop-rate", "Probability of not answering a request.", "p", "0");
+    QCommandLineOption crcOpt("crc-error-rate", "Probability of a corrupted response CRC.", "p", "0");
+    QCommandLineOption exceptionOpt("exception-rate", "Probability of a device-failure exception.", "p", "0");
+    QCommandLineOption errorOpt("error-code", "Initial value of the fault register (0x0002).", "code", "0");
+    QCommandLineOption freeOpt("free-blocks-motion", "Treat control bit 0x0004 as 'Free' (motor released).");
+    parser.addOptions({linkOpt, stationsOpt, baudOpt, latencyOpt, jitterOpt, dropOpt,
+                       crcOpt, exceptionOpt, errorOpt, freeOpt});
+    parser.process(app);
+
+    AgeDriveSim::Faults faults;
+    faults.latencyUs = parser.value(latencyOpt).toInt();
+    faults.jitterUs = parser.value(jitterOpt).toInt();
+    faults.dropRate = parser.value(dropOpt).toDouble();
+    faults.crcErrorRate = parser.value(crcOpt).toDouble();
+    faults.exceptionRate = parser.value(exceptionOpt).toDouble();
+    const quint16 errorCode = (quint16)parser.value(errorOpt).toUInt(nullptr, 0);
+
+    AgeSimPty::Config config;
+    config.linkPath = parser.value(linkOpt);
+    config.baudRate = parser.value(baudOpt).toInt();
+    AgeSimPty pty(config);
+
+    std::vector<std::unique_ptr<AgeDriveSim>> drives;
+    const QStringList stations = parser.value(stationsOpt).split(',', Qt::SkipEmptyParts);
+    for (const QString &s : stations) {
+        bool ok = false;
+        const int station = s.trimmed().toInt(&ok);
+        if (!ok || station < 1 || station > 247) {
+            qCritical() << "Invalid station id:" << s;
+            return 1;
+        }
+        drives.emplace_back(new AgeDriveSim((quint8)station));
+        drives.back()->setFaults(faults);
+        drives.back()->setFreeBitBlocksMotion(parser.isSet(freeOpt));
+        if (errorCode) drives.back()->injectError(errorCode);
+        pty.addDrive(drives.back().get());
+    }
+
+    if (!pty.open()) {
+        qCritical() << pty.lastError();
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    qInfo().noquote() << "agesim listening on" << pty.slavePath()
+                      << (config.linkPath.isEmpty() ? QString() : "(" + config.linkPath + ")")
+                      << "stations" << parser.value(stationsOpt);
+
+    const bool ok = pty.serve(g_stop);
+    if (!ok) qCritical() << pty.lastError();
+
+    const AgeSimPty::Stats &st = pty.stats();
+    qInfo() << "requests" << st.requests << "responses" << st.responses
+            << "broadcasts" << st.broadcasts << "crcErrors" << st.crcErrors
+            << "discardedBytes" << st.discardedBytes;
+    return ok ? 0 : 1;
+}